@@ -26,6 +26,11 @@
 #include "cplus_semaphore.h"
 #include "cplus_task.h"
 #include "cplus_taskpool.h"
+#include "cplus_taskgraph.h"
+#include "cplus_parallel.h"
+#include "cplus_timerwheel.h"
+#include "cplus_fiber.h"
+#include "cplus_strand.h"
 #include "cplus_syslog.h"
 #include "cplus_socket.h"
 #include "cplus_ipc_server.h"
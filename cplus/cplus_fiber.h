@@ -0,0 +1,24 @@
+#ifndef __CPLUS_FIBER_H__
+#define __CPLUS_FIBER_H__
+#include "cplus_typedef.h"
+#include "cplus_task.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+cplus_fiberpool cplus_fiberpool_new(cplus_taskpool pool, uint32_t max_fiber_count, uint32_t stack_size);
+int32_t cplus_fiberpool_delete(cplus_fiberpool obj);
+bool cplus_fiberpool_check(cplus_object obj);
+int32_t cplus_fiberpool_spawn(cplus_fiberpool obj, CPLUS_TASK_PROC proc, void * param1, void * param2);
+uint32_t cplus_fiberpool_get_fiber_count(cplus_fiberpool obj);
+int32_t cplus_fiberpool_wait_all(cplus_fiberpool obj, uint32_t timeout);
+bool cplus_fiber_is_running(void);
+int32_t cplus_fiber_yield(void);
+int32_t cplus_fiber_wait_fd(int32_t fd, bool for_write, uint32_t timeout);
+int32_t cplus_fiber_sleep_msec(uint32_t msec);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __CPLUS_FIBER_H__
@@ -6,22 +6,126 @@
 extern "C" {
 #endif
 
+#define CPLUS_IPC_HISTOGRAM_BUCKETS 32U
+
+typedef struct cplus_ipc_histogram
+{
+    uint64_t count;
+    uint64_t total_nsec;
+    uint64_t max_nsec;
+    uint64_t buckets[CPLUS_IPC_HISTOGRAM_BUCKETS]; // bucket 0 is below 1 usec, bucket N is [2^(N-1), 2^N) usec
+} *CPLUS_IPC_HISTOGRAM, CPLUS_IPC_HISTOGRAM_T;
+
+typedef struct cplus_ipc_conn_stats
+{
+    cplus_socket conn_sock;
+    uint64_t bytes_received; // payload bytes, whichever transport carried them
+    uint64_t bytes_sent;
+    uint64_t messages_received;
+    uint64_t messages_sent;
+    uint32_t queued_bytes; // accepted for sending but not written to the socket yet
+    uint32_t inflight_count; // handler_pool only, packets not answered yet
+    uint32_t last_active_tick; // cplus_systime_get_tick() of the last message either way
+    bool is_slow;
+    CPLUS_IPC_HISTOGRAM_T request_time; // from the arrival of a request to its answer being sent
+} *CPLUS_IPC_CONN_STATS, CPLUS_IPC_CONN_STATS_T;
+
+typedef struct cplus_ipc_server_stats
+{
+    uint32_t conn_count;
+    uint32_t slow_conn_count;
+    uint32_t queued_bytes; // over the open connections
+    uint64_t accepted_count;
+    uint64_t slow_count; // times a connection turned slow
+    uint64_t bytes_received; // these and the request times include the connections closed already
+    uint64_t bytes_sent;
+    uint64_t messages_received;
+    uint64_t messages_sent;
+    CPLUS_IPC_HISTOGRAM_T request_time;
+} *CPLUS_IPC_SERVER_STATS, CPLUS_IPC_SERVER_STATS_T;
+
 typedef int32_t (* CPLUS_IPC_CB_ON_CONNECTED)(cplus_socket conn_sock);
 typedef int32_t (* CPLUS_IPC_CB_ON_ERROR)(cplus_socket conn_sock, int32_t sock_errno);
 typedef int32_t (* CPLUS_IPC_CB_ON_DISCONNECTED)(cplus_socket conn_sock);
+// 'input_bufs' points into the connection's receive buffer or a read-only mapping, copy it out to keep it past the callback.
 typedef int32_t (* CPLUS_IPC_CB_ON_RECEIVED)\
     (cplus_socket conn_sock, uint32_t input_bufs_len, void * input_bufs, uint32_t * output_bufs_len, void * output_bufs);
 
+// 'status' is CPLUS_SUCCESS or the errno value the request failed with, 'output_bufs' is only valid during the callback.
+typedef void (* CPLUS_IPC_CB_ON_COMPLETED)\
+    (cplus_ipc_client clt, uint32_t request_id, int32_t status, uint32_t output_bufs_len, void * output_bufs, void * arg);
+
+// Called once per chunk in order, then once with 'is_end' set and no data. Failing aborts the stream, the sender
+// learns about it from its next append or the end. A stream cut short by a disconnect never sees its end.
+typedef int32_t (* CPLUS_IPC_CB_ON_STREAM_CHUNK)\
+    (cplus_socket conn_sock, uint32_t stream_id, uint64_t offset, uint32_t chunk_len, void * chunk_bufs, bool is_end);
+
+// 'topic' and 'data' are only valid during the callback.
+typedef void (* CPLUS_IPC_CB_ON_PUBLISHED)\
+    (cplus_socket conn_sock, const char * topic, uint32_t data_len, void * data);
+
+// Called on the connection's own thread as it turns slow, and not again before it has recovered.
+typedef void (* CPLUS_IPC_CB_ON_SLOW_CONSUMER)(cplus_socket conn_sock, CPLUS_IPC_CONN_STATS stats);
+
 typedef struct cplus_ipc_cb_funcs
 {
     CPLUS_IPC_CB_ON_CONNECTED on_connected;
     CPLUS_IPC_CB_ON_ERROR on_error;
     CPLUS_IPC_CB_ON_DISCONNECTED on_disconnected;
     CPLUS_IPC_CB_ON_RECEIVED on_received;
+    CPLUS_IPC_CB_ON_STREAM_CHUNK on_stream_chunk; // server only, accepts streams from clients when set
+    CPLUS_IPC_CB_ON_PUBLISHED on_published; // client only, receives what is published to its subscriptions
+    CPLUS_IPC_CB_ON_SLOW_CONSUMER on_slow_consumer; // server only, see the slow_* limits of the server config
 } *CPLUS_IPC_CB_FUNCS, CPLUS_IPC_CB_FUNCS_T;
 
+typedef enum cplus_ipc_slow_subscriber_policy
+{
+    CPLUS_IPC_SLOW_SUBSCRIBER_POLICY_DROP       = 0, // skip whole messages until the subscriber catches up
+    CPLUS_IPC_SLOW_SUBSCRIBER_POLICY_DISCONNECT = 1, // drop the connection of a subscriber which falls behind
+} CPLUS_IPC_SLOW_SUBSCRIBER_POLICY;
+
+#define CPLUS_IPC_SERVER_MAX_REACTOR_COUNT 16U
+#define CPLUS_IPC_CLIENT_MAX_INFLIGHT_COUNT 256U
+#define CPLUS_IPC_CLIENT_MAX_SHM_RING_SIZE (256U * 1024U * 1024U)
+#define CPLUS_IPC_STREAM_CREDIT_WINDOW 16U
+#define CPLUS_IPC_CLIENT_MAX_ONEWAY_BATCH_SIZE (1024U * 1024U)
+#define CPLUS_IPC_SERVER_DEFAULT_MAX_INFLIGHT_PER_CONN 16U
+#define CPLUS_IPC_SERVER_DEFAULT_PUBLISH_BACKLOG (256U * 1024U)
+#define CPLUS_IPC_MAX_TOPIC_SIZE 64U
+#define CPLUS_IPC_MAX_SUBSCRIPTIONS 16U
+
+typedef struct cplus_ipc_server_config
+{
+    const char * name;
+    uint32_t max_connection;
+    CPLUS_IPC_CB_FUNCS cb_funcs;
+    uint32_t reactor_count; // 0 serves every connection on its own task, otherwise on this many shared epoll threads
+    cplus_taskpool dispatch_pool; // reactor mode only, runs the callbacks on this pool instead of the reactor threads
+    uint32_t memfd_threshold; // 0 keeps to the socket, otherwise responses of this size and up are passed in a sealed memfd
+    cplus_taskpool handler_pool; // runs on_received on this pool, a connection's packets overlap but are answered in order
+    uint32_t max_inflight_per_conn; // handler_pool only, a connection is not read on with this many unanswered packets, 0 for the default
+    uint32_t publish_backlog; // bytes of published messages a subscriber may fall behind by, 0 for the default
+    CPLUS_IPC_SLOW_SUBSCRIBER_POLICY slow_subscriber_policy; // what happens to a subscriber beyond its backlog
+    uint32_t slow_queued_bytes; // 0 for no limit, a connection with more bytes waiting to be written is slow
+    uint32_t slow_request_msec; // 0 for no limit, a connection whose last request took longer is slow
+    bool is_seqpacket; // SOCK_SEQPACKET instead of a byte stream, one datagram per message, clients must match
+} *CPLUS_IPC_SERVER_CONFIG, CPLUS_IPC_SERVER_CONFIG_T;
+
+typedef struct cplus_ipc_client_config
+{
+    const char * name;
+    CPLUS_IPC_CB_FUNCS cb_funcs;
+    uint32_t shm_ring_size; // 0 keeps to the socket, otherwise frames from 4 KB up go through a shared memory ring of this size each way
+    uint32_t memfd_threshold; // 0 keeps to the socket, otherwise requests of this size and up are passed in a sealed memfd
+    uint32_t oneway_batch_size; // 0 writes every oneway at once, otherwise oneways are coalesced into frames of up to this many bytes
+    uint32_t oneway_linger; // msec the first batched oneway waits for company, 0 leaves it to a full batch or an explicit flush
+    bool is_seqpacket; // must match the server, payloads too large for a datagram are passed in a sealed memfd
+} *CPLUS_IPC_CLIENT_CONFIG, CPLUS_IPC_CLIENT_CONFIG_T;
+
 cplus_ipc_server cplus_ipc_server_new(const char * name, uint32_t max_connection, CPLUS_IPC_CB_FUNCS cb_funcs);
+cplus_ipc_server cplus_ipc_server_new_ex(CPLUS_IPC_SERVER_CONFIG config);
 cplus_ipc_client cplus_ipc_client_new(const char * name, CPLUS_IPC_CB_FUNCS cb_funcs);
+cplus_ipc_client cplus_ipc_client_new_ex(CPLUS_IPC_CLIENT_CONFIG config);
 int32_t cplus_ipc_server_delete(cplus_ipc_server obj);
 int32_t cplus_ipc_client_delete(cplus_ipc_client obj);
 bool cplus_ipc_server_check(cplus_object obj);
@@ -29,7 +133,25 @@ bool cplus_ipc_client_check(cplus_object obj);
 int32_t cplus_ipc_client_send_request(cplus_ipc_client obj, uint32_t input_bufs_len, void * input_bufs
     , uint32_t output_bufs_len, void * output_bufs, uint32_t timeout);
 int32_t cplus_ipc_client_send_oneway(cplus_ipc_client obj, uint32_t input_bufs_len, void * input_bufs);
+int32_t cplus_ipc_client_flush_oneway(cplus_ipc_client obj);
 int32_t cplus_ipc_client_send_heartbeat(cplus_ipc_client obj, uint32_t timeout);
+int32_t cplus_ipc_client_send_request_async(cplus_ipc_client obj, uint32_t input_bufs_len, void * input_bufs
+    , CPLUS_IPC_CB_ON_COMPLETED on_completed, void * arg, uint32_t timeout, uint32_t * request_id);
+uint32_t cplus_ipc_client_get_inflight_count(cplus_ipc_client obj);
+int32_t cplus_ipc_client_wait_requests(cplus_ipc_client obj, uint32_t timeout);
+bool cplus_ipc_client_is_shm_attached(cplus_ipc_client obj);
+// One stream per client at a time, driven from one thread. Up to CPLUS_IPC_STREAM_CREDIT_WINDOW chunks are in flight.
+int32_t cplus_ipc_client_stream_begin(cplus_ipc_client obj, uint32_t timeout, uint32_t * stream_id);
+int32_t cplus_ipc_client_stream_append(cplus_ipc_client obj, uint32_t chunk_len, void * chunk_bufs, uint32_t timeout);
+int32_t cplus_ipc_client_stream_end(cplus_ipc_client obj, uint32_t timeout);
+// Returns how many subscribers took the message, a topic holds up to CPLUS_IPC_MAX_TOPIC_SIZE - 1 characters.
+int32_t cplus_ipc_server_publish(cplus_ipc_server obj, const char * topic, uint32_t data_len, void * data);
+// Asynchronous clients with on_published only, up to CPLUS_IPC_MAX_SUBSCRIPTIONS topics each.
+int32_t cplus_ipc_client_subscribe(cplus_ipc_client obj, const char * topic, uint32_t timeout);
+int32_t cplus_ipc_client_unsubscribe(cplus_ipc_client obj, const char * topic, uint32_t timeout);
+int32_t cplus_ipc_server_get_stats(cplus_ipc_server obj, CPLUS_IPC_SERVER_STATS stats);
+// Returns how many of the open connections were written to 'stats', at most 'max_count'.
+int32_t cplus_ipc_server_get_conn_stats(cplus_ipc_server obj, uint32_t max_count, CPLUS_IPC_CONN_STATS stats);
 
 #ifdef __cplusplus
 }
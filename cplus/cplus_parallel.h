@@ -0,0 +1,21 @@
+#ifndef __CPLUS_PARALLEL_H__
+#define __CPLUS_PARALLEL_H__
+#include "cplus_typedef.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (* CPLUS_PARALLEL_FOR_PROC)(uint64_t begin, uint64_t end, void * ctx);
+typedef void (* CPLUS_PARALLEL_REDUCE_PROC)(uint64_t begin, uint64_t end, void * ctx, void * partial);
+typedef void (* CPLUS_PARALLEL_JOIN_PROC)(void * result, void * partial, void * ctx);
+
+int32_t cplus_parallel_for(cplus_taskpool pool, uint64_t begin, uint64_t end, uint64_t grain
+    , CPLUS_PARALLEL_FOR_PROC fn, void * ctx);
+int32_t cplus_parallel_reduce(cplus_taskpool pool, uint64_t begin, uint64_t end, uint64_t grain
+    , CPLUS_PARALLEL_REDUCE_PROC fn, CPLUS_PARALLEL_JOIN_PROC join, void * ctx, void * result, uint32_t result_size);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __CPLUS_PARALLEL_H__
@@ -1,5 +1,7 @@
 #ifndef __CPLUS_SOCKET_H__
 #define __CPLUS_SOCKET_H__
+#include <sys/uio.h>
+#include <sys/socket.h>
 #include "cplus_typedef.h"
 
 #ifdef __cplusplus
@@ -27,6 +29,7 @@ typedef enum cplus_socket_style
 {
     CPLUS_SOCKET_STYLE_STREAM,
     CPLUS_SOCKET_STYLE_DGRAM,
+    CPLUS_SOCKET_STYLE_SEQPACKET,
     CPLUS_SOCKET_STYLE_UNKNOWN,
 }CPLUS_SOCKET_STYLE;
 
@@ -47,6 +50,7 @@ typedef enum cplus_socket_type
     CPLUS_SOCKET_TYPE_STREAM_LOCAL,
     CPLUS_SOCKET_TYPE_DGRAM_LOCAL,
     CPLUS_SOCKET_TYPE_DUEL_STACK,
+    CPLUS_SOCKET_TYPE_SEQPACKET_LOCAL,
     CPLUS_SOCKET_TYPE_UNKNOWN,
 }CPLUS_SOCKET_TYPE;
 
@@ -66,7 +70,13 @@ int32_t cplus_socket_recvfrom(
 int32_t cplus_socket_recv(cplus_socket obj, void * data_bufs, int32_t data_len, uint32_t timeout);
 int32_t cplus_socket_sendto(cplus_socket obj, void * data_bufs, int32_t data_len, const char * addr, int32_t port);
 int32_t cplus_socket_send(cplus_socket obj, void * data_bufs, int32_t data_len);
+int32_t cplus_socket_sendv(cplus_socket obj, const struct iovec * iov, int32_t iov_count);
+int32_t cplus_socket_recvv(cplus_socket obj, struct iovec * iov, int32_t iov_count, uint32_t timeout);
+int32_t cplus_socket_sendv_fd(cplus_socket obj, const struct iovec * iov, int32_t iov_count, int32_t sendfd);
+int32_t cplus_socket_recvmsg(cplus_socket obj, struct msghdr * msg, int32_t flags, uint32_t timeout);
 int32_t cplus_socket_setopt_reuse_addr(cplus_socket obj, bool enable_reuse_addr);
+int32_t cplus_socket_setopt_nonblock(cplus_socket obj, bool enable_nonblock);
+int32_t cplus_socket_get_fd(cplus_socket obj);
 int32_t cplus_socket_recv_fd(cplus_socket obj, int32_t * recvfd, uint32_t timeout);
 int32_t cplus_socket_send_fd(cplus_socket obj, int32_t sendfd, const char * addr, int32_t port);
 
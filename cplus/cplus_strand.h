@@ -0,0 +1,21 @@
+#ifndef __CPLUS_STRAND_H__
+#define __CPLUS_STRAND_H__
+#include "cplus_typedef.h"
+#include "cplus_task.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+cplus_strand cplus_strand_new(cplus_taskpool pool, uint32_t max_task_count);
+int32_t cplus_strand_delete(cplus_strand obj);
+bool cplus_strand_check(cplus_object obj);
+int32_t cplus_strand_post(cplus_strand obj, CPLUS_TASK_PROC proc, void * param1, void * param2);
+uint32_t cplus_strand_get_task_count(cplus_strand obj);
+int32_t cplus_strand_wait_idle(cplus_strand obj, uint32_t timeout);
+bool cplus_strand_is_running_in_this_thread(cplus_strand obj);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __CPLUS_STRAND_H__
@@ -7,6 +7,14 @@ extern "C" {
 #endif
 typedef void (* CPLUS_TASK_PROC) (void * param1, void * param2);
 
+typedef enum cplus_task_sched_policy
+{
+    CPLUS_TASK_SCHED_POLICY_DEFAULT = 0,
+    CPLUS_TASK_SCHED_POLICY_FIFO,
+    CPLUS_TASK_SCHED_POLICY_RR,
+    CPLUS_TASK_SCHED_POLICY_MAX,
+} CPLUS_TASK_SCHED_POLICY;
+
 typedef struct cplus_task_config
 {
     CPLUS_TASK_PROC proc;
@@ -16,8 +24,40 @@ typedef struct cplus_task_config
     uint32_t duration;
     bool suspend;
     uint32_t stacksize;
+    uint64_t cpu_mask; // bit N allows CPU N, 0 inherits the affinity of the creator
+    CPLUS_TASK_SCHED_POLICY sched_policy;
+    int32_t sched_priority; // only used by FIFO and RR
+    uint32_t period_usec; // non-zero runs proc on absolute deadlines of this period, duration is then ignored
+    bool collect_stats; // per-iteration timing for cplus_task_get_stats()
 } *CPLUS_TASK_CONFIG, CPLUS_TASK_CONFIG_T;
 
+typedef struct cplus_task_time_stats
+{
+    uint64_t min_nsec;
+    uint64_t avg_nsec;
+    uint64_t max_nsec;
+    uint64_t p99_nsec; // upper bound of its histogram bucket, within 1/8 of the real value
+} *CPLUS_TASK_TIME_STATS, CPLUS_TASK_TIME_STATS_T;
+
+typedef struct cplus_task_stats
+{
+    uint64_t iteration_count;
+    uint64_t total_wall_nsec;
+    uint64_t total_cpu_nsec;
+    CPLUS_TASK_TIME_STATS_T wall_time; // of proc
+    CPLUS_TASK_TIME_STATS_T cpu_time; // of proc, CLOCK_THREAD_CPUTIME_ID
+    CPLUS_TASK_TIME_STATS_T wakeup_latency; // start of an iteration against its scheduled time
+} *CPLUS_TASK_STATS, CPLUS_TASK_STATS_T;
+
+typedef struct cplus_task_period_stats
+{
+    uint64_t iteration_count;
+    uint64_t overrun_count; // iterations which ended past the next deadline
+    uint64_t missed_count; // whole periods skipped to catch up after overruns
+    uint64_t max_jitter_nsec; // worst wake-up lateness against the deadline
+    uint64_t avg_jitter_nsec;
+} *CPLUS_TASK_PERIOD_STATS, CPLUS_TASK_PERIOD_STATS_T;
+
 cplus_task cplus_task_oneshot(CPLUS_TASK_PROC proc, void * param1, void * param2);
 cplus_task cplus_task_oneshot_ex(CPLUS_TASK_PROC proc, void * param1, void * param2, CPLUS_TASK_PROC callback);
 cplus_task cplus_task_new(CPLUS_TASK_PROC proc, void * param1, void * param2, uint32_t duration);
@@ -38,6 +78,8 @@ uint32_t cplus_task_get_loop_duration(void);
 int32_t cplus_task_set_loop_finish(void);
 int32_t cplus_task_reset_loop_finish(void);
 uint32_t cplus_task_get_loop_last_timestamp(void);
+int32_t cplus_task_get_period_stats(cplus_task obj, CPLUS_TASK_PERIOD_STATS stats);
+int32_t cplus_task_get_stats(cplus_task obj, CPLUS_TASK_STATS stats);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,22 @@
+#ifndef __CPLUS_TASKGRAPH_H__
+#define __CPLUS_TASKGRAPH_H__
+#include "cplus_typedef.h"
+#include "cplus_task.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+cplus_taskgraph cplus_taskgraph_new(cplus_taskpool pool, uint32_t max_node_count);
+int32_t cplus_taskgraph_delete(cplus_taskgraph obj);
+bool cplus_taskgraph_check(cplus_object obj);
+int32_t cplus_taskgraph_add_node(cplus_taskgraph obj, CPLUS_TASK_PROC proc, void * param1, void * param2);
+int32_t cplus_taskgraph_add_edge(cplus_taskgraph obj, int32_t predecessor, int32_t successor);
+uint32_t cplus_taskgraph_get_node_count(cplus_taskgraph obj);
+int32_t cplus_taskgraph_submit(cplus_taskgraph obj);
+int32_t cplus_taskgraph_wait(cplus_taskgraph obj, uint32_t timeout);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __CPLUS_TASKGRAPH_H__
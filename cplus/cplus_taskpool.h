@@ -6,12 +6,27 @@
 extern "C" {
 #endif
 
+typedef enum cplus_taskpool_affinity
+{
+    CPLUS_TASKPOOL_AFFINITY_NONE = 0, // every worker may run on any CPU of cpu_mask
+    CPLUS_TASKPOOL_AFFINITY_COMPACT, // workers pinned to neighbouring CPUs of cpu_mask
+    CPLUS_TASKPOOL_AFFINITY_SCATTER, // workers pinned as far apart as possible in cpu_mask
+    CPLUS_TASKPOOL_AFFINITY_EXPLICIT, // worker N pinned to cpu_list[N % cpu_list_count]
+    CPLUS_TASKPOOL_AFFINITY_MAX,
+} CPLUS_TASKPOOL_AFFINITY;
+
 typedef struct cplus_taskpool_config
 {
     uint32_t worker_count;
     uint32_t max_task_count;
     uint32_t stack_size;
     bool get_task_cycling;
+    uint64_t cpu_mask; // 0 means the affinity of the creator
+    CPLUS_TASKPOOL_AFFINITY affinity;
+    const uint32_t * cpu_list;
+    uint32_t cpu_list_count;
+    CPLUS_TASK_SCHED_POLICY sched_policy;
+    int32_t sched_priority;
 } *CPLUS_TASKPOOL_CONFIG, CPLUS_TASKPOOL_CONFIG_T;
 
 typedef struct cplus_taskpool_task
@@ -22,6 +37,41 @@ typedef struct cplus_taskpool_task
     CPLUS_TASK_PROC callback;
 } *CPLUS_TASKPOOL_TASK, CPLUS_TASKPOOL_TASK_T;
 
+#define CPLUS_TASKPOOL_MAX_WORKER_COUNT 32U
+#define CPLUS_TASKPOOL_HISTOGRAM_BUCKETS 32U
+
+typedef struct cplus_taskpool_histogram
+{
+    uint64_t count;
+    uint64_t total_nsec;
+    uint64_t max_nsec;
+    uint64_t buckets[CPLUS_TASKPOOL_HISTOGRAM_BUCKETS]; // bucket 0 is below 1 usec, bucket N is [2^(N-1), 2^N) usec
+} *CPLUS_TASKPOOL_HISTOGRAM, CPLUS_TASKPOOL_HISTOGRAM_T;
+
+typedef struct cplus_taskpool_worker_stats
+{
+    uint32_t slot;
+    uint64_t executed_count;
+    uint64_t busy_nsec; // spent in proc and callback
+    uint64_t idle_nsec; // spent parked without a task
+} *CPLUS_TASKPOOL_WORKER_STATS, CPLUS_TASKPOOL_WORKER_STATS_T;
+
+typedef struct cplus_taskpool_stats
+{
+    uint64_t submitted_count;
+    uint64_t rejected_count; // submissions refused because the task list was full
+    uint64_t executed_count;
+    uint32_t queued_count;
+    uint32_t max_queued_count;
+    uint64_t busy_nsec; // sum over the workers, including the retired ones
+    uint64_t idle_nsec;
+    CPLUS_TASKPOOL_HISTOGRAM_T wait_time; // from the submission to the start of proc
+    CPLUS_TASKPOOL_HISTOGRAM_T run_time;
+    CPLUS_TASKPOOL_HISTOGRAM_T callback_time;
+    uint32_t worker_count;
+    CPLUS_TASKPOOL_WORKER_STATS_T workers[CPLUS_TASKPOOL_MAX_WORKER_COUNT];
+} *CPLUS_TASKPOOL_STATS, CPLUS_TASKPOOL_STATS_T;
+
 cplus_taskpool cplus_taskpool_new(uint32_t worker_count);
 cplus_taskpool cplus_taskpool_new_ex(CPLUS_TASKPOOL_CONFIG config);
 int32_t cplus_taskpool_delete(cplus_taskpool obj);
@@ -29,12 +79,15 @@ int32_t cplus_taskpool_delete_ex(cplus_taskpool obj, uint32_t timeout);
 bool cplus_taskpool_check(cplus_object obj);
 int32_t cplus_taskpool_add_task_ex(cplus_taskpool obj, CPLUS_TASKPOOL_TASK task);
 int32_t cplus_taskpool_add_task(cplus_taskpool obj, CPLUS_TASK_PROC proc, void * param1);
+int32_t cplus_taskpool_add_tasks(cplus_taskpool obj, uint32_t count, CPLUS_TASKPOOL_TASK tasks);
 int32_t cplus_taskpool_remove_task(cplus_taskpool obj, int32_t (* comparator)(void * data, void * arg), void * arg);
 uint32_t cplus_taskpool_get_worker_count(cplus_taskpool obj);
 int32_t cplus_taskpool_reset_worker_count(cplus_taskpool obj, uint32_t worker_count);
 uint32_t cplus_taskpool_get_task_count(cplus_taskpool obj);
 int32_t cplus_taskpool_all_pause(cplus_taskpool obj, bool pause);
 int32_t cplus_taskpool_clear_task(cplus_taskpool obj);
+int32_t cplus_taskpool_get_stats(cplus_taskpool obj, CPLUS_TASKPOOL_STATS stats);
+int32_t cplus_taskpool_reset_stats(cplus_taskpool obj);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,20 @@
+#ifndef __CPLUS_TIMERWHEEL_H__
+#define __CPLUS_TIMERWHEEL_H__
+#include "cplus_typedef.h"
+#include "cplus_task.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+cplus_timerwheel cplus_timerwheel_new(uint32_t max_timer_count, cplus_taskpool pool);
+int32_t cplus_timerwheel_delete(cplus_timerwheel obj);
+bool cplus_timerwheel_check(cplus_object obj);
+uint32_t cplus_timerwheel_add(cplus_timerwheel obj, uint32_t delay, uint32_t period, CPLUS_TASK_PROC proc, void * param1, void * param2);
+int32_t cplus_timerwheel_cancel(cplus_timerwheel obj, uint32_t timer_id);
+uint32_t cplus_timerwheel_get_timer_count(cplus_timerwheel obj);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // __CPLUS_TIMERWHEEL_H__
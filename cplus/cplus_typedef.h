@@ -37,6 +37,10 @@ typedef void* cplus_socket;
 typedef void* cplus_syslog;
 typedef void* cplus_task;
 typedef void* cplus_taskpool;
+typedef void* cplus_taskgraph;
+typedef void* cplus_timerwheel;
+typedef void* cplus_fiberpool;
+typedef void* cplus_strand;
 typedef void* cplus_file;
 typedef void* cplus_event_server;
 typedef void* cplus_event_client;
@@ -17,6 +17,11 @@ SOURCES			+= mempool
 SOURCES 		+= llist
 SOURCES 		+= task
 SOURCES 		+= taskpool
+SOURCES 		+= taskgraph
+SOURCES 		+= parallel
+SOURCES 		+= timerwheel
+SOURCES 		+= fiber
+SOURCES 		+= strand
 SOURCES 		+= syslog
 SOURCES 		+= data
 SOURCES 		+= socket
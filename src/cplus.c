@@ -26,6 +26,22 @@ int32_t cplus_object_delete(cplus_object object)
     {
         return cplus_taskpool_delete(object);
     }
+    else if (cplus_taskgraph_check(object))
+    {
+        return cplus_taskgraph_delete(object);
+    }
+    else if (cplus_timerwheel_check(object))
+    {
+        return cplus_timerwheel_delete(object);
+    }
+    else if (cplus_fiberpool_check(object))
+    {
+        return cplus_fiberpool_delete(object);
+    }
+    else if (cplus_strand_check(object))
+    {
+        return cplus_strand_delete(object);
+    }
     else if (cplus_syslog_check(object))
     {
         return cplus_syslog_delete(object);
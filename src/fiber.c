@@ -0,0 +1,1231 @@
+/******************************************************************
+* @file: fiber.c
+*
+* @author: Hunter Huang <bill.b750121@gmail.com>
+******************************************************************/
+
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE
+#endif
+#include <pthread.h>
+#include <ucontext.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include "common.h"
+#include "cplus_memmgr.h"
+#include "cplus_atomic.h"
+#include "cplus_mutex.h"
+#include "cplus_pevent.h"
+#include "cplus_systime.h"
+#include "cplus_task.h"
+#include "cplus_taskpool.h"
+#include "cplus_timerwheel.h"
+#include "cplus_socket.h"
+#include "cplus_fiber.h"
+
+#define OBJ_TYPE (OBJ_NONE + SYS + 13)
+#define MAX_FIBER_COUNT 0xFFFFU
+#define DEFAULT_STACK_SIZE (64 * 1024)
+#define MIN_STACK_SIZE (16 * 1024)
+#define MAX_EPOLL_EVENTS 64
+#define PERIOD_FOR_STRANDED_CHECK 10
+
+/* A wait is identified by the fiber index and a per-fiber sequence, so a late
+epoll event or timer of an earlier wait can never resume the fiber again. */
+#define FIBER_TOKEN_MAKE(INDEX, SEQ) ((((uint64_t)(SEQ)) << 32) | ((uint64_t)(INDEX) + 1))
+#define FIBER_TOKEN_INDEX(TOKEN) ((uint32_t)((TOKEN) & 0xFFFFFFFFU) - 1)
+/* Epoll data of a watched fd, 0 is taken by the wake-up eventfd. */
+#define FIBER_WATCH_DATA(FD) ((uint64_t)(FD) + 1)
+#define FIBER_WATCH_FD(DATA) ((int32_t)((DATA) - 1))
+#define MIN_WATCH_BUCKET_COUNT 16U
+
+enum fiber_action
+{
+    FIBER_ACTION_NONE = 0,
+    FIBER_ACTION_YIELD,
+    FIBER_ACTION_WAIT,
+    FIBER_ACTION_EXIT,
+};
+
+/* One epoll registration per fd, with the combined events of every fiber
+waiting on it. */
+struct fiber_watch
+{
+    struct fiber_watch * next;
+    int32_t fd;
+    bool is_registered;
+    struct fiber * readers;
+    struct fiber * writers;
+};
+
+struct fiber
+{
+    ucontext_t context;
+    ucontext_t * return_context;
+    struct fiberpool * fp;
+    struct fiber * next;
+    uint8_t * stack;
+    uint32_t index;
+    CPLUS_TASK_PROC proc;
+    void * param1;
+    void * param2;
+    enum fiber_action action;
+    uint32_t wait_seq;
+    uint64_t wait_token;
+    int32_t wait_fd;
+    bool wait_for_write;
+    struct fiber_watch * watch;
+    struct fiber * watch_next;
+    uint32_t wait_timeout;
+    uint32_t timer_id;
+    int32_t wait_result;
+};
+
+struct fiberpool
+{
+    uint16_t type;
+    cplus_taskpool pool;
+    cplus_timerwheel timers;
+    cplus_mutex access_sect;
+    cplus_mutex arm_sect;
+    cplus_pevent evt_all_done;
+    cplus_task poller;
+    volatile bool is_stopping;
+    int32_t epoll_fd;
+    int32_t wakeup_fd;
+    uint32_t stack_size;
+    uint32_t page_size;
+    uint32_t max_fiber_count;
+    uint32_t fiber_count;
+    uint32_t runner_count;
+    uint32_t max_runner_count;
+    struct fiber * fibers;
+    struct fiber * free_fibers;
+    struct fiber * ready_head;
+    struct fiber * ready_tail;
+    struct fiber_watch * watches;
+    struct fiber_watch * free_watches;
+    struct fiber_watch ** watch_buckets;
+    uint32_t watch_bucket_mask;
+};
+
+static pthread_once_t once_init = PTHREAD_ONCE_INIT;
+static pthread_key_t key_for_current_fiber;
+
+static void cplus_fiber_once_init(void)
+{
+    pthread_key_create(&key_for_current_fiber, CPLUS_NULL);
+}
+
+/* A fiber may be resumed by a different worker than the one it was suspended
+on, the current fiber and errno are therefore never cached across a switch. */
+static __attribute__((noinline)) struct fiber * fiber_get_current(void)
+{
+    pthread_once(&(once_init), cplus_fiber_once_init);
+    return (struct fiber *)pthread_getspecific(key_for_current_fiber);
+}
+
+static __attribute__((noinline)) void fiber_set_errno(int32_t error)
+{
+    errno = error;
+}
+
+static void fiberpool_runner_proc(void * param1, void * param2);
+
+static inline void fiberpool_kick_poller(struct fiberpool * fp)
+{
+    uint64_t value = 1;
+    ssize_t res = write(fp->wakeup_fd, &value, sizeof(value));
+    UNUSED_PARAM(res);
+}
+
+static int32_t fiberpool_start_runner(struct fiberpool * fp)
+{
+    struct cplus_taskpool_task task = {0};
+
+    task.proc = fiberpool_runner_proc;
+    task.param1 = fp;
+    task.param2 = CPLUS_NULL;
+    task.callback = CPLUS_NULL;
+    if (CPLUS_SUCCESS != cplus_taskpool_add_task_ex(fp->pool, &task))
+    {
+        cplus_crit_sect_enter(fp->access_sect);
+        fp->runner_count --;
+        cplus_crit_sect_exit(fp->access_sect);
+        return CPLUS_FAIL;
+    }
+    return CPLUS_SUCCESS;
+}
+
+static void fiberpool_push_ready(struct fiberpool * fp, struct fiber * fiber)
+{
+    bool need_runner = false;
+
+    cplus_crit_sect_enter(fp->access_sect);
+    {
+        fiber->next = CPLUS_NULL;
+        if (fp->ready_tail)
+        {
+            fp->ready_tail->next = fiber;
+        }
+        else
+        {
+            fp->ready_head = fiber;
+        }
+        fp->ready_tail = fiber;
+
+        if (fp->runner_count < fp->max_runner_count)
+        {
+            fp->runner_count ++;
+            need_runner = true;
+        }
+    }
+    cplus_crit_sect_exit(fp->access_sect);
+
+    if (need_runner AND CPLUS_SUCCESS != fiberpool_start_runner(fp))
+    {
+        /* The pool queue is full, let the poller retry later. */
+        fiberpool_kick_poller(fp);
+    }
+}
+
+static struct fiber * fiberpool_pop_ready(struct fiberpool * fp)
+{
+    struct fiber * fiber = CPLUS_NULL;
+
+    cplus_crit_sect_enter(fp->access_sect);
+    {
+        if ((fiber = fp->ready_head))
+        {
+            if (CPLUS_NULL == (fp->ready_head = fiber->next))
+            {
+                fp->ready_tail = CPLUS_NULL;
+            }
+        }
+        else
+        {
+            fp->runner_count --;
+        }
+    }
+    cplus_crit_sect_exit(fp->access_sect);
+
+    return fiber;
+}
+
+static struct fiber_watch * fiberpool_find_watch(struct fiberpool * fp, int32_t fd)
+{
+    struct fiber_watch * watch = fp->watch_buckets[(uint32_t)(fd) & fp->watch_bucket_mask];
+
+    while (watch AND fd != watch->fd)
+    {
+        watch = watch->next;
+    }
+    return watch;
+}
+
+static void fiberpool_free_watch(struct fiberpool * fp, struct fiber_watch * watch)
+{
+    struct fiber_watch ** link = &(fp->watch_buckets[(uint32_t)(watch->fd) & fp->watch_bucket_mask]);
+
+    while (watch != (* link))
+    {
+        link = &((* link)->next);
+    }
+    (* link) = watch->next;
+    watch->next = fp->free_watches;
+    fp->free_watches = watch;
+}
+
+/* Re-arms the registration with the events still waited for, or removes it
+once the last waiter has left. Called with arm_sect held. */
+static int32_t fiberpool_update_watch(struct fiberpool * fp, struct fiber_watch * watch)
+{
+    struct epoll_event event = {0};
+
+    event.events = ((watch->readers)? (EPOLLIN | EPOLLRDHUP): 0) | ((watch->writers)? EPOLLOUT: 0);
+    event.data.u64 = FIBER_WATCH_DATA(watch->fd);
+    if (0 == event.events)
+    {
+        if (watch->is_registered)
+        {
+            /* The fd may be closed already, epoll has dropped it then. */
+            epoll_ctl(fp->epoll_fd, EPOLL_CTL_DEL, watch->fd, &event);
+        }
+        fiberpool_free_watch(fp, watch);
+        return CPLUS_SUCCESS;
+    }
+
+    event.events |= EPOLLONESHOT;
+    if (watch->is_registered)
+    {
+        if (0 != epoll_ctl(fp->epoll_fd, EPOLL_CTL_MOD, watch->fd, &event)
+            AND (ENOENT != errno OR 0 != epoll_ctl(fp->epoll_fd, EPOLL_CTL_ADD, watch->fd, &event)))
+        {
+            return CPLUS_FAIL;
+        }
+    }
+    else if (0 != epoll_ctl(fp->epoll_fd, EPOLL_CTL_ADD, watch->fd, &event)
+        AND (EEXIST != errno OR 0 != epoll_ctl(fp->epoll_fd, EPOLL_CTL_MOD, watch->fd, &event)))
+    {
+        return CPLUS_FAIL;
+    }
+    watch->is_registered = true;
+    return CPLUS_SUCCESS;
+}
+
+static void fiberpool_unwatch(struct fiberpool * fp, struct fiber * fiber)
+{
+    struct fiber_watch * watch = fiber->watch;
+    struct fiber ** link = CPLUS_NULL;
+
+    if (CPLUS_NULL == watch)
+    {
+        return;
+    }
+
+    link = (fiber->wait_for_write)? &(watch->writers): &(watch->readers);
+    while (fiber != (* link))
+    {
+        link = &((* link)->watch_next);
+    }
+    (* link) = fiber->watch_next;
+    fiber->watch_next = CPLUS_NULL;
+    fiber->watch = CPLUS_NULL;
+    fiberpool_update_watch(fp, watch);
+}
+
+static int32_t fiberpool_watch(struct fiberpool * fp, struct fiber * fiber)
+{
+    struct fiber_watch * watch = CPLUS_NULL;
+    struct fiber ** waiters = CPLUS_NULL;
+    int32_t error = 0;
+
+    if (CPLUS_NULL == (watch = fiberpool_find_watch(fp, fiber->wait_fd)))
+    {
+        /* A fiber waits on one fd at most, there is a watch for every fiber. */
+        watch = fp->free_watches;
+        fp->free_watches = watch->next;
+        watch->fd = fiber->wait_fd;
+        watch->is_registered = false;
+        watch->readers = CPLUS_NULL;
+        watch->writers = CPLUS_NULL;
+        watch->next = fp->watch_buckets[(uint32_t)(watch->fd) & fp->watch_bucket_mask];
+        fp->watch_buckets[(uint32_t)(watch->fd) & fp->watch_bucket_mask] = watch;
+    }
+
+    waiters = (fiber->wait_for_write)? &(watch->writers): &(watch->readers);
+    fiber->watch_next = (* waiters);
+    (* waiters) = fiber;
+    fiber->watch = watch;
+
+    if (CPLUS_SUCCESS != fiberpool_update_watch(fp, watch))
+    {
+        error = errno;
+        fiberpool_unwatch(fp, fiber);
+        errno = error;
+        return CPLUS_FAIL;
+    }
+    return CPLUS_SUCCESS;
+}
+
+static void fiberpool_wakeup(struct fiberpool * fp, uint64_t token, int32_t result)
+{
+    struct fiber * fiber = CPLUS_NULL;
+    uint64_t expect = token, cleared = 0;
+    uint32_t index = FIBER_TOKEN_INDEX(token);
+
+    if (index >= fp->max_fiber_count)
+    {
+        return;
+    }
+
+    fiber = &(fp->fibers[index]);
+    if (false == cplus_atomic_compare_exchange(&(fiber->wait_token), &expect, &cleared))
+    {
+        return;
+    }
+
+    /* The winner still waits for the arming to finish before handing the
+    fiber to a runner. */
+    cplus_crit_sect_enter(fp->arm_sect);
+    fiber->wait_result = result;
+    fiberpool_unwatch(fp, fiber);
+    cplus_crit_sect_exit(fp->arm_sect);
+
+    fiberpool_push_ready(fp, fiber);
+}
+
+static struct fiber * fiberpool_take_waiters(struct fiber ** waiters, struct fiber * woken)
+{
+    struct fiber * fiber = CPLUS_NULL;
+    uint64_t expect = 0, cleared = 0;
+
+    while ((fiber = (* waiters)))
+    {
+        /* Losing to the timer leaves the fiber here, the timer unlinks it. */
+        expect = cplus_atomic_read(&(fiber->wait_token));
+        if (0 == expect
+            OR false == cplus_atomic_compare_exchange(&(fiber->wait_token), &expect, &cleared))
+        {
+            waiters = &(fiber->watch_next);
+            continue;
+        }
+        (* waiters) = fiber->watch_next;
+        fiber->watch_next = CPLUS_NULL;
+        fiber->watch = CPLUS_NULL;
+        fiber->wait_result = 0;
+        fiber->next = woken;
+        woken = fiber;
+    }
+    return woken;
+}
+
+static void fiberpool_on_fd_event(struct fiberpool * fp, int32_t fd, uint32_t events)
+{
+    struct fiber_watch * watch = CPLUS_NULL;
+    struct fiber * woken = CPLUS_NULL, * fiber = CPLUS_NULL;
+
+    cplus_crit_sect_enter(fp->arm_sect);
+    if ((watch = fiberpool_find_watch(fp, fd)))
+    {
+        if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+        {
+            woken = fiberpool_take_waiters(&(watch->readers), woken);
+        }
+        if (events & (EPOLLOUT | EPOLLHUP | EPOLLERR))
+        {
+            woken = fiberpool_take_waiters(&(watch->writers), woken);
+        }
+        fiberpool_update_watch(fp, watch);
+    }
+    cplus_crit_sect_exit(fp->arm_sect);
+
+    while ((fiber = woken))
+    {
+        woken = fiber->next;
+        fiberpool_push_ready(fp, fiber);
+    }
+}
+
+static void fiberpool_on_timeout(void * param1, void * param2)
+{
+    struct fiber * fiber = (struct fiber *)(param1);
+    fiberpool_wakeup(fiber->fp, FIBER_TOKEN_MAKE(fiber->index, (uint32_t)(uintptr_t)(param2)), ETIMEDOUT);
+}
+
+static void fiberpool_arm_wait(struct fiberpool * fp, struct fiber * fiber)
+{
+    uint64_t token = 0, expect = 0, cleared = 0;
+    int32_t error = 0;
+
+    cplus_crit_sect_enter(fp->arm_sect);
+    {
+        fiber->wait_result = 0;
+        fiber->timer_id = 0;
+        token = FIBER_TOKEN_MAKE(fiber->index, ++ (fiber->wait_seq));
+        cplus_atomic_write(&(fiber->wait_token), token);
+
+        if (CPLUS_INFINITE_TIMEOUT != fiber->wait_timeout)
+        {
+            /* The sequence travels alone, a 64-bit token does not fit a
+            pointer on 32-bit targets. */
+            if (0 == (fiber->timer_id = cplus_timerwheel_add(fp->timers, fiber->wait_timeout, 0
+                , fiberpool_on_timeout, fiber, (void *)(uintptr_t)(fiber->wait_seq))))
+            {
+                error = errno;
+            }
+        }
+
+        if (0 == error AND 0 <= fiber->wait_fd
+            AND CPLUS_SUCCESS != fiberpool_watch(fp, fiber))
+        {
+            error = errno;
+            if (fiber->timer_id)
+            {
+                cplus_timerwheel_cancel(fp->timers, fiber->timer_id);
+                fiber->timer_id = 0;
+            }
+        }
+    }
+    cplus_crit_sect_exit(fp->arm_sect);
+
+    expect = token;
+    if (0 != error
+        AND cplus_atomic_compare_exchange(&(fiber->wait_token), &expect, &cleared))
+    {
+        fiber->wait_result = error;
+        fiberpool_push_ready(fp, fiber);
+    }
+}
+
+static void fiberpool_release_fiber(struct fiberpool * fp, struct fiber * fiber)
+{
+    cplus_crit_sect_enter(fp->access_sect);
+    {
+        fiber->next = fp->free_fibers;
+        fp->free_fibers = fiber;
+        if (0 == (-- fp->fiber_count))
+        {
+            cplus_pevent_set(fp->evt_all_done);
+        }
+    }
+    cplus_crit_sect_exit(fp->access_sect);
+}
+
+static void fiberpool_runner_proc(void * param1, void * param2)
+{
+    struct fiberpool * fp = (struct fiberpool *)(param1);
+    struct fiber * fiber = CPLUS_NULL;
+    ucontext_t runner_context;
+    UNUSED_PARAM(param2);
+
+    pthread_once(&(once_init), cplus_fiber_once_init);
+    while ((fiber = fiberpool_pop_ready(fp)))
+    {
+        fiber->return_context = &runner_context;
+        fiber->action = FIBER_ACTION_NONE;
+        pthread_setspecific(key_for_current_fiber, fiber);
+        swapcontext(&runner_context, &(fiber->context));
+        pthread_setspecific(key_for_current_fiber, CPLUS_NULL);
+
+        /* The fiber context is completely saved at this point, only now it is
+        safe to let another runner pick it up. */
+        switch (fiber->action)
+        {
+        case FIBER_ACTION_YIELD:
+            fiberpool_push_ready(fp, fiber);
+            break;
+        case FIBER_ACTION_WAIT:
+            fiberpool_arm_wait(fp, fiber);
+            break;
+        case FIBER_ACTION_EXIT:
+        default:
+            fiberpool_release_fiber(fp, fiber);
+            break;
+        }
+    }
+}
+
+static void fiberpool_poller_proc(void * param1, void * param2)
+{
+    struct fiberpool * fp = (struct fiberpool *)(param1);
+    struct epoll_event events[MAX_EPOLL_EVENTS];
+    int32_t count = 0, timeout = -1;
+    bool need_runner = false;
+    uint64_t value = 0;
+    ssize_t res = 0;
+    UNUSED_PARAM(param2);
+
+    while (false == fp->is_stopping)
+    {
+        need_runner = false;
+        cplus_crit_sect_enter(fp->access_sect);
+        if (fp->ready_head AND 0 == fp->runner_count)
+        {
+            fp->runner_count ++;
+            need_runner = true;
+        }
+        cplus_crit_sect_exit(fp->access_sect);
+
+        timeout = -1;
+        if (need_runner AND CPLUS_SUCCESS != fiberpool_start_runner(fp))
+        {
+            timeout = PERIOD_FOR_STRANDED_CHECK;
+        }
+
+        if (0 >= (count = epoll_wait(fp->epoll_fd, events, MAX_EPOLL_EVENTS, timeout)))
+        {
+            continue;
+        }
+
+        for (int32_t i = 0; i < count; i++)
+        {
+            if (0 == events[i].data.u64)
+            {
+                res = read(fp->wakeup_fd, &value, sizeof(value));
+                UNUSED_PARAM(res);
+                continue;
+            }
+            fiberpool_on_fd_event(fp, FIBER_WATCH_FD(events[i].data.u64), events[i].events);
+        }
+    }
+}
+
+int32_t cplus_fiberpool_delete(cplus_fiberpool obj)
+{
+    struct fiberpool * fp = (struct fiberpool *)(obj);
+    uint32_t fiber_count = 0, runner_count = 0;
+    CHECK_OBJECT_TYPE(obj);
+
+    if (fp->access_sect)
+    {
+        cplus_crit_sect_enter(fp->access_sect);
+        fiber_count = fp->fiber_count;
+        cplus_crit_sect_exit(fp->access_sect);
+        if (0 != fiber_count)
+        {
+            /* Suspended fibers live on their own stacks, they cannot be torn down. */
+            errno = EBUSY;
+            return CPLUS_FAIL;
+        }
+    }
+
+    if (fp->poller)
+    {
+        fp->is_stopping = true;
+        fiberpool_kick_poller(fp);
+        cplus_task_stop(fp->poller, CPLUS_INFINITE_TIMEOUT);
+    }
+
+    if (fp->access_sect)
+    {
+        do
+        {
+            cplus_crit_sect_enter(fp->access_sect);
+            runner_count = fp->runner_count;
+            cplus_crit_sect_exit(fp->access_sect);
+            if (0 != runner_count)
+            {
+                cplus_systime_sleep_msec(1);
+            }
+        }
+        while (0 != runner_count);
+    }
+
+    if (fp->timers)
+    {
+        cplus_timerwheel_delete(fp->timers);
+    }
+
+    if (0 <= fp->epoll_fd)
+    {
+        close(fp->epoll_fd);
+    }
+
+    if (0 <= fp->wakeup_fd)
+    {
+        close(fp->wakeup_fd);
+    }
+
+    if (fp->fibers)
+    {
+        for (uint32_t i = 0; i < fp->max_fiber_count; i++)
+        {
+            if (fp->fibers[i].stack)
+            {
+                munmap(fp->fibers[i].stack, fp->stack_size + fp->page_size);
+            }
+        }
+        cplus_free(fp->fibers);
+    }
+
+    if (fp->watch_buckets)
+    {
+        cplus_free(fp->watch_buckets);
+    }
+
+    if (fp->watches)
+    {
+        cplus_free(fp->watches);
+    }
+
+    if (fp->evt_all_done)
+    {
+        cplus_pevent_delete(fp->evt_all_done);
+    }
+
+    if (fp->arm_sect)
+    {
+        cplus_mutex_delete(fp->arm_sect);
+    }
+
+    if (fp->access_sect)
+    {
+        cplus_mutex_delete(fp->access_sect);
+    }
+
+    cplus_free(fp);
+    return CPLUS_SUCCESS;
+}
+
+static void * fiberpool_initialize_object(
+    cplus_taskpool pool
+    , uint32_t max_fiber_count
+    , uint32_t stack_size)
+{
+    struct fiberpool * fp = CPLUS_NULL;
+    struct epoll_event event = {0};
+    CPLUS_TASK_CONFIG_T task_config = {0};
+
+    if ((fp = (struct fiberpool *)cplus_malloc(sizeof(struct fiberpool))))
+    {
+        CPLUS_INITIALIZE_STRUCT_POINTER(fp);
+        fp->type = OBJ_TYPE;
+        fp->pool = pool;
+        fp->is_stopping = false;
+        fp->epoll_fd = -1;
+        fp->wakeup_fd = -1;
+        fp->page_size = (uint32_t)sysconf(_SC_PAGESIZE);
+        fp->stack_size = ((stack_size + fp->page_size - 1) / fp->page_size) * fp->page_size;
+        fp->max_fiber_count = max_fiber_count;
+        fp->fiber_count = 0;
+        fp->runner_count = 0;
+        fp->max_runner_count = CPLUS_MAX(1U, cplus_taskpool_get_worker_count(pool));
+
+        if (CPLUS_NULL == (fp->access_sect = cplus_mutex_new()))
+        {
+            goto exit;
+        }
+
+        if (CPLUS_NULL == (fp->arm_sect = cplus_mutex_new()))
+        {
+            goto exit;
+        }
+
+        if (CPLUS_NULL == (fp->evt_all_done = cplus_pevent_new(true, true)))
+        {
+            goto exit;
+        }
+
+        if (CPLUS_NULL == (fp->fibers = (struct fiber *)cplus_malloc(
+            max_fiber_count * sizeof(struct fiber))))
+        {
+            goto exit;
+        }
+        cplus_mem_set(fp->fibers, 0x00, max_fiber_count * sizeof(struct fiber));
+        fp->free_fibers = CPLUS_NULL;
+        for (uint32_t i = max_fiber_count; i > 0; i--)
+        {
+            fp->fibers[i - 1].index = i - 1;
+            fp->fibers[i - 1].fp = fp;
+            fp->fibers[i - 1].wait_fd = -1;
+            fp->fibers[i - 1].next = fp->free_fibers;
+            fp->free_fibers = &(fp->fibers[i - 1]);
+        }
+
+        if (CPLUS_NULL == (fp->watches = (struct fiber_watch *)cplus_malloc(
+            max_fiber_count * sizeof(struct fiber_watch))))
+        {
+            goto exit;
+        }
+        fp->free_watches = CPLUS_NULL;
+        for (uint32_t i = max_fiber_count; i > 0; i--)
+        {
+            fp->watches[i - 1].next = fp->free_watches;
+            fp->free_watches = &(fp->watches[i - 1]);
+        }
+
+        fp->watch_bucket_mask = MIN_WATCH_BUCKET_COUNT - 1;
+        while (fp->watch_bucket_mask < max_fiber_count)
+        {
+            fp->watch_bucket_mask = (fp->watch_bucket_mask << 1) | 1;
+        }
+        if (CPLUS_NULL == (fp->watch_buckets = (struct fiber_watch **)cplus_malloc(
+            (fp->watch_bucket_mask + 1) * sizeof(struct fiber_watch *))))
+        {
+            goto exit;
+        }
+        cplus_mem_set(fp->watch_buckets, 0x00, (fp->watch_bucket_mask + 1) * sizeof(struct fiber_watch *));
+
+        if (CPLUS_NULL == (fp->timers = cplus_timerwheel_new(max_fiber_count, CPLUS_NULL)))
+        {
+            goto exit;
+        }
+
+        if (0 > (fp->epoll_fd = epoll_create1(EPOLL_CLOEXEC)))
+        {
+            goto exit;
+        }
+
+        if (0 > (fp->wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)))
+        {
+            goto exit;
+        }
+
+        event.events = EPOLLIN;
+        event.data.u64 = 0;
+        if (0 != epoll_ctl(fp->epoll_fd, EPOLL_CTL_ADD, fp->wakeup_fd, &event))
+        {
+            goto exit;
+        }
+
+        task_config.proc = fiberpool_poller_proc;
+        task_config.param1 = fp;
+        task_config.param2 = CPLUS_NULL;
+        task_config.duration = 0;
+        task_config.suspend = false;
+        if (CPLUS_NULL == (fp->poller = cplus_task_new_ex(&task_config)))
+        {
+            goto exit;
+        }
+    }
+    return fp;
+exit:
+    cplus_fiberpool_delete(fp);
+    return CPLUS_NULL;
+}
+
+cplus_fiberpool cplus_fiberpool_new(
+    cplus_taskpool pool
+    , uint32_t max_fiber_count
+    , uint32_t stack_size)
+{
+    CHECK_IF(false == cplus_taskpool_check(pool), CPLUS_NULL);
+    CHECK_IN_INTERVAL(max_fiber_count, 1, MAX_FIBER_COUNT, CPLUS_NULL);
+
+    stack_size = (0 == stack_size)? DEFAULT_STACK_SIZE: CPLUS_MAX(stack_size, (uint32_t)(MIN_STACK_SIZE));
+    return fiberpool_initialize_object(pool, max_fiber_count, stack_size);
+}
+
+bool cplus_fiberpool_check(cplus_object obj)
+{
+    return (obj && (GET_OBJECT_TYPE(obj) == OBJ_TYPE));
+}
+
+static void fiber_entry(uint32_t high, uint32_t low)
+{
+    /* makecontext() passes int arguments only, the pointer comes in two halves
+    joined through 64 bits, the high half is 0 on 32-bit targets. */
+    struct fiber * fiber = (struct fiber *)(uintptr_t)((((uint64_t)(high)) << 32) | (uint64_t)(low));
+
+    fiber->proc(fiber->param1, fiber->param2);
+    fiber->action = FIBER_ACTION_EXIT;
+    setcontext(fiber->return_context);
+}
+
+int32_t cplus_fiberpool_spawn(
+    cplus_fiberpool obj
+    , CPLUS_TASK_PROC proc
+    , void * param1
+    , void * param2)
+{
+    struct fiberpool * fp = (struct fiberpool *)(obj);
+    struct fiber * fiber = CPLUS_NULL;
+    uint8_t * stack = CPLUS_NULL;
+    CHECK_OBJECT_TYPE(obj);
+    CHECK_NOT_NULL(proc, CPLUS_FAIL);
+
+    cplus_crit_sect_enter(fp->access_sect);
+    {
+        if ((fiber = fp->free_fibers))
+        {
+            fp->free_fibers = fiber->next;
+            if (1 == (++ fp->fiber_count))
+            {
+                cplus_pevent_reset(fp->evt_all_done);
+            }
+        }
+    }
+    cplus_crit_sect_exit(fp->access_sect);
+
+    if (CPLUS_NULL == fiber)
+    {
+        errno = ENOMEM;
+        return CPLUS_FAIL;
+    }
+
+    /* Stacks are kept with their fiber slot and reused, the lowest page is a
+    guard so an overflow faults instead of corrupting a neighbour. */
+    if (CPLUS_NULL == fiber->stack)
+    {
+        stack = (uint8_t *)mmap(CPLUS_NULL, fp->stack_size + fp->page_size, PROT_READ | PROT_WRITE
+            , MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+        if (MAP_FAILED == stack)
+        {
+            fiberpool_release_fiber(fp, fiber);
+            return CPLUS_FAIL;
+        }
+        mprotect(stack, fp->page_size, PROT_NONE);
+        fiber->stack = stack;
+    }
+
+    fiber->proc = proc;
+    fiber->param1 = param1;
+    fiber->param2 = param2;
+    fiber->action = FIBER_ACTION_NONE;
+    fiber->wait_fd = -1;
+    fiber->watch = CPLUS_NULL;
+
+    getcontext(&(fiber->context));
+    fiber->context.uc_stack.ss_sp = fiber->stack + fp->page_size;
+    fiber->context.uc_stack.ss_size = fp->stack_size;
+    fiber->context.uc_link = CPLUS_NULL;
+    makecontext(&(fiber->context), (void (*)(void))(fiber_entry), 2
+        , (uint32_t)(((uint64_t)(uintptr_t)(fiber)) >> 32), (uint32_t)((uintptr_t)(fiber)));
+
+    fiberpool_push_ready(fp, fiber);
+    return CPLUS_SUCCESS;
+}
+
+uint32_t cplus_fiberpool_get_fiber_count(cplus_fiberpool obj)
+{
+    uint32_t count = 0;
+    struct fiberpool * fp = (struct fiberpool *)(obj);
+    CHECK_OBJECT_TYPE(obj);
+
+    cplus_crit_sect_enter(fp->access_sect);
+    count = fp->fiber_count;
+    cplus_crit_sect_exit(fp->access_sect);
+
+    return count;
+}
+
+int32_t cplus_fiberpool_wait_all(cplus_fiberpool obj, uint32_t timeout)
+{
+    CHECK_OBJECT_TYPE(obj);
+    return cplus_pevent_wait(((struct fiberpool *)(obj))->evt_all_done, timeout);
+}
+
+bool cplus_fiber_is_running(void)
+{
+    return (CPLUS_NULL != fiber_get_current());
+}
+
+int32_t cplus_fiber_yield(void)
+{
+    struct fiber * fiber = CPLUS_NULL;
+
+    if (CPLUS_NULL == (fiber = fiber_get_current()))
+    {
+        sched_yield();
+        return CPLUS_SUCCESS;
+    }
+
+    fiber->action = FIBER_ACTION_YIELD;
+    swapcontext(&(fiber->context), fiber->return_context);
+    return CPLUS_SUCCESS;
+}
+
+static int32_t fiber_suspend(
+    struct fiber * fiber
+    , int32_t fd
+    , bool for_write
+    , uint32_t timeout)
+{
+    fiber->action = FIBER_ACTION_WAIT;
+    fiber->wait_fd = fd;
+    fiber->wait_for_write = for_write;
+    fiber->wait_timeout = timeout;
+    swapcontext(&(fiber->context), fiber->return_context);
+
+    if (0 == fiber->wait_result)
+    {
+        if (fiber->timer_id)
+        {
+            cplus_timerwheel_cancel(fiber->fp->timers, fiber->timer_id);
+        }
+        return CPLUS_SUCCESS;
+    }
+    fiber_set_errno(fiber->wait_result);
+    return CPLUS_FAIL;
+}
+
+int32_t cplus_fiber_wait_fd(int32_t fd, bool for_write, uint32_t timeout)
+{
+    struct pollfd pfd = {0};
+    struct fiber * fiber = fiber_get_current();
+    int32_t res = 0;
+    CHECK_IF(0 > fd, CPLUS_FAIL);
+
+    pfd.fd = fd;
+    pfd.events = (for_write)? POLLOUT: POLLIN;
+    if (0 < (res = poll(&pfd, 1, (CPLUS_NULL == fiber AND CPLUS_INFINITE_TIMEOUT == timeout)
+        ? -1: ((CPLUS_NULL == fiber)? (int32_t)(timeout): 0))))
+    {
+        return CPLUS_SUCCESS;
+    }
+
+    if (CPLUS_NULL == fiber OR 0 == timeout)
+    {
+        errno = (0 == res)? ETIMEDOUT: errno;
+        return CPLUS_FAIL;
+    }
+    return fiber_suspend(fiber, fd, for_write, timeout);
+}
+
+int32_t cplus_fiber_sleep_msec(uint32_t msec)
+{
+    struct fiber * fiber = CPLUS_NULL;
+
+    if (CPLUS_NULL == (fiber = fiber_get_current()))
+    {
+        cplus_systime_sleep_msec(msec);
+        return CPLUS_SUCCESS;
+    }
+
+    if (0 == msec)
+    {
+        return cplus_fiber_yield();
+    }
+
+    fiber_suspend(fiber, -1, false, msec);
+    return CPLUS_SUCCESS;
+}
+
+#ifdef __CPLUS_UNITTEST__
+
+#define FIBER_TEST_COUNT 1000U
+#define FIBER_PAIR_COUNT 100U
+
+static void sleep_then_count(void * param1, void * param2)
+{
+    UNUSED_PARAM(param2);
+    cplus_fiber_sleep_msec(50);
+    cplus_atomic_add((int32_t *)(param1), 1);
+}
+
+CPLUS_UNIT_TEST(cplus_fiberpool_spawn, functionity)
+{
+    cplus_taskpool pool = CPLUS_NULL;
+    cplus_fiberpool fp = CPLUS_NULL;
+    int32_t count = 0;
+    uint32_t spent = 0;
+
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL != (pool = cplus_taskpool_new(2)));
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL == cplus_fiberpool_new(pool, 0, 0));
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL != (fp = cplus_fiberpool_new(pool, FIBER_TEST_COUNT, 0)));
+    UNITTEST_EXPECT_EQ(false, cplus_fiber_is_running());
+
+    /* 1000 sleeping flows on 2 workers, each sleep parks the fiber only. */
+    spent = cplus_systime_get_tick();
+    for (uint32_t i = 0; i < FIBER_TEST_COUNT; i++)
+    {
+        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_fiberpool_spawn(fp, sleep_then_count, &count, CPLUS_NULL));
+    }
+    UNITTEST_EXPECT_EQ(CPLUS_FAIL, cplus_fiberpool_spawn(fp, sleep_then_count, &count, CPLUS_NULL));
+    UNITTEST_EXPECT_EQ(ENOMEM, errno);
+    UNITTEST_EXPECT_EQ(CPLUS_FAIL, cplus_fiberpool_delete(fp));
+    UNITTEST_EXPECT_EQ(EBUSY, errno);
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_fiberpool_wait_all(fp, 5000));
+    spent = cplus_systime_elapsed_tick(spent);
+    UNITTEST_EXPECT_EQ(FIBER_TEST_COUNT, (uint32_t)cplus_atomic_read(&count));
+    UNITTEST_EXPECT_EQ(true, spent < 1000);
+    UNITTEST_EXPECT_EQ(0, cplus_fiberpool_get_fiber_count(fp));
+
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_fiberpool_delete(fp));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskpool_delete(pool));
+    UNITTEST_EXPECT_EQ(0, cplus_mgr_report());
+}
+
+struct fiber_pair
+{
+    int32_t fds[2];
+    int32_t * count;
+};
+
+static void wait_then_read(void * param1, void * param2)
+{
+    struct fiber_pair * pair = (struct fiber_pair *)(param1);
+    char data = 0;
+    UNUSED_PARAM(param2);
+
+    if (CPLUS_SUCCESS == cplus_fiber_wait_fd(pair->fds[0], false, CPLUS_INFINITE_TIMEOUT)
+        AND 1 == read(pair->fds[0], &data, 1)
+        AND 'A' == data)
+    {
+        cplus_atomic_add(pair->count, 1);
+    }
+}
+
+static void wait_timeout(void * param1, void * param2)
+{
+    if (CPLUS_FAIL == cplus_fiber_wait_fd(*((int32_t *)(param1)), false, 20)
+        AND ETIMEDOUT == errno)
+    {
+        cplus_atomic_add((int32_t *)(param2), 1);
+    }
+}
+
+static void yield_and_count(void * param1, void * param2)
+{
+    UNUSED_PARAM(param2);
+    for (int32_t i = 0; i < 100; i++)
+    {
+        cplus_atomic_add((int32_t *)(param1), 1);
+        cplus_fiber_yield();
+    }
+}
+
+CPLUS_UNIT_TEST(cplus_fiber_wait_fd, functionity)
+{
+    cplus_taskpool pool = CPLUS_NULL;
+    cplus_fiberpool fp = CPLUS_NULL;
+    struct fiber_pair pairs[FIBER_PAIR_COUNT];
+    int32_t count = 0, timeout_count = 0, yield_count = 0;
+    ssize_t res = 0;
+
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL != (pool = cplus_taskpool_new(2)));
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL != (fp = cplus_fiberpool_new(pool, FIBER_PAIR_COUNT + 3, 32 * 1024)));
+
+    for (uint32_t i = 0; i < FIBER_PAIR_COUNT; i++)
+    {
+        UNITTEST_EXPECT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, pairs[i].fds));
+        pairs[i].count = &count;
+        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_fiberpool_spawn(fp, wait_then_read, &(pairs[i]), CPLUS_NULL));
+    }
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_fiberpool_spawn(fp, wait_timeout, &(pairs[0].fds[1]), &timeout_count));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_fiberpool_spawn(fp, yield_and_count, &yield_count, CPLUS_NULL));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_fiberpool_spawn(fp, yield_and_count, &yield_count, CPLUS_NULL));
+
+    cplus_systime_sleep_msec(100);
+    UNITTEST_EXPECT_EQ(0, cplus_atomic_read(&count));
+    UNITTEST_EXPECT_EQ(1, cplus_atomic_read(&timeout_count));
+    UNITTEST_EXPECT_EQ(200, cplus_atomic_read(&yield_count));
+    UNITTEST_EXPECT_EQ(FIBER_PAIR_COUNT, cplus_fiberpool_get_fiber_count(fp));
+
+    for (uint32_t i = 0; i < FIBER_PAIR_COUNT; i++)
+    {
+        res = write(pairs[i].fds[1], "A", 1);
+        UNITTEST_EXPECT_EQ(1, res);
+    }
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_fiberpool_wait_all(fp, 2000));
+    UNITTEST_EXPECT_EQ(FIBER_PAIR_COUNT, (uint32_t)cplus_atomic_read(&count));
+
+    for (uint32_t i = 0; i < FIBER_PAIR_COUNT; i++)
+    {
+        close(pairs[i].fds[0]);
+        close(pairs[i].fds[1]);
+    }
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_fiberpool_delete(fp));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskpool_delete(pool));
+    UNITTEST_EXPECT_EQ(0, cplus_mgr_report());
+}
+
+static void wait_then_write(void * param1, void * param2)
+{
+    struct fiber_pair * pair = (struct fiber_pair *)(param1);
+    UNUSED_PARAM(param2);
+
+    if (CPLUS_SUCCESS == cplus_fiber_wait_fd(pair->fds[0], true, CPLUS_INFINITE_TIMEOUT)
+        AND 1 == write(pair->fds[0], "B", 1))
+    {
+        cplus_atomic_add(pair->count, 1);
+    }
+}
+
+CPLUS_UNIT_TEST(cplus_fiber_wait_fd, shared_fd)
+{
+    cplus_taskpool pool = CPLUS_NULL;
+    struct fiberpool * fp = CPLUS_NULL;
+    struct fiber_pair pair = {0};
+    struct epoll_event event = {0};
+    int32_t count = 0, write_count = 0;
+    struct fiber_pair writer = {0};
+    struct fiber_watch * watch = CPLUS_NULL;
+    bool is_parked = false;
+    char data_bufs[4096];
+
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL != (pool = cplus_taskpool_new(2)));
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL != (fp = (struct fiberpool *)cplus_fiberpool_new(pool, 3, 0)));
+    UNITTEST_EXPECT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, pair.fds));
+    pair.count = &count;
+    writer = pair;
+    writer.count = &write_count;
+    /* Fill the send buffer, the writer has to wait as well. */
+    while (0 < write(pair.fds[0], data_bufs, sizeof(data_bufs)));
+
+    /* Two readers and a writer on one fd share one registration. */
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_fiberpool_spawn(fp, wait_then_read, &pair, CPLUS_NULL));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_fiberpool_spawn(fp, wait_then_read, &pair, CPLUS_NULL));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_fiberpool_spawn(fp, wait_then_write, &writer, CPLUS_NULL));
+    for (int32_t i = 0; i < 100 AND false == is_parked; i++)
+    {
+        cplus_systime_sleep_msec(10);
+        cplus_crit_sect_enter(fp->arm_sect);
+        watch = fiberpool_find_watch(fp, pair.fds[0]);
+        is_parked = (watch AND watch->writers AND watch->readers AND watch->readers->watch_next);
+        cplus_crit_sect_exit(fp->arm_sect);
+    }
+    UNITTEST_EXPECT_EQ(true, is_parked);
+
+    UNITTEST_EXPECT_EQ(2, write(pair.fds[1], "AA", 2));
+    for (int32_t i = 0; i < 100 AND 2 != cplus_atomic_read(&count); i++)
+    {
+        cplus_systime_sleep_msec(10);
+    }
+    UNITTEST_EXPECT_EQ(2, cplus_atomic_read(&count));
+    UNITTEST_EXPECT_EQ(0, cplus_atomic_read(&write_count));
+
+    while (0 < read(pair.fds[1], data_bufs, sizeof(data_bufs)));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_fiberpool_wait_all(fp, 2000));
+    UNITTEST_EXPECT_EQ(1, cplus_atomic_read(&write_count));
+
+    /* The last waiter to leave removes the registration. */
+    UNITTEST_EXPECT_EQ(-1, epoll_ctl(fp->epoll_fd, EPOLL_CTL_DEL, pair.fds[0], &event));
+    UNITTEST_EXPECT_EQ(ENOENT, errno);
+
+    close(pair.fds[0]);
+    close(pair.fds[1]);
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_fiberpool_delete(fp));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskpool_delete(pool));
+    UNITTEST_EXPECT_EQ(0, cplus_mgr_report());
+}
+
+#define FIBER_TEST_PORT 35999
+
+struct fiber_socket_test
+{
+    cplus_socket server;
+    int32_t received;
+};
+
+static void socket_recv_in_fiber(void * param1, void * param2)
+{
+    struct fiber_socket_test * test = (struct fiber_socket_test *)(param1);
+    char data_bufs[32] = {0};
+    UNUSED_PARAM(param2);
+
+    if (0 < cplus_socket_recv(test->server, data_bufs, sizeof(data_bufs), 1000))
+    {
+        cplus_atomic_add(&(test->received), 1);
+    }
+}
+
+static void socket_send_in_fiber(void * param1, void * param2)
+{
+    cplus_socket client = (cplus_socket)(param1);
+    UNUSED_PARAM(param2);
+
+    cplus_fiber_sleep_msec(20);
+    cplus_socket_sendto(client, (void *)("Hello"), 6, "127.0.0.1", FIBER_TEST_PORT);
+}
+
+CPLUS_UNIT_TEST(cplus_fiber_wait_fd, socket_recv)
+{
+    cplus_taskpool pool = CPLUS_NULL;
+    cplus_fiberpool fp = CPLUS_NULL;
+    cplus_socket client = CPLUS_NULL;
+    struct fiber_socket_test test = {0};
+
+    /* One worker only, the sender can run only if the receiver yields. */
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL != (pool = cplus_taskpool_new(1)));
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL != (fp = cplus_fiberpool_new(pool, 2, 0)));
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL != (test.server = cplus_socket_new(CPLUS_SOCKET_TYPE_UDP_IPV4)));
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL != (client = cplus_socket_new(CPLUS_SOCKET_TYPE_UDP_IPV4)));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_socket_bind(test.server, "127.0.0.1", FIBER_TEST_PORT));
+
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_fiberpool_spawn(fp, socket_recv_in_fiber, &test, CPLUS_NULL));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_fiberpool_spawn(fp, socket_send_in_fiber, client, CPLUS_NULL));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_fiberpool_wait_all(fp, 2000));
+    UNITTEST_EXPECT_EQ(1, test.received);
+
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_socket_delete(client));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_socket_delete(test.server));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_fiberpool_delete(fp));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskpool_delete(pool));
+    UNITTEST_EXPECT_EQ(0, cplus_mgr_report());
+}
+
+void unittest_fiber(void)
+{
+    UNITTEST_ADD_TESTCASE(cplus_fiberpool_spawn, functionity);
+    UNITTEST_ADD_TESTCASE(cplus_fiber_wait_fd, functionity);
+    UNITTEST_ADD_TESTCASE(cplus_fiber_wait_fd, shared_fd);
+    UNITTEST_ADD_TESTCASE(cplus_fiber_wait_fd, socket_recv);
+}
+
+#endif // __CPLUS_UNITTEST__
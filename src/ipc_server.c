@@ -5,6 +5,13 @@
 ******************************************************************/
 
 #include <arpa/inet.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
 #include "common.h"
 #include "cplus_memmgr.h"
 #include "cplus_llist.h"
@@ -12,8 +19,11 @@
 #include "cplus_mutex.h"
 #include "cplus_socket.h"
 #include "cplus_task.h"
+#include "cplus_taskpool.h"
 #include "cplus_systime.h"
 #include "cplus_pevent.h"
+#include "cplus_atomic.h"
+#include "cplus_sharedmem.h"
 #include "cplus_ipc_server.h"
 
 #define OBJ_TYPE_SERVER (OBJ_NONE + SYS + 7)
@@ -25,10 +35,34 @@
 #define DEFAULT_RECEVICE_BUFFER_SIZE 512U
 #define MAX_PACKET_DATA_SIZE (16 * DEFAULT_RECEVICE_BUFFER_SIZE)
 #define DEFAULT_RESPONSE_BUFS_SIZE 8192U
-#define DEFAULT_PACKET_DATA_SIZE 512U
 #define TIMEOUT_FOR_HEARTBEAT_PACKET 3000
 #define IPC_CONN_PACKET_TAG_SIZE 3U
 #define TOLERANCE_TO_DIFF_SEQUENCE 3U
+#define IPC_CONN_PACKET_HEAD_SIZE (IPC_CONN_PACKET_TAG_SIZE + 2U + sizeof(uint32_t))
+#define MAX_FRAME_DATA_SIZE (1024U * 1024U)
+#define IPC_CONN_MAX_FRAME_SIZE (IPC_CONN_PACKET_HEAD_SIZE + MAX_PACKET_DATA_SIZE + IPC_CONN_PACKET_TAG_SIZE)
+#define IPC_CONN_RECEIVE_BUFFER_SIZE (2U * IPC_CONN_MAX_FRAME_SIZE)
+#define MAX_REACTOR_EVENTS 64
+#define MAX_REACTOR_RECV_ROUNDS 16U
+#define MAX_PENDING_SEND_SIZE (64U * 1024U)
+#define DURATION_FOR_IPC_REQUEST_SWEEP 100U
+#define IPC_ASYNC_RESPONSE_HEAD_SIZE (2U * sizeof(uint32_t))
+#define IPC_SHM_HEADER_SIZE 64U
+#define IPC_SHM_MIN_FRAME_SIZE 4096U
+#define IPC_SHM_NAME_MAX_SIZE 47U
+#define TIMEOUT_FOR_SHM_RING_SPACE 1000U
+#define IPC_SHM_RING_TO_SERVER 0
+#define IPC_SHM_RING_TO_CLIENT 1
+#define IPC_CONN_MAX_PASSED_FDS 8U
+#define IPC_BATCH_RECORD_HEAD_SIZE sizeof(uint32_t)
+#define TIMEOUT_FOR_PUBLISH_SEND_LOCK 1U
+#define IPC_MEMFD_SEALS (F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL)
+#define IPC_SEQPACKET_HEAD_SIZE 2U
+#define IPC_SEQPACKET_MAX_DATAGRAM_SIZE (64U * 1024U)
+#define IPC_SEQPACKET_MAX_DATA_SIZE (IPC_SEQPACKET_MAX_DATAGRAM_SIZE - IPC_SEQPACKET_HEAD_SIZE)
+#define IPC_SEQPACKET_RECORD_HEAD_SIZE sizeof(uint32_t)
+#define IPC_MAX_FRAME_DATA_SIZE(IS_SEQPACKET) \
+    ((IS_SEQPACKET)? IPC_SEQPACKET_MAX_DATA_SIZE: MAX_FRAME_DATA_SIZE)
 #define ACCUMULATE_SEQUENCE_NUMBER(SEQN) \
     ({ SEQN = ((255U <= SEQN)? 0: SEQN + 1U); SEQN; })
 
@@ -43,17 +77,6 @@ typedef enum ipc_conn_statusus
     IPC_CONN_STATUS_FAULT,
 } IPC_CONN_STATUS;
 
-typedef enum ipc_conn_recv_stage
-{
-    IPC_CONN_STAGE_RECV_HEAD = 0,
-    IPC_CONN_STAGE_RECV_SEQN,
-    IPC_CONN_STAGE_RECV_CMD,
-    IPC_CONN_STAGE_RECV_DATA_LEN,
-    IPC_CONN_STAGE_RECV_DATA,
-    IPC_CONN_STAGE_RECV_TAIL,
-    IPC_CONN_STAGE_RECV_COMPLETED,
-} IPC_CONN_RECV_STAGE;
-
 typedef enum ipc_cmd
 {
     IPC_CMD_HEARTBEAT = 0,
@@ -61,6 +84,19 @@ typedef enum ipc_cmd
     IPC_CMD_REQUEST,
     IPC_CMD_RESPONSE,
     IPC_CMD_ACK,
+    IPC_CMD_ASYNC_REQUEST,
+    IPC_CMD_ASYNC_RESPONSE,
+    IPC_CMD_SHM_SETUP,
+    IPC_CMD_SHM_FRAME,
+    IPC_CMD_MEMFD_FRAME,
+    IPC_CMD_STREAM_BEGIN,
+    IPC_CMD_STREAM_CHUNK,
+    IPC_CMD_STREAM_END,
+    IPC_CMD_STREAM_CREDIT,
+    IPC_CMD_ONEWAY_BATCH,
+    IPC_CMD_SUBSCRIBE,
+    IPC_CMD_UNSUBSCRIBE,
+    IPC_CMD_PUBLISH,
     IPC_CMD_MAX,
 } IPC_CMD;
 
@@ -72,14 +108,84 @@ typedef struct ipc_conn_packet
     void * data;
 } *IPC_CONN_PACKET, IPC_CONN_PACKET_T;
 
+/* Starts the segment a client shares with its connection, the ring towards the
+server follows it and then the ring towards the client. */
+typedef struct ipc_shm_header
+{
+    uint32_t ring_size;
+    uint32_t reserved;
+    volatile uint64_t tails[2];
+} *IPC_SHM_HEADER, IPC_SHM_HEADER_T;
+
+/* Sent over the socket in place of a frame whose payload sits in the ring. */
+typedef struct ipc_shm_desc
+{
+    uint8_t cmd;
+    uint32_t offset;
+    uint32_t len;
+    uint64_t end;
+} *IPC_SHM_DESC, IPC_SHM_DESC_T;
+
+/* Sent over the socket together with the sealed memfd which holds the payload. */
+typedef struct ipc_memfd_desc
+{
+    uint8_t cmd;
+    uint32_t len;
+} *IPC_MEMFD_DESC, IPC_MEMFD_DESC_T;
+
+/* Returned for a stream, it grants more chunks, reports a failure or confirms the end. */
+typedef struct ipc_stream_credit
+{
+    uint32_t stream_id;
+    uint32_t credits;
+    uint32_t status;
+    uint32_t is_closed;
+} *IPC_STREAM_CREDIT, IPC_STREAM_CREDIT_T;
+
+/* A memfd waiting in the send queue for the first byte of its descriptor frame. */
+typedef struct ipc_pending_fd
+{
+    uint64_t pos;
+    int32_t fd;
+} *IPC_PENDING_FD, IPC_PENDING_FD_T;
+
+/* What a connection has moved so far, folded into the server's totals as it closes. */
+typedef struct ipc_conn_counters
+{
+    uint64_t bytes_received;
+    uint64_t bytes_sent;
+    uint64_t messages_received;
+    uint64_t messages_sent;
+    CPLUS_IPC_HISTOGRAM_T request_time;
+} *IPC_CONN_COUNTERS, IPC_CONN_COUNTERS_T;
+
+/* A packet handed to the handler pool, it keeps its own copy of the input and is
+answered once every job ahead of it on the connection is. */
+typedef struct ipc_job
+{
+    struct ipc_conn * ipc_conn;
+    struct ipc_job * next;
+    struct ipc_conn_packet packet;
+    uint32_t request_id;
+    uint64_t start_nsec;
+    int32_t res;
+    int32_t status;
+    bool is_done;
+    bool is_pooled;
+    uint32_t output_size;
+    uint32_t output_len;
+    void * output_bufs;
+} *IPC_JOB, IPC_JOB_T;
+
 typedef struct ipc_conn
 {
     struct ipc_server * ipc_serv;
+    struct ipc_client * ipc_clt;
     bool is_async;
+    bool is_seqpacket;
     uint32_t recv_timeout;
     volatile IPC_CONN_STATUS status;
     uint32_t sock_error;
-    volatile IPC_CONN_RECV_STAGE recv_stage;
     cplus_socket sock;
     cplus_task conn_task;
     cplus_pevent evt_packet_received;
@@ -88,17 +194,74 @@ typedef struct ipc_conn
     uint8_t * recv_bufs;
     uint32_t recv_bufs_size;
     uint32_t recv_bufs_offset;
-    uint32_t sub_offset;
-    void * packet_databufs;
-    uint32_t packet_databufs_size;
-    uint32_t packet_databufs_offset;
+    uint32_t recv_bufs_len;
     uint32_t response_data_size;
     void * response_data;
     CPLUS_IPC_CB_ON_RECEIVED on_received;
     CPLUS_IPC_CB_ON_DISCONNECTED on_disconnected;
     CPLUS_IPC_CB_ON_ERROR on_error;
+    CPLUS_IPC_CB_ON_STREAM_CHUNK on_stream_chunk;
+    uint32_t stream_id;
+    uint64_t stream_offset;
+    int32_t stream_status;
+    uint32_t stream_consumed;
+    struct ipc_reactor * reactor;
+    uint32_t epoll_events;
+    uint8_t * send_bufs;
+    uint32_t send_bufs_size;
+    uint32_t send_bufs_len;
+    uint32_t send_bufs_offset;
+    uint64_t send_bufs_base;
+    struct ipc_pending_fd send_fds[IPC_CONN_MAX_PASSED_FDS];
+    uint32_t send_fds_head;
+    uint32_t send_fds_count;
+    cplus_sharedmem shm;
+    uint32_t shm_ring_size;
+    uint8_t * shm_tx_data;
+    volatile uint64_t * shm_tx_tail;
+    uint64_t shm_tx_head;
+    uint8_t * shm_tx_reserved;
+    uint32_t shm_tx_pad;
+    uint8_t * shm_rx_data;
+    volatile uint64_t * shm_rx_tail;
+    uint64_t shm_rx_release;
+    uint32_t memfd_threshold;
+    int32_t recv_fds[IPC_CONN_MAX_PASSED_FDS];
+    uint32_t recv_fds_head;
+    uint32_t recv_fds_count;
+    void * memfd_view;
+    uint32_t memfd_view_len;
+    cplus_taskpool handler_pool;
+    uint32_t max_inflight;
+    cplus_mutex send_sect;
+    cplus_mutex job_sect;
+    cplus_pevent evt_job_done;
+    struct ipc_job * job_head;
+    struct ipc_job * job_tail;
+    uint32_t job_count;
+    volatile bool is_recv_held;
+    char (* topics)[CPLUS_IPC_MAX_TOPIC_SIZE];
+    uint32_t topic_count;
+    CPLUS_IPC_CB_ON_PUBLISHED on_published;
+    volatile bool is_dispatched;
+    volatile bool is_rearm_pending;
+    bool is_closing;
+    struct ipc_conn_counters counters;
+    volatile uint32_t last_active_tick;
+    volatile uint64_t last_request_nsec;
+    bool is_slow;
 } *IPC_CONN, IPC_CONN_T;
 
+typedef struct ipc_reactor
+{
+    struct ipc_server * ipc_serv;
+    int32_t epoll_fd;
+    int32_t wakeup_fd;
+    cplus_task reactor_task;
+    volatile bool is_rearm_pending;
+    volatile bool is_reap_pending;
+} *IPC_REACTOR, IPC_REACTOR_T;
+
 typedef struct ipc_server
 {
     uint16_t type;
@@ -107,23 +270,79 @@ typedef struct ipc_server
     cplus_mutex ipc_conn_sect;
     cplus_llist ipc_conn_list;
     cplus_mempool ipc_conn_pool;
+    cplus_mempool response_pool;
     cplus_task accept_task;
+    uint32_t reactor_count;
+    struct ipc_reactor * reactors;
+    uint32_t next_reactor;
+    cplus_taskpool dispatch_pool;
+    uint32_t dispatched_count;
+    cplus_taskpool handler_pool;
+    uint32_t max_inflight_per_conn;
+    uint32_t publish_backlog;
+    CPLUS_IPC_SLOW_SUBSCRIBER_POLICY slow_subscriber_policy;
+    uint32_t slow_queued_bytes;
+    uint32_t slow_request_msec;
+    struct ipc_conn_counters retired;
+    uint64_t accepted_count;
+    uint64_t slow_count;
+    uint32_t memfd_threshold;
+    bool is_seqpacket;
+    volatile bool is_stopping;
+    bool is_accept_paused;
     CPLUS_IPC_CB_ON_CONNECTED on_connected;
     CPLUS_IPC_CB_ON_ERROR on_error;
     CPLUS_IPC_CB_ON_DISCONNECTED on_disconnected;
     CPLUS_IPC_CB_ON_RECEIVED on_received;
+    CPLUS_IPC_CB_ON_STREAM_CHUNK on_stream_chunk;
+    CPLUS_IPC_CB_ON_SLOW_CONSUMER on_slow_consumer;
 } *IPC_SERVER, IPC_SERVER_T;
 
+typedef struct ipc_request
+{
+    uint32_t request_id;
+    uint32_t start_tick;
+    uint32_t timeout;
+    CPLUS_IPC_CB_ON_COMPLETED on_completed;
+    void * arg;
+} *IPC_REQUEST, IPC_REQUEST_T;
+
 typedef struct ipc_client
 {
     uint16_t type;
     bool is_async;
+    bool is_seqpacket;
     cplus_socket server_socket;
     uint32_t seqn;
     struct ipc_conn * ipc_conn;
     CPLUS_IPC_CB_ON_CONNECTED on_connected;
+    cplus_mutex send_sect;
+    cplus_mutex request_sect;
+    struct ipc_request * requests;
+    uint32_t next_request_id;
+    uint32_t inflight_count;
+    cplus_pevent evt_requests_done;
+    uint32_t stream_id;
+    uint32_t next_stream_id;
+    uint32_t stream_credits;
+    int32_t stream_status;
+    uint32_t is_stream_closed;
+    cplus_pevent evt_stream;
+    cplus_mutex batch_sect;
+    cplus_task batch_task;
+    uint8_t * batch_bufs;
+    uint32_t batch_size;
+    uint32_t batch_len;
+    uint32_t batch_linger;
+    uint32_t batch_start_tick;
+    cplus_mutex subscribe_sect;
+    cplus_pevent evt_subscribe;
+    volatile uint8_t subscribe_seqn;
+    volatile int32_t subscribe_status;
 } *IPC_CLIENT, IPC_CLIENT_T;
 
+static void ipc_conn_wait_jobs(struct ipc_conn * ipc_conn);
+
 static int32_t ipc_conn_delete(struct ipc_conn * ipc_conn)
 {
     if (ipc_conn)
@@ -135,6 +354,8 @@ static int32_t ipc_conn_delete(struct ipc_conn * ipc_conn)
             cplus_task_stop(ipc_conn->conn_task, TIMEOUT_FOR_STOP_IPC_CONN_TASK);
         }
 
+        ipc_conn_wait_jobs(ipc_conn);
+
         if (ipc_conn->recv_bufs)
         {
             cplus_free(ipc_conn->recv_bufs);
@@ -150,9 +371,9 @@ static int32_t ipc_conn_delete(struct ipc_conn * ipc_conn)
             cplus_free(ipc_conn->response_data);
         }
 
-        if (ipc_conn->packet_databufs)
+        if (ipc_conn->send_bufs)
         {
-            cplus_free(ipc_conn->packet_databufs);
+            cplus_free(ipc_conn->send_bufs);
         }
 
         if (ipc_conn->sock)
@@ -160,6 +381,46 @@ static int32_t ipc_conn_delete(struct ipc_conn * ipc_conn)
             cplus_socket_delete(ipc_conn->sock);
         }
 
+        if (ipc_conn->shm)
+        {
+            cplus_sharedmem_delete(ipc_conn->shm);
+        }
+
+        if (ipc_conn->memfd_view)
+        {
+            munmap(ipc_conn->memfd_view, ipc_conn->memfd_view_len);
+        }
+
+        for (uint32_t i = 0; i < ipc_conn->recv_fds_count; i++)
+        {
+            close(ipc_conn->recv_fds[(ipc_conn->recv_fds_head + i) % IPC_CONN_MAX_PASSED_FDS]);
+        }
+
+        for (uint32_t i = 0; i < ipc_conn->send_fds_count; i++)
+        {
+            close(ipc_conn->send_fds[(ipc_conn->send_fds_head + i) % IPC_CONN_MAX_PASSED_FDS].fd);
+        }
+
+        if (ipc_conn->evt_job_done)
+        {
+            cplus_pevent_delete(ipc_conn->evt_job_done);
+        }
+
+        if (ipc_conn->job_sect)
+        {
+            cplus_mutex_delete(ipc_conn->job_sect);
+        }
+
+        if (ipc_conn->send_sect)
+        {
+            cplus_mutex_delete(ipc_conn->send_sect);
+        }
+
+        if (ipc_conn->topics)
+        {
+            cplus_free(ipc_conn->topics);
+        }
+
         if (ipc_conn->ipc_serv)
         {
             cplus_mempool_free((ipc_conn->ipc_serv)->ipc_conn_pool, ipc_conn);
@@ -173,26 +434,148 @@ static int32_t ipc_conn_delete(struct ipc_conn * ipc_conn)
     return CPLUS_SUCCESS;
 }
 
+static void ipc_client_fail_requests(struct ipc_client * ipc_clt, int32_t status, bool expired_only);
+
+static int32_t ipc_client_flush_batch(struct ipc_client * clt);
+
 static int32_t ipc_client_delete(struct ipc_client * ipc_clt)
 {
     if (ipc_clt)
     {
+        if (ipc_clt->batch_task)
+        {
+            cplus_task_stop(ipc_clt->batch_task, TIMEOUT_FOR_STOP_IPC_CONN_TASK);
+        }
+
+        if (ipc_clt->batch_bufs)
+        {
+            /* Oneways still waiting in the batch leave before the connection goes. */
+            if (ipc_clt->ipc_conn AND IPC_CONN_STATUS_NOT_CONNECTED != (ipc_clt->ipc_conn)->status)
+            {
+                ipc_client_flush_batch(ipc_clt);
+            }
+            cplus_free(ipc_clt->batch_bufs);
+        }
+
+        if (ipc_clt->batch_sect)
+        {
+            cplus_mutex_delete(ipc_clt->batch_sect);
+        }
+
         if (ipc_clt->ipc_conn)
         {
+            /* The connection owns the socket as well. */
             ipc_conn_delete(ipc_clt->ipc_conn);
         }
+        else if (ipc_clt->server_socket)
+        {
+            cplus_socket_delete(ipc_clt->server_socket);
+        }
+
+        if (ipc_clt->requests)
+        {
+            /* Nothing answers from here on, so whatever is still in flight is cancelled. */
+            ipc_client_fail_requests(ipc_clt, ECANCELED, false);
+            cplus_free(ipc_clt->requests);
+        }
+
+        if (ipc_clt->evt_requests_done)
+        {
+            cplus_pevent_delete(ipc_clt->evt_requests_done);
+        }
+
+        if (ipc_clt->evt_stream)
+        {
+            cplus_pevent_delete(ipc_clt->evt_stream);
+        }
+
+        if (ipc_clt->evt_subscribe)
+        {
+            cplus_pevent_delete(ipc_clt->evt_subscribe);
+        }
+
+        if (ipc_clt->subscribe_sect)
+        {
+            cplus_mutex_delete(ipc_clt->subscribe_sect);
+        }
+
+        if (ipc_clt->request_sect)
+        {
+            cplus_mutex_delete(ipc_clt->request_sect);
+        }
+
+        if (ipc_clt->send_sect)
+        {
+            cplus_mutex_delete(ipc_clt->send_sect);
+        }
 
         cplus_free(ipc_clt);
     }
     return CPLUS_SUCCESS;
 }
 
+static void ipc_reactor_kick(struct ipc_reactor * reactor)
+{
+    uint64_t value = 1;
+    ssize_t res = write(reactor->wakeup_fd, &value, sizeof(value));
+    UNUSED_PARAM(res);
+}
+
+static void ipc_server_stop_reactors(struct ipc_server * ipc_serv)
+{
+    struct ipc_reactor * reactor = CPLUS_NULL;
+
+    ipc_serv->is_stopping = true;
+    for (uint32_t i = 0; i < ipc_serv->reactor_count; i++)
+    {
+        reactor = &(ipc_serv->reactors[i]);
+        if (reactor->reactor_task)
+        {
+            ipc_reactor_kick(reactor);
+            cplus_task_stop(reactor->reactor_task, TIMEOUT_FOR_STOP_IPC_SEVR_TASK);
+            reactor->reactor_task = CPLUS_NULL;
+        }
+    }
+
+    /* Connections handed to the dispatch pool are owned by its workers until they return. */
+    while (0 != cplus_atomic_read(&(ipc_serv->dispatched_count)))
+    {
+        cplus_systime_sleep_msec(1);
+    }
+
+    /* Jobs on the handler pool re-arm their connections on these reactors as they are answered. */
+    for (uint32_t i = 0; ipc_serv->handler_pool AND i < cplus_llist_get_size(ipc_serv->ipc_conn_list); i++)
+    {
+        ipc_conn_wait_jobs((struct ipc_conn *)cplus_llist_get_of(ipc_serv->ipc_conn_list, (int32_t)i));
+    }
+
+    for (uint32_t i = 0; i < ipc_serv->reactor_count; i++)
+    {
+        reactor = &(ipc_serv->reactors[i]);
+        if (0 <= reactor->epoll_fd)
+        {
+            close(reactor->epoll_fd);
+        }
+        if (0 <= reactor->wakeup_fd)
+        {
+            close(reactor->wakeup_fd);
+        }
+    }
+    cplus_free(ipc_serv->reactors);
+    ipc_serv->reactors = CPLUS_NULL;
+}
+
 static int32_t ipc_server_delete(struct ipc_server * ipc_serv)
 {
     struct ipc_conn * conn = CPLUS_NULL;
 
     if (ipc_serv)
     {
+        if (ipc_serv->reactors)
+        {
+            ipc_server_stop_reactors(ipc_serv);
+        }
+
         if (ipc_serv->accept_task)
         {
             cplus_task_stop(ipc_serv->accept_task, TIMEOUT_FOR_STOP_IPC_SEVR_TASK);
@@ -213,6 +596,11 @@ static int32_t ipc_server_delete(struct ipc_server * ipc_serv)
             cplus_mempool_delete(ipc_serv->ipc_conn_pool);
         }
 
+        if (ipc_serv->response_pool)
+        {
+            cplus_mempool_delete(ipc_serv->response_pool);
+        }
+
         if (ipc_serv->ipc_conn_sect)
         {
             cplus_mutex_delete(ipc_serv->ipc_conn_sect);
@@ -241,1092 +629,4498 @@ int32_t cplus_ipc_client_delete(cplus_ipc_client obj)
     return ipc_client_delete((struct ipc_client *)(obj));
 }
 
-int32_t ipc_recv_packet(
-    cplus_socket skt
-    , IPC_CONN_PACKET packet
-    , uint32_t output_bufs_len
-    , void * output_bufs
-    , uint32_t timeout)
+static uint32_t ipc_packet_build_iov(IPC_CONN_PACKET packet, bool is_seqpacket, uint8_t * head, struct iovec * iov)
 {
-    int32_t res = CPLUS_FAIL, recv_count = 0;
-    uint8_t begin_tag[3] = {0}, end_tag[3] = {0};
-    uint32_t curr_tick = 0;
-    void * recv_data = CPLUS_NULL;
-
-    CHECK_NOT_NULL(skt, CPLUS_FAIL);
-    CHECK_NOT_NULL(packet, CPLUS_FAIL);
+    uint32_t network_order = htonl(packet->data_len);
 
-    do
+    if (is_seqpacket)
     {
-        curr_tick = cplus_systime_get_tick();
-        if (IPC_CONN_PACKET_TAG_SIZE != cplus_socket_recv(skt, begin_tag, IPC_CONN_PACKET_TAG_SIZE, timeout))
-        {
-            break;
-        }
-        timeout -= cplus_systime_elapsed_tick(curr_tick);
+        /* The datagram keeps the message boundary, so neither tags nor a length are sent. */
+        head[0] = packet->seqn;
+        head[1] = packet->cmd;
+        iov[0].iov_base = head;
+        iov[0].iov_len = IPC_SEQPACKET_HEAD_SIZE;
+        iov[1].iov_base = packet->data;
+        iov[1].iov_len = (packet->data)? packet->data_len: 0;
+        iov[2].iov_base = CPLUS_NULL;
+        iov[2].iov_len = 0;
+        return (uint32_t)(iov[0].iov_len + iov[1].iov_len);
+    }
 
-        if (0 != memcmp(IPC_CONN_PACKET_BEGIN_TAG, begin_tag, IPC_CONN_PACKET_TAG_SIZE))
-        {
-            break;
-        }
+    cplus_mem_cpy(head, IPC_CONN_PACKET_BEGIN_TAG, IPC_CONN_PACKET_TAG_SIZE);
+    head[IPC_CONN_PACKET_TAG_SIZE] = packet->seqn;
+    head[IPC_CONN_PACKET_TAG_SIZE + 1] = packet->cmd;
+    cplus_mem_cpy(&(head[IPC_CONN_PACKET_TAG_SIZE + 2]), &network_order, sizeof(network_order));
 
-        curr_tick = cplus_systime_get_tick();
-        if (sizeof(packet->seqn) != cplus_socket_recv(skt, &(packet->seqn), sizeof(packet->seqn), timeout))
+    iov[0].iov_base = head;
+    iov[0].iov_len = IPC_CONN_PACKET_HEAD_SIZE;
+    iov[1].iov_base = packet->data;
+    iov[1].iov_len = (packet->data)? packet->data_len: 0;
+    iov[2].iov_base = IPC_CONN_PACKET_END_TAG;
+    iov[2].iov_len = IPC_CONN_PACKET_TAG_SIZE;
+
+    return (uint32_t)(iov[0].iov_len + iov[1].iov_len + iov[2].iov_len);
+}
+
+static int32_t ipc_recv_iov(
+    cplus_socket skt
+    , struct iovec * iov
+    , int32_t iov_count
+    , uint32_t * timeout)
+{
+    int32_t count = 0;
+    uint32_t curr_tick = 0, elapsed_tick = 0;
+
+    while (true)
+    {
+        while (0 < iov_count AND 0 == iov->iov_len)
         {
-            break;
+            iov ++;
+            iov_count --;
         }
-        timeout -= cplus_systime_elapsed_tick(curr_tick);
-
-        curr_tick = cplus_systime_get_tick();
-        if (sizeof(packet->cmd) != cplus_socket_recv(skt, &(packet->cmd), sizeof(packet->cmd), timeout))
+        if (0 == iov_count)
         {
             break;
         }
-        timeout -= cplus_systime_elapsed_tick(curr_tick);
 
         curr_tick = cplus_systime_get_tick();
-        if (sizeof(packet->data_len) != cplus_socket_recv(skt, &(packet->data_len), sizeof(packet->data_len), timeout))
+        if (0 >= (count = cplus_socket_recvv(skt, iov, iov_count, (* timeout))))
         {
-            break;
+            errno = (0 == count)? ECONNRESET: errno;
+            return CPLUS_FAIL;
         }
-        timeout -= cplus_systime_elapsed_tick(curr_tick);
-        packet->data_len = ntohl(packet->data_len);
 
-        curr_tick = cplus_systime_get_tick();
-        if (0 < packet->data_len AND CPLUS_NULL != output_bufs AND 0 < output_bufs_len)
+        if (CPLUS_INFINITE_TIMEOUT != (* timeout))
         {
-            recv_data = (void *)cplus_malloc(packet->data_len * sizeof(uint8_t));
-            if (recv_data)
-            {
-                recv_count = cplus_socket_recv(skt, recv_data, packet->data_len, timeout);
-                if (0 >= recv_count OR packet->data_len != ((uint32_t)recv_count))
-                {
-                    break;
-                }
-                cplus_mem_cpy_ex(output_bufs, output_bufs_len, recv_data, packet->data_len);
-
-                cplus_free(recv_data);
-                timeout -= cplus_systime_elapsed_tick(curr_tick);
-            }
+            elapsed_tick = cplus_systime_elapsed_tick(curr_tick);
+            (* timeout) = (elapsed_tick < (* timeout))? ((* timeout) - elapsed_tick): 0;
         }
 
-        curr_tick = cplus_systime_get_tick();
-        if (IPC_CONN_PACKET_TAG_SIZE != cplus_socket_recv(skt, end_tag, sizeof(end_tag), timeout))
+        /* A short read resumes in the middle of an entry. */
+        while (0 < iov_count AND 0 < count AND ((size_t)count) >= iov->iov_len)
         {
-            break;
+            count -= iov->iov_len;
+            iov ++;
+            iov_count --;
         }
-        timeout -= cplus_systime_elapsed_tick(curr_tick);
-
-        if (0 != memcmp(IPC_CONN_PACKET_END_TAG, end_tag, IPC_CONN_PACKET_TAG_SIZE))
+        if (0 < iov_count)
         {
-            break;
+            iov->iov_base = &(((uint8_t *)(iov->iov_base))[count]);
+            iov->iov_len -= count;
         }
+    }
+    return CPLUS_SUCCESS;
+}
 
-        res = recv_count;
-    } while (0);
+static int32_t ipc_recv_datagram(
+    cplus_socket skt
+    , IPC_CONN_PACKET packet
+    , uint32_t output_bufs_len
+    , void * output_bufs
+    , uint32_t timeout)
+{
+    uint8_t head[IPC_SEQPACKET_HEAD_SIZE] = {0};
+    struct iovec iov[2] = {0};
+    struct msghdr msg = {0};
+    int32_t count = 0;
+
+    iov[0].iov_base = head;
+    iov[0].iov_len = sizeof(head);
+    iov[1].iov_base = output_bufs;
+    iov[1].iov_len = (output_bufs)? output_bufs_len: 0;
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 2;
+
+    /* MSG_TRUNC reports the length of the whole datagram, what does not fit is dropped with it. */
+    if (0 >= (count = cplus_socket_recvmsg(skt, &msg, MSG_TRUNC, timeout)))
+    {
+        errno = (0 == count)? ECONNRESET: errno;
+        return CPLUS_FAIL;
+    }
 
-    if (recv_data)
+    if (IPC_SEQPACKET_HEAD_SIZE > ((uint32_t)count))
     {
-        cplus_free(recv_data);
+        errno = EPROTO;
+        return CPLUS_FAIL;
     }
-    return res;
+
+    packet->seqn = head[0];
+    packet->cmd = head[1];
+    packet->data_len = ((uint32_t)count) - IPC_SEQPACKET_HEAD_SIZE;
+
+    return (int32_t)CPLUS_MIN(packet->data_len, (uint32_t)(iov[1].iov_len));
 }
 
-int32_t ipc_send_packet(cplus_socket skt, IPC_CONN_PACKET packet)
+int32_t ipc_recv_packet(
+    cplus_socket skt
+    , bool is_seqpacket
+    , IPC_CONN_PACKET packet
+    , uint32_t output_bufs_len
+    , void * output_bufs
+    , uint32_t timeout)
 {
-    int32_t res = CPLUS_FAIL, send_count = 0;
-    uint32_t network_order = 0;
+    uint8_t head[IPC_CONN_PACKET_HEAD_SIZE] = {0}, end_tag[IPC_CONN_PACKET_TAG_SIZE] = {0};
+    uint8_t discard_bufs[DEFAULT_RECEVICE_BUFFER_SIZE];
+    uint32_t copy_len = 0, remain_len = 0;
+    struct iovec iov[2] = {0};
 
     CHECK_NOT_NULL(skt, CPLUS_FAIL);
     CHECK_NOT_NULL(packet, CPLUS_FAIL);
-    /* CHECK_GT_ZERO(packet->seqn, CPLUS_FAIL); */
-    CHECK_IN_INTERVAL(((int32_t)packet->cmd), IPC_CMD_HEARTBEAT, (IPC_CMD_MAX - 1), CPLUS_FAIL);
-    if (0 < packet->data_len)
+
+    if (is_seqpacket)
     {
-        CHECK_NOT_NULL(packet->data, CPLUS_FAIL);
+        return ipc_recv_datagram(skt, packet, output_bufs_len, output_bufs, timeout);
     }
 
-    do
+    iov[0].iov_base = head;
+    iov[0].iov_len = sizeof(head);
+    if (CPLUS_SUCCESS != ipc_recv_iov(skt, iov, 1, &timeout))
     {
-        if (IPC_CONN_PACKET_TAG_SIZE != cplus_socket_send(skt, IPC_CONN_PACKET_BEGIN_TAG, IPC_CONN_PACKET_TAG_SIZE))
-        {
-            break;
-        }
+        return CPLUS_FAIL;
+    }
 
-        if (sizeof(packet->seqn) != cplus_socket_send(skt, &(packet->seqn), sizeof(packet->seqn)))
-        {
-            break;
-        }
+    if (0 != memcmp(IPC_CONN_PACKET_BEGIN_TAG, head, IPC_CONN_PACKET_TAG_SIZE))
+    {
+        errno = EPROTO;
+        return CPLUS_FAIL;
+    }
 
-        if (sizeof(packet->cmd) != cplus_socket_send(skt, &(packet->cmd), sizeof(packet->cmd)))
-        {
-            break;
-        }
+    packet->seqn = head[IPC_CONN_PACKET_TAG_SIZE];
+    packet->cmd = head[IPC_CONN_PACKET_TAG_SIZE + 1];
+    cplus_mem_cpy(&(packet->data_len), &(head[IPC_CONN_PACKET_TAG_SIZE + 2]), sizeof(packet->data_len));
+    packet->data_len = ntohl(packet->data_len);
+    if (MAX_FRAME_DATA_SIZE < packet->data_len)
+    {
+        errno = EMSGSIZE;
+        return CPLUS_FAIL;
+    }
 
-        /* Convert network byte order. */
-        network_order = htonl(packet->data_len);
-        if (sizeof(packet->data_len) != cplus_socket_send(skt, &network_order, sizeof(packet->data_len)))
+    /* The payload lands straight in the caller's buffer, together with the tail tag when it fits. */
+    copy_len = (output_bufs)? CPLUS_MIN(packet->data_len, output_bufs_len): 0;
+    remain_len = packet->data_len - copy_len;
+    iov[0].iov_base = output_bufs;
+    iov[0].iov_len = copy_len;
+    iov[1].iov_base = end_tag;
+    iov[1].iov_len = sizeof(end_tag);
+    if (0 < remain_len)
+    {
+        if (CPLUS_SUCCESS != ipc_recv_iov(skt, iov, 1, &timeout))
         {
-            break;
+            return CPLUS_FAIL;
         }
 
-        if (0 < packet->data_len AND CPLUS_NULL != packet->data)
+        while (0 < remain_len)
         {
-            send_count = cplus_socket_send(skt, packet->data, packet->data_len);
-            if (0 > send_count OR packet->data_len != ((uint32_t)send_count))
+            iov[0].iov_base = discard_bufs;
+            iov[0].iov_len = CPLUS_MIN(remain_len, sizeof(discard_bufs));
+            remain_len -= iov[0].iov_len;
+            if (CPLUS_SUCCESS != ipc_recv_iov(skt, iov, 1, &timeout))
             {
-                break;
+                return CPLUS_FAIL;
             }
         }
 
-        if (IPC_CONN_PACKET_TAG_SIZE != cplus_socket_send(skt, IPC_CONN_PACKET_END_TAG, IPC_CONN_PACKET_TAG_SIZE))
-        {
-            break;
-        }
+        iov[0].iov_len = 0;
+    }
 
-        res = send_count;
-    } while (0);
+    if (CPLUS_SUCCESS != ipc_recv_iov(skt, iov, 2, &timeout))
+    {
+        return CPLUS_FAIL;
+    }
 
-    return res;
+    if (0 != memcmp(IPC_CONN_PACKET_END_TAG, end_tag, IPC_CONN_PACKET_TAG_SIZE))
+    {
+        errno = EPROTO;
+        return CPLUS_FAIL;
+    }
+
+    return (int32_t)copy_len;
 }
 
-static int32_t packet_analyze_completed(struct ipc_conn * ipc_conn)
+static int32_t ipc_send_frame(cplus_socket skt, bool is_seqpacket, IPC_CONN_PACKET packet, int32_t send_fd)
 {
-    int32_t res = CPLUS_SUCCESS;
-    uint32_t dataout_size = ipc_conn->response_data_size;
-    struct ipc_conn_packet * completed_packet = &(ipc_conn->packet), response_packet = {0};
+    uint8_t head[IPC_CONN_PACKET_HEAD_SIZE] = {0};
+    struct iovec iov[3] = {0};
+    uint32_t total = 0;
 
-    switch(completed_packet->cmd)
+    CHECK_NOT_NULL(skt, CPLUS_FAIL);
+    CHECK_NOT_NULL(packet, CPLUS_FAIL);
+    /* CHECK_GT_ZERO(packet->seqn, CPLUS_FAIL); */
+    CHECK_IN_INTERVAL(((int32_t)packet->cmd), IPC_CMD_HEARTBEAT, (IPC_CMD_MAX - 1), CPLUS_FAIL);
+    if (0 < packet->data_len)
     {
-    default:
-    case IPC_CMD_ACK:
-        break;
-    case IPC_CMD_HEARTBEAT:
-        {
-            response_packet.seqn = completed_packet->seqn;
-            response_packet.cmd = IPC_CMD_ACK;
-            response_packet.data_len = 0;
-            response_packet.data = CPLUS_NULL;
-            res = ipc_send_packet(ipc_conn->sock, &response_packet);
-        }
-        break;
-    case IPC_CMD_ONEWAY:
-    case IPC_CMD_REQUEST:
-    case IPC_CMD_RESPONSE:
-        {
-            if (ipc_conn->on_received)
-            {
-                if (CPLUS_NULL == ipc_conn->response_data)
-                {
-                    ipc_conn->response_data = (void *)cplus_malloc(ipc_conn->response_data_size);
-                    if (CPLUS_NULL == ipc_conn->response_data)
-                    {
-                        return CPLUS_FAIL;
-                    }
-                    cplus_mem_set(ipc_conn->response_data, 0x00, ipc_conn->response_data_size);
-                }
+        CHECK_NOT_NULL(packet->data, CPLUS_FAIL);
+    }
 
-                res = ipc_conn->on_received(
-                    ipc_conn->sock
-                    , completed_packet->data_len
-                    , completed_packet->data
-                    , &dataout_size /* Pass current size of 'response_data'. */
-                    , ipc_conn->response_data);
+    if (IPC_MAX_FRAME_DATA_SIZE(is_seqpacket) < packet->data_len)
+    {
+        /* The receiver would take it for garbage, only a shared memory ring or a memfd carries it. */
+        errno = EMSGSIZE;
+        return CPLUS_FAIL;
+    }
 
-                if (CPLUS_FAIL == res)
-                {
-                    return CPLUS_FAIL;
-                }
+    /* The whole frame goes out in one sendmsg(), instead of one send() per field. */
+    total = ipc_packet_build_iov(packet, is_seqpacket, head, iov);
+    if (((int32_t)total) != ((INVALID_FD == send_fd)
+        ? cplus_socket_sendv(skt, iov, 3)
+        : cplus_socket_sendv_fd(skt, iov, 3, send_fd)))
+    {
+        return CPLUS_FAIL;
+    }
 
-                /* The needed buffer size is larger than the size of existing buffer. */
-                if (dataout_size > ipc_conn->response_data_size)
-                {
-                    /* Re-allocate new buffer size based on needed size. */
-                    ipc_conn->response_data = (void *)cplus_realloc(
-                        ipc_conn->response_data
-                        , dataout_size);
-                    if (CPLUS_NULL == ipc_conn->response_data)
-                    {
-                        return CPLUS_FAIL;
-                    }
-                    cplus_mem_set(ipc_conn->response_data, 0x00, dataout_size);
-
-                    /* Update and store existing size. */
-                    ipc_conn->response_data_size = dataout_size;
+    return (int32_t)(packet->data_len);
+}
 
-                    /* Invoke on_received() callback function to get compleled data. */
-                    res = ipc_conn->on_received(
-                        ipc_conn->sock
-                        , completed_packet->data_len
-                        , completed_packet->data
-                        , &(ipc_conn->response_data_size)
-                        , ipc_conn->response_data);
+int32_t ipc_send_packet(cplus_socket skt, bool is_seqpacket, IPC_CONN_PACKET packet)
+{
+    return ipc_send_frame(skt, is_seqpacket, packet, INVALID_FD);
+}
 
-                    if (CPLUS_FAIL == res)
-                    {
-                        return CPLUS_FAIL;
-                    }
-                }
+static inline uint64_t ipc_get_nsec(void)
+{
+    struct timespec ts = {0};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)(ts.tv_sec) * 1000000000ULL) + (uint64_t)(ts.tv_nsec);
+}
 
-                if (IPC_CMD_REQUEST == completed_packet->cmd)
-                {
-                    if (0 != ipc_conn->response_data_size)
-                    {
-                        response_packet.seqn = completed_packet->seqn;
-                        response_packet.cmd = IPC_CMD_RESPONSE;
-                        response_packet.data_len = dataout_size;
-                        response_packet.data = ipc_conn->response_data;
-                        res = ipc_send_packet(ipc_conn->sock, &response_packet);
-                    }
-                }
-                else if (IPC_CMD_RESPONSE == completed_packet->cmd)
-                {
-                    response_packet.seqn = completed_packet->seqn;
-                    response_packet.cmd = IPC_CMD_ACK;
-                    response_packet.data_len = 0;
-                    response_packet.data = CPLUS_NULL;
-                    res = ipc_send_packet(ipc_conn->sock, &response_packet);
-                }
-            }
-        }
-        break;
-    }
+static inline void ipc_histogram_add(CPLUS_IPC_HISTOGRAM histogram, uint64_t nsec)
+{
+    uint64_t usec = nsec / 1000, max_nsec = cplus_atomic_read(&(histogram->max_nsec));
+    uint32_t index = (0 == usec)? 0: (64 - __builtin_clzll(usec));
 
-    return res;
+    cplus_atomic_add(&(histogram->count), 1);
+    cplus_atomic_add(&(histogram->total_nsec), nsec);
+    while (max_nsec < nsec AND false == cplus_atomic_compare_exchange(&(histogram->max_nsec), &max_nsec, &nsec));
+    cplus_atomic_add(&(histogram->buckets[CPLUS_MIN(index, CPLUS_IPC_HISTOGRAM_BUCKETS - 1)]), 1);
 }
 
-static void ipc_packet_analyze(
-    struct ipc_conn * ipc_conn
-    , int32_t (* on_completed)(struct ipc_conn *))
+static void ipc_conn_counters_merge(struct ipc_conn_counters * dest, struct ipc_conn_counters * src)
 {
-    uint32_t diff = 0, walker_count = (((uint32_t)ipc_conn->recv_count) + ipc_conn->recv_bufs_offset);
-    struct ipc_conn_packet * packet = &(ipc_conn->packet);
-
-    while (ipc_conn->recv_bufs_offset < walker_count)
+    /* 'src' may be counted into while it is read, 'dest' belongs to the caller. */
+    dest->bytes_received += cplus_atomic_read(&(src->bytes_received));
+    dest->bytes_sent += cplus_atomic_read(&(src->bytes_sent));
+    dest->messages_received += cplus_atomic_read(&(src->messages_received));
+    dest->messages_sent += cplus_atomic_read(&(src->messages_sent));
+    (dest->request_time).count += cplus_atomic_read(&((src->request_time).count));
+    (dest->request_time).total_nsec += cplus_atomic_read(&((src->request_time).total_nsec));
+    (dest->request_time).max_nsec = CPLUS_MAX(
+        (dest->request_time).max_nsec
+        , cplus_atomic_read(&((src->request_time).max_nsec)));
+    for (uint32_t i = 0; i < CPLUS_IPC_HISTOGRAM_BUCKETS; i++)
     {
-        switch (ipc_conn->recv_stage)
-        {
-        default:
-        case IPC_CONN_STAGE_RECV_HEAD:
-            {
-                if (IPC_CONN_PACKET_BEGIN_TAG[ipc_conn->sub_offset] == ((uint8_t *)(ipc_conn->recv_bufs))[ipc_conn->recv_bufs_offset])
-                {
-                    ipc_conn->sub_offset += sizeof(uint8_t);
-                    if (IPC_CONN_PACKET_TAG_SIZE <= ipc_conn->sub_offset)
-                    {
-                        /* Recvice a head tag, hence reset event fo receive a packet. */
-                        if (ipc_conn->evt_packet_received)
-                        {
-                            cplus_pevent_reset(ipc_conn->evt_packet_received);
-                        }
-
-                        ipc_conn->recv_stage = IPC_CONN_STAGE_RECV_SEQN;
-                        ipc_conn->sub_offset = 0;
-                    }
-                }
-                else
-                {
-                    /* Drop this packet, re-pick a new one. */
-                    ipc_conn->recv_stage = IPC_CONN_STAGE_RECV_HEAD;
-                    ipc_conn->sub_offset = 0;
-                }
-                ipc_conn->recv_bufs_offset += sizeof(uint8_t);
-            }
-            break;
-        case IPC_CONN_STAGE_RECV_SEQN:
-            {
-                packet->seqn = ((uint8_t *)(ipc_conn->recv_bufs))[ipc_conn->recv_bufs_offset];
-                ipc_conn->recv_stage = IPC_CONN_STAGE_RECV_CMD;
-                ipc_conn->recv_bufs_offset += sizeof(uint8_t);
-            }
-            break;
-        case IPC_CONN_STAGE_RECV_CMD:
-            {
-                packet->cmd = ((uint8_t *)(ipc_conn->recv_bufs))[ipc_conn->recv_bufs_offset];
-                ipc_conn->recv_stage = IPC_CONN_STAGE_RECV_DATA_LEN;
-                ipc_conn->recv_bufs_offset += sizeof(uint8_t);
-            }
-            break;
-        case IPC_CONN_STAGE_RECV_DATA_LEN:
-            {
-                if (0 == ipc_conn->sub_offset)
-                {
-                    packet->data_len = 0;
-                }
-                if (sizeof(packet->data_len) > ipc_conn->sub_offset)
-                {
-                    packet->data_len <<= (ipc_conn->sub_offset? 8: 0);
-                    packet->data_len += ((uint8_t *)(ipc_conn->recv_bufs))[ipc_conn->recv_bufs_offset];
-                    ipc_conn->sub_offset += sizeof(uint8_t);
-                    ipc_conn->recv_bufs_offset += sizeof(uint8_t);
-                }
-                else
-                {
-                    ipc_conn->sub_offset = 0;
+        (dest->request_time).buckets[i] += cplus_atomic_read(&((src->request_time).buckets[i]));
+    }
+}
 
-                    if (MAX_PACKET_DATA_SIZE < packet->data_len)
-                    {
-                        /* Drop this packet, re-pick a new one. */
-                        ipc_conn->recv_stage = IPC_CONN_STAGE_RECV_HEAD;
-                        ipc_conn->sub_offset = 0;
-                    }
+static inline void ipc_conn_count_sent(struct ipc_conn * ipc_conn, uint32_t data_len)
+{
+    /* Stats readers do not take send_sect, so every counter moves atomically. */
+    cplus_atomic_add(&((ipc_conn->counters).bytes_sent), data_len);
+    cplus_atomic_add(&((ipc_conn->counters).messages_sent), 1);
+    ipc_conn->last_active_tick = cplus_systime_get_tick();
+}
 
-                    if (0 < packet->data_len)
-                    {
-                        ipc_conn->recv_stage = IPC_CONN_STAGE_RECV_DATA;
-                    }
-                    else
-                    {
-                        ipc_conn->recv_stage = IPC_CONN_STAGE_RECV_TAIL;
-                    }
-                }
-            }
-            break;
-        case IPC_CONN_STAGE_RECV_DATA:
-            {
-                if (packet->data_len > ipc_conn->packet_databufs_size)
-                {
-                    if (CPLUS_NULL == ipc_conn->packet_databufs)
-                    {
-                        ipc_conn->packet_databufs = (void *)cplus_malloc(packet->data_len);
-                    }
-                    else
-                    {
-                        ipc_conn->packet_databufs = (void *)cplus_realloc(
-                            ipc_conn->packet_databufs
-                            , packet->data_len);
-                    }
+static inline void ipc_conn_count_request(struct ipc_conn * ipc_conn, uint64_t start_nsec)
+{
+    uint64_t nsec = ipc_get_nsec() - start_nsec;
 
-                    if (ipc_conn->packet_databufs)
-                    {
-                        ipc_conn->packet_databufs_size = packet->data_len;
-                        cplus_mem_set(ipc_conn->packet_databufs, 0x00, ipc_conn->packet_databufs_size);
-                    }
-                }
-                else
-                {
-                    if (CPLUS_NULL == ipc_conn->packet_databufs)
-                    {
-                        ipc_conn->packet_databufs = (void *)cplus_malloc(ipc_conn->packet_databufs_size);
-                        cplus_mem_set(ipc_conn->packet_databufs, 0x00, ipc_conn->packet_databufs_size);
-                    }
-                }
+    ipc_histogram_add(&((ipc_conn->counters).request_time), nsec);
+    ipc_conn->last_request_nsec = nsec;
+}
 
-                if (CPLUS_NULL == ipc_conn->packet_databufs)
-                {
-                    /* Cannot allocate memory
-                    Drop this packet, re-pick a new one. */
-                    ipc_conn->recv_stage = IPC_CONN_STAGE_RECV_HEAD;
-                    ipc_conn->sub_offset = 0;
-                }
-                else
-                {
-                    packet->data = ipc_conn->packet_databufs;
+static inline uint32_t ipc_conn_get_queued_bytes(struct ipc_conn * ipc_conn)
+{
+    uint32_t len = ipc_conn->send_bufs_len, offset = ipc_conn->send_bufs_offset;
 
-                    diff = CPLUS_MIN(
-                        (packet->data_len - ipc_conn->packet_databufs_offset)
-                        , (ipc_conn->recv_bufs_size - ipc_conn->recv_bufs_offset));
+    /* Read without send_sect, the two may be a write apart. */
+    return (len > offset)? (len - offset): 0;
+}
 
-                    cplus_mem_cpy_ex(
-                        &(((uint8_t *)(packet->data))[ipc_conn->packet_databufs_offset])
-                        , diff
-                        , &(ipc_conn->recv_bufs[ipc_conn->recv_bufs_offset])
-                        , diff);
+static void ipc_conn_get_stats(struct ipc_conn * ipc_conn, CPLUS_IPC_CONN_STATS stats)
+{
+    struct ipc_conn_counters counters = {0};
+
+    ipc_conn_counters_merge(&counters, &(ipc_conn->counters));
+    CPLUS_INITIALIZE_STRUCT_POINTER(stats);
+    stats->conn_sock = ipc_conn->sock;
+    stats->bytes_received = counters.bytes_received;
+    stats->bytes_sent = counters.bytes_sent;
+    stats->messages_received = counters.messages_received;
+    stats->messages_sent = counters.messages_sent;
+    stats->queued_bytes = ipc_conn_get_queued_bytes(ipc_conn);
+    stats->inflight_count = cplus_atomic_read(&(ipc_conn->job_count));
+    stats->last_active_tick = ipc_conn->last_active_tick;
+    stats->is_slow = ipc_conn->is_slow;
+    cplus_mem_cpy(&(stats->request_time), &(counters.request_time), sizeof(CPLUS_IPC_HISTOGRAM_T));
+}
 
-                    ipc_conn->packet_databufs_offset += diff;
-                    ipc_conn->recv_bufs_offset += diff;
+static void ipc_conn_check_slow(struct ipc_conn * ipc_conn)
+{
+    struct ipc_server * ipc_serv = ipc_conn->ipc_serv;
+    CPLUS_IPC_CONN_STATS_T stats = {0};
+    bool is_slow = false;
 
-                    if (0 >= (packet->data_len - ipc_conn->packet_databufs_offset))
-                    {
-                        ipc_conn->recv_stage = IPC_CONN_STAGE_RECV_TAIL;
-                        ipc_conn->packet_databufs_offset = 0;
-                    }
-                }
-            }
-            break;
-        case IPC_CONN_STAGE_RECV_TAIL:
-            {
-                if (IPC_CONN_PACKET_END_TAG[ipc_conn->sub_offset] == ((uint8_t *)(ipc_conn->recv_bufs))[ipc_conn->recv_bufs_offset])
-                {
-                    ipc_conn->sub_offset += sizeof(uint8_t);
-                    if (IPC_CONN_PACKET_TAG_SIZE <= ipc_conn->sub_offset)
-                    {
-                        ipc_conn->recv_stage = IPC_CONN_STAGE_RECV_HEAD;
-                        ipc_conn->sub_offset = 0;
+    /* Only ever called on the thread that serves the connection and with no lock held,
+    so the callback may look at the server freely. */
+    if (0 < ipc_serv->slow_queued_bytes AND ipc_serv->slow_queued_bytes < ipc_conn_get_queued_bytes(ipc_conn))
+    {
+        is_slow = true;
+    }
+    if (0 < ipc_serv->slow_request_msec AND (ipc_serv->slow_request_msec * 1000000ULL) < ipc_conn->last_request_nsec)
+    {
+        is_slow = true;
+    }
 
-                        if (on_completed)
-                        {
-                            on_completed(ipc_conn);
-                        }
+    if (is_slow == ipc_conn->is_slow)
+    {
+        return;
+    }
+    ipc_conn->is_slow = is_slow;
 
-                        if (ipc_conn->evt_packet_received)
-                        {
-                            cplus_pevent_set(ipc_conn->evt_packet_received);
-                            if (true == ipc_conn->is_async)
-                            {
-                                /* Re-pick another new packet. */
-                                break;
-                            }
-                        }
-                    }
-                }
-                else
-                {
-                    /* Drop this packet, re-pick a new one. */
-                    ipc_conn->recv_stage = IPC_CONN_STAGE_RECV_HEAD;
-                    ipc_conn->sub_offset = 0;
-                }
-                ipc_conn->recv_bufs_offset += sizeof(uint8_t);
-            }
-            break;
+    if (true == is_slow)
+    {
+        cplus_atomic_add(&(ipc_serv->slow_count), 1);
+        if (ipc_serv->on_slow_consumer)
+        {
+            ipc_conn_get_stats(ipc_conn, &stats);
+            ipc_serv->on_slow_consumer(ipc_conn->sock, &stats);
         }
     }
 }
 
-static void ipc_conn_proc(void * param1, void * param2)
+static int32_t ipc_conn_queue_bytes(struct ipc_conn * ipc_conn, void * data, uint32_t data_len)
 {
-    struct ipc_conn * ipc_conn = (struct ipc_conn *)(param1);
-    UNUSED_PARAM(param2);
+    uint32_t pending = ipc_conn->send_bufs_len - ipc_conn->send_bufs_offset;
+    uint8_t * bufs = CPLUS_NULL;
 
-    if (IPC_CONN_STATUS_NOT_CONNECTED == ipc_conn->status)
+    if (0 == data_len)
     {
-        return;
+        return CPLUS_SUCCESS;
     }
 
-    if (ipc_conn->recv_bufs_offset >= ipc_conn->recv_bufs_size)
+    if (ipc_conn->send_bufs_size < (ipc_conn->send_bufs_len + data_len))
     {
-        ipc_conn->recv_bufs_offset = 0;
+        if (0 < ipc_conn->send_bufs_offset)
+        {
+            /* Slide the unsent bytes to the front before considering to grow. */
+            memmove(ipc_conn->send_bufs, &(ipc_conn->send_bufs[ipc_conn->send_bufs_offset]), pending);
+            ipc_conn->send_bufs_base += ipc_conn->send_bufs_offset;
+            ipc_conn->send_bufs_offset = 0;
+            ipc_conn->send_bufs_len = pending;
+        }
+
+        if (ipc_conn->send_bufs_size < (pending + data_len))
+        {
+            /* cplus_realloc() refuses a NULL pointer and drops the old block on failure,
+            so grow by hand to keep the queued bytes intact. */
+            if (CPLUS_NULL == (bufs = (uint8_t *)cplus_malloc(
+                CPLUS_MAX(pending + data_len, 2 * ipc_conn->send_bufs_size))))
+            {
+                return CPLUS_FAIL;
+            }
+            if (ipc_conn->send_bufs)
+            {
+                cplus_mem_cpy(bufs, ipc_conn->send_bufs, pending);
+                cplus_free(ipc_conn->send_bufs);
+            }
+            ipc_conn->send_bufs = bufs;
+            ipc_conn->send_bufs_size = CPLUS_MAX(pending + data_len, 2 * ipc_conn->send_bufs_size);
+        }
     }
 
-    ipc_conn->recv_count = cplus_socket_recv(
-        ipc_conn->sock
-        , &(((uint8_t *)(ipc_conn->recv_bufs))[ipc_conn->recv_bufs_offset])
-        , (ipc_conn->recv_bufs_size - ipc_conn->recv_bufs_offset)
-        , ipc_conn->recv_timeout);
+    cplus_mem_cpy(&(ipc_conn->send_bufs[ipc_conn->send_bufs_len]), data, data_len);
+    ipc_conn->send_bufs_len += data_len;
 
-    if (0 == ipc_conn->recv_count)
+    return CPLUS_SUCCESS;
+}
+
+static int32_t ipc_conn_queue_frame(
+    struct ipc_conn * ipc_conn
+    , struct iovec * iov
+    , uint32_t iov_count
+    , uint32_t total
+    , uint32_t sent)
+{
+    uint32_t skip = 0;
+
+    /* A datagram leaves whole or not at all, so it waits as a record behind its length. */
+    if (sent < total AND ipc_conn->is_seqpacket
+        AND CPLUS_SUCCESS != ipc_conn_queue_bytes(ipc_conn, &total, IPC_SEQPACKET_RECORD_HEAD_SIZE))
     {
-        if (ipc_conn->ipc_serv)
+        return CPLUS_FAIL;
+    }
+
+    for (uint32_t i = 0; i < iov_count AND sent < total; i++)
+    {
+        if (skip + iov[i].iov_len <= sent)
         {
-            cplus_crit_sect_enter((ipc_conn->ipc_serv)->ipc_conn_sect);
+            skip += iov[i].iov_len;
+            continue;
         }
-
-        if (ipc_conn->on_disconnected)
+        if (CPLUS_SUCCESS != ipc_conn_queue_bytes(
+            ipc_conn
+            , &(((uint8_t *)(iov[i].iov_base))[sent - skip])
+            , iov[i].iov_len - (sent - skip)))
         {
-            ipc_conn->on_disconnected(ipc_conn->sock);
+            return CPLUS_FAIL;
         }
+        skip += iov[i].iov_len;
+        sent = skip;
+    }
+    return CPLUS_SUCCESS;
+}
 
-        cplus_socket_delete(ipc_conn->sock);
-        ipc_conn->sock = CPLUS_NULL;
-        ipc_conn->status = IPC_CONN_STATUS_NOT_CONNECTED;
+static ssize_t ipc_conn_sendmsg(struct ipc_conn * ipc_conn, struct iovec * iov, uint32_t iov_count, int32_t send_fd)
+{
+    struct msghdr msg = {0};
+    struct cmsghdr * cmptr = CPLUS_NULL;
+    ssize_t count = 0;
+    union
+    {
+        struct cmsghdr cm;
+        uint8_t control[CMSG_SPACE(sizeof(int32_t))];
+    } control_un;
 
-        if (ipc_conn->ipc_serv)
-        {
-            cplus_crit_sect_exit((ipc_conn->ipc_serv)->ipc_conn_sect);
-        }
+    msg.msg_iov = iov;
+    msg.msg_iovlen = iov_count;
+    if (INVALID_FD != send_fd)
+    {
+        cplus_mem_set(&control_un, 0x00, sizeof(control_un));
+        msg.msg_control = control_un.control;
+        msg.msg_controllen = sizeof(control_un.control);
+        cmptr = CMSG_FIRSTHDR(&msg);
+        cmptr->cmsg_len = CMSG_LEN(sizeof(int32_t));
+        cmptr->cmsg_level = SOL_SOCKET;
+        cmptr->cmsg_type = SCM_RIGHTS;
+        cplus_mem_cpy(CMSG_DATA(cmptr), &send_fd, sizeof(int32_t));
     }
-    else if (0 > ipc_conn->recv_count)
+
+    do
     {
-        ipc_conn->sock_error = errno;
+        count = sendmsg(cplus_socket_get_fd(ipc_conn->sock), &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+    } while (0 > count AND EINTR == errno);
 
-        if (ipc_conn->ipc_serv)
-        {
-            cplus_crit_sect_enter((ipc_conn->ipc_serv)->ipc_conn_sect);
-        }
+    return count;
+}
 
-        switch (ipc_conn->sock_error)
+static int32_t ipc_conn_flush(struct ipc_conn * ipc_conn)
+{
+    ssize_t count = 0;
+    uint64_t pos = 0;
+    uint32_t record_len = 0;
+    int32_t send_fd = INVALID_FD;
+    struct iovec iov = {0};
+
+    while (ipc_conn->send_bufs_offset < ipc_conn->send_bufs_len)
+    {
+        pos = ipc_conn->send_bufs_base + ipc_conn->send_bufs_offset;
+        iov.iov_base = &(ipc_conn->send_bufs[ipc_conn->send_bufs_offset]);
+        iov.iov_len = ipc_conn->send_bufs_len - ipc_conn->send_bufs_offset;
+        send_fd = INVALID_FD;
+        if (ipc_conn->is_seqpacket)
         {
-        default:
-        case EBADF:
-            /* The argument sockfd is an invalid file descriptor. */
-        case EFAULT:
-            /* The receive buffer pointer(s) point outside the process's
-            address space. */
-        case EINVAL:
-            /* Invalid argument passed. */
-        case ENOMEM:
-            /* Could not allocate memory for recv(). */
+            /* One record is one datagram, a memfd queued with it is keyed by the record. */
+            cplus_mem_cpy(&record_len, iov.iov_base, IPC_SEQPACKET_RECORD_HEAD_SIZE);
+            iov.iov_base = &(ipc_conn->send_bufs[ipc_conn->send_bufs_offset + IPC_SEQPACKET_RECORD_HEAD_SIZE]);
+            iov.iov_len = record_len;
+            if (0 < ipc_conn->send_fds_count AND pos == ipc_conn->send_fds[ipc_conn->send_fds_head].pos)
             {
-                ipc_conn->status = IPC_CONN_STATUS_FAULT;
+                send_fd = ipc_conn->send_fds[ipc_conn->send_fds_head].fd;
             }
-            break;
-        case ETIMEDOUT:
-            /* Timeout */
+        }
+        else if (0 < ipc_conn->send_fds_count)
+        {
+            /* A queued memfd leaves with the first byte of its descriptor frame, so the
+            bytes ahead of it go out on their own. */
+            if (pos == ipc_conn->send_fds[ipc_conn->send_fds_head].pos)
             {
-                ipc_conn->status = IPC_CONN_STATUS_TIMEOUT;
+                send_fd = ipc_conn->send_fds[ipc_conn->send_fds_head].fd;
             }
-            break;
-        case ENOTCONN:
-            /* The socket is associated with a connection-oriented
-            protocol and has not been connected */
+            else
             {
-                ipc_conn->status = IPC_CONN_STATUS_NOT_CONNECTED;
+                iov.iov_len = CPLUS_MIN(iov.iov_len, (size_t)(ipc_conn->send_fds[ipc_conn->send_fds_head].pos - pos));
             }
-            break;
-        case EINTR:
-            /* The receive was interrupted by delivery of a signal before
-            any data was available. */
-            break;
         }
 
-        if (ipc_conn->ipc_serv)
+        if (0 > (count = ipc_conn_sendmsg(ipc_conn, &iov, 1, send_fd)))
         {
-            cplus_crit_sect_exit((ipc_conn->ipc_serv)->ipc_conn_sect);
+            if (EAGAIN == errno OR EWOULDBLOCK == errno)
+            {
+                /* The rest goes out once the reactor reports the socket writable. */
+                return CPLUS_SUCCESS;
+            }
+            ipc_conn->sock_error = errno;
+            return CPLUS_FAIL;
         }
 
-        if (ipc_conn->on_error)
+        if (INVALID_FD != send_fd)
         {
-            ipc_conn->on_error(ipc_conn->sock, ipc_conn->sock_error);
+            close(send_fd);
+            ipc_conn->send_fds_head = (ipc_conn->send_fds_head + 1) % IPC_CONN_MAX_PASSED_FDS;
+            ipc_conn->send_fds_count --;
         }
+        ipc_conn->send_bufs_offset += (uint32_t)count
+            + ((ipc_conn->is_seqpacket)? IPC_SEQPACKET_RECORD_HEAD_SIZE: 0);
     }
-    else
-    {
-        /* Received the packet successfully, so refresh the status. */
-        ipc_conn->sock_error = 0;
-        ipc_conn->status = IPC_CONN_STATUS_CONNECTED;
 
-        ipc_packet_analyze(
-            ipc_conn
-            , packet_analyze_completed);
-    }
-    return;
+    ipc_conn->send_bufs_base += ipc_conn->send_bufs_len;
+    ipc_conn->send_bufs_offset = 0;
+    ipc_conn->send_bufs_len = 0;
+    return CPLUS_SUCCESS;
 }
 
-static struct ipc_conn * ipc_conn_create(
-    struct ipc_server * ipc_serv
-    , cplus_socket conn_sock
-    , bool is_async
-    , CPLUS_IPC_CB_ON_RECEIVED on_received
-    , CPLUS_IPC_CB_ON_DISCONNECTED on_disconnected
-    , CPLUS_IPC_CB_ON_ERROR on_error)
+static int32_t ipc_conn_attach_shm(struct ipc_conn * ipc_conn, cplus_sharedmem shm, bool is_server)
 {
-    struct ipc_conn * conn = CPLUS_NULL;
+    struct ipc_shm_header * header = (struct ipc_shm_header *)cplus_sharedmem_alloc(shm);
+    uint8_t * rings = &(((uint8_t *)header)[IPC_SHM_HEADER_SIZE]);
+    uint32_t ring_size = header->ring_size;
 
-    if ((conn = (struct ipc_conn *)((ipc_serv)
-        ? (struct ipc_conn *)cplus_mempool_alloc(ipc_serv->ipc_conn_pool)
-        : (struct ipc_conn *)cplus_malloc(sizeof(struct ipc_conn)))))
+    /* The layout comes from the other process, so hold it against what is actually mapped. */
+    if (0 == ring_size
+        OR ((uint64_t)cplus_sharedmem_get_size(shm)) < (IPC_SHM_HEADER_SIZE + (2ULL * ring_size)))
     {
-        CPLUS_INITIALIZE_STRUCT_POINTER(conn);
-        conn->ipc_serv = ipc_serv;
-        conn->is_async = is_async;
-        conn->recv_timeout = CPLUS_INFINITE_TIMEOUT;
-        conn->sock = conn_sock;
-        conn->evt_packet_received = CPLUS_NULL;
-        conn->status = IPC_CONN_STATUS_NOT_CONNECTED;
-        conn->sock_error = 0;
-        conn->recv_stage = IPC_CONN_STAGE_RECV_HEAD;
-        conn->recv_count = 0;
-        conn->recv_bufs = CPLUS_NULL;
-        conn->recv_bufs_size = DEFAULT_RECEVICE_BUFFER_SIZE;
-        conn->recv_bufs_offset = 0;
-        conn->sub_offset = 0;
-        conn->packet_databufs = CPLUS_NULL;
-        conn->packet_databufs_size = DEFAULT_PACKET_DATA_SIZE;
-        conn->packet_databufs_offset = 0;
-        conn->response_data_size = DEFAULT_RESPONSE_BUFS_SIZE;
-        conn->response_data = CPLUS_NULL;
-        conn->conn_task = CPLUS_NULL;
+        errno = EINVAL;
+        return CPLUS_FAIL;
+    }
 
-        if (on_received)
-        {
-            conn->on_received = on_received;
-        }
-        if (on_disconnected)
-        {
-            conn->on_disconnected = on_disconnected;
-        }
-        if (on_error)
-        {
-            conn->on_error = on_error;
-        }
+    ipc_conn->shm = shm;
+    ipc_conn->shm_ring_size = ring_size;
+    ipc_conn->shm_tx_data = (is_server)? &(rings[ring_size]): rings;
+    ipc_conn->shm_tx_tail = &(header->tails[(is_server)? IPC_SHM_RING_TO_CLIENT: IPC_SHM_RING_TO_SERVER]);
+    ipc_conn->shm_tx_head = cplus_atomic_read(ipc_conn->shm_tx_tail);
+    ipc_conn->shm_tx_reserved = CPLUS_NULL;
+    ipc_conn->shm_rx_data = (is_server)? rings: &(rings[ring_size]);
+    ipc_conn->shm_rx_tail = &(header->tails[(is_server)? IPC_SHM_RING_TO_SERVER: IPC_SHM_RING_TO_CLIENT]);
+    ipc_conn->shm_rx_release = 0;
 
-        if (CPLUS_NULL == conn->recv_bufs)
-        {
-            conn->recv_bufs = (uint8_t *)cplus_malloc(conn->recv_bufs_size);
-            if (CPLUS_NULL == conn->recv_bufs)
-            {
-                goto error;
-            }
-            cplus_mem_set(conn->recv_bufs, 0x00, conn->recv_bufs_size);
-        }
+    return CPLUS_SUCCESS;
+}
 
-        if (true == conn->is_async)
-        {
-            conn->conn_task = cplus_task_new(
-                ipc_conn_proc
-                , conn
-                , CPLUS_NULL
-                , DURATION_FOR_IPC_CONN_TASK);
-            if (CPLUS_NULL == conn->conn_task)
-            {
-                goto error;
-            }
-            cplus_task_start(conn->conn_task, 500);
-        }
-        else
-        {
-            if (CPLUS_NULL == conn->evt_packet_received)
-            {
-                conn->evt_packet_received = cplus_pevent_new(true, false);
-                if (CPLUS_NULL == conn->evt_packet_received)
-                {
-                    goto error;
-                }
-            }
-        }
-        return conn;
+static uint8_t * ipc_conn_shm_reserve(struct ipc_conn * ipc_conn, uint32_t * avail_len)
+{
+    uint64_t used = ipc_conn->shm_tx_head - cplus_atomic_read(ipc_conn->shm_tx_tail);
+    uint32_t free_len = ipc_conn->shm_ring_size - (uint32_t)(used);
+    uint32_t pos = (uint32_t)(ipc_conn->shm_tx_head % ipc_conn->shm_ring_size);
+    uint32_t to_end = ipc_conn->shm_ring_size - pos;
+
+    /* A frame never wraps, it takes the free run up to the end of the ring, or skips
+    that run when the one from the start of the ring is longer. */
+    ipc_conn->shm_tx_pad = 0;
+    if (free_len <= to_end OR to_end >= (free_len - to_end))
+    {
+        (* avail_len) = CPLUS_MIN(free_len, to_end);
+        ipc_conn->shm_tx_reserved = &(ipc_conn->shm_tx_data[pos]);
     }
-error:
-    ipc_conn_delete(conn);
-    return CPLUS_NULL;
+    else
+    {
+        ipc_conn->shm_tx_pad = to_end;
+        (* avail_len) = free_len - to_end;
+        ipc_conn->shm_tx_reserved = ipc_conn->shm_tx_data;
+    }
+    return ipc_conn->shm_tx_reserved;
 }
 
-static inline int32_t find_disconnect_conn(void * data, void * arg)
+static void ipc_conn_shm_commit(struct ipc_conn * ipc_conn, uint8_t cmd, uint32_t len, struct ipc_shm_desc * desc)
 {
-    UNUSED_PARAM(arg);
-    return !(IPC_CONN_STATUS_NOT_CONNECTED == ((struct ipc_conn *)(data))->status);
+    desc->cmd = cmd;
+    desc->offset = (uint32_t)(ipc_conn->shm_tx_reserved - ipc_conn->shm_tx_data);
+    desc->len = len;
+    desc->end = ipc_conn->shm_tx_head + ipc_conn->shm_tx_pad + len;
+    ipc_conn->shm_tx_head = desc->end;
+    ipc_conn->shm_tx_reserved = CPLUS_NULL;
+
+    /* The payload has to be visible before the descriptor pointing at it. */
+    __atomic_thread_fence(__ATOMIC_RELEASE);
 }
 
-void ipc_server_proc(void * param1, void * param2)
+static int32_t ipc_conn_shm_put(
+    struct ipc_conn * ipc_conn
+    , void * prefix
+    , uint32_t prefix_len
+    , IPC_CONN_PACKET packet
+    , struct ipc_shm_desc * desc)
 {
-    struct ipc_server * ipc_serv = (struct ipc_server *)(param1);
-    bool can_accept = false;
-    struct ipc_conn * conn = CPLUS_NULL;
-    cplus_socket sock = CPLUS_NULL;
-    UNUSED_PARAM(param2);
+    uint32_t avail_len = 0, frame_len = prefix_len + packet->data_len, start_tick = 0;
+    uint8_t * bufs = CPLUS_NULL;
 
-    cplus_crit_sect_enter(ipc_serv->ipc_conn_sect);
-    while ((conn = (struct ipc_conn *)cplus_llist_pop_if(
-        ipc_serv->ipc_conn_list
-        , find_disconnect_conn
-        , CPLUS_NULL)))
+    if (CPLUS_NULL == ipc_conn->shm_tx_data OR IPC_SHM_MIN_FRAME_SIZE > frame_len)
     {
-        ipc_conn_delete(conn);
+        return CPLUS_FAIL;
     }
 
-    if (cplus_llist_get_size(ipc_serv->ipc_conn_list) < ipc_serv->max_conn)
+    if (0 == prefix_len AND CPLUS_NULL != packet->data AND packet->data == ipc_conn->shm_tx_reserved)
     {
-        can_accept = true;
+        /* Written in place by the callback, only the descriptor is left to send. */
+        ipc_conn_shm_commit(ipc_conn, packet->cmd, frame_len, desc);
+        return CPLUS_SUCCESS;
     }
-    cplus_crit_sect_exit(ipc_serv->ipc_conn_sect);
 
-    if (true == can_accept)
+    start_tick = cplus_systime_get_tick();
+    while (true)
     {
-        if ((sock = cplus_socket_accept(ipc_serv->accept_socket, CPLUS_INFINITE_TIMEOUT)))
+        bufs = ipc_conn_shm_reserve(ipc_conn, &avail_len);
+        if (frame_len <= avail_len)
         {
-            conn = ipc_conn_create(
-                ipc_serv
-                , sock
-                , true
-                , ipc_serv->on_received
-                , ipc_serv->on_disconnected
-                , ipc_serv->on_error);
-            if (conn)
-            {
-                conn->status = IPC_CONN_STATUS_CONNECTED;
-
-                cplus_crit_sect_enter(ipc_serv->ipc_conn_sect);
-                cplus_llist_push_front(ipc_serv->ipc_conn_list, conn);
-                cplus_crit_sect_exit(ipc_serv->ipc_conn_sect);
-
-                /* Invoke on_connect() callback function. */
-                if (ipc_serv->on_connected)
-                {
-                    ipc_serv->on_connected(sock);
-                }
-            }
+            break;
+        }
+        /* A busy ring hands the frame to the socket, unless it is too large for a socket frame
+        and the reader is about to give space back. */
+        if (MAX_FRAME_DATA_SIZE >= frame_len
+            OR ipc_conn->shm_ring_size < frame_len
+            OR TIMEOUT_FOR_SHM_RING_SPACE <= cplus_systime_elapsed_tick(start_tick))
+        {
+            ipc_conn->shm_tx_reserved = CPLUS_NULL;
+            return CPLUS_FAIL;
         }
+        cplus_systime_sleep_msec(1);
     }
-    return;
+
+    if (0 < prefix_len)
+    {
+        cplus_mem_cpy(bufs, prefix, prefix_len);
+    }
+    if (0 < packet->data_len)
+    {
+        cplus_mem_cpy(&(bufs[prefix_len]), packet->data, packet->data_len);
+    }
+    ipc_conn_shm_commit(ipc_conn, packet->cmd, frame_len, desc);
+
+    return CPLUS_SUCCESS;
 }
 
-int32_t cplus_ipc_client_send_heartbeat(cplus_ipc_client obj, uint32_t timeout)
+static int32_t ipc_conn_shm_get(struct ipc_conn * ipc_conn, IPC_CONN_PACKET packet)
 {
-    int32_t res = CPLUS_FAIL, count = 0;
-    struct ipc_client * clt = (struct ipc_client *)(obj);
-    struct ipc_conn_packet request_packet = {0}, response_packet = {0};
-
-    CHECK_OBJECT_TYPE_EX(obj, OBJ_TYPE_CLIENT);
+    struct ipc_shm_desc desc = {0};
 
-    request_packet.seqn = ACCUMULATE_SEQUENCE_NUMBER(clt->seqn);
-    request_packet.cmd = IPC_CMD_HEARTBEAT;
-    request_packet.data_len = 0;
-    request_packet.data = CPLUS_NULL;
+    if (CPLUS_NULL == ipc_conn->shm_rx_data OR sizeof(desc) != packet->data_len)
+    {
+        return CPLUS_FAIL;
+    }
 
-    count = ipc_send_packet(clt->server_socket, &request_packet);
-    if (0 <= count)
+    cplus_mem_cpy(&desc, packet->data, sizeof(desc));
+    if (ipc_conn->shm_ring_size < ((uint64_t)desc.offset + desc.len)
+        OR IPC_CMD_SHM_FRAME == desc.cmd)
     {
-        count = ipc_recv_packet(clt->server_socket, &response_packet, 0, CPLUS_NULL, timeout);
-        if (0 <= count)
-        {
-            if (request_packet.seqn == response_packet.seqn
-                AND IPC_CMD_ACK == response_packet.cmd)
-            {
-                res = CPLUS_SUCCESS;
-            }
-        }
+        return CPLUS_FAIL;
     }
-    return res;
+
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    packet->cmd = desc.cmd;
+    packet->data_len = desc.len;
+    packet->data = (0 < desc.len)? &(ipc_conn->shm_rx_data[desc.offset]): CPLUS_NULL;
+
+    /* Handed back to the writer on the next receive, when this view expires. */
+    ipc_conn->shm_rx_release = desc.end;
+
+    return CPLUS_SUCCESS;
 }
 
-int32_t cplus_ipc_client_send_oneway(
-    cplus_ipc_client obj
-    , uint32_t input_bufs_len
-    , void * input_bufs)
+static int32_t ipc_conn_open_shm(struct ipc_conn * ipc_conn, IPC_CONN_PACKET packet)
 {
-    struct ipc_client * clt = (struct ipc_client *)(obj);
-    struct ipc_conn_packet resquest_packet = {0};
+    char name[IPC_SHM_NAME_MAX_SIZE + 1] = {0};
+    cplus_sharedmem shm = CPLUS_NULL;
 
-    CHECK_OBJECT_TYPE_EX(obj, OBJ_TYPE_CLIENT);
+    if (ipc_conn->shm)
+    {
+        return EALREADY;
+    }
 
-    resquest_packet.seqn = ACCUMULATE_SEQUENCE_NUMBER(clt->seqn);
-    resquest_packet.cmd = IPC_CMD_ONEWAY;
-    resquest_packet.data_len = input_bufs_len;
-    resquest_packet.data = input_bufs;
+    if (0 == packet->data_len OR IPC_SHM_NAME_MAX_SIZE < packet->data_len)
+    {
+        return EINVAL;
+    }
+
+    cplus_mem_cpy(name, packet->data, packet->data_len);
+    if (CPLUS_NULL == (shm = cplus_sharedmem_open(name)))
+    {
+        return (0 != errno)? errno: ENOENT;
+    }
+
+    if (CPLUS_SUCCESS != ipc_conn_attach_shm(ipc_conn, shm, true))
+    {
+        cplus_sharedmem_delete(shm);
+        return EINVAL;
+    }
 
-    return ipc_send_packet(clt->server_socket, &resquest_packet);
+    return CPLUS_SUCCESS;
 }
 
-int32_t cplus_ipc_client_send_request(
-    cplus_ipc_client obj
-    , uint32_t input_bufs_len
-    , void * input_bufs
-    , uint32_t output_bufs_len
-    , void * output_bufs
-    , uint32_t timeout)
+static int32_t ipc_conn_memfd_put(
+    struct ipc_conn * ipc_conn
+    , void * prefix
+    , uint32_t prefix_len
+    , IPC_CONN_PACKET packet
+    , struct ipc_memfd_desc * desc)
 {
-    int32_t res = CPLUS_SUCCESS, count = 0;
-    struct ipc_client * clt = (struct ipc_client *)(obj);
-    struct ipc_conn_packet resquest_packet = {0};
-
-    CHECK_OBJECT_TYPE_EX(obj, OBJ_TYPE_CLIENT);
+    uint32_t frame_len = prefix_len + packet->data_len, threshold = ipc_conn->memfd_threshold;
+    int32_t memfd = INVALID_FD;
+    struct iovec iov[2] = {0};
 
-    resquest_packet.seqn = ACCUMULATE_SEQUENCE_NUMBER(clt->seqn);
-    resquest_packet.cmd = IPC_CMD_REQUEST;
-    resquest_packet.data_len = input_bufs_len;
-    resquest_packet.data = input_bufs;
+    if (ipc_conn->is_seqpacket AND (0 == threshold OR IPC_SEQPACKET_MAX_DATA_SIZE < threshold))
+    {
+        /* What does not fit a datagram has no other way to go. */
+        threshold = IPC_SEQPACKET_MAX_DATA_SIZE + 1;
+    }
 
-    count = ipc_send_packet(clt->server_socket, &resquest_packet);
-    if (0 < count)
+    if (0 == threshold
+        OR threshold > frame_len
+        OR IPC_CONN_MAX_PASSED_FDS <= ipc_conn->send_fds_count)
     {
-        if (true == clt->is_async)
-        {
-            res = CPLUS_SUCCESS;
-        }
-        else
-        {
-            (clt->ipc_conn)->recv_timeout = timeout;
+        return INVALID_FD;
+    }
 
-            while (true)
-            {
-                timeout = cplus_systime_get_tick();
-                ipc_conn_proc(clt->ipc_conn, CPLUS_NULL);
-                count = (clt->ipc_conn)->recv_count;
-                if (0 >= count)
-                {
-                    res = CPLUS_FAIL;
-                    break;
-                }
-                else
-                {
-                    uint32_t elapsed_period = cplus_systime_elapsed_tick(timeout);
-                    if (elapsed_period >= (clt->ipc_conn)->recv_timeout)
-                    {
-                        errno = ETIMEDOUT;
-                        res = CPLUS_FAIL;
-                        break;
-                    }
-                    else
-                    {
-                        /* Refreah timeout. */
-                        (clt->ipc_conn)->recv_timeout -= elapsed_period;
-                    }
-                }
+    if (INVALID_FD == (memfd = memfd_create("cplus.ipc", MFD_CLOEXEC | MFD_ALLOW_SEALING)))
+    {
+        return INVALID_FD;
+    }
 
-                /* Reason for False Positive : The mutex will be locked or always blocked
-                    until call calling pthread_cond_broadcast() or pthread_cond_signal(). */
-                /* coverity[double_unlock: FALSE] */
-                if (CPLUS_FAIL == cplus_pevent_wait((clt->ipc_conn)->evt_packet_received, 0))
-                {
-                    if (EAGAIN != errno)
-                    {
-                        res = CPLUS_FAIL;
-                        break;
-                    }
-                }
-                else
-                {
-                    /* Completely received a packet */
-                    if (resquest_packet.seqn == clt->ipc_conn->packet.seqn)
-                    {
-                        /* Sequence number correct, then exit loop */
-                        res = CPLUS_SUCCESS;
-                        break;
-                    }
-                    else
-                    {
-                        uint32_t diff = 0;
-                        if (resquest_packet.seqn > (clt->ipc_conn)->packet.seqn)
-                        {
-                            diff = resquest_packet.seqn - (clt->ipc_conn)->packet.seqn;
-                        }
-                        else
-                        {
-                            diff = (255U - resquest_packet.seqn) + (clt->ipc_conn)->packet.seqn;
-                        }
+    iov[0].iov_base = prefix;
+    iov[0].iov_len = prefix_len;
+    iov[1].iov_base = packet->data;
+    iov[1].iov_len = (packet->data)? packet->data_len: 0;
 
-                        if (TOLERANCE_TO_DIFF_SEQUENCE > diff)
-                        {
-                            /* Drop recviced packet */
-                            cplus_pevent_reset((clt->ipc_conn)->evt_packet_received);
-                        }
-                        else
-                        {
-                            errno = EILSEQ;
-                            res = CPLUS_FAIL;
-                            break;
-                        }
-                    }
-                }
-            }
+    /* A short write only happens when tmpfs is full, the socket carries the frame then. Once
+    sealed, the receiver can map it without fearing that it changes or shrinks under it. */
+    if (((ssize_t)frame_len) != writev(memfd, iov, 2)
+        OR 0 != fcntl(memfd, F_ADD_SEALS, IPC_MEMFD_SEALS))
+    {
+        close(memfd);
+        return INVALID_FD;
+    }
 
-            cplus_pevent_reset((clt->ipc_conn)->evt_packet_received);
+    desc->cmd = packet->cmd;
+    desc->len = frame_len;
+    return memfd;
+}
 
-            if (CPLUS_FAIL == res
-                OR 0 != (clt->ipc_conn)->sock_error)
-            {
-                errno = (0 != (clt->ipc_conn)->sock_error)? (clt->ipc_conn)->sock_error: errno;
-                res = CPLUS_FAIL;
-            }
-            else
-            {
-                CHECK_NOT_NULL(output_bufs, CPLUS_FAIL);
-                CHECK_GT_ZERO(output_bufs_len, CPLUS_FAIL);
+static void ipc_conn_keep_fds(struct ipc_conn * ipc_conn, struct msghdr * msg)
+{
+    struct cmsghdr * cmptr = CPLUS_NULL;
+    uint32_t fd_count = 0;
+    int32_t fd = INVALID_FD;
 
-                cplus_mem_cpy_ex(
-                    output_bufs
-                    , output_bufs_len
-                    , (clt->ipc_conn)->packet.data
-                    , (clt->ipc_conn)->packet.data_len);
+    for (cmptr = CMSG_FIRSTHDR(msg); cmptr; cmptr = CMSG_NXTHDR(msg, cmptr))
+    {
+        if (SOL_SOCKET != cmptr->cmsg_level OR SCM_RIGHTS != cmptr->cmsg_type)
+        {
+            continue;
+        }
 
-                res = (int32_t)((clt->ipc_conn)->packet.data_len);
+        fd_count = (uint32_t)((cmptr->cmsg_len - CMSG_LEN(0)) / sizeof(int32_t));
+        for (uint32_t i = 0; i < fd_count; i++)
+        {
+            cplus_mem_cpy(&fd, &(((uint8_t *)CMSG_DATA(cmptr))[i * sizeof(int32_t)]), sizeof(int32_t));
+            if (IPC_CONN_MAX_PASSED_FDS <= ipc_conn->recv_fds_count)
+            {
+                /* More than any sender queues up, its frame is dropped for lack of a payload. */
+                close(fd);
+                continue;
             }
+            ipc_conn->recv_fds[(ipc_conn->recv_fds_head + ipc_conn->recv_fds_count) % IPC_CONN_MAX_PASSED_FDS] = fd;
+            ipc_conn->recv_fds_count ++;
         }
     }
-    return res;
 }
 
-static void * ipc_server_new(
-    const char * name
-    , uint32_t max_connection
-    , CPLUS_IPC_CB_FUNCS cb_funcs)
+static int32_t ipc_conn_memfd_get(struct ipc_conn * ipc_conn, IPC_CONN_PACKET packet)
 {
-    struct ipc_server * ipc_serv = CPLUS_NULL;
-    if ((ipc_serv = (struct ipc_server *)cplus_malloc(sizeof(struct ipc_server))))
+    struct ipc_memfd_desc desc = {0};
+    struct stat memfd_stat = {0};
+    int32_t memfd = INVALID_FD, seals = 0, res = CPLUS_FAIL;
+    void * view = CPLUS_NULL;
+
+    /* Descriptors arrive in the order of their frames, each frame takes the oldest one. */
+    if (0 == ipc_conn->recv_fds_count)
     {
-        CPLUS_INITIALIZE_STRUCT_POINTER(ipc_serv);
+        return CPLUS_FAIL;
+    }
+    memfd = ipc_conn->recv_fds[ipc_conn->recv_fds_head];
+    ipc_conn->recv_fds_head = (ipc_conn->recv_fds_head + 1) % IPC_CONN_MAX_PASSED_FDS;
+    ipc_conn->recv_fds_count --;
 
-        ipc_serv->type = OBJ_TYPE_SERVER;
-        ipc_serv->max_conn = max_connection;
+    if (sizeof(desc) != packet->data_len)
+    {
+        goto exit;
+    }
 
-        ipc_serv->accept_socket = cplus_socket_new(CPLUS_SOCKET_TYPE_STREAM_LOCAL);
-        if (CPLUS_NULL == ipc_serv->accept_socket)
-        {
-            goto exit;
-        }
+    cplus_mem_cpy(&desc, packet->data, sizeof(desc));
+    if (0 == desc.len
+        OR IPC_CMD_SHM_FRAME == desc.cmd
+        OR IPC_CMD_MEMFD_FRAME == desc.cmd
+        OR 0 > (seals = fcntl(memfd, F_GET_SEALS))
+        OR IPC_MEMFD_SEALS != (seals & IPC_MEMFD_SEALS)
+        OR 0 != fstat(memfd, &memfd_stat)
+        OR ((off_t)desc.len) > memfd_stat.st_size)
+    {
+        goto exit;
+    }
 
-        (void)cplus_socket_setopt_reuse_addr(ipc_serv->accept_socket, true);
+    if (MAP_FAILED == (view = mmap(CPLUS_NULL, desc.len, PROT_READ, MAP_SHARED, memfd, 0)))
+    {
+        goto exit;
+    }
 
-        if (CPLUS_SUCCESS != cplus_socket_bind(ipc_serv->accept_socket, name, 0))
-        {
-            goto exit;
-        }
+    /* Only one view is kept, the one before has been handed to its callback already. */
+    if (ipc_conn->memfd_view)
+    {
+        munmap(ipc_conn->memfd_view, ipc_conn->memfd_view_len);
+    }
+    ipc_conn->memfd_view = view;
+    ipc_conn->memfd_view_len = desc.len;
 
-        ipc_serv->ipc_conn_list = cplus_llist_prev_new(ipc_serv->max_conn);
-        if (CPLUS_NULL == ipc_serv->ipc_conn_list)
-        {
-            goto exit;
-        }
+    packet->cmd = desc.cmd;
+    packet->data_len = desc.len;
+    packet->data = view;
+    res = CPLUS_SUCCESS;
+exit:
+    close(memfd);
+    return res;
+}
 
-        ipc_serv->ipc_conn_pool = cplus_mempool_new(ipc_serv->max_conn, sizeof(struct ipc_conn));
-        if (CPLUS_NULL == ipc_serv->ipc_conn_pool)
-        {
-            goto exit;
-        }
+static int32_t ipc_conn_send_frame(struct ipc_conn * ipc_conn, IPC_CONN_PACKET packet, int32_t send_fd)
+{
+    uint8_t head[IPC_CONN_PACKET_HEAD_SIZE] = {0};
+    uint32_t total = 0, sent = 0;
+    uint64_t frame_pos = 0;
+    struct iovec iov[3] = {0};
+    int32_t res = CPLUS_FAIL;
+    ssize_t count = 0;
+
+    /* Takes over 'send_fd', it is closed once the kernel holds it or the frame is given up.
+    A connection on its own task only queues behind what a publish left for its subscriber. */
+    if (CPLUS_NULL == ipc_conn->reactor AND ipc_conn->send_bufs_offset == ipc_conn->send_bufs_len)
+    {
+        res = ipc_send_frame(ipc_conn->sock, ipc_conn->is_seqpacket, packet, send_fd);
+        goto exit;
+    }
 
-        ipc_serv->ipc_conn_sect = cplus_mutex_new();
-        if (CPLUS_NULL == ipc_serv->ipc_conn_sect)
-        {
-            goto exit;
-        }
+    if (IPC_MAX_FRAME_DATA_SIZE(ipc_conn->is_seqpacket) < packet->data_len)
+    {
+        errno = EMSGSIZE;
+        goto exit;
+    }
 
-        if (cb_funcs)
+    /* The descriptor may have to wait in the queue with its frame, so there must be room for it
+    before anything is written or queued. */
+    if (INVALID_FD != send_fd AND IPC_CONN_MAX_PASSED_FDS <= ipc_conn->send_fds_count)
+    {
+        errno = EAGAIN;
+        goto exit;
+    }
+
+    total = ipc_packet_build_iov(packet, ipc_conn->is_seqpacket, head, iov);
+    frame_pos = ipc_conn->send_bufs_base + ipc_conn->send_bufs_len;
+
+    /* Frames queued earlier must leave first, so only write directly on an idle connection. */
+    if (ipc_conn->send_bufs_offset == ipc_conn->send_bufs_len)
+    {
+        if (0 > (count = ipc_conn_sendmsg(ipc_conn, iov, 3, send_fd)))
         {
-            if (cb_funcs->on_connected)
-            {
-                ipc_serv->on_connected = cb_funcs->on_connected;
-            }
-            if (cb_funcs->on_error)
-            {
-                ipc_serv->on_error = cb_funcs->on_error;
-            }
-            if (cb_funcs->on_disconnected)
-            {
-                ipc_serv->on_disconnected = cb_funcs->on_disconnected;
-            }
-            if (cb_funcs->on_received)
+            if (EAGAIN != errno AND EWOULDBLOCK != errno)
             {
-                ipc_serv->on_received = cb_funcs->on_received;
+                ipc_conn->sock_error = errno;
+                goto exit;
             }
+            count = 0;
         }
+        sent = (uint32_t)count;
+    }
 
-        if (CPLUS_SUCCESS != cplus_socket_listen(ipc_serv->accept_socket, ipc_serv->max_conn))
-        {
-            goto exit;
-        }
+    if (CPLUS_SUCCESS != ipc_conn_queue_frame(ipc_conn, iov, 3, total, sent))
+    {
+        goto exit;
+    }
 
-        ipc_serv->accept_task = cplus_task_new(
-            ipc_server_proc
-            , ipc_serv
-            , CPLUS_NULL
-            , DURATION_FOR_IPC_SEVR_ACCEPT_TASK);
-        if (CPLUS_NULL == ipc_serv->accept_task)
+    if (INVALID_FD != send_fd AND 0 == count AND 0 < total)
+    {
+        /* Nothing went out yet, so the descriptor waits for the frame in the queue. */
+        ipc_conn->send_fds[(ipc_conn->send_fds_head + ipc_conn->send_fds_count) % IPC_CONN_MAX_PASSED_FDS].pos = frame_pos;
+        ipc_conn->send_fds[(ipc_conn->send_fds_head + ipc_conn->send_fds_count) % IPC_CONN_MAX_PASSED_FDS].fd = send_fd;
+        ipc_conn->send_fds_count ++;
+        send_fd = INVALID_FD;
+    }
+    res = (int32_t)(iov[1].iov_len);
+exit:
+    if (INVALID_FD != send_fd)
+    {
+        close(send_fd);
+    }
+    return res;
+}
+
+static int32_t ipc_conn_route_packet(struct ipc_conn * ipc_conn, IPC_CONN_PACKET packet)
+{
+    struct ipc_shm_desc desc = {0};
+    struct ipc_memfd_desc memfd_desc = {0};
+    struct ipc_conn_packet desc_packet = {0};
+    int32_t memfd = INVALID_FD, res = CPLUS_FAIL;
+
+    desc_packet.seqn = packet->seqn;
+    if (CPLUS_SUCCESS == ipc_conn_shm_put(ipc_conn, CPLUS_NULL, 0, packet, &desc))
+    {
+        desc_packet.cmd = IPC_CMD_SHM_FRAME;
+        desc_packet.data_len = sizeof(desc);
+        desc_packet.data = &desc;
+        res = (0 <= ipc_conn_send_frame(ipc_conn, &desc_packet, INVALID_FD))? (int32_t)(packet->data_len): CPLUS_FAIL;
+    }
+    else if (INVALID_FD != (memfd = ipc_conn_memfd_put(ipc_conn, CPLUS_NULL, 0, packet, &memfd_desc)))
+    {
+        desc_packet.cmd = IPC_CMD_MEMFD_FRAME;
+        desc_packet.data_len = sizeof(memfd_desc);
+        desc_packet.data = &memfd_desc;
+        res = (0 <= ipc_conn_send_frame(ipc_conn, &desc_packet, memfd))? (int32_t)(packet->data_len): CPLUS_FAIL;
+    }
+    else
+    {
+        res = ipc_conn_send_frame(ipc_conn, packet, INVALID_FD);
+    }
+
+    if (0 <= res)
+    {
+        ipc_conn_count_sent(ipc_conn, packet->data_len);
+    }
+    return res;
+}
+
+static int32_t ipc_conn_send_packet(struct ipc_conn * ipc_conn, IPC_CONN_PACKET packet)
+{
+    int32_t res = CPLUS_FAIL;
+
+    /* Publishers and handler pool workers write next to the receiving thread, so the frames must not interleave. */
+    if (ipc_conn->send_sect)
+    {
+        cplus_crit_sect_enter(ipc_conn->send_sect);
+    }
+    res = ipc_conn_route_packet(ipc_conn, packet);
+    if (ipc_conn->send_sect)
+    {
+        cplus_crit_sect_exit(ipc_conn->send_sect);
+    }
+    return res;
+}
+
+static int32_t ipc_conn_put_published(struct ipc_conn * ipc_conn, uint8_t * frame, uint32_t frame_len, uint32_t backlog)
+{
+    struct iovec iov = {0};
+    ssize_t count = 0;
+
+    /* Caller holds send_sect. What an earlier publish left behind goes first. */
+    if (ipc_conn->send_bufs_offset < ipc_conn->send_bufs_len AND CPLUS_SUCCESS != ipc_conn_flush(ipc_conn))
+    {
+        return CPLUS_FAIL;
+    }
+
+    if (ipc_conn->send_bufs_offset == ipc_conn->send_bufs_len)
+    {
+        iov.iov_base = frame;
+        iov.iov_len = frame_len;
+        if (0 > (count = ipc_conn_sendmsg(ipc_conn, &iov, 1, INVALID_FD)))
         {
-            goto exit;
+            if (EAGAIN != errno AND EWOULDBLOCK != errno)
+            {
+                ipc_conn->sock_error = errno;
+                return CPLUS_FAIL;
+            }
+            count = 0;
         }
+    }
 
-        cplus_task_start(ipc_serv->accept_task, 500);
-        cplus_task_wait_start(ipc_serv->accept_task, CPLUS_INFINITE_TIMEOUT);
+    /* Only a message nothing of which went out yet can be skipped, a started one must be finished. */
+    if (0 == count AND backlog < (ipc_conn->send_bufs_len - ipc_conn->send_bufs_offset + frame_len))
+    {
+        errno = ENOBUFS;
+        return CPLUS_FAIL;
     }
-    return ipc_serv;
-exit:
-    ipc_server_delete(ipc_serv);
-    return CPLUS_NULL;
+    iov.iov_base = frame;
+    iov.iov_len = frame_len;
+    return ipc_conn_queue_frame(ipc_conn, &iov, 1, frame_len, (uint32_t)count);
 }
 
-static void * ipc_client_new(
-    const char * name
-    , CPLUS_IPC_CB_FUNCS cb_funcs)
+static bool ipc_client_take_request(
+    struct ipc_client * ipc_clt
+    , uint32_t index
+    , uint32_t request_id
+    , bool expired_only
+    , struct ipc_request * request)
 {
-    struct ipc_client * ipc_clt = CPLUS_NULL;
+    struct ipc_request * slot = &(ipc_clt->requests[index]);
+    bool is_taken = false;
+
+    cplus_crit_sect_enter(ipc_clt->request_sect);
+    if (0 != slot->request_id
+        AND (0 == request_id OR request_id == slot->request_id)
+        AND (false == expired_only
+            OR (CPLUS_INFINITE_TIMEOUT != slot->timeout
+                AND cplus_systime_elapsed_tick(slot->start_tick) >= slot->timeout)))
+    {
+        /* The slot is free again right away, the copy carries the completion. */
+        (* request) = (* slot);
+        slot->request_id = 0;
+        is_taken = true;
+    }
+    cplus_crit_sect_exit(ipc_clt->request_sect);
 
-    if ((ipc_clt = (struct ipc_client *)cplus_malloc(sizeof(struct ipc_client))))
+    return is_taken;
+}
+
+static void ipc_client_finish_request(
+    struct ipc_client * ipc_clt
+    , struct ipc_request * request
+    , int32_t status
+    , uint32_t data_len
+    , void * data)
+{
+    request->on_completed(ipc_clt, request->request_id, status, data_len, data, request->arg);
+
+    /* Counted down only after the callback, so a finished wait means finished callbacks. */
+    cplus_crit_sect_enter(ipc_clt->request_sect);
+    if (0 == (-- ipc_clt->inflight_count))
     {
-        CPLUS_INITIALIZE_STRUCT_POINTER(ipc_clt);
+        cplus_pevent_set(ipc_clt->evt_requests_done);
+    }
+    cplus_crit_sect_exit(ipc_clt->request_sect);
+}
 
-        ipc_clt->type = OBJ_TYPE_CLIENT;
-        ipc_clt->is_async = false;
-        ipc_clt->ipc_conn = CPLUS_NULL;
-        ipc_clt->seqn = 0;
+static void ipc_client_fail_requests(struct ipc_client * ipc_clt, int32_t status, bool expired_only)
+{
+    struct ipc_request request = {0};
 
-        ipc_clt->server_socket = cplus_socket_new(CPLUS_SOCKET_TYPE_STREAM_LOCAL);
-        if (CPLUS_NULL == ipc_clt->server_socket)
+    if (0 == ipc_clt->inflight_count)
+    {
+        return;
+    }
+
+    for (uint32_t i = 0; i < CPLUS_IPC_CLIENT_MAX_INFLIGHT_COUNT; i++)
+    {
+        if (ipc_client_take_request(ipc_clt, i, 0, expired_only, &request))
         {
-            goto error;
+            ipc_client_finish_request(ipc_clt, &request, status, 0, CPLUS_NULL);
         }
+    }
+}
 
-        if (cb_funcs)
+static void ipc_client_complete_request(struct ipc_client * ipc_clt, IPC_CONN_PACKET packet)
+{
+    struct ipc_request request = {0};
+    uint32_t request_id = 0;
+    int32_t status = 0;
+
+    if (CPLUS_NULL == ipc_clt
+        OR CPLUS_NULL == ipc_clt->requests
+        OR IPC_ASYNC_RESPONSE_HEAD_SIZE > packet->data_len)
+    {
+        return;
+    }
+
+    cplus_mem_cpy(&request_id, packet->data, sizeof(uint32_t));
+    cplus_mem_cpy(&status, &(((uint8_t *)(packet->data))[sizeof(uint32_t)]), sizeof(int32_t));
+    request_id = ntohl(request_id);
+    status = (int32_t)ntohl((uint32_t)status);
+
+    /* A late answer to a request that already timed out finds its slot empty or reused. */
+    if (ipc_client_take_request(
+        ipc_clt
+        , request_id % CPLUS_IPC_CLIENT_MAX_INFLIGHT_COUNT
+        , request_id
+        , false
+        , &request))
+    {
+        ipc_client_finish_request(
+            ipc_clt
+            , &request
+            , status
+            , packet->data_len - IPC_ASYNC_RESPONSE_HEAD_SIZE
+            , &(((uint8_t *)(packet->data))[IPC_ASYNC_RESPONSE_HEAD_SIZE]));
+    }
+}
+
+static int32_t ipc_conn_send_stream_credit(
+    struct ipc_conn * ipc_conn
+    , uint8_t seqn
+    , uint32_t stream_id
+    , uint32_t credits
+    , int32_t status
+    , bool is_closed)
+{
+    struct ipc_stream_credit credit = {0};
+    struct ipc_conn_packet credit_packet = {0};
+
+    credit.stream_id = htonl(stream_id);
+    credit.credits = htonl(credits);
+    credit.status = htonl((uint32_t)status);
+    credit.is_closed = htonl((is_closed)? 1U: 0U);
+
+    credit_packet.seqn = seqn;
+    credit_packet.cmd = IPC_CMD_STREAM_CREDIT;
+    credit_packet.data_len = sizeof(credit);
+    credit_packet.data = &credit;
+    return ipc_conn_send_packet(ipc_conn, &credit_packet);
+}
+
+static int32_t ipc_conn_stream_proc(struct ipc_conn * ipc_conn, IPC_CONN_PACKET packet)
+{
+    uint32_t stream_id = 0, chunk_len = 0;
+    void * chunk_bufs = CPLUS_NULL;
+    int32_t status = CPLUS_SUCCESS;
+
+    /* The stream ID leads every frame of a stream. */
+    if (sizeof(uint32_t) > packet->data_len)
+    {
+        return CPLUS_SUCCESS;
+    }
+    cplus_mem_cpy(&stream_id, packet->data, sizeof(uint32_t));
+    stream_id = ntohl(stream_id);
+    chunk_len = packet->data_len - sizeof(uint32_t);
+    chunk_bufs = (0 < chunk_len)? &(((uint8_t *)(packet->data))[sizeof(uint32_t)]): CPLUS_NULL;
+
+    switch (packet->cmd)
+    {
+    default:
+        break;
+    case IPC_CMD_STREAM_BEGIN:
         {
-            if (cb_funcs->on_connected)
+            status = (CPLUS_NULL == ipc_conn->on_stream_chunk)? ENOTSUP: ((0 != ipc_conn->stream_id)? EBUSY: 0);
+            if (0 == status)
             {
-                ipc_clt->on_connected = cb_funcs->on_connected;
+                ipc_conn->stream_id = stream_id;
+                ipc_conn->stream_offset = 0;
+                ipc_conn->stream_status = 0;
+                ipc_conn->stream_consumed = 0;
             }
-            if (cb_funcs->on_received)
+            return ipc_conn_send_stream_credit(
+                ipc_conn
+                , packet->seqn
+                , stream_id
+                , (0 == status)? CPLUS_IPC_STREAM_CREDIT_WINDOW: 0
+                , status
+                , (0 != status));
+        }
+    case IPC_CMD_STREAM_CHUNK:
+        {
+            /* Chunks behind a failure are dropped, the sender has been told already. */
+            if (stream_id != ipc_conn->stream_id OR 0 != ipc_conn->stream_status)
             {
-                ipc_clt->is_async = true;
+                break;
             }
-        }
 
-        if (CPLUS_SUCCESS != cplus_socket_connect(ipc_clt->server_socket, name, 0))
-        {
-            goto error;
+            if (CPLUS_SUCCESS != ipc_conn->on_stream_chunk(
+                ipc_conn->sock
+                , stream_id
+                , ipc_conn->stream_offset
+                , chunk_len
+                , chunk_bufs
+                , false))
+            {
+                ipc_conn->stream_status = (0 != errno)? errno: EIO;
+                return ipc_conn_send_stream_credit(
+                    ipc_conn, packet->seqn, stream_id, 0, ipc_conn->stream_status, false);
+            }
+            ipc_conn->stream_offset += chunk_len;
+
+            /* Credits go back once chunks are consumed, in batches of half a window, so the
+            sender keeps writing while this side works through what has arrived. */
+            if ((CPLUS_IPC_STREAM_CREDIT_WINDOW / 2) <= (++ ipc_conn->stream_consumed))
+            {
+                status = ipc_conn_send_stream_credit(
+                    ipc_conn, packet->seqn, stream_id, ipc_conn->stream_consumed, 0, false);
+                ipc_conn->stream_consumed = 0;
+                return status;
+            }
         }
-        else
+        break;
+    case IPC_CMD_STREAM_END:
         {
-            if (CPLUS_FAIL == cplus_ipc_client_send_heartbeat(ipc_clt, TIMEOUT_FOR_HEARTBEAT_PACKET))
+            if (stream_id != ipc_conn->stream_id)
             {
-                cplus_socket_delete(ipc_clt->server_socket);
-                goto error;
+                return ipc_conn_send_stream_credit(ipc_conn, packet->seqn, stream_id, 0, EBADF, true);
             }
-            else
-            {
-                ipc_clt->ipc_conn = ipc_conn_create(
-                    CPLUS_NULL
-                    , ipc_clt->server_socket
-                    , ipc_clt->is_async
-                    , CPLUS_NULL
-                    , CPLUS_NULL
-                    , CPLUS_NULL);
-                if (CPLUS_NULL == ipc_clt->ipc_conn)
-                {
-                    goto error;
-                }
 
-                ipc_clt->ipc_conn->status = IPC_CONN_STATUS_CONNECTED;
-                if (ipc_clt->on_connected)
-                {
-                    ipc_clt->on_connected(ipc_clt->server_socket);
-                }
+            if (0 == (status = ipc_conn->stream_status)
+                AND CPLUS_SUCCESS != ipc_conn->on_stream_chunk(
+                    ipc_conn->sock
+                    , stream_id
+                    , ipc_conn->stream_offset
+                    , 0
+                    , CPLUS_NULL
+                    , true))
+            {
+                status = (0 != errno)? errno: EIO;
             }
+            ipc_conn->stream_id = 0;
+            return ipc_conn_send_stream_credit(ipc_conn, packet->seqn, stream_id, 0, status, true);
         }
     }
-    return ipc_clt;
-error:
-    ipc_client_delete(ipc_clt);
-    return CPLUS_NULL;
+    return CPLUS_SUCCESS;
 }
 
-cplus_ipc_server cplus_ipc_server_new(
-    const char * name
-    , uint32_t max_connection
-    , CPLUS_IPC_CB_FUNCS cb_funcs)
+static void ipc_client_update_stream(struct ipc_client * ipc_clt, IPC_CONN_PACKET packet)
 {
-    CHECK_NOT_NULL(name, CPLUS_NULL);
-    CHECK_GT_ZERO(max_connection, CPLUS_NULL);
-    CHECK_NOT_NULL(cb_funcs, CPLUS_NULL);
+    struct ipc_stream_credit credit = {0};
 
-    return ipc_server_new(name, max_connection, cb_funcs);
-}
+    if (CPLUS_NULL == ipc_clt OR sizeof(credit) != packet->data_len)
+    {
+        return;
+    }
 
-cplus_ipc_client cplus_ipc_client_new(
-    const char * name
-    , CPLUS_IPC_CB_FUNCS cb_funcs)
-{
-    CHECK_NOT_NULL(name, CPLUS_NULL);
+    cplus_mem_cpy(&credit, packet->data, sizeof(credit));
+    if (ntohl(credit.stream_id) != cplus_atomic_read(&(ipc_clt->stream_id)))
+    {
+        /* Left over from a stream which is over already. */
+        return;
+    }
+
+    if (0 != credit.status)
+    {
+        cplus_atomic_write(&(ipc_clt->stream_status), (int32_t)ntohl(credit.status));
+    }
+    cplus_atomic_add(&(ipc_clt->stream_credits), ntohl(credit.credits));
+    if (0 != credit.is_closed)
+    {
+        cplus_atomic_write(&(ipc_clt->is_stream_closed), 1U);
+    }
 
-    return ipc_client_new(name, cb_funcs);
+    if (ipc_clt->evt_stream)
+    {
+        cplus_pevent_set(ipc_clt->evt_stream);
+    }
 }
 
-bool cplus_ipc_server_check(cplus_object obj)
+static int32_t ipc_reactor_watch_conn(struct ipc_conn * ipc_conn, int32_t op);
+
+static int32_t ipc_conn_find_topic(struct ipc_conn * ipc_conn, const char * topic)
 {
-    return (GET_OBJECT_TYPE(obj) == OBJ_TYPE_SERVER);
+    for (uint32_t i = 0; i < ipc_conn->topic_count; i++)
+    {
+        if (0 == strcmp(ipc_conn->topics[i], topic))
+        {
+            return (int32_t)i;
+        }
+    }
+    return -1;
 }
 
-bool cplus_ipc_client_check(cplus_object obj)
+static int32_t ipc_conn_update_topics(struct ipc_conn * ipc_conn, IPC_CONN_PACKET packet)
 {
-    return (GET_OBJECT_TYPE(obj) == OBJ_TYPE_CLIENT);
-}
+    const char * topic = (const char *)(packet->data);
+    int32_t status = 0, idx = -1;
 
-#ifdef __CPLUS_UNITTEST__
-#include "cplus_systime.h"
+    if (CPLUS_NULL == ipc_conn->ipc_serv)
+    {
+        return ENOTSUP;
+    }
 
-#define SERVER_NAME "unittest_serv"
-#define MAX_CLIENT_COUNT 5
-static uint32_t client_count = 0;
-static uint32_t verification_count[5] = {0};
+    if (CPLUS_NULL == topic
+        OR 2 > packet->data_len
+        OR CPLUS_IPC_MAX_TOPIC_SIZE < packet->data_len
+        OR (strnlen(topic, packet->data_len) + 1) != packet->data_len)
+    {
+        return EINVAL;
+    }
 
-static char test_string0[] = "Hello Word";
-static char test_string1[] = "AaBbCcDd";
-static char test_string2[] = "";
-static char test_string3[] = "1";
-static char test_string4[] = \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
+    /* Publishers walk the subscriptions under the same lock as the connection list. */
+    cplus_crit_sect_enter((ipc_conn->ipc_serv)->ipc_conn_sect);
+    idx = ipc_conn_find_topic(ipc_conn, topic);
+    if (IPC_CMD_SUBSCRIBE == packet->cmd)
+    {
+        if (0 <= idx)
+        {
+            status = 0;
+        }
+        else if (CPLUS_IPC_MAX_SUBSCRIPTIONS <= ipc_conn->topic_count)
+        {
+            status = ENOSPC;
+        }
+        else if (CPLUS_NULL == ipc_conn->topics
+            AND CPLUS_NULL == (ipc_conn->topics = (char (*)[CPLUS_IPC_MAX_TOPIC_SIZE])cplus_malloc(
+                CPLUS_IPC_MAX_SUBSCRIPTIONS * CPLUS_IPC_MAX_TOPIC_SIZE)))
+        {
+            status = ENOMEM;
+        }
+        else
+        {
+            cplus_mem_cpy(ipc_conn->topics[ipc_conn->topic_count], (void *)topic, packet->data_len);
+            ipc_conn->topic_count ++;
+        }
+    }
+    else if (0 > idx)
+    {
+        status = ENOENT;
+    }
+    else
+    {
+        ipc_conn->topic_count --;
+        if ((uint32_t)idx != ipc_conn->topic_count)
+        {
+            cplus_mem_cpy(ipc_conn->topics[idx], ipc_conn->topics[ipc_conn->topic_count], CPLUS_IPC_MAX_TOPIC_SIZE);
+        }
+    }
+    cplus_crit_sect_exit((ipc_conn->ipc_serv)->ipc_conn_sect);
+    return status;
+}
+
+static void ipc_conn_deliver_published(struct ipc_conn * ipc_conn, IPC_CONN_PACKET packet)
+{
+    char topic[CPLUS_IPC_MAX_TOPIC_SIZE] = {0};
+    uint8_t * bufs = (uint8_t *)(packet->data);
+    uint32_t topic_len = 0;
+
+    /* [topic length][topic][message], the topic goes out without its terminator. */
+    if (CPLUS_NULL == ipc_conn->on_published OR CPLUS_NULL == bufs OR sizeof(uint8_t) > packet->data_len)
+    {
+        return;
+    }
+    topic_len = bufs[0];
+    if (0 == topic_len OR CPLUS_IPC_MAX_TOPIC_SIZE <= topic_len OR (sizeof(uint8_t) + topic_len) > packet->data_len)
+    {
+        return;
+    }
+    cplus_mem_cpy(topic, &(bufs[sizeof(uint8_t)]), topic_len);
+
+    ipc_conn->on_published(
+        ipc_conn->sock
+        , topic
+        , packet->data_len - sizeof(uint8_t) - topic_len
+        , (packet->data_len > (sizeof(uint8_t) + topic_len))? &(bufs[sizeof(uint8_t) + topic_len]): CPLUS_NULL);
+}
+
+static void ipc_client_ack_subscription(struct ipc_client * ipc_clt, IPC_CONN_PACKET packet)
+{
+    uint32_t status = 0;
+
+    if (ipc_clt
+        AND ipc_clt->evt_subscribe
+        AND packet->seqn == ipc_clt->subscribe_seqn
+        AND sizeof(status) == packet->data_len)
+    {
+        cplus_mem_cpy(&status, packet->data, sizeof(status));
+        ipc_clt->subscribe_status = (int32_t)ntohl(status);
+        cplus_pevent_set(ipc_clt->evt_subscribe);
+    }
+}
+
+static void ipc_job_release_output(struct ipc_job * job)
+{
+    if (job->output_bufs)
+    {
+        if (true == job->is_pooled)
+        {
+            cplus_mempool_free(((job->ipc_conn)->ipc_serv)->response_pool, job->output_bufs);
+        }
+        else
+        {
+            cplus_free(job->output_bufs);
+        }
+        job->output_bufs = CPLUS_NULL;
+        job->is_pooled = false;
+    }
+}
+
+static void ipc_job_delete(struct ipc_job * job)
+{
+    ipc_job_release_output(job);
+    cplus_free(job);
+}
+
+static void ipc_conn_answer_job(struct ipc_conn * ipc_conn, struct ipc_job * job)
+{
+    struct ipc_conn_packet response_packet = {0};
+    uint8_t head[IPC_ASYNC_RESPONSE_HEAD_SIZE] = {0};
+    int32_t status = 0;
+
+    response_packet.seqn = (job->packet).seqn;
+    switch ((job->packet).cmd)
+    {
+    default:
+        return;
+    case IPC_CMD_REQUEST:
+        {
+            if (CPLUS_FAIL == job->res)
+            {
+                return;
+            }
+            response_packet.cmd = IPC_CMD_RESPONSE;
+            response_packet.data_len = job->output_len;
+            response_packet.data = job->output_bufs;
+        }
+        break;
+    case IPC_CMD_ASYNC_REQUEST:
+        {
+            status = (int32_t)htonl((uint32_t)(job->status));
+            response_packet.cmd = IPC_CMD_ASYNC_RESPONSE;
+            response_packet.data_len = job->output_len + IPC_ASYNC_RESPONSE_HEAD_SIZE;
+            response_packet.data = (job->output_bufs)? job->output_bufs: head;
+            cplus_mem_cpy(response_packet.data, &(job->request_id), sizeof(uint32_t));
+            cplus_mem_cpy(&(((uint8_t *)(response_packet.data))[sizeof(uint32_t)]), &status, sizeof(int32_t));
+        }
+        break;
+    case IPC_CMD_RESPONSE:
+        {
+            response_packet.cmd = IPC_CMD_ACK;
+        }
+        break;
+    }
+
+    if (0 <= ipc_conn_send_packet(ipc_conn, &response_packet) AND IPC_CMD_ACK != response_packet.cmd)
+    {
+        ipc_conn_count_request(ipc_conn, job->start_nsec);
+    }
+}
+
+static void ipc_conn_job_proc(void * param1, void * param2)
+{
+    struct ipc_job * job = (struct ipc_job *)(param1), * head = CPLUS_NULL;
+    struct ipc_conn * ipc_conn = job->ipc_conn;
+    struct ipc_server * ipc_serv = ipc_conn->ipc_serv;
+    uint32_t reserved_len = (IPC_CMD_ASYNC_REQUEST == (job->packet).cmd)? IPC_ASYNC_RESPONSE_HEAD_SIZE: 0;
+    uint32_t dataout_size = 0;
+    UNUSED_PARAM(param2);
+
+    if ((job->output_bufs = cplus_mempool_alloc(ipc_serv->response_pool)))
+    {
+        job->is_pooled = true;
+        job->output_size = DEFAULT_RESPONSE_BUFS_SIZE;
+    }
+    else if ((job->output_bufs = cplus_malloc(DEFAULT_RESPONSE_BUFS_SIZE)))
+    {
+        job->output_size = DEFAULT_RESPONSE_BUFS_SIZE;
+    }
+
+    job->res = CPLUS_FAIL;
+    errno = ENOMEM;
+    if (job->output_bufs)
+    {
+        dataout_size = job->output_size - reserved_len;
+        errno = 0;
+        job->res = ipc_conn->on_received(
+            ipc_conn->sock
+            , (job->packet).data_len
+            , (job->packet).data
+            , &dataout_size
+            , &(((uint8_t *)(job->output_bufs))[reserved_len]));
+
+        /* The handler asks for more room, so hand it a buffer of the size it needs and call it again. */
+        if (CPLUS_FAIL != job->res AND (dataout_size + reserved_len) > job->output_size)
+        {
+            job->output_size = dataout_size + reserved_len;
+            ipc_job_release_output(job);
+            job->res = CPLUS_FAIL;
+            errno = ENOMEM;
+            if ((job->output_bufs = cplus_malloc(job->output_size)))
+            {
+                dataout_size = job->output_size - reserved_len;
+                errno = 0;
+                job->res = ipc_conn->on_received(
+                    ipc_conn->sock
+                    , (job->packet).data_len
+                    , (job->packet).data
+                    , &dataout_size
+                    , &(((uint8_t *)(job->output_bufs))[reserved_len]));
+            }
+        }
+    }
+
+    if (CPLUS_FAIL == job->res)
+    {
+        job->status = (0 != errno)? errno: EIO;
+        dataout_size = 0;
+    }
+    job->output_len = CPLUS_MIN(dataout_size, (job->output_bufs)? job->output_size - reserved_len: 0);
+
+    cplus_crit_sect_enter(ipc_conn->job_sect);
+    job->is_done = true;
+    /* Answer strictly in arrival order, a finished job waits for the ones ahead of it
+    and whoever finishes the head sends everything that is ready behind it. */
+    while ((head = ipc_conn->job_head) AND true == head->is_done)
+    {
+        if (CPLUS_NULL == (ipc_conn->job_head = head->next))
+        {
+            ipc_conn->job_tail = CPLUS_NULL;
+        }
+        ipc_conn_answer_job(ipc_conn, head);
+        ipc_job_delete(head);
+        ipc_conn->job_count --;
+    }
+
+    if (true == ipc_conn->is_closing)
+    {
+        if (0 == ipc_conn->job_count)
+        {
+            /* The reactor frees the connection, it cannot get past job_sect before this leaves it. */
+            (ipc_conn->reactor)->is_reap_pending = true;
+            ipc_reactor_kick(ipc_conn->reactor);
+        }
+    }
+    else if (ipc_conn->reactor)
+    {
+        /* Reading may have paused on the bound, and an answer may wait for the socket to drain. */
+        cplus_crit_sect_enter(ipc_conn->send_sect);
+        (void)ipc_reactor_watch_conn(ipc_conn, EPOLL_CTL_MOD);
+        cplus_crit_sect_exit(ipc_conn->send_sect);
+    }
+    cplus_pevent_set(ipc_conn->evt_job_done);
+    cplus_crit_sect_exit(ipc_conn->job_sect);
+}
+
+static int32_t ipc_conn_wait_job_slot(struct ipc_conn * ipc_conn)
+{
+    while (ipc_conn->max_inflight <= cplus_atomic_read(&(ipc_conn->job_count)))
+    {
+        if (IPC_CONN_STATUS_NOT_CONNECTED == ipc_conn->status OR (ipc_conn->ipc_serv)->is_stopping)
+        {
+            errno = ECANCELED;
+            return CPLUS_FAIL;
+        }
+        cplus_pevent_reset(ipc_conn->evt_job_done);
+        if (ipc_conn->max_inflight > cplus_atomic_read(&(ipc_conn->job_count)))
+        {
+            break;
+        }
+        cplus_pevent_wait(ipc_conn->evt_job_done, DURATION_FOR_IPC_REQUEST_SWEEP);
+    }
+    return CPLUS_SUCCESS;
+}
+
+static int32_t ipc_conn_dispatch_job(
+    struct ipc_conn * ipc_conn
+    , IPC_CONN_PACKET packet
+    , uint32_t request_id
+    , uint32_t input_bufs_len
+    , void * input_bufs)
+{
+    struct ipc_job * job = CPLUS_NULL;
+    uint64_t start_nsec = ipc_get_nsec();
+
+    /* A connection on its own task simply stops reading until a slot is free. */
+    if (CPLUS_NULL == ipc_conn->reactor AND CPLUS_SUCCESS != ipc_conn_wait_job_slot(ipc_conn))
+    {
+        return CPLUS_FAIL;
+    }
+
+    /* The input is only valid until the next receive, the job carries a copy right behind itself. */
+    if (CPLUS_NULL == (job = (struct ipc_job *)cplus_malloc(sizeof(struct ipc_job) + input_bufs_len)))
+    {
+        return CPLUS_FAIL;
+    }
+    CPLUS_INITIALIZE_STRUCT_POINTER(job);
+    job->ipc_conn = ipc_conn;
+    job->packet.seqn = packet->seqn;
+    job->packet.cmd = packet->cmd;
+    job->packet.data_len = input_bufs_len;
+    job->packet.data = (0 < input_bufs_len)? (void *)(&(job[1])): CPLUS_NULL;
+    job->request_id = request_id;
+    job->start_nsec = start_nsec;
+    if (0 < input_bufs_len)
+    {
+        cplus_mem_cpy(job->packet.data, input_bufs, input_bufs_len);
+    }
+
+    cplus_crit_sect_enter(ipc_conn->job_sect);
+    if (ipc_conn->job_tail)
+    {
+        (ipc_conn->job_tail)->next = job;
+    }
+    else
+    {
+        ipc_conn->job_head = job;
+    }
+    ipc_conn->job_tail = job;
+    ipc_conn->job_count ++;
+    cplus_crit_sect_exit(ipc_conn->job_sect);
+
+    if (CPLUS_SUCCESS != cplus_taskpool_add_task(ipc_conn->handler_pool, ipc_conn_job_proc, job))
+    {
+        /* Handle it right here rather than lose it, it is still answered in order. */
+        ipc_conn_job_proc(job, CPLUS_NULL);
+    }
+    return CPLUS_SUCCESS;
+}
+
+static void ipc_conn_wait_jobs(struct ipc_conn * ipc_conn)
+{
+    /* Every job refers to its connection, so none may outlive it. */
+    while (ipc_conn->job_sect AND 0 < cplus_atomic_read(&(ipc_conn->job_count)))
+    {
+        cplus_pevent_reset(ipc_conn->evt_job_done);
+        if (0 == cplus_atomic_read(&(ipc_conn->job_count)))
+        {
+            break;
+        }
+        cplus_pevent_wait(ipc_conn->evt_job_done, DURATION_FOR_IPC_REQUEST_SWEEP);
+    }
+
+    if (ipc_conn->job_sect)
+    {
+        /* Let the last worker leave the section it signalled from. */
+        cplus_crit_sect_enter(ipc_conn->job_sect);
+        cplus_crit_sect_exit(ipc_conn->job_sect);
+    }
+}
+
+static int32_t packet_analyze_completed(struct ipc_conn * ipc_conn)
+{
+    int32_t res = CPLUS_SUCCESS, status = CPLUS_SUCCESS;
+    struct ipc_server * ipc_serv = ipc_conn->ipc_serv;
+    struct ipc_conn_packet * completed_packet = &(ipc_conn->packet), response_packet = {0};
+    void * response_bufs = CPLUS_NULL, * pooled_bufs = CPLUS_NULL, * bufs = CPLUS_NULL, * input_bufs = CPLUS_NULL;
+    uint32_t response_bufs_size = 0, dataout_size = 0, input_bufs_len = 0, reserved_len = 0, request_id = 0;
+    uint64_t start_nsec = 0;
+
+    if (ipc_serv)
+    {
+        /* Only the thread serving the connection gets here, the receive side needs no lock. */
+        cplus_atomic_add(&((ipc_conn->counters).bytes_received), completed_packet->data_len);
+        cplus_atomic_add(&((ipc_conn->counters).messages_received), 1);
+        ipc_conn->last_active_tick = cplus_systime_get_tick();
+        if (IPC_CMD_REQUEST == completed_packet->cmd OR IPC_CMD_ASYNC_REQUEST == completed_packet->cmd)
+        {
+            start_nsec = ipc_get_nsec();
+        }
+    }
+
+    switch(completed_packet->cmd)
+    {
+    default:
+        break;
+    case IPC_CMD_ACK:
+        {
+            ipc_client_ack_subscription(ipc_conn->ipc_clt, completed_packet);
+        }
+        break;
+    case IPC_CMD_SUBSCRIBE:
+    case IPC_CMD_UNSUBSCRIBE:
+        {
+            /* Acknowledged with 0 or the errno, like a ring setup. */
+            status = (int32_t)htonl((uint32_t)ipc_conn_update_topics(ipc_conn, completed_packet));
+            response_packet.seqn = completed_packet->seqn;
+            response_packet.cmd = IPC_CMD_ACK;
+            response_packet.data_len = sizeof(status);
+            response_packet.data = &status;
+            res = ipc_conn_send_packet(ipc_conn, &response_packet);
+        }
+        break;
+    case IPC_CMD_PUBLISH:
+        {
+            ipc_conn_deliver_published(ipc_conn, completed_packet);
+        }
+        break;
+    case IPC_CMD_HEARTBEAT:
+        {
+            response_packet.seqn = completed_packet->seqn;
+            response_packet.cmd = IPC_CMD_ACK;
+            response_packet.data_len = 0;
+            response_packet.data = CPLUS_NULL;
+            res = ipc_conn_send_packet(ipc_conn, &response_packet);
+        }
+        break;
+    case IPC_CMD_ASYNC_RESPONSE:
+        {
+            ipc_client_complete_request(ipc_conn->ipc_clt, completed_packet);
+        }
+        break;
+    case IPC_CMD_STREAM_BEGIN:
+    case IPC_CMD_STREAM_CHUNK:
+    case IPC_CMD_STREAM_END:
+        {
+            res = ipc_conn_stream_proc(ipc_conn, completed_packet);
+        }
+        break;
+    case IPC_CMD_STREAM_CREDIT:
+        {
+            ipc_client_update_stream(ipc_conn->ipc_clt, completed_packet);
+        }
+        break;
+    case IPC_CMD_SHM_SETUP:
+        {
+            /* Acknowledged with 0 or the errno, the client stays on the socket alone on failure. */
+            status = (int32_t)htonl((uint32_t)ipc_conn_open_shm(ipc_conn, completed_packet));
+            response_packet.seqn = completed_packet->seqn;
+            response_packet.cmd = IPC_CMD_ACK;
+            response_packet.data_len = sizeof(status);
+            response_packet.data = &status;
+            res = ipc_conn_send_packet(ipc_conn, &response_packet);
+        }
+        break;
+    case IPC_CMD_ONEWAY:
+    case IPC_CMD_REQUEST:
+    case IPC_CMD_RESPONSE:
+    case IPC_CMD_ASYNC_REQUEST:
+        {
+            input_bufs = completed_packet->data;
+            input_bufs_len = completed_packet->data_len;
+            if (IPC_CMD_ASYNC_REQUEST == completed_packet->cmd)
+            {
+                /* The wide request ID leads the payload, and leads the answer together with a status. */
+                if (sizeof(uint32_t) > completed_packet->data_len)
+                {
+                    break;
+                }
+                cplus_mem_cpy(&request_id, completed_packet->data, sizeof(uint32_t));
+                input_bufs = (0 < (input_bufs_len -= sizeof(uint32_t)))
+                    ? &(((uint8_t *)(completed_packet->data))[sizeof(uint32_t)])
+                    : CPLUS_NULL;
+                reserved_len = IPC_ASYNC_RESPONSE_HEAD_SIZE;
+            }
+
+            if (ipc_conn->on_received AND ipc_conn->handler_pool)
+            {
+                res = ipc_conn_dispatch_job(ipc_conn, completed_packet, request_id, input_bufs_len, input_bufs);
+            }
+            else if (ipc_conn->on_received)
+            {
+                if (ipc_conn->shm_tx_data)
+                {
+                    /* Let the callback write straight into the ring, the answer leaves from there. */
+                    response_bufs = ipc_conn_shm_reserve(ipc_conn, &response_bufs_size);
+                    if (IPC_SHM_MIN_FRAME_SIZE > response_bufs_size)
+                    {
+                        response_bufs = CPLUS_NULL;
+                    }
+                }
+
+                /* Borrow a response buffer only for this packet, the frame is either written
+                out or queued on the connection by the time it goes back to the pool. */
+                if (CPLUS_NULL == response_bufs
+                    AND ipc_serv AND ipc_serv->response_pool
+                    AND (pooled_bufs = cplus_mempool_alloc(ipc_serv->response_pool)))
+                {
+                    response_bufs = pooled_bufs;
+                    response_bufs_size = DEFAULT_RESPONSE_BUFS_SIZE;
+                }
+                else if (CPLUS_NULL == response_bufs)
+                {
+                    if (CPLUS_NULL == ipc_conn->response_data)
+                    {
+                        ipc_conn->response_data = (void *)cplus_malloc(ipc_conn->response_data_size);
+                        if (CPLUS_NULL == ipc_conn->response_data)
+                        {
+                            return CPLUS_FAIL;
+                        }
+                    }
+                    response_bufs = ipc_conn->response_data;
+                    response_bufs_size = ipc_conn->response_data_size;
+                }
+
+                dataout_size = response_bufs_size - reserved_len;
+                res = ipc_conn->on_received(
+                    ipc_conn->sock
+                    , input_bufs_len
+                    , input_bufs
+                    , &dataout_size /* Pass current size of 'response_bufs'. */
+                    , &(((uint8_t *)response_bufs)[reserved_len]));
+
+                /* The needed buffer size is larger than the size of existing buffer. */
+                if (CPLUS_FAIL != res AND (dataout_size + reserved_len) > response_bufs_size)
+                {
+                    /* Grow the connection's own buffer, it is kept for the next large response. */
+                    if ((dataout_size + reserved_len) > ipc_conn->response_data_size
+                        OR CPLUS_NULL == ipc_conn->response_data)
+                    {
+                        if (CPLUS_NULL == (bufs = (void *)cplus_malloc(
+                            CPLUS_MAX(dataout_size + reserved_len, ipc_conn->response_data_size))))
+                        {
+                            res = CPLUS_FAIL;
+                        }
+                        else
+                        {
+                            if (ipc_conn->response_data)
+                            {
+                                cplus_free(ipc_conn->response_data);
+                            }
+                            ipc_conn->response_data = bufs;
+                            ipc_conn->response_data_size = CPLUS_MAX(
+                                dataout_size + reserved_len
+                                , ipc_conn->response_data_size);
+                        }
+                    }
+
+                    if (CPLUS_FAIL != res)
+                    {
+                        response_bufs = ipc_conn->response_data;
+                        response_bufs_size = ipc_conn->response_data_size - reserved_len;
+
+                        /* Invoke on_received() callback function to get compleled data. */
+                        res = ipc_conn->on_received(
+                            ipc_conn->sock
+                            , input_bufs_len
+                            , input_bufs
+                            , &response_bufs_size
+                            , &(((uint8_t *)response_bufs)[reserved_len]));
+                    }
+                }
+
+                if (CPLUS_FAIL == res)
+                {
+                    if (IPC_CMD_ASYNC_REQUEST != completed_packet->cmd)
+                    {
+                        goto exit;
+                    }
+                    /* An asynchronous caller hears about the failure instead of waiting out its timeout. */
+                    status = (0 != errno)? errno: EIO;
+                    dataout_size = 0;
+                }
+
+                if (IPC_CMD_REQUEST == completed_packet->cmd)
+                {
+                    if (0 != response_bufs_size)
+                    {
+                        response_packet.seqn = completed_packet->seqn;
+                        response_packet.cmd = IPC_CMD_RESPONSE;
+                        response_packet.data_len = dataout_size;
+                        response_packet.data = response_bufs;
+                        res = ipc_conn_send_packet(ipc_conn, &response_packet);
+                    }
+                }
+                else if (IPC_CMD_ASYNC_REQUEST == completed_packet->cmd)
+                {
+                    status = (int32_t)htonl((uint32_t)status);
+                    cplus_mem_cpy(response_bufs, &request_id, sizeof(uint32_t));
+                    cplus_mem_cpy(&(((uint8_t *)response_bufs)[sizeof(uint32_t)]), &status, sizeof(int32_t));
+
+                    response_packet.seqn = completed_packet->seqn;
+                    response_packet.cmd = IPC_CMD_ASYNC_RESPONSE;
+                    response_packet.data_len = dataout_size + reserved_len;
+                    response_packet.data = response_bufs;
+                    res = ipc_conn_send_packet(ipc_conn, &response_packet);
+                }
+
+                if (0 < start_nsec
+                    AND 0 <= res
+                    AND (IPC_CMD_RESPONSE == response_packet.cmd OR IPC_CMD_ASYNC_RESPONSE == response_packet.cmd))
+                {
+                    ipc_conn_count_request(ipc_conn, start_nsec);
+                }
+                else if (IPC_CMD_RESPONSE == completed_packet->cmd)
+                {
+                    response_packet.seqn = completed_packet->seqn;
+                    response_packet.cmd = IPC_CMD_ACK;
+                    response_packet.data_len = 0;
+                    response_packet.data = CPLUS_NULL;
+                    res = ipc_conn_send_packet(ipc_conn, &response_packet);
+                }
+            }
+        }
+        break;
+    }
+exit:
+    if (pooled_bufs)
+    {
+        cplus_mempool_free(ipc_serv->response_pool, pooled_bufs);
+    }
+    return res;
+}
+
+static int32_t ipc_conn_reserve_frame(struct ipc_conn * ipc_conn, uint32_t frame_len);
+
+static uint32_t ipc_conn_prepare_recv(struct ipc_conn * ipc_conn)
+{
+    uint32_t remain_len = ipc_conn->recv_bufs_len - ipc_conn->recv_bufs_offset;
+
+    if (0 != ipc_conn->shm_rx_release)
+    {
+        /* The last view into the ring expires with this receive. */
+        cplus_atomic_write(ipc_conn->shm_rx_tail, ipc_conn->shm_rx_release);
+        ipc_conn->shm_rx_release = 0;
+    }
+
+    if (ipc_conn->memfd_view)
+    {
+        munmap(ipc_conn->memfd_view, ipc_conn->memfd_view_len);
+        ipc_conn->memfd_view = CPLUS_NULL;
+        ipc_conn->memfd_view_len = 0;
+    }
+
+    if (0 == remain_len)
+    {
+        ipc_conn->recv_bufs_offset = 0;
+        ipc_conn->recv_bufs_len = 0;
+    }
+    else if (0 < ipc_conn->recv_bufs_offset
+        AND IPC_CONN_MAX_FRAME_SIZE > (ipc_conn->recv_bufs_size - ipc_conn->recv_bufs_offset))
+    {
+        /* Only the tail of a partial frame moves, so a frame can always complete in place. */
+        memmove(ipc_conn->recv_bufs, &(ipc_conn->recv_bufs[ipc_conn->recv_bufs_offset]), remain_len);
+        ipc_conn->recv_bufs_offset = 0;
+        ipc_conn->recv_bufs_len = remain_len;
+    }
+
+    if (ipc_conn->is_seqpacket)
+    {
+        /* A datagram cannot be read in parts, so there is always room for the largest one. */
+        (void)ipc_conn_reserve_frame(ipc_conn, IPC_SEQPACKET_MAX_DATAGRAM_SIZE);
+    }
+    return ipc_conn->recv_bufs_size - ipc_conn->recv_bufs_len;
+}
+
+static int32_t ipc_conn_reserve_frame(struct ipc_conn * ipc_conn, uint32_t frame_len)
+{
+    uint32_t remain_len = ipc_conn->recv_bufs_len - ipc_conn->recv_bufs_offset;
+    uint8_t * bufs = CPLUS_NULL;
+
+    if ((ipc_conn->recv_bufs_size - ipc_conn->recv_bufs_offset) >= frame_len)
+    {
+        return CPLUS_SUCCESS;
+    }
+
+    /* Beyond the default size, the buffer grows once and is kept for later frames. */
+    if (ipc_conn->recv_bufs_size < frame_len)
+    {
+        if (CPLUS_NULL == (bufs = (uint8_t *)cplus_malloc(frame_len)))
+        {
+            return CPLUS_FAIL;
+        }
+        cplus_mem_cpy(bufs, &(ipc_conn->recv_bufs[ipc_conn->recv_bufs_offset]), remain_len);
+        cplus_free(ipc_conn->recv_bufs);
+        ipc_conn->recv_bufs = bufs;
+        ipc_conn->recv_bufs_size = frame_len;
+    }
+    else
+    {
+        memmove(ipc_conn->recv_bufs, &(ipc_conn->recv_bufs[ipc_conn->recv_bufs_offset]), remain_len);
+    }
+    ipc_conn->recv_bufs_offset = 0;
+    ipc_conn->recv_bufs_len = remain_len;
+
+    return CPLUS_SUCCESS;
+}
+
+static void ipc_conn_split_batch(struct ipc_conn * ipc_conn, int32_t (* on_completed)(struct ipc_conn *))
+{
+    struct ipc_conn_packet * packet = &(ipc_conn->packet);
+    uint8_t * records = (uint8_t *)(packet->data);
+    uint32_t total_len = packet->data_len, offset = 0, record_len = 0;
+
+    /* Every record is handed on as a oneway of its own, a malformed tail is dropped. */
+    while (on_completed AND IPC_BATCH_RECORD_HEAD_SIZE <= (total_len - offset))
+    {
+        cplus_mem_cpy(&record_len, &(records[offset]), IPC_BATCH_RECORD_HEAD_SIZE);
+        record_len = ntohl(record_len);
+        offset += IPC_BATCH_RECORD_HEAD_SIZE;
+        if (record_len > (total_len - offset))
+        {
+            break;
+        }
+
+        packet->cmd = IPC_CMD_ONEWAY;
+        packet->data_len = record_len;
+        packet->data = (0 < record_len)? &(records[offset]): CPLUS_NULL;
+        offset += record_len;
+        on_completed(ipc_conn);
+    }
+}
+
+static void ipc_packet_deliver(
+    struct ipc_conn * ipc_conn
+    , int32_t (* on_completed)(struct ipc_conn *))
+{
+    struct ipc_conn_packet * packet = &(ipc_conn->packet);
+
+    if (IPC_CMD_SHM_FRAME == packet->cmd AND CPLUS_SUCCESS != ipc_conn_shm_get(ipc_conn, packet))
+    {
+        return;
+    }
+
+    if (IPC_CMD_MEMFD_FRAME == packet->cmd AND CPLUS_SUCCESS != ipc_conn_memfd_get(ipc_conn, packet))
+    {
+        return;
+    }
+
+    if (IPC_CMD_ONEWAY_BATCH == packet->cmd)
+    {
+        ipc_conn_split_batch(ipc_conn, on_completed);
+        return;
+    }
+
+    if (on_completed)
+    {
+        on_completed(ipc_conn);
+    }
+
+    if (ipc_conn->evt_packet_received)
+    {
+        cplus_pevent_set(ipc_conn->evt_packet_received);
+    }
+}
+
+static void ipc_packet_analyze_datagram(
+    struct ipc_conn * ipc_conn
+    , int32_t (* on_completed)(struct ipc_conn *))
+{
+    struct ipc_conn_packet * packet = &(ipc_conn->packet);
+    uint8_t * datagram = &(ipc_conn->recv_bufs[ipc_conn->recv_bufs_offset]);
+    uint32_t datagram_len = ipc_conn->recv_bufs_len - ipc_conn->recv_bufs_offset;
+
+    /* Every receive takes exactly one datagram, and that is exactly one message. */
+    if (IPC_SEQPACKET_HEAD_SIZE > datagram_len)
+    {
+        ipc_conn->recv_bufs_offset = ipc_conn->recv_bufs_len;
+        return;
+    }
+
+    if (ipc_conn->reactor AND ipc_conn->handler_pool
+        AND ipc_conn->max_inflight <= cplus_atomic_read(&(ipc_conn->job_count)))
+    {
+        ipc_conn->is_recv_held = true;
+        return;
+    }
+
+    packet->seqn = datagram[0];
+    packet->cmd = datagram[1];
+    packet->data_len = datagram_len - IPC_SEQPACKET_HEAD_SIZE;
+    packet->data = (0 < packet->data_len)? &(datagram[IPC_SEQPACKET_HEAD_SIZE]): CPLUS_NULL;
+    ipc_conn->recv_bufs_offset = ipc_conn->recv_bufs_len;
+
+    ipc_packet_deliver(ipc_conn, on_completed);
+}
+
+static void ipc_packet_analyze(
+    struct ipc_conn * ipc_conn
+    , int32_t (* on_completed)(struct ipc_conn *))
+{
+    struct ipc_conn_packet * packet = &(ipc_conn->packet);
+    uint8_t * frame = CPLUS_NULL;
+    uint32_t avail_len = 0, data_len = 0, frame_len = 0;
+
+    ipc_conn->recv_bufs_len += (uint32_t)(ipc_conn->recv_count);
+
+    if (ipc_conn->is_seqpacket)
+    {
+        ipc_packet_analyze_datagram(ipc_conn, on_completed);
+        return;
+    }
+
+    while (IPC_CONN_PACKET_HEAD_SIZE <= (avail_len = ipc_conn->recv_bufs_len - ipc_conn->recv_bufs_offset))
+    {
+        if (ipc_conn->reactor AND ipc_conn->handler_pool
+            AND ipc_conn->max_inflight <= cplus_atomic_read(&(ipc_conn->job_count)))
+        {
+            /* A reactor must not block, so the rest stays put until a job is answered. */
+            ipc_conn->is_recv_held = true;
+            break;
+        }
+
+        frame = &(ipc_conn->recv_bufs[ipc_conn->recv_bufs_offset]);
+        if (0 != memcmp(IPC_CONN_PACKET_BEGIN_TAG, frame, IPC_CONN_PACKET_TAG_SIZE))
+        {
+            /* Drop a byte and look for the next head tag. */
+            ipc_conn->recv_bufs_offset += sizeof(uint8_t);
+            continue;
+        }
+
+        cplus_mem_cpy(&data_len, &(frame[IPC_CONN_PACKET_TAG_SIZE + 2]), sizeof(data_len));
+        data_len = ntohl(data_len);
+        frame_len = IPC_CONN_PACKET_HEAD_SIZE + data_len + IPC_CONN_PACKET_TAG_SIZE;
+        if (MAX_FRAME_DATA_SIZE < data_len
+            OR (avail_len < frame_len AND CPLUS_SUCCESS != ipc_conn_reserve_frame(ipc_conn, frame_len)))
+        {
+            ipc_conn->recv_bufs_offset += sizeof(uint8_t);
+            continue;
+        }
+
+        if (avail_len < frame_len)
+        {
+            /* Wait for the rest of the frame. */
+            break;
+        }
+
+        if (0 != memcmp(IPC_CONN_PACKET_END_TAG, &(frame[frame_len - IPC_CONN_PACKET_TAG_SIZE]), IPC_CONN_PACKET_TAG_SIZE))
+        {
+            ipc_conn->recv_bufs_offset += sizeof(uint8_t);
+            continue;
+        }
+
+        /* The payload is handed out as a view into the receive buffer, it stays valid
+        until the next receive on this connection. */
+        packet->seqn = frame[IPC_CONN_PACKET_TAG_SIZE];
+        packet->cmd = frame[IPC_CONN_PACKET_TAG_SIZE + 1];
+        packet->data_len = data_len;
+        packet->data = (0 < data_len)? &(frame[IPC_CONN_PACKET_HEAD_SIZE]): CPLUS_NULL;
+        ipc_conn->recv_bufs_offset += frame_len;
+
+        ipc_packet_deliver(ipc_conn, on_completed);
+    }
+}
+
+static void ipc_conn_sweep_requests(struct ipc_conn * ipc_conn)
+{
+    if (ipc_conn->ipc_clt AND (ipc_conn->ipc_clt)->requests)
+    {
+        /* The receive timeout bounds how late an expired request is reported. */
+        ipc_client_fail_requests(
+            ipc_conn->ipc_clt
+            , (IPC_CONN_STATUS_NOT_CONNECTED == ipc_conn->status)? ECONNRESET: ETIMEDOUT
+            , (IPC_CONN_STATUS_NOT_CONNECTED != ipc_conn->status));
+    }
+}
+
+static int32_t ipc_conn_recv(struct ipc_conn * ipc_conn, uint32_t bufs_len, int32_t flags, uint32_t timeout)
+{
+    struct iovec iov = {0};
+    struct msghdr msg = {0};
+    int32_t count = 0;
+    uint32_t fd_count = 0;
+    union
+    {
+        struct cmsghdr cm;
+        uint8_t control[CMSG_SPACE(IPC_CONN_MAX_PASSED_FDS * sizeof(int32_t))];
+    } control_un;
+
+    /* recvmsg() instead of recv(), which would silently close any memfd passed along. */
+    iov.iov_base = &(ipc_conn->recv_bufs[ipc_conn->recv_bufs_len]);
+    iov.iov_len = bufs_len;
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control_un.control;
+    msg.msg_controllen = sizeof(control_un.control);
+
+    if (0 < (count = cplus_socket_recvmsg(ipc_conn->sock, &msg, flags | MSG_CMSG_CLOEXEC, timeout)))
+    {
+        fd_count = ipc_conn->recv_fds_count;
+        ipc_conn_keep_fds(ipc_conn, &msg);
+        if (ipc_conn->is_seqpacket AND (msg.msg_flags & MSG_TRUNC))
+        {
+            /* No peer of ours sends a datagram this large, it is refused together with its descriptors. */
+            while (fd_count < ipc_conn->recv_fds_count)
+            {
+                ipc_conn->recv_fds_count --;
+                close(ipc_conn->recv_fds[(ipc_conn->recv_fds_head + ipc_conn->recv_fds_count) % IPC_CONN_MAX_PASSED_FDS]);
+            }
+            errno = EMSGSIZE;
+            count = CPLUS_FAIL;
+        }
+    }
+    return count;
+}
+
+static void ipc_conn_proc(void * param1, void * param2)
+{
+    struct ipc_conn * ipc_conn = (struct ipc_conn *)(param1);
+    UNUSED_PARAM(param2);
+
+    if (IPC_CONN_STATUS_NOT_CONNECTED == ipc_conn->status)
+    {
+        ipc_conn_sweep_requests(ipc_conn);
+        return;
+    }
+
+    if (ipc_conn->send_sect AND ipc_conn->send_bufs_offset < ipc_conn->send_bufs_len)
+    {
+        /* Published messages a slow subscriber could not take at once, only this task pushes them on. */
+        cplus_crit_sect_enter(ipc_conn->send_sect);
+        (void)ipc_conn_flush(ipc_conn);
+        cplus_crit_sect_exit(ipc_conn->send_sect);
+    }
+
+    if (ipc_conn->ipc_serv)
+    {
+        ipc_conn_check_slow(ipc_conn);
+    }
+
+    ipc_conn->recv_count = ipc_conn_recv(
+        ipc_conn
+        , ipc_conn_prepare_recv(ipc_conn)
+        , 0
+        , ipc_conn->recv_timeout);
+
+    if (0 == ipc_conn->recv_count)
+    {
+        /* The handlers still running answer on this socket. */
+        ipc_conn_wait_jobs(ipc_conn);
+
+        if (ipc_conn->ipc_serv)
+        {
+            cplus_crit_sect_enter((ipc_conn->ipc_serv)->ipc_conn_sect);
+        }
+
+        if (ipc_conn->on_disconnected)
+        {
+            ipc_conn->on_disconnected(ipc_conn->sock);
+        }
+
+        cplus_socket_delete(ipc_conn->sock);
+        ipc_conn->sock = CPLUS_NULL;
+        ipc_conn->status = IPC_CONN_STATUS_NOT_CONNECTED;
+
+        if (ipc_conn->ipc_serv)
+        {
+            cplus_crit_sect_exit((ipc_conn->ipc_serv)->ipc_conn_sect);
+        }
+    }
+    else if (0 > ipc_conn->recv_count)
+    {
+        ipc_conn->sock_error = errno;
+
+        if (ipc_conn->ipc_serv)
+        {
+            cplus_crit_sect_enter((ipc_conn->ipc_serv)->ipc_conn_sect);
+        }
+
+        switch (ipc_conn->sock_error)
+        {
+        default:
+        case EBADF:
+            /* The argument sockfd is an invalid file descriptor. */
+        case EFAULT:
+            /* The receive buffer pointer(s) point outside the process's
+            address space. */
+        case EINVAL:
+            /* Invalid argument passed. */
+        case ENOMEM:
+            /* Could not allocate memory for recv(). */
+            {
+                ipc_conn->status = IPC_CONN_STATUS_FAULT;
+            }
+            break;
+        case ETIMEDOUT:
+            /* Timeout */
+            {
+                ipc_conn->status = IPC_CONN_STATUS_TIMEOUT;
+            }
+            break;
+        case ENOTCONN:
+            /* The socket is associated with a connection-oriented
+            protocol and has not been connected */
+            {
+                ipc_conn->status = IPC_CONN_STATUS_NOT_CONNECTED;
+            }
+            break;
+        case EINTR:
+            /* The receive was interrupted by delivery of a signal before
+            any data was available. */
+            break;
+        }
+
+        if (ipc_conn->ipc_serv)
+        {
+            cplus_crit_sect_exit((ipc_conn->ipc_serv)->ipc_conn_sect);
+        }
+
+        if (ipc_conn->on_error)
+        {
+            ipc_conn->on_error(ipc_conn->sock, ipc_conn->sock_error);
+        }
+    }
+    else
+    {
+        /* Received the packet successfully, so refresh the status. */
+        ipc_conn->sock_error = 0;
+        ipc_conn->status = IPC_CONN_STATUS_CONNECTED;
+
+        ipc_packet_analyze(
+            ipc_conn
+            , packet_analyze_completed);
+    }
+
+    ipc_conn_sweep_requests(ipc_conn);
+    return;
+}
+
+static struct ipc_conn * ipc_conn_create(
+    struct ipc_server * ipc_serv
+    , cplus_socket conn_sock
+    , bool is_async
+    , CPLUS_IPC_CB_ON_RECEIVED on_received
+    , CPLUS_IPC_CB_ON_DISCONNECTED on_disconnected
+    , CPLUS_IPC_CB_ON_ERROR on_error)
+{
+    struct ipc_conn * conn = CPLUS_NULL;
+
+    if ((conn = (struct ipc_conn *)((ipc_serv)
+        ? (struct ipc_conn *)cplus_mempool_alloc(ipc_serv->ipc_conn_pool)
+        : (struct ipc_conn *)cplus_malloc(sizeof(struct ipc_conn)))))
+    {
+        CPLUS_INITIALIZE_STRUCT_POINTER(conn);
+        conn->ipc_serv = ipc_serv;
+        conn->is_async = is_async;
+        conn->recv_timeout = CPLUS_INFINITE_TIMEOUT;
+        conn->sock = conn_sock;
+        conn->evt_packet_received = CPLUS_NULL;
+        conn->status = IPC_CONN_STATUS_NOT_CONNECTED;
+        conn->sock_error = 0;
+        conn->recv_count = 0;
+        conn->recv_bufs = CPLUS_NULL;
+        conn->recv_bufs_size = IPC_CONN_RECEIVE_BUFFER_SIZE;
+        conn->recv_bufs_offset = 0;
+        conn->recv_bufs_len = 0;
+        conn->response_data_size = DEFAULT_RESPONSE_BUFS_SIZE;
+        conn->response_data = CPLUS_NULL;
+        conn->conn_task = CPLUS_NULL;
+        conn->memfd_threshold = (ipc_serv)? ipc_serv->memfd_threshold: 0;
+        conn->is_seqpacket = (ipc_serv)? ipc_serv->is_seqpacket: false;
+        conn->on_stream_chunk = (ipc_serv)? ipc_serv->on_stream_chunk: CPLUS_NULL;
+        conn->handler_pool = (ipc_serv)? ipc_serv->handler_pool: CPLUS_NULL;
+        conn->max_inflight = (ipc_serv)? ipc_serv->max_inflight_per_conn: 0;
+        conn->last_active_tick = cplus_systime_get_tick();
+
+        if (on_received)
+        {
+            conn->on_received = on_received;
+        }
+        if (on_disconnected)
+        {
+            conn->on_disconnected = on_disconnected;
+        }
+        if (on_error)
+        {
+            conn->on_error = on_error;
+        }
+
+        if (CPLUS_NULL == conn->recv_bufs)
+        {
+            conn->recv_bufs = (uint8_t *)cplus_malloc(conn->recv_bufs_size);
+            if (CPLUS_NULL == conn->recv_bufs)
+            {
+                goto error;
+            }
+        }
+
+        if (ipc_serv AND CPLUS_NULL == (conn->send_sect = cplus_mutex_new()))
+        {
+            /* Publishers and handler pool workers write next to the receiving thread. */
+            goto error;
+        }
+
+        if (conn->handler_pool)
+        {
+            if (CPLUS_NULL == (conn->job_sect = cplus_mutex_new())
+                OR CPLUS_NULL == (conn->evt_job_done = cplus_pevent_new(true, false)))
+            {
+                goto error;
+            }
+        }
+
+        if (ipc_serv AND ipc_serv->reactors)
+        {
+            /* Served by a shared reactor, it is registered once the owner publishes it. */
+            conn->reactor = &(ipc_serv->reactors[ipc_serv->next_reactor]);
+            ipc_serv->next_reactor = (ipc_serv->next_reactor + 1) % ipc_serv->reactor_count;
+        }
+        else if (true == conn->is_async)
+        {
+            /* Wake up regularly to expire requests and to notice a stop. */
+            conn->recv_timeout = DURATION_FOR_IPC_REQUEST_SWEEP;
+            conn->conn_task = cplus_task_new(
+                ipc_conn_proc
+                , conn
+                , CPLUS_NULL
+                , DURATION_FOR_IPC_CONN_TASK);
+            if (CPLUS_NULL == conn->conn_task)
+            {
+                goto error;
+            }
+            cplus_task_start(conn->conn_task, 500);
+        }
+        else
+        {
+            if (CPLUS_NULL == conn->evt_packet_received)
+            {
+                conn->evt_packet_received = cplus_pevent_new(true, false);
+                if (CPLUS_NULL == conn->evt_packet_received)
+                {
+                    goto error;
+                }
+            }
+        }
+        return conn;
+    }
+error:
+    if (conn)
+    {
+        /* The socket stays with the caller when no connection could be made of it. */
+        conn->sock = CPLUS_NULL;
+        ipc_conn_delete(conn);
+    }
+    return CPLUS_NULL;
+}
+
+static inline int32_t find_disconnect_conn(void * data, void * arg)
+{
+    UNUSED_PARAM(arg);
+    return !(IPC_CONN_STATUS_NOT_CONNECTED == ((struct ipc_conn *)(data))->status);
+}
+
+void ipc_server_proc(void * param1, void * param2)
+{
+    struct ipc_server * ipc_serv = (struct ipc_server *)(param1);
+    bool can_accept = false;
+    struct ipc_conn * conn = CPLUS_NULL;
+    cplus_socket sock = CPLUS_NULL;
+    UNUSED_PARAM(param2);
+
+    cplus_crit_sect_enter(ipc_serv->ipc_conn_sect);
+    while ((conn = (struct ipc_conn *)cplus_llist_pop_if(
+        ipc_serv->ipc_conn_list
+        , find_disconnect_conn
+        , CPLUS_NULL)))
+    {
+        ipc_conn_counters_merge(&(ipc_serv->retired), &(conn->counters));
+        ipc_conn_delete(conn);
+    }
+
+    if (cplus_llist_get_size(ipc_serv->ipc_conn_list) < ipc_serv->max_conn)
+    {
+        can_accept = true;
+    }
+    cplus_crit_sect_exit(ipc_serv->ipc_conn_sect);
+
+    if (true == can_accept)
+    {
+        if ((sock = cplus_socket_accept(ipc_serv->accept_socket, CPLUS_INFINITE_TIMEOUT)))
+        {
+            conn = ipc_conn_create(
+                ipc_serv
+                , sock
+                , true
+                , ipc_serv->on_received
+                , ipc_serv->on_disconnected
+                , ipc_serv->on_error);
+            if (conn)
+            {
+                conn->status = IPC_CONN_STATUS_CONNECTED;
+
+                cplus_crit_sect_enter(ipc_serv->ipc_conn_sect);
+                cplus_llist_push_front(ipc_serv->ipc_conn_list, conn);
+                ipc_serv->accepted_count ++;
+                cplus_crit_sect_exit(ipc_serv->ipc_conn_sect);
+
+                /* Invoke on_connect() callback function. */
+                if (ipc_serv->on_connected)
+                {
+                    ipc_serv->on_connected(sock);
+                }
+            }
+            else
+            {
+                cplus_socket_delete(sock);
+            }
+        }
+    }
+    return;
+}
+
+static uint32_t ipc_reactor_get_conn_events(struct ipc_conn * ipc_conn)
+{
+    uint32_t events = 0;
+
+    /* Stop reading from a peer which does not read its responses or keeps too many packets
+    unanswered on the handler pool, HUP and ERR are still reported. */
+    if (MAX_PENDING_SEND_SIZE > (ipc_conn->send_bufs_len - ipc_conn->send_bufs_offset)
+        AND (CPLUS_NULL == ipc_conn->handler_pool
+            OR ipc_conn->max_inflight > cplus_atomic_read(&(ipc_conn->job_count))))
+    {
+        events |= EPOLLIN;
+    }
+
+    if (ipc_conn->send_bufs_offset < ipc_conn->send_bufs_len)
+    {
+        events |= EPOLLOUT;
+    }
+
+    if (true == ipc_conn->is_recv_held AND ipc_conn->max_inflight > cplus_atomic_read(&(ipc_conn->job_count)))
+    {
+        /* The held frames may be all there is, so ask for a writable socket to get called back at once. */
+        events |= EPOLLOUT;
+    }
+
+    if ((ipc_conn->ipc_serv)->dispatch_pool)
+    {
+        /* Keep one worker per connection, so the packets are still handled in order. */
+        events |= EPOLLONESHOT;
+    }
+    return events;
+}
+
+static int32_t ipc_reactor_watch_conn(struct ipc_conn * ipc_conn, int32_t op)
+{
+    struct epoll_event event = {0};
+    uint32_t events = ipc_reactor_get_conn_events(ipc_conn);
+
+    if (EPOLL_CTL_MOD == op
+        AND events == ipc_conn->epoll_events
+        AND 0 == (events & EPOLLONESHOT))
+    {
+        return CPLUS_SUCCESS;
+    }
+
+    event.events = events;
+    event.data.ptr = ipc_conn;
+    if (0 != epoll_ctl((ipc_conn->reactor)->epoll_fd, op, cplus_socket_get_fd(ipc_conn->sock), &event))
+    {
+        return CPLUS_FAIL;
+    }
+    ipc_conn->epoll_events = events;
+
+    return CPLUS_SUCCESS;
+}
+
+static void ipc_server_resume_accept(struct ipc_server * ipc_serv)
+{
+    struct epoll_event event = {0};
+
+    /* Caller holds ipc_conn_sect. */
+    if (true == ipc_serv->is_accept_paused)
+    {
+        event.events = EPOLLIN;
+        event.data.ptr = ipc_serv;
+        if (0 == epoll_ctl(
+            ipc_serv->reactors[0].epoll_fd
+            , EPOLL_CTL_MOD
+            , cplus_socket_get_fd(ipc_serv->accept_socket)
+            , &event))
+        {
+            ipc_serv->is_accept_paused = false;
+        }
+    }
+}
+
+static inline int32_t find_conn(void * data, void * arg)
+{
+    return !(data == arg);
+}
+
+static void ipc_reactor_release_conn(struct ipc_conn * ipc_conn)
+{
+    struct ipc_server * ipc_serv = ipc_conn->ipc_serv;
+
+    /* Caller holds ipc_conn_sect and took it off the list. */
+    ipc_conn_counters_merge(&(ipc_serv->retired), &(ipc_conn->counters));
+    ipc_server_resume_accept(ipc_serv);
+    ipc_conn_delete(ipc_conn);
+}
+
+static void ipc_reactor_close_conn(struct ipc_conn * ipc_conn)
+{
+    struct ipc_server * ipc_serv = ipc_conn->ipc_serv;
+    bool is_busy = false;
+
+    epoll_ctl((ipc_conn->reactor)->epoll_fd, EPOLL_CTL_DEL, cplus_socket_get_fd(ipc_conn->sock), CPLUS_NULL);
+
+    cplus_crit_sect_enter(ipc_serv->ipc_conn_sect);
+    ipc_conn->status = IPC_CONN_STATUS_NOT_CONNECTED;
+    if (ipc_conn->on_disconnected)
+    {
+        ipc_conn->on_disconnected(ipc_conn->sock);
+    }
+
+    /* Handlers still running keep it in the list, the last one to finish has the reactor reap it,
+    so the reactor never waits on them. */
+    if (ipc_conn->job_sect)
+    {
+        cplus_crit_sect_enter(ipc_conn->job_sect);
+        ipc_conn->is_closing = true;
+        is_busy = (0 < ipc_conn->job_count);
+        cplus_crit_sect_exit(ipc_conn->job_sect);
+    }
+
+    if (false == is_busy)
+    {
+        cplus_llist_pop_if(ipc_serv->ipc_conn_list, find_conn, ipc_conn);
+        ipc_reactor_release_conn(ipc_conn);
+    }
+    cplus_crit_sect_exit(ipc_serv->ipc_conn_sect);
+}
+
+static int32_t ipc_reactor_conn_recv(struct ipc_conn * ipc_conn)
+{
+    uint32_t bufs_len = 0;
+
+    for (uint32_t round = 0; round < MAX_REACTOR_RECV_ROUNDS AND false == ipc_conn->is_recv_held; round++)
+    {
+        bufs_len = ipc_conn_prepare_recv(ipc_conn);
+        ipc_conn->recv_count = ipc_conn_recv(ipc_conn, bufs_len, MSG_DONTWAIT, 0);
+
+        if (0 == ipc_conn->recv_count)
+        {
+            return CPLUS_FAIL;
+        }
+        else if (0 > ipc_conn->recv_count)
+        {
+            if (EINTR == errno)
+            {
+                continue;
+            }
+            if (EAGAIN == errno OR EWOULDBLOCK == errno)
+            {
+                break;
+            }
+
+            ipc_conn->sock_error = errno;
+            ipc_conn->status = IPC_CONN_STATUS_FAULT;
+            if (ipc_conn->on_error)
+            {
+                ipc_conn->on_error(ipc_conn->sock, ipc_conn->sock_error);
+            }
+            return CPLUS_FAIL;
+        }
+
+        ipc_conn->sock_error = 0;
+        ipc_conn->status = IPC_CONN_STATUS_CONNECTED;
+        ipc_packet_analyze(ipc_conn, packet_analyze_completed);
+
+        if (false == ipc_conn->is_seqpacket AND ((uint32_t)ipc_conn->recv_count) < bufs_len)
+        {
+            /* Drained, do not pay for a recv() which only says EAGAIN. A datagram always
+            comes short, so those are read on until then. */
+            break;
+        }
+
+    }
+    return CPLUS_SUCCESS;
+}
+
+static void ipc_reactor_conn_proc(void * param1, void * param2)
+{
+    struct ipc_conn * ipc_conn = (struct ipc_conn *)(param1);
+    uint32_t events = (uint32_t)((uintptr_t)(param2));
+    bool is_closed = false;
+
+    if (events & EPOLLOUT)
+    {
+        if (ipc_conn->send_sect)
+        {
+            cplus_crit_sect_enter(ipc_conn->send_sect);
+        }
+        is_closed = (CPLUS_SUCCESS != ipc_conn_flush(ipc_conn));
+        if (ipc_conn->send_sect)
+        {
+            cplus_crit_sect_exit(ipc_conn->send_sect);
+        }
+    }
+
+    if (false == is_closed AND true == ipc_conn->is_recv_held)
+    {
+        if (events & (EPOLLHUP | EPOLLERR))
+        {
+            /* Always reported, so rather wait for a slot here than spin on it. */
+            (void)ipc_conn_wait_job_slot(ipc_conn);
+        }
+
+        if (ipc_conn->max_inflight > cplus_atomic_read(&(ipc_conn->job_count)))
+        {
+            ipc_conn->is_recv_held = false;
+            ipc_conn->recv_count = 0;
+            ipc_packet_analyze(ipc_conn, packet_analyze_completed);
+        }
+    }
+
+    if (false == is_closed AND (events & (EPOLLIN | EPOLLHUP | EPOLLERR)))
+    {
+        is_closed = (CPLUS_SUCCESS != ipc_reactor_conn_recv(ipc_conn));
+    }
+
+    if (false == is_closed)
+    {
+        /* Still ours alone, once armed again the next event may run on another worker. */
+        ipc_conn_check_slow(ipc_conn);
+
+        if (ipc_conn->send_sect)
+        {
+            cplus_crit_sect_enter(ipc_conn->send_sect);
+        }
+        /* Hand the connection back before it is armed, another event may follow at once. */
+        ipc_conn->is_dispatched = false;
+        is_closed = (CPLUS_SUCCESS != ipc_reactor_watch_conn(ipc_conn, EPOLL_CTL_MOD));
+        if (ipc_conn->send_sect)
+        {
+            cplus_crit_sect_exit(ipc_conn->send_sect);
+        }
+    }
+
+    if (true == is_closed)
+    {
+        ipc_reactor_close_conn(ipc_conn);
+    }
+}
+
+static void ipc_reactor_dispatched_proc(void * param1, void * param2)
+{
+    struct ipc_server * ipc_serv = ((struct ipc_conn *)(param1))->ipc_serv;
+
+    ipc_reactor_conn_proc(param1, param2);
+    cplus_atomic_add(&(ipc_serv->dispatched_count), -1);
+}
+
+static void ipc_reactor_accept(struct ipc_server * ipc_serv)
+{
+    struct epoll_event event = {0};
+    struct ipc_conn * conn = CPLUS_NULL;
+    cplus_socket sock = CPLUS_NULL;
+
+    while (true)
+    {
+        cplus_crit_sect_enter(ipc_serv->ipc_conn_sect);
+        if (cplus_llist_get_size(ipc_serv->ipc_conn_list) >= ipc_serv->max_conn)
+        {
+            /* Leave further peers in the backlog until a connection is closed. */
+            event.events = 0;
+            event.data.ptr = ipc_serv;
+            if (0 == epoll_ctl(
+                ipc_serv->reactors[0].epoll_fd
+                , EPOLL_CTL_MOD
+                , cplus_socket_get_fd(ipc_serv->accept_socket)
+                , &event))
+            {
+                ipc_serv->is_accept_paused = true;
+            }
+            cplus_crit_sect_exit(ipc_serv->ipc_conn_sect);
+            break;
+        }
+        cplus_crit_sect_exit(ipc_serv->ipc_conn_sect);
+
+        if (CPLUS_NULL == (sock = cplus_socket_accept(ipc_serv->accept_socket, CPLUS_INFINITE_TIMEOUT)))
+        {
+            break;
+        }
+
+        conn = ipc_conn_create(
+            ipc_serv
+            , sock
+            , true
+            , ipc_serv->on_received
+            , ipc_serv->on_disconnected
+            , ipc_serv->on_error);
+        if (CPLUS_NULL == conn)
+        {
+            cplus_socket_delete(sock);
+            continue;
+        }
+
+        conn->status = IPC_CONN_STATUS_CONNECTED;
+
+        cplus_crit_sect_enter(ipc_serv->ipc_conn_sect);
+        cplus_llist_push_front(ipc_serv->ipc_conn_list, conn);
+        ipc_serv->accepted_count ++;
+        cplus_crit_sect_exit(ipc_serv->ipc_conn_sect);
+
+        if (ipc_serv->on_connected)
+        {
+            ipc_serv->on_connected(sock);
+        }
+
+        if (CPLUS_SUCCESS != ipc_reactor_watch_conn(conn, EPOLL_CTL_ADD))
+        {
+            ipc_reactor_close_conn(conn);
+        }
+    }
+}
+
+static inline int32_t find_rearm_conn(void * data, void * arg)
+{
+    struct ipc_conn * conn = (struct ipc_conn *)(data);
+
+    /* Never matches, it only visits the connections on the reactor. */
+    if (conn->reactor == (struct ipc_reactor *)(arg) AND true == conn->is_rearm_pending)
+    {
+        cplus_crit_sect_enter(conn->send_sect);
+        conn->is_rearm_pending = false;
+        if (false == conn->is_dispatched)
+        {
+            /* Idle and armed, a worker holding it re-arms it by itself as it finishes. */
+            (void)ipc_reactor_watch_conn(conn, EPOLL_CTL_MOD);
+        }
+        cplus_crit_sect_exit(conn->send_sect);
+    }
+    return 1;
+}
+
+static inline int32_t find_reap_conn(void * data, void * arg)
+{
+    struct ipc_conn * conn = (struct ipc_conn *)(data);
+
+    return !(conn->reactor == (struct ipc_reactor *)(arg)
+        AND true == conn->is_closing
+        AND 0 == cplus_atomic_read(&(conn->job_count)));
+}
+
+static void ipc_reactor_reap_conns(struct ipc_reactor * reactor)
+{
+    struct ipc_server * ipc_serv = reactor->ipc_serv;
+    struct ipc_conn * conn = CPLUS_NULL;
+
+    reactor->is_reap_pending = false;
+    cplus_crit_sect_enter(ipc_serv->ipc_conn_sect);
+    while ((conn = (struct ipc_conn *)cplus_llist_pop_if(ipc_serv->ipc_conn_list, find_reap_conn, reactor)))
+    {
+        ipc_reactor_release_conn(conn);
+    }
+    cplus_crit_sect_exit(ipc_serv->ipc_conn_sect);
+}
+
+static void ipc_reactor_rearm_conns(struct ipc_reactor * reactor)
+{
+    struct ipc_server * ipc_serv = reactor->ipc_serv;
+
+    reactor->is_rearm_pending = false;
+    cplus_crit_sect_enter(ipc_serv->ipc_conn_sect);
+    (void)cplus_llist_get_if(ipc_serv->ipc_conn_list, find_rearm_conn, reactor);
+    cplus_crit_sect_exit(ipc_serv->ipc_conn_sect);
+}
+
+static void ipc_reactor_proc(void * param1, void * param2)
+{
+    struct ipc_reactor * reactor = (struct ipc_reactor *)(param1);
+    struct ipc_server * ipc_serv = reactor->ipc_serv;
+    struct epoll_event events[MAX_REACTOR_EVENTS];
+    CPLUS_TASKPOOL_TASK_T task = {0};
+    int32_t count = 0;
+    uint64_t value = 0;
+    ssize_t res = 0;
+    UNUSED_PARAM(param2);
+
+    if (true == ipc_serv->is_stopping)
+    {
+        return;
+    }
+
+    if (0 >= (count = epoll_wait(reactor->epoll_fd, events, MAX_REACTOR_EVENTS, -1)))
+    {
+        return;
+    }
+
+    for (int32_t i = 0; i < count AND false == ipc_serv->is_stopping; i++)
+    {
+        if (events[i].data.ptr == reactor)
+        {
+            res = read(reactor->wakeup_fd, &value, sizeof(value));
+            UNUSED_PARAM(res);
+        }
+        else if (events[i].data.ptr == ipc_serv)
+        {
+            ipc_reactor_accept(ipc_serv);
+        }
+        else if (ipc_serv->dispatch_pool)
+        {
+            cplus_crit_sect_enter(((struct ipc_conn *)(events[i].data.ptr))->send_sect);
+            ((struct ipc_conn *)(events[i].data.ptr))->is_dispatched = true;
+            cplus_crit_sect_exit(((struct ipc_conn *)(events[i].data.ptr))->send_sect);
+
+            task.proc = ipc_reactor_dispatched_proc;
+            task.param1 = events[i].data.ptr;
+            task.param2 = (void *)((uintptr_t)(events[i].events));
+            task.callback = CPLUS_NULL;
+
+            cplus_atomic_add(&(ipc_serv->dispatched_count), 1);
+            if (CPLUS_SUCCESS != cplus_taskpool_add_task_ex(ipc_serv->dispatch_pool, &task))
+            {
+                /* The pool is full, serve it here rather than lose the one-shot event. */
+                ipc_reactor_dispatched_proc(task.param1, task.param2);
+            }
+        }
+        else
+        {
+            ipc_reactor_conn_proc(events[i].data.ptr, (void *)((uintptr_t)(events[i].events)));
+        }
+    }
+
+    if (true == reactor->is_rearm_pending AND false == ipc_serv->is_stopping)
+    {
+        /* Only now is every connection delivered above marked as dispatched. */
+        ipc_reactor_rearm_conns(reactor);
+    }
+
+    if (true == reactor->is_reap_pending AND false == ipc_serv->is_stopping)
+    {
+        ipc_reactor_reap_conns(reactor);
+    }
+}
+
+static int32_t ipc_client_send_packet(
+    struct ipc_client * clt
+    , IPC_CONN_PACKET packet
+    , void * prefix
+    , uint32_t prefix_len)
+{
+    uint8_t head[IPC_CONN_PACKET_HEAD_SIZE] = {0};
+    struct iovec iov[4] = {0};
+    struct ipc_shm_desc desc = {0};
+    struct ipc_memfd_desc memfd_desc = {0};
+    struct ipc_conn_packet desc_packet = {0};
+    uint32_t total = 0, data_len = packet->data_len;
+    int32_t res = CPLUS_FAIL, memfd = INVALID_FD;
+
+    if (clt->batch_bufs AND IPC_CMD_ONEWAY_BATCH != packet->cmd)
+    {
+        /* Nothing overtakes the oneways batched before it. */
+        ipc_client_flush_batch(clt);
+    }
+
+    /* Only a client with a receive task can be shared by several senders. A ring slot and
+    its descriptor stay in order under the same lock. */
+    if (clt->send_sect)
+    {
+        cplus_crit_sect_enter(clt->send_sect);
+    }
+
+    if (clt->ipc_conn
+        AND CPLUS_SUCCESS == ipc_conn_shm_put(clt->ipc_conn, prefix, prefix_len, packet, &desc))
+    {
+        desc_packet.seqn = packet->seqn;
+        desc_packet.cmd = IPC_CMD_SHM_FRAME;
+        desc_packet.data_len = sizeof(desc);
+        desc_packet.data = &desc;
+        res = (0 <= ipc_send_packet(clt->server_socket, clt->is_seqpacket, &desc_packet))? (int32_t)(data_len): CPLUS_FAIL;
+    }
+    else if (clt->ipc_conn
+        AND INVALID_FD != (memfd = ipc_conn_memfd_put(clt->ipc_conn, prefix, prefix_len, packet, &memfd_desc)))
+    {
+        desc_packet.seqn = packet->seqn;
+        desc_packet.cmd = IPC_CMD_MEMFD_FRAME;
+        desc_packet.data_len = sizeof(memfd_desc);
+        desc_packet.data = &memfd_desc;
+        res = (0 <= ipc_send_frame(clt->server_socket, clt->is_seqpacket, &desc_packet, memfd))? (int32_t)(data_len): CPLUS_FAIL;
+        close(memfd);
+    }
+    else if (0 == prefix_len)
+    {
+        res = ipc_send_packet(clt->server_socket, clt->is_seqpacket, packet);
+    }
+    else if (IPC_MAX_FRAME_DATA_SIZE(clt->is_seqpacket) < (prefix_len + data_len))
+    {
+        errno = EMSGSIZE;
+    }
+    else
+    {
+        /* The prefix rides in its own iovec, so the caller's payload is never copied. */
+        packet->data_len = prefix_len + data_len;
+        ipc_packet_build_iov(packet, clt->is_seqpacket, head, iov);
+        packet->data_len = data_len;
+        iov[3] = iov[2];
+        iov[2].iov_base = packet->data;
+        iov[2].iov_len = (packet->data)? data_len: 0;
+        iov[1].iov_base = prefix;
+        iov[1].iov_len = prefix_len;
+        total = (uint32_t)(iov[0].iov_len + iov[1].iov_len + iov[2].iov_len + iov[3].iov_len);
+        res = (((int32_t)total) == cplus_socket_sendv(clt->server_socket, iov, 4))? (int32_t)(data_len): CPLUS_FAIL;
+    }
+
+    if (clt->send_sect)
+    {
+        cplus_crit_sect_exit(clt->send_sect);
+    }
+    return res;
+}
+
+static int32_t ipc_client_wait_packet(struct ipc_client * clt, uint8_t seqn, uint32_t timeout)
+{
+    int32_t res = CPLUS_SUCCESS, count = 0;
+    uint32_t curr_tick = 0;
+
+    (clt->ipc_conn)->recv_timeout = timeout;
+
+    while (true)
+    {
+        curr_tick = cplus_systime_get_tick();
+        ipc_conn_proc(clt->ipc_conn, CPLUS_NULL);
+        count = (clt->ipc_conn)->recv_count;
+        if (0 >= count)
+        {
+            res = CPLUS_FAIL;
+            break;
+        }
+        else
+        {
+            uint32_t elapsed_period = cplus_systime_elapsed_tick(curr_tick);
+            if (elapsed_period >= (clt->ipc_conn)->recv_timeout)
+            {
+                errno = ETIMEDOUT;
+                res = CPLUS_FAIL;
+                break;
+            }
+            else
+            {
+                /* Refreah timeout. */
+                (clt->ipc_conn)->recv_timeout -= elapsed_period;
+            }
+        }
+
+        /* Reason for False Positive : The mutex will be locked or always blocked
+            until call calling pthread_cond_broadcast() or pthread_cond_signal(). */
+        /* coverity[double_unlock: FALSE] */
+        if (CPLUS_FAIL == cplus_pevent_wait((clt->ipc_conn)->evt_packet_received, 0))
+        {
+            if (EAGAIN != errno)
+            {
+                res = CPLUS_FAIL;
+                break;
+            }
+        }
+        else
+        {
+            /* Completely received a packet */
+            if (seqn == clt->ipc_conn->packet.seqn)
+            {
+                /* Sequence number correct, then exit loop */
+                res = CPLUS_SUCCESS;
+                break;
+            }
+            else
+            {
+                uint32_t diff = 0;
+                if (seqn > (clt->ipc_conn)->packet.seqn)
+                {
+                    diff = seqn - (clt->ipc_conn)->packet.seqn;
+                }
+                else
+                {
+                    diff = (255U - seqn) + (clt->ipc_conn)->packet.seqn;
+                }
+
+                if (TOLERANCE_TO_DIFF_SEQUENCE > diff)
+                {
+                    /* Drop recviced packet */
+                    cplus_pevent_reset((clt->ipc_conn)->evt_packet_received);
+                }
+                else
+                {
+                    errno = EILSEQ;
+                    res = CPLUS_FAIL;
+                    break;
+                }
+            }
+        }
+    }
+
+    cplus_pevent_reset((clt->ipc_conn)->evt_packet_received);
+
+    if (CPLUS_FAIL == res
+        OR 0 != (clt->ipc_conn)->sock_error)
+    {
+        errno = (0 != (clt->ipc_conn)->sock_error)? (clt->ipc_conn)->sock_error: errno;
+        res = CPLUS_FAIL;
+    }
+    return res;
+}
+
+static cplus_sharedmem ipc_client_setup_shm(struct ipc_client * clt, uint32_t ring_size, uint32_t timeout)
+{
+    static uint32_t shm_count = 0;
+    char name[IPC_SHM_NAME_MAX_SIZE + 1] = {0};
+    cplus_sharedmem shm = CPLUS_NULL;
+    struct ipc_shm_header * header = CPLUS_NULL;
+    struct ipc_conn_packet request_packet = {0}, response_packet = {0};
+    uint32_t status = htonl(ETIMEDOUT);
+    int32_t count = 0;
+
+    if (0 > (count = cplus_str_printf(
+        name
+        , sizeof(name)
+        , "ipc.%d.%u"
+        , getpid()
+        , cplus_atomic_add(&shm_count, 1))))
+    {
+        return CPLUS_NULL;
+    }
+
+    if (CPLUS_NULL == (shm = cplus_sharedmem_create(name, IPC_SHM_HEADER_SIZE + (2 * ring_size))))
+    {
+        return CPLUS_NULL;
+    }
+    header = (struct ipc_shm_header *)cplus_sharedmem_alloc(shm);
+    cplus_mem_set(header, 0x00, IPC_SHM_HEADER_SIZE);
+    header->ring_size = ring_size;
+
+    request_packet.seqn = ACCUMULATE_SEQUENCE_NUMBER(clt->seqn);
+    request_packet.cmd = IPC_CMD_SHM_SETUP;
+    request_packet.data_len = strlen(name) + 1;
+    request_packet.data = name;
+
+    if (0 <= ipc_client_send_packet(clt, &request_packet, CPLUS_NULL, 0))
+    {
+        if (clt->ipc_conn)
+        {
+            if (CPLUS_SUCCESS == ipc_client_wait_packet(clt, request_packet.seqn, timeout)
+                AND IPC_CMD_ACK == (clt->ipc_conn)->packet.cmd
+                AND sizeof(status) == (clt->ipc_conn)->packet.data_len)
+            {
+                cplus_mem_cpy(&status, (clt->ipc_conn)->packet.data, sizeof(status));
+            }
+        }
+        else if (0 <= ipc_recv_packet(clt->server_socket, clt->is_seqpacket, &response_packet, sizeof(status), &status, timeout)
+            AND (request_packet.seqn != response_packet.seqn OR IPC_CMD_ACK != response_packet.cmd))
+        {
+            status = htonl(EPROTO);
+        }
+    }
+
+    if (0 != (status = ntohl(status)))
+    {
+        cplus_sharedmem_delete(shm);
+        errno = (int32_t)status;
+        return CPLUS_NULL;
+    }
+    return shm;
+}
+
+int32_t cplus_ipc_client_send_heartbeat(cplus_ipc_client obj, uint32_t timeout)
+{
+    int32_t res = CPLUS_FAIL, count = 0;
+    struct ipc_client * clt = (struct ipc_client *)(obj);
+    struct ipc_conn_packet request_packet = {0}, response_packet = {0};
+
+    CHECK_OBJECT_TYPE_EX(obj, OBJ_TYPE_CLIENT);
+
+    request_packet.seqn = ACCUMULATE_SEQUENCE_NUMBER(clt->seqn);
+    request_packet.cmd = IPC_CMD_HEARTBEAT;
+    request_packet.data_len = 0;
+    request_packet.data = CPLUS_NULL;
+
+    count = ipc_client_send_packet(clt, &request_packet, CPLUS_NULL, 0);
+    if (0 <= count)
+    {
+        if (clt->ipc_conn AND false == clt->is_async)
+        {
+            /* Parse the answer with the connection's buffered reader, as requests do. */
+            if (CPLUS_SUCCESS == ipc_client_wait_packet(clt, request_packet.seqn, timeout)
+                AND IPC_CMD_ACK == (clt->ipc_conn)->packet.cmd)
+            {
+                res = CPLUS_SUCCESS;
+            }
+        }
+        else
+        {
+            count = ipc_recv_packet(clt->server_socket, clt->is_seqpacket, &response_packet, 0, CPLUS_NULL, timeout);
+            if (0 <= count)
+            {
+                if (request_packet.seqn == response_packet.seqn
+                    AND IPC_CMD_ACK == response_packet.cmd)
+                {
+                    res = CPLUS_SUCCESS;
+                }
+            }
+        }
+    }
+    return res;
+}
+
+static int32_t ipc_client_flush_batch_locked(struct ipc_client * clt)
+{
+    struct ipc_conn_packet batch_packet = {0};
+    int32_t res = CPLUS_SUCCESS;
+
+    if (0 < clt->batch_len)
+    {
+        batch_packet.seqn = ACCUMULATE_SEQUENCE_NUMBER(clt->seqn);
+        batch_packet.cmd = IPC_CMD_ONEWAY_BATCH;
+        batch_packet.data_len = clt->batch_len;
+        batch_packet.data = clt->batch_bufs;
+        res = (0 <= ipc_client_send_packet(clt, &batch_packet, CPLUS_NULL, 0))? CPLUS_SUCCESS: CPLUS_FAIL;
+        /* A batch which could not be written is lost, as a single oneway would be. */
+        clt->batch_len = 0;
+    }
+    return res;
+}
+
+static int32_t ipc_client_flush_batch(struct ipc_client * clt)
+{
+    int32_t res = CPLUS_SUCCESS;
+
+    if (clt->batch_sect)
+    {
+        cplus_crit_sect_enter(clt->batch_sect);
+        res = ipc_client_flush_batch_locked(clt);
+        cplus_crit_sect_exit(clt->batch_sect);
+    }
+    return res;
+}
+
+static void ipc_client_batch_proc(void * param1, void * param2)
+{
+    struct ipc_client * clt = (struct ipc_client *)(param1);
+    UNUSED_PARAM(param2);
+
+    cplus_crit_sect_enter(clt->batch_sect);
+    if (0 < clt->batch_len AND clt->batch_linger <= cplus_systime_elapsed_tick(clt->batch_start_tick))
+    {
+        ipc_client_flush_batch_locked(clt);
+    }
+    cplus_crit_sect_exit(clt->batch_sect);
+}
+
+int32_t cplus_ipc_client_flush_oneway(cplus_ipc_client obj)
+{
+    CHECK_OBJECT_TYPE_EX(obj, OBJ_TYPE_CLIENT);
+
+    return ipc_client_flush_batch((struct ipc_client *)(obj));
+}
+
+int32_t cplus_ipc_client_send_oneway(
+    cplus_ipc_client obj
+    , uint32_t input_bufs_len
+    , void * input_bufs)
+{
+    struct ipc_client * clt = (struct ipc_client *)(obj);
+    struct ipc_conn_packet resquest_packet = {0};
+    uint32_t record_len = htonl(input_bufs_len);
+    int32_t res = CPLUS_SUCCESS;
+
+    CHECK_OBJECT_TYPE_EX(obj, OBJ_TYPE_CLIENT);
+
+    /* A message which does not fit a batch on its own goes out as a frame of its own. */
+    if (clt->batch_bufs AND clt->batch_size >= (IPC_BATCH_RECORD_HEAD_SIZE + input_bufs_len))
+    {
+        CHECK_IF(0 < input_bufs_len AND CPLUS_NULL == input_bufs, CPLUS_FAIL);
+
+        cplus_crit_sect_enter(clt->batch_sect);
+        if (clt->batch_size < (clt->batch_len + IPC_BATCH_RECORD_HEAD_SIZE + input_bufs_len))
+        {
+            res = ipc_client_flush_batch_locked(clt);
+        }
+        if (CPLUS_SUCCESS == res)
+        {
+            if (0 == clt->batch_len)
+            {
+                clt->batch_start_tick = cplus_systime_get_tick();
+            }
+            cplus_mem_cpy(&(clt->batch_bufs[clt->batch_len]), &record_len, IPC_BATCH_RECORD_HEAD_SIZE);
+            clt->batch_len += IPC_BATCH_RECORD_HEAD_SIZE;
+            if (0 < input_bufs_len)
+            {
+                cplus_mem_cpy(&(clt->batch_bufs[clt->batch_len]), input_bufs, input_bufs_len);
+                clt->batch_len += input_bufs_len;
+            }
+        }
+        cplus_crit_sect_exit(clt->batch_sect);
+        return (CPLUS_SUCCESS == res)? (int32_t)(input_bufs_len): CPLUS_FAIL;
+    }
+
+    resquest_packet.seqn = ACCUMULATE_SEQUENCE_NUMBER(clt->seqn);
+    resquest_packet.cmd = IPC_CMD_ONEWAY;
+    resquest_packet.data_len = input_bufs_len;
+    resquest_packet.data = input_bufs;
+
+    return ipc_client_send_packet(clt, &resquest_packet, CPLUS_NULL, 0);
+}
+
+int32_t cplus_ipc_client_send_request(
+    cplus_ipc_client obj
+    , uint32_t input_bufs_len
+    , void * input_bufs
+    , uint32_t output_bufs_len
+    , void * output_bufs
+    , uint32_t timeout)
+{
+    int32_t res = CPLUS_SUCCESS, count = 0;
+    struct ipc_client * clt = (struct ipc_client *)(obj);
+    struct ipc_conn_packet resquest_packet = {0};
+
+    CHECK_OBJECT_TYPE_EX(obj, OBJ_TYPE_CLIENT);
+
+    resquest_packet.seqn = ACCUMULATE_SEQUENCE_NUMBER(clt->seqn);
+    resquest_packet.cmd = IPC_CMD_REQUEST;
+    resquest_packet.data_len = input_bufs_len;
+    resquest_packet.data = input_bufs;
+
+    count = ipc_client_send_packet(clt, &resquest_packet, CPLUS_NULL, 0);
+    if (0 < count)
+    {
+        if (true == clt->is_async)
+        {
+            res = CPLUS_SUCCESS;
+        }
+        else if (CPLUS_SUCCESS != (res = ipc_client_wait_packet(clt, resquest_packet.seqn, timeout)))
+        {
+            res = CPLUS_FAIL;
+        }
+        else
+        {
+            CHECK_NOT_NULL(output_bufs, CPLUS_FAIL);
+            CHECK_GT_ZERO(output_bufs_len, CPLUS_FAIL);
+
+            cplus_mem_cpy_ex(
+                output_bufs
+                , output_bufs_len
+                , (clt->ipc_conn)->packet.data
+                , (clt->ipc_conn)->packet.data_len);
+
+            res = (int32_t)((clt->ipc_conn)->packet.data_len);
+        }
+    }
+    return res;
+}
+
+int32_t cplus_ipc_client_send_request_async(
+    cplus_ipc_client obj
+    , uint32_t input_bufs_len
+    , void * input_bufs
+    , CPLUS_IPC_CB_ON_COMPLETED on_completed
+    , void * arg
+    , uint32_t timeout
+    , uint32_t * request_id)
+{
+    struct ipc_client * clt = (struct ipc_client *)(obj);
+    struct ipc_conn_packet request_packet = {0};
+    struct ipc_request * slot = CPLUS_NULL, request = {0};
+    uint32_t id = 0, wire_id = 0;
+
+    CHECK_OBJECT_TYPE_EX(obj, OBJ_TYPE_CLIENT);
+    CHECK_NOT_NULL(on_completed, CPLUS_FAIL);
+    CHECK_IF(0 < input_bufs_len AND CPLUS_NULL == input_bufs, CPLUS_FAIL);
+    /* Responses are matched by the receive task, which only an asynchronous client has. */
+    CHECK_NOT_NULL(clt->requests, CPLUS_FAIL);
+
+    if (IPC_CONN_STATUS_NOT_CONNECTED == (clt->ipc_conn)->status)
+    {
+        errno = ENOTCONN;
+        return CPLUS_FAIL;
+    }
+
+    cplus_crit_sect_enter(clt->request_sect);
+    for (uint32_t i = 0; i < CPLUS_IPC_CLIENT_MAX_INFLIGHT_COUNT; i++)
+    {
+        /* Request ID 0 marks a free slot, it is skipped when the counter wraps. */
+        if (0 == (id = ++(clt->next_request_id)))
+        {
+            id = ++(clt->next_request_id);
+        }
+        if (0 == clt->requests[id % CPLUS_IPC_CLIENT_MAX_INFLIGHT_COUNT].request_id)
+        {
+            slot = &(clt->requests[id % CPLUS_IPC_CLIENT_MAX_INFLIGHT_COUNT]);
+            break;
+        }
+    }
+    if (slot)
+    {
+        slot->request_id = id;
+        slot->start_tick = cplus_systime_get_tick();
+        slot->timeout = timeout;
+        slot->on_completed = on_completed;
+        slot->arg = arg;
+        if (0 == (clt->inflight_count ++))
+        {
+            cplus_pevent_reset(clt->evt_requests_done);
+        }
+    }
+    cplus_crit_sect_exit(clt->request_sect);
+
+    if (CPLUS_NULL == slot)
+    {
+        errno = EBUSY;
+        return CPLUS_FAIL;
+    }
+
+    wire_id = htonl(id);
+    request_packet.seqn = (uint8_t)(id);
+    request_packet.cmd = IPC_CMD_ASYNC_REQUEST;
+    request_packet.data_len = input_bufs_len;
+    request_packet.data = input_bufs;
+
+    if (0 > ipc_client_send_packet(clt, &request_packet, &wire_id, sizeof(wire_id)))
+    {
+        /* Never went out, so give the slot back without a completion. */
+        if (ipc_client_take_request(clt, id % CPLUS_IPC_CLIENT_MAX_INFLIGHT_COUNT, id, false, &request))
+        {
+            cplus_crit_sect_enter(clt->request_sect);
+            if (0 == (-- clt->inflight_count))
+            {
+                cplus_pevent_set(clt->evt_requests_done);
+            }
+            cplus_crit_sect_exit(clt->request_sect);
+        }
+        return CPLUS_FAIL;
+    }
+
+    if (request_id)
+    {
+        (* request_id) = id;
+    }
+    return CPLUS_SUCCESS;
+}
+
+uint32_t cplus_ipc_client_get_inflight_count(cplus_ipc_client obj)
+{
+    struct ipc_client * clt = (struct ipc_client *)(obj);
+    CHECK_OBJECT_TYPE_EX(obj, OBJ_TYPE_CLIENT);
+
+    return clt->inflight_count;
+}
+
+int32_t cplus_ipc_client_wait_requests(cplus_ipc_client obj, uint32_t timeout)
+{
+    struct ipc_client * clt = (struct ipc_client *)(obj);
+    CHECK_OBJECT_TYPE_EX(obj, OBJ_TYPE_CLIENT);
+
+    if (CPLUS_NULL == clt->evt_requests_done)
+    {
+        return CPLUS_SUCCESS;
+    }
+    return cplus_pevent_wait(clt->evt_requests_done, timeout);
+}
+
+static int32_t ipc_client_wait_stream(struct ipc_client * clt, bool for_closed, uint32_t timeout)
+{
+    uint32_t start_tick = cplus_systime_get_tick(), elapsed_tick = 0, remain = timeout;
+
+    while (true)
+    {
+        /* Reset before looking, a credit landing in between sets it again. */
+        cplus_pevent_reset(clt->evt_stream);
+        if ((true == for_closed)
+            ? (0 != cplus_atomic_read(&(clt->is_stream_closed)))
+            : (0 != cplus_atomic_read(&(clt->stream_status)) OR 0 < cplus_atomic_read(&(clt->stream_credits))))
+        {
+            return CPLUS_SUCCESS;
+        }
+
+        if (IPC_CONN_STATUS_NOT_CONNECTED == (clt->ipc_conn)->status)
+        {
+            errno = ECONNRESET;
+            return CPLUS_FAIL;
+        }
+
+        if (CPLUS_INFINITE_TIMEOUT != timeout)
+        {
+            if (timeout <= (elapsed_tick = cplus_systime_elapsed_tick(start_tick)))
+            {
+                errno = ETIMEDOUT;
+                return CPLUS_FAIL;
+            }
+            remain = timeout - elapsed_tick;
+        }
+
+        if (true == clt->is_async)
+        {
+            cplus_pevent_wait(clt->evt_stream, remain);
+        }
+        else
+        {
+            /* Without a receive task, the caller reads the credits in itself. */
+            (clt->ipc_conn)->recv_timeout = remain;
+            ipc_conn_proc(clt->ipc_conn, CPLUS_NULL);
+            if (0 > (clt->ipc_conn)->recv_count AND ETIMEDOUT != (clt->ipc_conn)->sock_error)
+            {
+                errno = (clt->ipc_conn)->sock_error;
+                return CPLUS_FAIL;
+            }
+        }
+    }
+}
+
+static int32_t ipc_client_send_stream_packet(
+    struct ipc_client * clt
+    , uint8_t cmd
+    , uint32_t chunk_len
+    , void * chunk_bufs)
+{
+    struct ipc_conn_packet stream_packet = {0};
+    uint32_t wire_id = htonl(clt->stream_id);
+
+    stream_packet.seqn = ACCUMULATE_SEQUENCE_NUMBER(clt->seqn);
+    stream_packet.cmd = cmd;
+    stream_packet.data_len = chunk_len;
+    stream_packet.data = chunk_bufs;
+
+    return ipc_client_send_packet(clt, &stream_packet, &wire_id, sizeof(wire_id));
+}
+
+int32_t cplus_ipc_client_stream_begin(cplus_ipc_client obj, uint32_t timeout, uint32_t * stream_id)
+{
+    struct ipc_client * clt = (struct ipc_client *)(obj);
+    int32_t status = 0;
+
+    CHECK_OBJECT_TYPE_EX(obj, OBJ_TYPE_CLIENT);
+
+    if (0 != clt->stream_id)
+    {
+        errno = EBUSY;
+        return CPLUS_FAIL;
+    }
+
+    cplus_atomic_write(&(clt->stream_credits), 0U);
+    cplus_atomic_write(&(clt->stream_status), 0);
+    cplus_atomic_write(&(clt->is_stream_closed), 0U);
+    if (0 == ++(clt->next_stream_id))
+    {
+        ++(clt->next_stream_id);
+    }
+    cplus_atomic_write(&(clt->stream_id), clt->next_stream_id);
+
+    /* The receiver grants the first window, or turns the stream down. */
+    if (0 > ipc_client_send_stream_packet(clt, IPC_CMD_STREAM_BEGIN, 0, CPLUS_NULL)
+        OR CPLUS_SUCCESS != ipc_client_wait_stream(clt, false, timeout)
+        OR 0 != (status = cplus_atomic_read(&(clt->stream_status))))
+    {
+        errno = (0 != status)? status: errno;
+        cplus_atomic_write(&(clt->stream_id), 0U);
+        return CPLUS_FAIL;
+    }
+
+    if (stream_id)
+    {
+        (* stream_id) = clt->stream_id;
+    }
+    return CPLUS_SUCCESS;
+}
+
+int32_t cplus_ipc_client_stream_append(
+    cplus_ipc_client obj
+    , uint32_t chunk_len
+    , void * chunk_bufs
+    , uint32_t timeout)
+{
+    struct ipc_client * clt = (struct ipc_client *)(obj);
+    int32_t status = 0;
+
+    CHECK_OBJECT_TYPE_EX(obj, OBJ_TYPE_CLIENT);
+    CHECK_IF(0 < chunk_len AND CPLUS_NULL == chunk_bufs, CPLUS_FAIL);
+
+    if (0 == clt->stream_id)
+    {
+        errno = EBADF;
+        return CPLUS_FAIL;
+    }
+
+    /* Blocks only while the receiver is a whole window behind. */
+    if (CPLUS_SUCCESS != ipc_client_wait_stream(clt, false, timeout))
+    {
+        return CPLUS_FAIL;
+    }
+
+    if (0 != (status = cplus_atomic_read(&(clt->stream_status))))
+    {
+        errno = status;
+        return CPLUS_FAIL;
+    }
+
+    cplus_atomic_add(&(clt->stream_credits), -1);
+    return ipc_client_send_stream_packet(clt, IPC_CMD_STREAM_CHUNK, chunk_len, chunk_bufs);
+}
+
+int32_t cplus_ipc_client_stream_end(cplus_ipc_client obj, uint32_t timeout)
+{
+    struct ipc_client * clt = (struct ipc_client *)(obj);
+    int32_t res = CPLUS_FAIL, status = 0;
+
+    CHECK_OBJECT_TYPE_EX(obj, OBJ_TYPE_CLIENT);
+
+    if (0 == clt->stream_id)
+    {
+        errno = EBADF;
+        return CPLUS_FAIL;
+    }
+
+    if (0 <= ipc_client_send_stream_packet(clt, IPC_CMD_STREAM_END, 0, CPLUS_NULL)
+        AND CPLUS_SUCCESS == ipc_client_wait_stream(clt, true, timeout))
+    {
+        if (0 != (status = cplus_atomic_read(&(clt->stream_status))))
+        {
+            errno = status;
+        }
+        else
+        {
+            res = CPLUS_SUCCESS;
+        }
+    }
+
+    /* The stream is over either way, a late answer to it is dropped. */
+    cplus_atomic_write(&(clt->stream_id), 0U);
+    return res;
+}
+
+static int32_t ipc_server_publish_to(struct ipc_server * ipc_serv, struct ipc_conn * conn, uint8_t * frame, uint32_t frame_len)
+{
+    int32_t res = CPLUS_FAIL;
+    bool is_rearm = false;
+
+    /* Never wait on a subscriber, one caught in a blocking write counts as slow. */
+    if (CPLUS_SUCCESS != cplus_mutex_lock(conn->send_sect, TIMEOUT_FOR_PUBLISH_SEND_LOCK))
+    {
+        errno = ENOBUFS;
+    }
+    else
+    {
+        if (CPLUS_SUCCESS == (res = ipc_conn_put_published(conn, frame, frame_len, ipc_serv->publish_backlog)))
+        {
+            ipc_conn_count_sent(conn, frame_len - ((conn->is_seqpacket)
+                ? IPC_SEQPACKET_HEAD_SIZE
+                : (IPC_CONN_PACKET_HEAD_SIZE + IPC_CONN_PACKET_TAG_SIZE)));
+        }
+        if (CPLUS_SUCCESS == res AND conn->reactor AND conn->send_bufs_offset < conn->send_bufs_len)
+        {
+            if (CPLUS_NULL == ipc_serv->dispatch_pool)
+            {
+                (void)ipc_reactor_watch_conn(conn, EPOLL_CTL_MOD);
+            }
+            else
+            {
+                /* Re-arming a one-shot connection may only happen where it cannot be in a worker's hands. */
+                conn->is_rearm_pending = true;
+                is_rearm = true;
+            }
+        }
+        cplus_mutex_unlock(conn->send_sect);
+    }
+
+    if (true == is_rearm)
+    {
+        (conn->reactor)->is_rearm_pending = true;
+        ipc_reactor_kick(conn->reactor);
+    }
+
+    if (CPLUS_FAIL == res
+        AND (ENOBUFS != errno OR CPLUS_IPC_SLOW_SUBSCRIBER_POLICY_DISCONNECT == ipc_serv->slow_subscriber_policy))
+    {
+        /* Its own receive loop sees the hang-up and cleans up as for any other peer. */
+        (void)shutdown(cplus_socket_get_fd(conn->sock), SHUT_RDWR);
+    }
+    return res;
+}
+
+struct ipc_publish_ctx
+{
+    struct ipc_server * ipc_serv;
+    const char * topic;
+    uint8_t * frame;
+    uint32_t frame_len;
+    int32_t delivered;
+};
+
+static inline int32_t publish_to_subscriber(void * data, void * arg)
+{
+    struct ipc_conn * conn = (struct ipc_conn *)(data);
+    struct ipc_publish_ctx * ctx = (struct ipc_publish_ctx *)(arg);
+
+    /* Never matches, it only visits every connection once. */
+    if (IPC_CONN_STATUS_NOT_CONNECTED != conn->status
+        AND CPLUS_NULL != conn->sock
+        AND 0 <= ipc_conn_find_topic(conn, ctx->topic)
+        AND CPLUS_SUCCESS == ipc_server_publish_to(ctx->ipc_serv, conn, ctx->frame, ctx->frame_len))
+    {
+        ctx->delivered ++;
+    }
+    return 1;
+}
+
+int32_t cplus_ipc_server_publish(cplus_ipc_server obj, const char * topic, uint32_t data_len, void * data)
+{
+    struct ipc_server * ipc_serv = (struct ipc_server *)(obj);
+    struct ipc_publish_ctx ctx = {0};
+    struct ipc_conn_packet packet = {0};
+    struct iovec iov[3] = {0};
+    uint8_t head[IPC_CONN_PACKET_HEAD_SIZE] = {0}, * frame = CPLUS_NULL;
+    uint32_t topic_len = 0, frame_len = 0;
+
+    CHECK_OBJECT_TYPE_EX(obj, OBJ_TYPE_SERVER);
+    CHECK_NOT_NULL(topic, CPLUS_FAIL);
+    CHECK_IF(0 == (topic_len = strlen(topic)) OR CPLUS_IPC_MAX_TOPIC_SIZE <= topic_len, CPLUS_FAIL);
+    CHECK_IF(0 < data_len AND CPLUS_NULL == data, CPLUS_FAIL);
+
+    packet.seqn = 0;
+    packet.cmd = IPC_CMD_PUBLISH;
+    packet.data_len = sizeof(uint8_t) + topic_len + data_len;
+    packet.data = CPLUS_NULL;
+    if (IPC_MAX_FRAME_DATA_SIZE(ipc_serv->is_seqpacket) < packet.data_len)
+    {
+        errno = EMSGSIZE;
+        return CPLUS_FAIL;
+    }
+
+    /* Encoded once, every subscriber is written the very same bytes. Without a payload
+    attached, the iovecs describe just the head and the tail of the frame. */
+    frame_len = ipc_packet_build_iov(&packet, ipc_serv->is_seqpacket, head, iov) + packet.data_len;
+    if (CPLUS_NULL == (frame = (uint8_t *)cplus_malloc(frame_len)))
+    {
+        return CPLUS_FAIL;
+    }
+    cplus_mem_cpy(frame, head, iov[0].iov_len);
+    frame[iov[0].iov_len] = (uint8_t)topic_len;
+    cplus_mem_cpy(&(frame[iov[0].iov_len + sizeof(uint8_t)]), (void *)topic, topic_len);
+    if (0 < data_len)
+    {
+        cplus_mem_cpy(&(frame[iov[0].iov_len + sizeof(uint8_t) + topic_len]), data, data_len);
+    }
+    if (0 < iov[2].iov_len)
+    {
+        cplus_mem_cpy(&(frame[frame_len - iov[2].iov_len]), iov[2].iov_base, iov[2].iov_len);
+    }
+
+    ctx.ipc_serv = ipc_serv;
+    ctx.topic = topic;
+    ctx.frame = frame;
+    ctx.frame_len = frame_len;
+    cplus_crit_sect_enter(ipc_serv->ipc_conn_sect);
+    (void)cplus_llist_get_if(ipc_serv->ipc_conn_list, publish_to_subscriber, &ctx);
+    cplus_crit_sect_exit(ipc_serv->ipc_conn_sect);
+
+    cplus_free(frame);
+    return ctx.delivered;
+}
+
+static int32_t ipc_client_change_subscription(struct ipc_client * clt, uint8_t cmd, const char * topic, uint32_t timeout)
+{
+    struct ipc_conn_packet request_packet = {0};
+    int32_t status = 0;
+
+    CHECK_NOT_NULL(topic, CPLUS_FAIL);
+    CHECK_IF(0 == strlen(topic) OR CPLUS_IPC_MAX_TOPIC_SIZE <= strlen(topic), CPLUS_FAIL);
+    /* Published messages are read by the connection task of an asynchronous client alone. */
+    CHECK_NOT_NULL(clt->evt_subscribe, CPLUS_FAIL);
+    CHECK_NOT_NULL((clt->ipc_conn)->on_published, CPLUS_FAIL);
+
+    cplus_crit_sect_enter(clt->subscribe_sect);
+    request_packet.seqn = ACCUMULATE_SEQUENCE_NUMBER(clt->seqn);
+    request_packet.cmd = cmd;
+    request_packet.data_len = strlen(topic) + 1;
+    request_packet.data = (void *)topic;
+
+    clt->subscribe_status = ETIMEDOUT;
+    clt->subscribe_seqn = request_packet.seqn;
+    cplus_pevent_reset(clt->evt_subscribe);
+    if (0 > ipc_client_send_packet(clt, &request_packet, CPLUS_NULL, 0))
+    {
+        status = (0 != errno)? errno: EIO;
+    }
+    else
+    {
+        (void)cplus_pevent_wait(clt->evt_subscribe, timeout);
+        status = clt->subscribe_status;
+    }
+    cplus_crit_sect_exit(clt->subscribe_sect);
+
+    if (0 != status)
+    {
+        errno = status;
+        return CPLUS_FAIL;
+    }
+    return CPLUS_SUCCESS;
+}
+
+int32_t cplus_ipc_client_subscribe(cplus_ipc_client obj, const char * topic, uint32_t timeout)
+{
+    CHECK_OBJECT_TYPE_EX(obj, OBJ_TYPE_CLIENT);
+    return ipc_client_change_subscription((struct ipc_client *)(obj), IPC_CMD_SUBSCRIBE, topic, timeout);
+}
+
+int32_t cplus_ipc_client_unsubscribe(cplus_ipc_client obj, const char * topic, uint32_t timeout)
+{
+    CHECK_OBJECT_TYPE_EX(obj, OBJ_TYPE_CLIENT);
+    return ipc_client_change_subscription((struct ipc_client *)(obj), IPC_CMD_UNSUBSCRIBE, topic, timeout);
+}
+
+int32_t cplus_ipc_server_get_stats(cplus_ipc_server obj, CPLUS_IPC_SERVER_STATS stats)
+{
+    struct ipc_server * ipc_serv = (struct ipc_server *)(obj);
+    struct ipc_conn * conn = CPLUS_NULL;
+    struct ipc_conn_counters total = {0};
+
+    CHECK_OBJECT_TYPE_EX(obj, OBJ_TYPE_SERVER);
+    CHECK_NOT_NULL(stats, CPLUS_FAIL);
+
+    CPLUS_INITIALIZE_STRUCT_POINTER(stats);
+
+    cplus_crit_sect_enter(ipc_serv->ipc_conn_sect);
+    {
+        cplus_mem_cpy(&total, &(ipc_serv->retired), sizeof(struct ipc_conn_counters));
+        for (uint32_t i = 0; i < cplus_llist_get_size(ipc_serv->ipc_conn_list); i++)
+        {
+            conn = (struct ipc_conn *)cplus_llist_get_of(ipc_serv->ipc_conn_list, (int32_t)i);
+            /* A closed connection waiting to be reaped still counts towards the totals. */
+            ipc_conn_counters_merge(&total, &(conn->counters));
+            if (IPC_CONN_STATUS_NOT_CONNECTED == conn->status OR CPLUS_NULL == conn->sock)
+            {
+                continue;
+            }
+            stats->conn_count ++;
+            stats->slow_conn_count += (true == conn->is_slow)? 1: 0;
+            stats->queued_bytes += ipc_conn_get_queued_bytes(conn);
+        }
+        stats->accepted_count = ipc_serv->accepted_count;
+    }
+    cplus_crit_sect_exit(ipc_serv->ipc_conn_sect);
+
+    stats->slow_count = cplus_atomic_read(&(ipc_serv->slow_count));
+    stats->bytes_received = total.bytes_received;
+    stats->bytes_sent = total.bytes_sent;
+    stats->messages_received = total.messages_received;
+    stats->messages_sent = total.messages_sent;
+    cplus_mem_cpy(&(stats->request_time), &(total.request_time), sizeof(CPLUS_IPC_HISTOGRAM_T));
+
+    return CPLUS_SUCCESS;
+}
+
+int32_t cplus_ipc_server_get_conn_stats(cplus_ipc_server obj, uint32_t max_count, CPLUS_IPC_CONN_STATS stats)
+{
+    struct ipc_server * ipc_serv = (struct ipc_server *)(obj);
+    struct ipc_conn * conn = CPLUS_NULL;
+    int32_t count = 0;
+
+    CHECK_OBJECT_TYPE_EX(obj, OBJ_TYPE_SERVER);
+    CHECK_IF(0 < max_count AND CPLUS_NULL == stats, CPLUS_FAIL);
+
+    cplus_crit_sect_enter(ipc_serv->ipc_conn_sect);
+    for (uint32_t i = 0; i < cplus_llist_get_size(ipc_serv->ipc_conn_list) AND (uint32_t)count < max_count; i++)
+    {
+        conn = (struct ipc_conn *)cplus_llist_get_of(ipc_serv->ipc_conn_list, (int32_t)i);
+        if (IPC_CONN_STATUS_NOT_CONNECTED == conn->status OR CPLUS_NULL == conn->sock)
+        {
+            continue;
+        }
+        ipc_conn_get_stats(conn, &(stats[count]));
+        count ++;
+    }
+    cplus_crit_sect_exit(ipc_serv->ipc_conn_sect);
+
+    return count;
+}
+
+static int32_t ipc_server_start_reactors(struct ipc_server * ipc_serv)
+{
+    struct ipc_reactor * reactor = CPLUS_NULL;
+    struct epoll_event event = {0};
+    CPLUS_TASK_CONFIG_T task_config = {0};
+
+    if (CPLUS_NULL == (ipc_serv->reactors = (struct ipc_reactor *)cplus_malloc(
+        ipc_serv->reactor_count * sizeof(struct ipc_reactor))))
+    {
+        return CPLUS_FAIL;
+    }
+
+    for (uint32_t i = 0; i < ipc_serv->reactor_count; i++)
+    {
+        reactor = &(ipc_serv->reactors[i]);
+        reactor->ipc_serv = ipc_serv;
+        reactor->epoll_fd = -1;
+        reactor->wakeup_fd = -1;
+        reactor->reactor_task = CPLUS_NULL;
+    }
+
+    for (uint32_t i = 0; i < ipc_serv->reactor_count; i++)
+    {
+        reactor = &(ipc_serv->reactors[i]);
+
+        if (0 > (reactor->epoll_fd = epoll_create1(EPOLL_CLOEXEC)))
+        {
+            return CPLUS_FAIL;
+        }
+
+        if (0 > (reactor->wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)))
+        {
+            return CPLUS_FAIL;
+        }
+
+        event.events = EPOLLIN;
+        event.data.ptr = reactor;
+        if (0 != epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, reactor->wakeup_fd, &event))
+        {
+            return CPLUS_FAIL;
+        }
+    }
+
+    /* The first reactor also accepts, a full server simply stops watching the listening socket. */
+    if (CPLUS_SUCCESS != cplus_socket_setopt_nonblock(ipc_serv->accept_socket, true))
+    {
+        return CPLUS_FAIL;
+    }
+
+    event.events = EPOLLIN;
+    event.data.ptr = ipc_serv;
+    if (0 != epoll_ctl(
+        ipc_serv->reactors[0].epoll_fd
+        , EPOLL_CTL_ADD
+        , cplus_socket_get_fd(ipc_serv->accept_socket)
+        , &event))
+    {
+        return CPLUS_FAIL;
+    }
+
+    for (uint32_t i = 0; i < ipc_serv->reactor_count; i++)
+    {
+        task_config.proc = ipc_reactor_proc;
+        task_config.param1 = &(ipc_serv->reactors[i]);
+        task_config.param2 = CPLUS_NULL;
+        task_config.duration = 0;
+        task_config.suspend = false;
+        if (CPLUS_NULL == (ipc_serv->reactors[i].reactor_task = cplus_task_new_ex(&task_config)))
+        {
+            return CPLUS_FAIL;
+        }
+    }
+
+    return CPLUS_SUCCESS;
+}
+
+static void * ipc_server_new(CPLUS_IPC_SERVER_CONFIG config)
+{
+    struct ipc_server * ipc_serv = CPLUS_NULL;
+    const char * name = config->name;
+    CPLUS_IPC_CB_FUNCS cb_funcs = config->cb_funcs;
+
+    if ((ipc_serv = (struct ipc_server *)cplus_malloc(sizeof(struct ipc_server))))
+    {
+        CPLUS_INITIALIZE_STRUCT_POINTER(ipc_serv);
+
+        ipc_serv->type = OBJ_TYPE_SERVER;
+        ipc_serv->max_conn = config->max_connection;
+        ipc_serv->reactor_count = config->reactor_count;
+        ipc_serv->reactors = CPLUS_NULL;
+        ipc_serv->next_reactor = 0;
+        ipc_serv->dispatch_pool = config->dispatch_pool;
+        ipc_serv->dispatched_count = 0;
+        ipc_serv->handler_pool = config->handler_pool;
+        ipc_serv->max_inflight_per_conn = (0 < config->max_inflight_per_conn)
+            ? config->max_inflight_per_conn
+            : CPLUS_IPC_SERVER_DEFAULT_MAX_INFLIGHT_PER_CONN;
+        ipc_serv->publish_backlog = (0 < config->publish_backlog)
+            ? config->publish_backlog
+            : CPLUS_IPC_SERVER_DEFAULT_PUBLISH_BACKLOG;
+        ipc_serv->slow_subscriber_policy = config->slow_subscriber_policy;
+        ipc_serv->slow_queued_bytes = config->slow_queued_bytes;
+        ipc_serv->slow_request_msec = config->slow_request_msec;
+        ipc_serv->memfd_threshold = config->memfd_threshold;
+        ipc_serv->is_seqpacket = config->is_seqpacket;
+        ipc_serv->is_stopping = false;
+        ipc_serv->is_accept_paused = false;
+
+        ipc_serv->accept_socket = cplus_socket_new((ipc_serv->is_seqpacket)
+            ? CPLUS_SOCKET_TYPE_SEQPACKET_LOCAL
+            : CPLUS_SOCKET_TYPE_STREAM_LOCAL);
+        if (CPLUS_NULL == ipc_serv->accept_socket)
+        {
+            goto exit;
+        }
+
+        (void)cplus_socket_setopt_reuse_addr(ipc_serv->accept_socket, true);
+
+        if (CPLUS_SUCCESS != cplus_socket_bind(ipc_serv->accept_socket, name, 0))
+        {
+            goto exit;
+        }
+
+        ipc_serv->ipc_conn_list = cplus_llist_prev_new(ipc_serv->max_conn);
+        if (CPLUS_NULL == ipc_serv->ipc_conn_list)
+        {
+            goto exit;
+        }
+
+        ipc_serv->ipc_conn_pool = cplus_mempool_new(ipc_serv->max_conn, sizeof(struct ipc_conn));
+        if (CPLUS_NULL == ipc_serv->ipc_conn_pool)
+        {
+            goto exit;
+        }
+
+        /* Response buffers are only held while a packet is handled, one per
+        concurrent handler is enough. */
+        ipc_serv->response_pool = cplus_mempool_new(
+            ((0 < ipc_serv->reactor_count)
+                ? CPLUS_MIN(ipc_serv->max_conn, ipc_serv->reactor_count + ((ipc_serv->dispatch_pool)
+                    ? cplus_taskpool_get_worker_count(ipc_serv->dispatch_pool): 0))
+                : ipc_serv->max_conn)
+                + ((ipc_serv->handler_pool)? cplus_taskpool_get_worker_count(ipc_serv->handler_pool): 0)
+            , DEFAULT_RESPONSE_BUFS_SIZE);
+        if (CPLUS_NULL == ipc_serv->response_pool)
+        {
+            goto exit;
+        }
+
+        ipc_serv->ipc_conn_sect = cplus_mutex_new();
+        if (CPLUS_NULL == ipc_serv->ipc_conn_sect)
+        {
+            goto exit;
+        }
+
+        if (cb_funcs)
+        {
+            if (cb_funcs->on_connected)
+            {
+                ipc_serv->on_connected = cb_funcs->on_connected;
+            }
+            if (cb_funcs->on_error)
+            {
+                ipc_serv->on_error = cb_funcs->on_error;
+            }
+            if (cb_funcs->on_disconnected)
+            {
+                ipc_serv->on_disconnected = cb_funcs->on_disconnected;
+            }
+            if (cb_funcs->on_received)
+            {
+                ipc_serv->on_received = cb_funcs->on_received;
+            }
+            if (cb_funcs->on_stream_chunk)
+            {
+                ipc_serv->on_stream_chunk = cb_funcs->on_stream_chunk;
+            }
+            if (cb_funcs->on_slow_consumer)
+            {
+                ipc_serv->on_slow_consumer = cb_funcs->on_slow_consumer;
+            }
+        }
+
+        if (CPLUS_SUCCESS != cplus_socket_listen(ipc_serv->accept_socket, ipc_serv->max_conn))
+        {
+            goto exit;
+        }
+
+        if (0 < ipc_serv->reactor_count)
+        {
+            if (CPLUS_SUCCESS != ipc_server_start_reactors(ipc_serv))
+            {
+                goto exit;
+            }
+            return ipc_serv;
+        }
+
+        ipc_serv->accept_task = cplus_task_new(
+            ipc_server_proc
+            , ipc_serv
+            , CPLUS_NULL
+            , DURATION_FOR_IPC_SEVR_ACCEPT_TASK);
+        if (CPLUS_NULL == ipc_serv->accept_task)
+        {
+            goto exit;
+        }
+
+        cplus_task_start(ipc_serv->accept_task, 500);
+        cplus_task_wait_start(ipc_serv->accept_task, CPLUS_INFINITE_TIMEOUT);
+    }
+    return ipc_serv;
+exit:
+    ipc_server_delete(ipc_serv);
+    return CPLUS_NULL;
+}
+
+static void * ipc_client_new(CPLUS_IPC_CLIENT_CONFIG config)
+{
+    struct ipc_client * ipc_clt = CPLUS_NULL;
+    CPLUS_IPC_CB_FUNCS cb_funcs = config->cb_funcs;
+    cplus_sharedmem shm = CPLUS_NULL;
+
+    if ((ipc_clt = (struct ipc_client *)cplus_malloc(sizeof(struct ipc_client))))
+    {
+        CPLUS_INITIALIZE_STRUCT_POINTER(ipc_clt);
+
+        ipc_clt->type = OBJ_TYPE_CLIENT;
+        ipc_clt->is_async = false;
+        ipc_clt->ipc_conn = CPLUS_NULL;
+        ipc_clt->seqn = 0;
+        ipc_clt->is_seqpacket = config->is_seqpacket;
+
+        ipc_clt->server_socket = cplus_socket_new((ipc_clt->is_seqpacket)
+            ? CPLUS_SOCKET_TYPE_SEQPACKET_LOCAL
+            : CPLUS_SOCKET_TYPE_STREAM_LOCAL);
+        if (CPLUS_NULL == ipc_clt->server_socket)
+        {
+            goto error;
+        }
+
+        if (cb_funcs)
+        {
+            if (cb_funcs->on_connected)
+            {
+                ipc_clt->on_connected = cb_funcs->on_connected;
+            }
+            if (cb_funcs->on_received)
+            {
+                ipc_clt->is_async = true;
+            }
+        }
+
+        if (CPLUS_SUCCESS != cplus_socket_connect(ipc_clt->server_socket, config->name, 0))
+        {
+            goto error;
+        }
+
+        if (false == ipc_clt->is_async)
+        {
+            /* A synchronous client reads the handshake through its buffered connection too. */
+            if (CPLUS_NULL == (ipc_clt->ipc_conn = ipc_conn_create(
+                CPLUS_NULL
+                , ipc_clt->server_socket
+                , false
+                , CPLUS_NULL
+                , CPLUS_NULL
+                , CPLUS_NULL)))
+            {
+                goto error;
+            }
+            ipc_clt->ipc_conn->is_seqpacket = ipc_clt->is_seqpacket;
+            ipc_clt->ipc_conn->status = IPC_CONN_STATUS_CONNECTED;
+            ipc_clt->ipc_conn->ipc_clt = ipc_clt;
+        }
+
+        if (CPLUS_FAIL == cplus_ipc_client_send_heartbeat(ipc_clt, TIMEOUT_FOR_HEARTBEAT_PACKET))
+        {
+            goto error;
+        }
+
+        if (0 < config->shm_ring_size)
+        {
+            /* Without a ring the client still works, everything then goes over the socket. */
+            shm = ipc_client_setup_shm(ipc_clt, config->shm_ring_size, TIMEOUT_FOR_HEARTBEAT_PACKET);
+        }
+
+        if (CPLUS_NULL == ipc_clt->ipc_conn)
+        {
+            /* The in-flight table is ready before the receive task can look at it. */
+            if (CPLUS_NULL == (ipc_clt->send_sect = cplus_mutex_new())
+                OR CPLUS_NULL == (ipc_clt->request_sect = cplus_mutex_new())
+                OR CPLUS_NULL == (ipc_clt->evt_requests_done = cplus_pevent_new(true, true))
+                OR CPLUS_NULL == (ipc_clt->requests = (struct ipc_request *)cplus_malloc(
+                    CPLUS_IPC_CLIENT_MAX_INFLIGHT_COUNT * sizeof(struct ipc_request))))
+            {
+                goto error;
+            }
+            cplus_mem_set(ipc_clt->requests, 0x00, CPLUS_IPC_CLIENT_MAX_INFLIGHT_COUNT * sizeof(struct ipc_request));
+
+            /* The task of an asynchronous connection would race the handshake, start it afterwards. */
+            if (CPLUS_NULL == (ipc_clt->ipc_conn = ipc_conn_create(
+                CPLUS_NULL
+                , ipc_clt->server_socket
+                , true
+                , CPLUS_NULL
+                , CPLUS_NULL
+                , CPLUS_NULL)))
+            {
+                goto error;
+            }
+            ipc_clt->ipc_conn->is_seqpacket = ipc_clt->is_seqpacket;
+            ipc_clt->ipc_conn->status = IPC_CONN_STATUS_CONNECTED;
+            ipc_clt->ipc_conn->ipc_clt = ipc_clt;
+            ipc_clt->ipc_conn->on_published = (cb_funcs)? cb_funcs->on_published: CPLUS_NULL;
+
+            if (CPLUS_NULL == (ipc_clt->subscribe_sect = cplus_mutex_new())
+                OR CPLUS_NULL == (ipc_clt->evt_subscribe = cplus_pevent_new(true, false)))
+            {
+                goto error;
+            }
+        }
+
+        ipc_clt->ipc_conn->memfd_threshold = config->memfd_threshold;
+
+        if (CPLUS_NULL == (ipc_clt->evt_stream = cplus_pevent_new(true, false)))
+        {
+            goto error;
+        }
+
+        if (shm)
+        {
+            if (CPLUS_SUCCESS != ipc_conn_attach_shm(ipc_clt->ipc_conn, shm, false))
+            {
+                goto error;
+            }
+            shm = CPLUS_NULL;
+        }
+
+        if (0 < config->oneway_batch_size)
+        {
+            /* The linger task flushes from its own thread, so writes to the socket take turns. */
+            if ((CPLUS_NULL == ipc_clt->send_sect AND CPLUS_NULL == (ipc_clt->send_sect = cplus_mutex_new()))
+                OR CPLUS_NULL == (ipc_clt->batch_sect = cplus_mutex_new())
+                OR CPLUS_NULL == (ipc_clt->batch_bufs = (uint8_t *)cplus_malloc(config->oneway_batch_size)))
+            {
+                goto error;
+            }
+            ipc_clt->batch_size = config->oneway_batch_size;
+            ipc_clt->batch_len = 0;
+            ipc_clt->batch_linger = config->oneway_linger;
+
+            if (0 < ipc_clt->batch_linger)
+            {
+                if (CPLUS_NULL == (ipc_clt->batch_task = cplus_task_new(
+                    ipc_client_batch_proc
+                    , ipc_clt
+                    , CPLUS_NULL
+                    , CPLUS_MAX(1U, ipc_clt->batch_linger / 2))))
+                {
+                    goto error;
+                }
+                cplus_task_start(ipc_clt->batch_task, 0);
+            }
+        }
+
+        if (ipc_clt->on_connected)
+        {
+            ipc_clt->on_connected(ipc_clt->server_socket);
+        }
+    }
+    return ipc_clt;
+error:
+    if (shm)
+    {
+        cplus_sharedmem_delete(shm);
+    }
+    ipc_client_delete(ipc_clt);
+    return CPLUS_NULL;
+}
+
+cplus_ipc_server cplus_ipc_server_new(
+    const char * name
+    , uint32_t max_connection
+    , CPLUS_IPC_CB_FUNCS cb_funcs)
+{
+    CPLUS_IPC_SERVER_CONFIG_T config = {0};
+    CHECK_NOT_NULL(name, CPLUS_NULL);
+    CHECK_GT_ZERO(max_connection, CPLUS_NULL);
+    CHECK_NOT_NULL(cb_funcs, CPLUS_NULL);
+
+    config.name = name;
+    config.max_connection = max_connection;
+    config.cb_funcs = cb_funcs;
+    config.reactor_count = 0;
+    config.dispatch_pool = CPLUS_NULL;
+    config.memfd_threshold = 0;
+    config.handler_pool = CPLUS_NULL;
+    config.max_inflight_per_conn = 0;
+    config.publish_backlog = 0;
+    config.slow_subscriber_policy = CPLUS_IPC_SLOW_SUBSCRIBER_POLICY_DROP;
+    config.slow_queued_bytes = 0;
+    config.slow_request_msec = 0;
+
+    return ipc_server_new(&config);
+}
+
+cplus_ipc_server cplus_ipc_server_new_ex(CPLUS_IPC_SERVER_CONFIG config)
+{
+    CHECK_NOT_NULL(config, CPLUS_NULL);
+    CHECK_NOT_NULL(config->name, CPLUS_NULL);
+    CHECK_GT_ZERO(config->max_connection, CPLUS_NULL);
+    CHECK_NOT_NULL(config->cb_funcs, CPLUS_NULL);
+    CHECK_IF(CPLUS_IPC_SERVER_MAX_REACTOR_COUNT < config->reactor_count, CPLUS_NULL);
+    CHECK_IF(CPLUS_NULL != config->dispatch_pool AND 0 == config->reactor_count, CPLUS_NULL);
+    /* A worker re-arms its connection as it answers, which would race a one-shot dispatch. */
+    CHECK_IF(CPLUS_NULL != config->dispatch_pool AND CPLUS_NULL != config->handler_pool, CPLUS_NULL);
+
+    return ipc_server_new(config);
+}
+
+cplus_ipc_client cplus_ipc_client_new(
+    const char * name
+    , CPLUS_IPC_CB_FUNCS cb_funcs)
+{
+    CPLUS_IPC_CLIENT_CONFIG_T config = {0};
+    CHECK_NOT_NULL(name, CPLUS_NULL);
+
+    config.name = name;
+    config.cb_funcs = cb_funcs;
+    config.shm_ring_size = 0;
+    config.memfd_threshold = 0;
+    config.oneway_batch_size = 0;
+    config.oneway_linger = 0;
+
+    return ipc_client_new(&config);
+}
+
+cplus_ipc_client cplus_ipc_client_new_ex(CPLUS_IPC_CLIENT_CONFIG config)
+{
+    CHECK_NOT_NULL(config, CPLUS_NULL);
+    CHECK_NOT_NULL(config->name, CPLUS_NULL);
+    CHECK_IF(CPLUS_IPC_CLIENT_MAX_SHM_RING_SIZE < config->shm_ring_size, CPLUS_NULL);
+    CHECK_IF(CPLUS_IPC_CLIENT_MAX_ONEWAY_BATCH_SIZE < config->oneway_batch_size, CPLUS_NULL);
+
+    return ipc_client_new(config);
+}
+
+bool cplus_ipc_client_is_shm_attached(cplus_ipc_client obj)
+{
+    CHECK_OBJECT_TYPE_EX(obj, OBJ_TYPE_CLIENT);
+
+    return (((struct ipc_client *)(obj))->ipc_conn
+        AND CPLUS_NULL != (((struct ipc_client *)(obj))->ipc_conn)->shm);
+}
+
+bool cplus_ipc_server_check(cplus_object obj)
+{
+    return (GET_OBJECT_TYPE(obj) == OBJ_TYPE_SERVER);
+}
+
+bool cplus_ipc_client_check(cplus_object obj)
+{
+    return (GET_OBJECT_TYPE(obj) == OBJ_TYPE_CLIENT);
+}
+
+#ifdef __CPLUS_UNITTEST__
+#include "cplus_systime.h"
+
+#define SERVER_NAME "unittest_serv"
+#define MAX_CLIENT_COUNT 5
+static uint32_t client_count = 0;
+static uint32_t verification_count[5] = {0};
+
+static char test_string0[] = "Hello Word";
+static char test_string1[] = "AaBbCcDd";
+static char test_string2[] = "";
+static char test_string3[] = "1";
+static char test_string4[] = \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789";
+
+static char response_string0[] = "Dlrow olleh";
+static char response_string1[] = "dDcCbCaA";
+static char response_string2[] = "";
+static char response_string3[] = "2";
+static char response_string4[] = \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
+"012345678901234567890123456789012345678901234567890123456789" \
 "012345678901234567890123456789012345678901234567890123456789" \
 "012345678901234567890123456789012345678901234567890123456789" \
 "012345678901234567890123456789012345678901234567890123456789" \
@@ -1365,547 +5159,1724 @@ static char test_string4[] = \
 "012345678901234567890123456789012345678901234567890123456789" \
 "012345678901234567890123456789012345678901234567890123456789";
 
-static char response_string0[] = "Dlrow olleh";
-static char response_string1[] = "dDcCbCaA";
-static char response_string2[] = "";
-static char response_string3[] = "2";
-static char response_string4[] = \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789" \
-"012345678901234567890123456789012345678901234567890123456789";
+int32_t serv_on_disconnected(cplus_socket conn_sock)
+{
+    client_count -= 1;
+    return CPLUS_SUCCESS;
+}
+
+int32_t serv_on_connected(cplus_socket conn_sock)
+{
+    client_count += 1;
+    return CPLUS_SUCCESS;
+}
+
+int32_t serv_request_on_received(
+    cplus_socket conn_sock
+    , uint32_t input_bufs_len
+    , void * input_bufs
+    , uint32_t * output_bufs_len
+    , void * output_bufs)
+{
+    if (((strlen(test_string0) + 1) == input_bufs_len)
+        AND (0 == strcmp((const char *)(input_bufs), test_string0)))
+    {
+        cplus_mem_cpy_ex(
+            output_bufs
+            , (*output_bufs_len)
+            , response_string0
+            , strlen(response_string0) + 1);
+        if ((* output_bufs_len) >= (strlen(response_string0) + 1))
+        {
+            verification_count[0] += 1;
+        }
+        (*output_bufs_len) = strlen(response_string0) + 1;
+    }
+    else if (((strlen(test_string1) + 1) == input_bufs_len)
+        AND (0 == strcmp((const char *)(input_bufs), test_string1)))
+    {
+        cplus_mem_cpy_ex(
+            output_bufs
+            , (*output_bufs_len)
+            , response_string1
+            , strlen(response_string1) + 1);
+        if ((* output_bufs_len) >= (strlen(response_string1) + 1))
+        {
+            verification_count[1] += 1;
+        }
+        (*output_bufs_len) = strlen(response_string1) + 1;
+    }
+    else if (((strlen(test_string2) + 1) == input_bufs_len)
+        AND (0 == strcmp((const char *)(input_bufs), test_string2)))
+    {
+        cplus_mem_cpy_ex(
+            output_bufs
+            , (*output_bufs_len)
+            , response_string2
+            , strlen(response_string2) + 1);
+        if ((* output_bufs_len) >= (strlen(response_string2) + 1))
+        {
+            verification_count[2] += 1;
+        }
+        (*output_bufs_len) = strlen(response_string2) + 1;
+    }
+    else if (((strlen(test_string3) + 1) == input_bufs_len)
+        AND (0 == strcmp((const char *)(input_bufs), test_string3)))
+    {
+        cplus_mem_cpy_ex(
+            output_bufs
+            , (*output_bufs_len)
+            , response_string3
+            , strlen(response_string3) + 1);
+        if ((* output_bufs_len) >= (strlen(response_string3) + 1))
+        {
+            verification_count[3] += 1;
+        }
+        (*output_bufs_len) = strlen(response_string3) + 1;
+    }
+    else if (((strlen(test_string4) + 1) == input_bufs_len)
+        AND (0 == strcmp((const char *)(input_bufs), test_string4)))
+    {
+        cplus_mem_cpy_ex(
+            output_bufs
+            , (*output_bufs_len)
+            , response_string4
+            , strlen(response_string4) + 1);
+        if ((* output_bufs_len) >= (strlen(response_string4) + 1))
+        {
+            verification_count[4] += 1;
+        }
+        (* output_bufs_len) = strlen(response_string4) + 1;
+    }
+    return CPLUS_SUCCESS;
+}
+
+CPLUS_UNIT_TEST(CPLUS_IPC_CLIENT_SEND_REQUEST, functionity)
+{
+    client_count = 0;
+    for (uint32_t i = 0; i < sizeof(verification_count)/sizeof(uint32_t); i++)
+    {
+        verification_count[i] = 0;
+    }
+
+    cplus_ipc_server ipc_server = CPLUS_NULL;
+    cplus_ipc_client client[MAX_CLIENT_COUNT] = {0};
+
+    char recv_bufs[65536] = {0};
+    uint32_t recv_bufs_size = sizeof(recv_bufs);
+    int32_t recv_count = 0;
+
+    CPLUS_IPC_CB_FUNCS_T ipc_server_cb_funcs = {0};
+    ipc_server_cb_funcs.on_connected = serv_on_connected;
+    ipc_server_cb_funcs.on_received = serv_request_on_received;
+    ipc_server_cb_funcs.on_disconnected = serv_on_disconnected;
+
+    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (ipc_server = cplus_ipc_server_new(SERVER_NAME, MAX_CLIENT_COUNT, &ipc_server_cb_funcs))));
+    for (int32_t idx = 0; idx < MAX_CLIENT_COUNT; idx++)
+    {
+        UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (client[idx] = cplus_ipc_client_new(SERVER_NAME, CPLUS_NULL))));
+        UNITTEST_EXPECT_EQ(
+            true
+            , (0 < (recv_count = cplus_ipc_client_send_request(
+                client[idx]
+                , strlen(test_string0) + 1
+                , test_string0
+                , recv_bufs_size
+                , (void *)(recv_bufs)
+                , 10000))));
+        UNITTEST_EXPECT_EQ(strlen(response_string0) + 1, recv_count);
+        UNITTEST_EXPECT_EQ(0, strcmp(recv_bufs, response_string0));
+        UNITTEST_EXPECT_EQ(
+            true
+            , (0 < (recv_count = cplus_ipc_client_send_request(
+                client[idx]
+                , strlen(test_string1) + 1
+                , test_string1
+                , recv_bufs_size
+                , (void *)(recv_bufs)
+                , 10000))));
+        UNITTEST_EXPECT_EQ(strlen(response_string1) + 1, recv_count);
+        UNITTEST_EXPECT_EQ(0, strcmp(recv_bufs, response_string1));
+        UNITTEST_EXPECT_EQ(
+            true
+            , (0 < (recv_count = cplus_ipc_client_send_request(
+                client[idx]
+                , strlen(test_string2) + 1
+                , test_string2
+                , recv_bufs_size
+                , (void *)(recv_bufs)
+                , 10000))));
+        UNITTEST_EXPECT_EQ(strlen(response_string2) + 1, recv_count);
+        UNITTEST_EXPECT_EQ(0, strcmp(recv_bufs, response_string2));
+        UNITTEST_EXPECT_EQ(
+            true
+            , (0 < (recv_count = cplus_ipc_client_send_request(
+                client[idx]
+                , strlen(test_string3) + 1
+                , test_string3
+                , recv_bufs_size
+                , (void *)(recv_bufs)
+                , 10000))));
+        UNITTEST_EXPECT_EQ(strlen(response_string3) + 1, recv_count);
+        UNITTEST_EXPECT_EQ(0, strcmp(recv_bufs, response_string3));
+        UNITTEST_EXPECT_EQ(
+            true
+            , (0 < (recv_count = cplus_ipc_client_send_request(
+                client[idx]
+                , strlen(test_string4) + 1
+                , test_string4
+                , recv_bufs_size
+                , (void *)(recv_bufs)
+                , 10000*60))));
+        UNITTEST_EXPECT_EQ(strlen(response_string4) + 1, recv_count);
+        UNITTEST_EXPECT_EQ(0, strcmp(recv_bufs, response_string4));
+    }
+    cplus_systime_sleep_msec(5 * 1000);
+    UNITTEST_EXPECT_EQ(MAX_CLIENT_COUNT, client_count);
+    for (int32_t idx = 0; idx < MAX_CLIENT_COUNT; idx++)
+    {
+        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_delete(client[idx]));
+    }
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_server_delete(ipc_server));
+    UNITTEST_EXPECT_EQ(0, client_count);
+    UNITTEST_EXPECT_EQ(MAX_CLIENT_COUNT, verification_count[0]);
+    UNITTEST_EXPECT_EQ(MAX_CLIENT_COUNT, verification_count[1]);
+    UNITTEST_EXPECT_EQ(MAX_CLIENT_COUNT, verification_count[2]);
+    UNITTEST_EXPECT_EQ(MAX_CLIENT_COUNT, verification_count[3]);
+    UNITTEST_EXPECT_EQ(MAX_CLIENT_COUNT, verification_count[4]);
+    UNITTEST_EXPECT_EQ(0, cplus_mgr_report());
+}
+
+int32_t serv_oneway_on_received(
+    cplus_socket conn_sock
+    , uint32_t input_bufs_len
+    , void * input_bufs
+    , uint32_t * output_bufs_len
+    , void * output_bufs)
+{
+    if (((strlen(test_string0) + 1) == input_bufs_len)
+        AND (0 == strcmp((const char *)(input_bufs), test_string0)))
+    {
+        verification_count[0] += 1;
+    }
+    else if (((strlen(test_string1) + 1) == input_bufs_len)
+        AND (0 == strcmp((const char *)(input_bufs), test_string1)))
+    {
+        verification_count[1] += 1;
+    }
+    else if (((strlen(test_string2) + 1) == input_bufs_len)
+        AND (0 == strcmp((const char *)(input_bufs), test_string2)))
+    {
+        verification_count[2] += 1;
+    }
+    else if (((strlen(test_string3) + 1) == input_bufs_len)
+        AND (0 == strcmp((const char *)(input_bufs), test_string3)))
+    {
+        verification_count[3] += 1;
+    }
+    else if (((strlen(test_string4) + 1) == input_bufs_len)
+        AND (0 == strcmp((const char *)(input_bufs), test_string4)))
+    {
+        verification_count[4] += 1;
+    }
+    return CPLUS_SUCCESS;
+}
+
+CPLUS_UNIT_TEST(CPLUS_IPC_CLIENT_SEND_ONEWAY, functionity)
+{
+    client_count = 0;
+    for (uint32_t i = 0; i < sizeof(verification_count)/sizeof(uint32_t); i++)
+    {
+        verification_count[i] = 0;
+    }
+
+    cplus_ipc_server ipc_server = CPLUS_NULL;
+    cplus_ipc_client client[MAX_CLIENT_COUNT] = {0};
+
+    CPLUS_IPC_CB_FUNCS_T ipc_server_cb_funcs = {0};
+    ipc_server_cb_funcs.on_connected = serv_on_connected;
+    ipc_server_cb_funcs.on_received = serv_oneway_on_received;
+    ipc_server_cb_funcs.on_disconnected = serv_on_disconnected;
+
+    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (ipc_server = cplus_ipc_server_new(SERVER_NAME, MAX_CLIENT_COUNT, &ipc_server_cb_funcs))));
+    for (int32_t idx = 0; idx < MAX_CLIENT_COUNT; idx++)
+    {
+        UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (client[idx] = cplus_ipc_client_new(SERVER_NAME, CPLUS_NULL))));
+        UNITTEST_EXPECT_EQ(strlen(test_string0) + 1, cplus_ipc_client_send_oneway(client[idx], strlen(test_string0) + 1, test_string0));
+        UNITTEST_EXPECT_EQ(strlen(test_string1) + 1, cplus_ipc_client_send_oneway(client[idx], strlen(test_string1) + 1, test_string1));
+        UNITTEST_EXPECT_EQ(strlen(test_string2) + 1, cplus_ipc_client_send_oneway(client[idx], strlen(test_string2) + 1, test_string2));
+        UNITTEST_EXPECT_EQ(strlen(test_string3) + 1, cplus_ipc_client_send_oneway(client[idx], strlen(test_string3) + 1, test_string3));
+        UNITTEST_EXPECT_EQ(strlen(test_string4) + 1, cplus_ipc_client_send_oneway(client[idx], strlen(test_string4) + 1, test_string4));
+    }
+    cplus_systime_sleep_msec(5 * 1000);
+    UNITTEST_EXPECT_EQ(MAX_CLIENT_COUNT, client_count);
+    for (int32_t idx = 0; idx < MAX_CLIENT_COUNT; idx++)
+    {
+        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_delete(client[idx]));
+    }
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_server_delete(ipc_server));
+    UNITTEST_EXPECT_EQ(0, client_count);
+    UNITTEST_EXPECT_EQ(MAX_CLIENT_COUNT, verification_count[0]);
+    UNITTEST_EXPECT_EQ(MAX_CLIENT_COUNT, verification_count[1]);
+    UNITTEST_EXPECT_EQ(MAX_CLIENT_COUNT, verification_count[2]);
+    UNITTEST_EXPECT_EQ(MAX_CLIENT_COUNT, verification_count[3]);
+    UNITTEST_EXPECT_EQ(MAX_CLIENT_COUNT, verification_count[4]);
+    UNITTEST_EXPECT_EQ(0, cplus_mgr_report());
+}
+
+CPLUS_UNIT_TEST(CPLUS_IPC_CLIENT_CONNECT, bad_case_over_connection_count)
+{
+    cplus_ipc_server ipc_server = CPLUS_NULL;
+    cplus_ipc_client client[MAX_CLIENT_COUNT + 1] = {0};
+
+    CPLUS_IPC_CB_FUNCS_T ipc_server_cb_funcs = {0};
+    ipc_server_cb_funcs.on_connected = serv_on_connected;
+    ipc_server_cb_funcs.on_received = serv_oneway_on_received;
+    ipc_server_cb_funcs.on_disconnected = serv_on_disconnected;
+
+    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (ipc_server = cplus_ipc_server_new(SERVER_NAME, MAX_CLIENT_COUNT, &ipc_server_cb_funcs))));
+    for (int32_t i = 0; i < MAX_CLIENT_COUNT; i++)
+    {
+        UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (client[i] = cplus_ipc_client_new(SERVER_NAME, CPLUS_NULL))));
+    }
+    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL == (client[5] = cplus_ipc_client_new(SERVER_NAME, CPLUS_NULL))));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_delete(client[0]));
+    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (client[5] = cplus_ipc_client_new(SERVER_NAME, CPLUS_NULL))));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_send_heartbeat(client[5], 3000));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_send_heartbeat(client[5], 3000));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_delete(client[2]));
+    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (client[2] = cplus_ipc_client_new(SERVER_NAME, CPLUS_NULL))));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_send_heartbeat(client[2], 3000));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_delete(client[1]));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_delete(client[2]));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_delete(client[3]));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_delete(client[4]));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_delete(client[5]));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_server_delete(ipc_server));
+    UNITTEST_EXPECT_EQ(0, cplus_mgr_report());
+}
+
+CPLUS_UNIT_TEST(CPLUS_IPC_CLIENT_SEND_REQUEST, bad_case_timeout)
+{
+    cplus_ipc_server ipc_server = CPLUS_NULL;
+    cplus_ipc_client ipc_client = CPLUS_NULL;
+
+    char recv_bufs[512] = {0};
+    uint32_t recv_bufs_size = sizeof(recv_bufs);
+    int32_t recv_count = 0;
+
+    CPLUS_IPC_CB_FUNCS_T ipc_server_cb_funcs = {0};
+    ipc_server_cb_funcs.on_connected = serv_on_connected;
+    ipc_server_cb_funcs.on_received = serv_request_on_received;
+    ipc_server_cb_funcs.on_disconnected = serv_on_disconnected;
+
+    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (ipc_server = cplus_ipc_server_new(SERVER_NAME, MAX_CLIENT_COUNT, &ipc_server_cb_funcs))));
+    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (ipc_client = cplus_ipc_client_new(SERVER_NAME, CPLUS_NULL))));
+    UNITTEST_EXPECT_EQ(
+            true
+            , (0 < (recv_count = cplus_ipc_client_send_request(
+                ipc_client
+                , strlen(test_string0) + 1
+                , test_string0
+                , recv_bufs_size
+                , (void *)(recv_bufs)
+                , 1000))));
+    UNITTEST_EXPECT_EQ(strlen(response_string0) + 1, recv_count);
+    UNITTEST_EXPECT_EQ(0, strcmp(recv_bufs, response_string0));
+    UNITTEST_EXPECT_NE(
+            true
+            , (0 < (recv_count = cplus_ipc_client_send_request(
+                ipc_client
+                , strlen(test_string1) + 1
+                , test_string1
+                , recv_bufs_size
+                , (void *)(recv_bufs)
+                , 1))));
+    UNITTEST_EXPECT_EQ(ETIMEDOUT, errno);
+    UNITTEST_EXPECT_EQ(
+            true
+            , (0 < (recv_count = cplus_ipc_client_send_request(
+                ipc_client
+                , strlen(test_string2) + 1
+                , test_string2
+                , recv_bufs_size
+                , (void *)(recv_bufs)
+                , 1000))));
+    UNITTEST_EXPECT_EQ(strlen(response_string2) + 1, recv_count);
+    UNITTEST_EXPECT_EQ(0, strcmp(recv_bufs, response_string2));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_delete(ipc_client));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_server_delete(ipc_server));
+    UNITTEST_EXPECT_EQ(0, cplus_mgr_report());
+}
+
+CPLUS_UNIT_TEST(CPLUS_IPC_CLIENT_SEND_HEARTBEAT, bad_case_timeout)
+{
+    cplus_ipc_server ipc_server = CPLUS_NULL;
+    cplus_ipc_client ipc_client = CPLUS_NULL;
+
+    CPLUS_IPC_CB_FUNCS_T ipc_server_cb_funcs = {0};
+    ipc_server_cb_funcs.on_connected = serv_on_connected;
+    ipc_server_cb_funcs.on_received = serv_oneway_on_received;
+    ipc_server_cb_funcs.on_disconnected = serv_on_disconnected;
+
+    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (ipc_server = cplus_ipc_server_new(SERVER_NAME, MAX_CLIENT_COUNT, &ipc_server_cb_funcs))));
+    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (ipc_client = cplus_ipc_client_new(SERVER_NAME, CPLUS_NULL))));
+    UNITTEST_EXPECT_EQ(CPLUS_FAIL, cplus_ipc_client_send_heartbeat(ipc_client, 1));
+    UNITTEST_EXPECT_EQ(ETIMEDOUT, errno);
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_delete(ipc_client));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_server_delete(ipc_server));
+    UNITTEST_EXPECT_EQ(0, cplus_mgr_report());
+}
+
+static void request_on_reactor_server(CPLUS_IPC_SERVER_CONFIG config, bool * failed)
+{
+    cplus_ipc_server ipc_server = CPLUS_NULL;
+    cplus_ipc_client client[MAX_CLIENT_COUNT] = {0};
+    char * test_strings[] = {test_string0, test_string1, test_string2, test_string3, test_string4};
+    char * response_strings[] = {response_string0, response_string1, response_string2, response_string3, response_string4};
+    char recv_bufs[65536] = {0};
+    int32_t recv_count = 0;
+
+    client_count = 0;
+    for (uint32_t i = 0; i < sizeof(verification_count)/sizeof(uint32_t); i++)
+    {
+        verification_count[i] = 0;
+    }
+
+    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (ipc_server = cplus_ipc_server_new_ex(config))));
+    for (int32_t idx = 0; idx < MAX_CLIENT_COUNT; idx++)
+    {
+        UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (client[idx] = cplus_ipc_client_new(SERVER_NAME, CPLUS_NULL))));
+    }
+    /* Interleave the clients, so every reactor serves several connections at once. */
+    for (int32_t i = 0; i < 5; i++)
+    {
+        for (int32_t idx = 0; idx < MAX_CLIENT_COUNT; idx++)
+        {
+            UNITTEST_EXPECT_EQ(
+                true
+                , (0 < (recv_count = cplus_ipc_client_send_request(
+                    client[idx]
+                    , strlen(test_strings[i]) + 1
+                    , test_strings[i]
+                    , sizeof(recv_bufs)
+                    , (void *)(recv_bufs)
+                    , 10000))));
+            UNITTEST_EXPECT_EQ(strlen(response_strings[i]) + 1, recv_count);
+            UNITTEST_EXPECT_EQ(0, strcmp(recv_bufs, response_strings[i]));
+        }
+    }
+    UNITTEST_EXPECT_EQ(MAX_CLIENT_COUNT, client_count);
+    for (int32_t idx = 0; idx < MAX_CLIENT_COUNT; idx++)
+    {
+        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_delete(client[idx]));
+    }
+    for (int32_t i = 0; i < 100 AND 0 != client_count; i++)
+    {
+        cplus_systime_sleep_msec(10);
+    }
+    UNITTEST_EXPECT_EQ(0, client_count);
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_server_delete(ipc_server));
+    for (int32_t i = 0; i < 5; i++)
+    {
+        UNITTEST_EXPECT_EQ(MAX_CLIENT_COUNT, verification_count[i]);
+    }
+}
+
+CPLUS_UNIT_TEST(cplus_ipc_server_new_ex, reactor)
+{
+    CPLUS_IPC_CB_FUNCS_T ipc_server_cb_funcs = {0};
+    CPLUS_IPC_SERVER_CONFIG_T config = {0};
+
+    ipc_server_cb_funcs.on_connected = serv_on_connected;
+    ipc_server_cb_funcs.on_received = serv_request_on_received;
+    ipc_server_cb_funcs.on_disconnected = serv_on_disconnected;
+
+    config.name = SERVER_NAME;
+    config.max_connection = MAX_CLIENT_COUNT;
+    config.cb_funcs = &ipc_server_cb_funcs;
+    config.reactor_count = 2;
+    config.dispatch_pool = CPLUS_NULL;
+    request_on_reactor_server(&config, failed);
+    UNITTEST_EXPECT_EQ(0, cplus_mgr_report());
+}
+
+CPLUS_UNIT_TEST(cplus_ipc_server_new_ex, reactor_with_dispatch_pool)
+{
+    cplus_taskpool pool = CPLUS_NULL;
+    CPLUS_IPC_CB_FUNCS_T ipc_server_cb_funcs = {0};
+    CPLUS_IPC_SERVER_CONFIG_T config = {0};
+
+    ipc_server_cb_funcs.on_connected = serv_on_connected;
+    ipc_server_cb_funcs.on_received = serv_request_on_received;
+    ipc_server_cb_funcs.on_disconnected = serv_on_disconnected;
+
+    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (pool = cplus_taskpool_new(2))));
+    config.name = SERVER_NAME;
+    config.max_connection = MAX_CLIENT_COUNT;
+    config.cb_funcs = &ipc_server_cb_funcs;
+    config.reactor_count = 1;
+    config.dispatch_pool = pool;
+    request_on_reactor_server(&config, failed);
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskpool_delete(pool));
+    UNITTEST_EXPECT_EQ(0, cplus_mgr_report());
+}
+
+CPLUS_UNIT_TEST(cplus_ipc_server_new_ex, reactor_over_connection_count)
+{
+    cplus_ipc_server ipc_server = CPLUS_NULL;
+    cplus_ipc_client client[MAX_CLIENT_COUNT + 1] = {0};
+    CPLUS_IPC_CB_FUNCS_T ipc_server_cb_funcs = {0};
+    CPLUS_IPC_SERVER_CONFIG_T config = {0};
+
+    ipc_server_cb_funcs.on_connected = serv_on_connected;
+    ipc_server_cb_funcs.on_received = serv_oneway_on_received;
+    ipc_server_cb_funcs.on_disconnected = serv_on_disconnected;
+
+    config.name = SERVER_NAME;
+    config.max_connection = MAX_CLIENT_COUNT;
+    config.cb_funcs = &ipc_server_cb_funcs;
+    config.reactor_count = 2;
+    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (ipc_server = cplus_ipc_server_new_ex(&config))));
+    for (int32_t i = 0; i < MAX_CLIENT_COUNT; i++)
+    {
+        UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (client[i] = cplus_ipc_client_new(SERVER_NAME, CPLUS_NULL))));
+    }
+    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL == (client[5] = cplus_ipc_client_new(SERVER_NAME, CPLUS_NULL))));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_delete(client[0]));
+    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (client[5] = cplus_ipc_client_new(SERVER_NAME, CPLUS_NULL))));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_send_heartbeat(client[5], 3000));
+    for (int32_t i = 1; i <= MAX_CLIENT_COUNT; i++)
+    {
+        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_delete(client[i]));
+    }
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_server_delete(ipc_server));
+    UNITTEST_EXPECT_EQ(0, cplus_mgr_report());
+}
+
+static uint32_t async_completed_count = 0;
+static uint32_t async_matched_count = 0;
+static int32_t async_last_status = 0;
+
+int32_t serv_async_on_received(
+    cplus_socket conn_sock
+    , uint32_t input_bufs_len
+    , void * input_bufs
+    , uint32_t * output_bufs_len
+    , void * output_bufs)
+{
+    if ((strlen("fail") + 1) == input_bufs_len AND 0 == strcmp((const char *)(input_bufs), "fail"))
+    {
+        errno = EPERM;
+        return CPLUS_FAIL;
+    }
+    if ((strlen("slow") + 1) == input_bufs_len AND 0 == strcmp((const char *)(input_bufs), "slow"))
+    {
+        cplus_systime_sleep_msec(500);
+        (* output_bufs_len) = 0;
+        return CPLUS_SUCCESS;
+    }
+    return serv_request_on_received(conn_sock, input_bufs_len, input_bufs, output_bufs_len, output_bufs);
+}
+
+static void client_on_completed(
+    cplus_ipc_client clt
+    , uint32_t request_id
+    , int32_t status
+    , uint32_t output_bufs_len
+    , void * output_bufs
+    , void * arg)
+{
+    UNUSED_PARAM(clt);
+    UNUSED_PARAM(request_id);
+
+    if (CPLUS_SUCCESS == status
+        AND arg
+        AND (strlen((const char *)(arg)) + 1) == output_bufs_len
+        AND 0 == strcmp((const char *)(output_bufs), (const char *)(arg)))
+    {
+        async_matched_count += 1;
+    }
+    async_last_status = status;
+    async_completed_count += 1;
+}
+
+CPLUS_UNIT_TEST(cplus_ipc_client_send_request_async, functionity)
+{
+    cplus_ipc_server ipc_server = CPLUS_NULL;
+    cplus_ipc_client ipc_client = CPLUS_NULL;
+    char * test_strings[] = {test_string0, test_string1, test_string2, test_string3, test_string4};
+    char * response_strings[] = {response_string0, response_string1, response_string2, response_string3, response_string4};
+    uint32_t reactor_counts[] = {0, 2};
+    uint32_t request_id = 0, last_request_id = 0;
+    CPLUS_IPC_CB_FUNCS_T ipc_server_cb_funcs = {0}, ipc_client_cb_funcs = {0};
+    CPLUS_IPC_SERVER_CONFIG_T config = {0};
+
+    ipc_server_cb_funcs.on_connected = serv_on_connected;
+    ipc_server_cb_funcs.on_received = serv_async_on_received;
+    ipc_server_cb_funcs.on_disconnected = serv_on_disconnected;
+    ipc_client_cb_funcs.on_received = serv_oneway_on_received;
+
+    config.name = SERVER_NAME;
+    config.max_connection = MAX_CLIENT_COUNT;
+    config.cb_funcs = &ipc_server_cb_funcs;
+
+    for (uint32_t k = 0; k < sizeof(reactor_counts) / sizeof(uint32_t); k++)
+    {
+        async_completed_count = 0;
+        async_matched_count = 0;
+        last_request_id = 0;
+        config.reactor_count = reactor_counts[k];
+
+        UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (ipc_server = cplus_ipc_server_new_ex(&config))));
+        UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (ipc_client = cplus_ipc_client_new(SERVER_NAME, &ipc_client_cb_funcs))));
+        /* Keep many requests in flight on the one connection. */
+        for (uint32_t i = 0; i < 100; i++)
+        {
+            UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_send_request_async(
+                ipc_client
+                , strlen(test_strings[i % 5]) + 1
+                , test_strings[i % 5]
+                , client_on_completed
+                , response_strings[i % 5]
+                , 10000
+                , &request_id));
+            UNITTEST_EXPECT_EQ(true, (last_request_id < request_id));
+            last_request_id = request_id;
+        }
+        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_wait_requests(ipc_client, 10000));
+        UNITTEST_EXPECT_EQ(0, cplus_ipc_client_get_inflight_count(ipc_client));
+        UNITTEST_EXPECT_EQ(100, async_completed_count);
+        UNITTEST_EXPECT_EQ(100, async_matched_count);
+        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_delete(ipc_client));
+        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_server_delete(ipc_server));
+    }
+    UNITTEST_EXPECT_EQ(0, cplus_mgr_report());
+}
+
+CPLUS_UNIT_TEST(cplus_ipc_client_send_request_async, bad_case)
+{
+    cplus_ipc_server ipc_server = CPLUS_NULL;
+    cplus_ipc_client ipc_client = CPLUS_NULL, sync_client = CPLUS_NULL;
+    CPLUS_IPC_CB_FUNCS_T ipc_server_cb_funcs = {0}, ipc_client_cb_funcs = {0};
+    char fail_string[] = "fail", slow_string[] = "slow";
+
+    ipc_server_cb_funcs.on_connected = serv_on_connected;
+    ipc_server_cb_funcs.on_received = serv_async_on_received;
+    ipc_server_cb_funcs.on_disconnected = serv_on_disconnected;
+    ipc_client_cb_funcs.on_received = serv_oneway_on_received;
+
+    async_completed_count = 0;
+    async_matched_count = 0;
+    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (ipc_server = cplus_ipc_server_new(SERVER_NAME, MAX_CLIENT_COUNT, &ipc_server_cb_funcs))));
+    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (sync_client = cplus_ipc_client_new(SERVER_NAME, CPLUS_NULL))));
+    UNITTEST_EXPECT_EQ(CPLUS_FAIL, cplus_ipc_client_send_request_async(
+        sync_client, strlen(test_string0) + 1, test_string0, client_on_completed, CPLUS_NULL, 1000, CPLUS_NULL));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_delete(sync_client));
+
+    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (ipc_client = cplus_ipc_client_new(SERVER_NAME, &ipc_client_cb_funcs))));
+    UNITTEST_EXPECT_EQ(CPLUS_FAIL, cplus_ipc_client_send_request_async(
+        ipc_client, strlen(test_string0) + 1, test_string0, CPLUS_NULL, CPLUS_NULL, 1000, CPLUS_NULL));
+    /* A failing handler is reported with its errno. */
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_send_request_async(
+        ipc_client, strlen(fail_string) + 1, fail_string, client_on_completed, CPLUS_NULL, 1000, CPLUS_NULL));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_wait_requests(ipc_client, 3000));
+    UNITTEST_EXPECT_EQ(1, async_completed_count);
+    UNITTEST_EXPECT_EQ(EPERM, async_last_status);
+    /* An answer later than the timeout completes the request with ETIMEDOUT and is dropped. */
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_send_request_async(
+        ipc_client, strlen(slow_string) + 1, slow_string, client_on_completed, CPLUS_NULL, 100, CPLUS_NULL));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_wait_requests(ipc_client, 3000));
+    UNITTEST_EXPECT_EQ(2, async_completed_count);
+    UNITTEST_EXPECT_EQ(ETIMEDOUT, async_last_status);
+    /* Still usable once the late answer shows up. */
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_send_request_async(
+        ipc_client, strlen(test_string1) + 1, test_string1, client_on_completed, response_string1, 3000, CPLUS_NULL));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_wait_requests(ipc_client, 3000));
+    UNITTEST_EXPECT_EQ(3, async_completed_count);
+    UNITTEST_EXPECT_EQ(1, async_matched_count);
+    /* Whatever is left in flight is cancelled with the client. */
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_send_request_async(
+        ipc_client, strlen(slow_string) + 1, slow_string, client_on_completed, CPLUS_NULL, 10000, CPLUS_NULL));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_delete(ipc_client));
+    UNITTEST_EXPECT_EQ(4, async_completed_count);
+    UNITTEST_EXPECT_NE(CPLUS_SUCCESS, async_last_status);
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_server_delete(ipc_server));
+    UNITTEST_EXPECT_EQ(0, cplus_mgr_report());
+}
+
+int32_t serv_echo_on_received(
+    cplus_socket conn_sock
+    , uint32_t input_bufs_len
+    , void * input_bufs
+    , uint32_t * output_bufs_len
+    , void * output_bufs)
+{
+    UNUSED_PARAM(conn_sock);
+
+    if ((* output_bufs_len) >= input_bufs_len AND 0 < input_bufs_len)
+    {
+        cplus_mem_cpy(output_bufs, input_bufs, input_bufs_len);
+    }
+    (* output_bufs_len) = input_bufs_len;
+    return CPLUS_SUCCESS;
+}
+
+static void echo_on_client(
+    uint32_t reactor_count
+    , uint32_t ring_size
+    , uint32_t memfd_threshold
+    , uint32_t frame_size
+    , bool * failed)
+{
+    cplus_ipc_server ipc_server = CPLUS_NULL;
+    cplus_ipc_client ipc_client = CPLUS_NULL;
+    CPLUS_IPC_CB_FUNCS_T ipc_server_cb_funcs = {0};
+    CPLUS_IPC_SERVER_CONFIG_T server_config = {0};
+    CPLUS_IPC_CLIENT_CONFIG_T client_config = {0};
+    uint8_t * send_bufs = CPLUS_NULL, * recv_bufs = CPLUS_NULL;
+    char recv_string[64] = {0};
+
+    ipc_server_cb_funcs.on_connected = serv_on_connected;
+    ipc_server_cb_funcs.on_received = serv_echo_on_received;
+    ipc_server_cb_funcs.on_disconnected = serv_on_disconnected;
+
+    server_config.name = SERVER_NAME;
+    server_config.max_connection = MAX_CLIENT_COUNT;
+    server_config.cb_funcs = &ipc_server_cb_funcs;
+    server_config.reactor_count = reactor_count;
+    server_config.memfd_threshold = memfd_threshold;
+    client_config.name = SERVER_NAME;
+    client_config.shm_ring_size = ring_size;
+    client_config.memfd_threshold = memfd_threshold;
+
+    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (send_bufs = (uint8_t *)cplus_malloc(frame_size))));
+    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (recv_bufs = (uint8_t *)cplus_malloc(frame_size))));
+    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (ipc_server = cplus_ipc_server_new_ex(&server_config))));
+    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (ipc_client = cplus_ipc_client_new_ex(&client_config))));
+    UNITTEST_EXPECT_EQ((0 < ring_size), cplus_ipc_client_is_shm_attached(ipc_client));
+    for (uint32_t i = 0; i < 5; i++)
+    {
+        for (uint32_t k = 0; k < frame_size; k++)
+        {
+            send_bufs[k] = (uint8_t)(i + k);
+        }
+        cplus_mem_set(recv_bufs, 0x00, frame_size);
+        UNITTEST_EXPECT_EQ(frame_size, cplus_ipc_client_send_request(
+            ipc_client, frame_size, send_bufs, frame_size, recv_bufs, 10000));
+        UNITTEST_EXPECT_EQ(0, memcmp(send_bufs, recv_bufs, frame_size));
+        /* Small frames keep going over the socket in between. */
+        UNITTEST_EXPECT_EQ(strlen(test_string0) + 1, cplus_ipc_client_send_request(
+            ipc_client, strlen(test_string0) + 1, test_string0, sizeof(recv_string), recv_string, 10000));
+        UNITTEST_EXPECT_EQ(0, strcmp(recv_string, test_string0));
+    }
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_delete(ipc_client));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_server_delete(ipc_server));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_free(send_bufs));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_free(recv_bufs));
+}
+
+CPLUS_UNIT_TEST(cplus_ipc_client_new_ex, shm_ring)
+{
+    /* Larger than any socket frame, so only the ring can carry it. */
+    echo_on_client(0, 4 * 1024 * 1024, 0, 1536 * 1024, failed);
+    echo_on_client(2, 4 * 1024 * 1024, 0, 1536 * 1024, failed);
+    UNITTEST_EXPECT_EQ(0, cplus_mgr_report());
+}
 
-int32_t serv_on_disconnected(cplus_socket conn_sock)
+CPLUS_UNIT_TEST(cplus_ipc_client_new_ex, shm_ring_fallback)
 {
-    client_count -= 1;
-    return CPLUS_SUCCESS;
+    /* The ring is too small for the frames, the socket carries them instead. */
+    echo_on_client(0, 64 * 1024, 0, 100 * 1024, failed);
+    echo_on_client(2, 64 * 1024, 0, 100 * 1024, failed);
+    UNITTEST_EXPECT_EQ(0, cplus_mgr_report());
 }
 
-int32_t serv_on_connected(cplus_socket conn_sock)
+CPLUS_UNIT_TEST(cplus_ipc_client_new_ex, shm_ring_async)
 {
-    client_count += 1;
-    return CPLUS_SUCCESS;
+    cplus_ipc_server ipc_server = CPLUS_NULL;
+    cplus_ipc_client ipc_client = CPLUS_NULL;
+    CPLUS_IPC_CB_FUNCS_T ipc_server_cb_funcs = {0}, ipc_client_cb_funcs = {0};
+    CPLUS_IPC_CLIENT_CONFIG_T client_config = {0};
+    char * frames[8] = {0};
+
+    ipc_server_cb_funcs.on_connected = serv_on_connected;
+    ipc_server_cb_funcs.on_received = serv_echo_on_received;
+    ipc_server_cb_funcs.on_disconnected = serv_on_disconnected;
+    ipc_client_cb_funcs.on_received = serv_oneway_on_received;
+    client_config.name = SERVER_NAME;
+    client_config.cb_funcs = &ipc_client_cb_funcs;
+    client_config.shm_ring_size = 1024 * 1024;
+
+    async_completed_count = 0;
+    async_matched_count = 0;
+    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (ipc_server = cplus_ipc_server_new(SERVER_NAME, MAX_CLIENT_COUNT, &ipc_server_cb_funcs))));
+    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (ipc_client = cplus_ipc_client_new_ex(&client_config))));
+    UNITTEST_EXPECT_EQ(true, cplus_ipc_client_is_shm_attached(ipc_client));
+    /* More in flight than the ring holds, the rest spills over to the socket. */
+    for (uint32_t i = 0; i < 8; i++)
+    {
+        UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (frames[i] = (char *)cplus_malloc(256 * 1024))));
+        cplus_mem_set(frames[i], 'a' + i, 256 * 1024);
+        frames[i][256 * 1024 - 1] = 0;
+        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_send_request_async(
+            ipc_client, 256 * 1024, frames[i], client_on_completed, frames[i], 10000, CPLUS_NULL));
+    }
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_wait_requests(ipc_client, 10000));
+    UNITTEST_EXPECT_EQ(8, async_completed_count);
+    UNITTEST_EXPECT_EQ(8, async_matched_count);
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_delete(ipc_client));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_server_delete(ipc_server));
+    for (uint32_t i = 0; i < 8; i++)
+    {
+        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_free(frames[i]));
+    }
+    UNITTEST_EXPECT_EQ(0, cplus_mgr_report());
 }
 
-int32_t serv_request_on_received(
+CPLUS_UNIT_TEST(cplus_ipc_client_new_ex, memfd)
+{
+    /* Several times what a socket frame takes, each one is handed over as a sealed memfd. */
+    echo_on_client(0, 0, 64 * 1024, 4 * 1024 * 1024, failed);
+    echo_on_client(2, 0, 64 * 1024, 4 * 1024 * 1024, failed);
+    /* Beyond the ring, the memfd takes over. */
+    echo_on_client(2, 1024 * 1024, 64 * 1024, 3 * 1024 * 1024, failed);
+    UNITTEST_EXPECT_EQ(0, cplus_mgr_report());
+}
+
+CPLUS_UNIT_TEST(cplus_ipc_client_new_ex, memfd_async)
+{
+    cplus_ipc_server ipc_server = CPLUS_NULL;
+    cplus_ipc_client ipc_client = CPLUS_NULL;
+    CPLUS_IPC_CB_FUNCS_T ipc_server_cb_funcs = {0}, ipc_client_cb_funcs = {0};
+    CPLUS_IPC_SERVER_CONFIG_T server_config = {0};
+    CPLUS_IPC_CLIENT_CONFIG_T client_config = {0};
+    char * frames[4] = {0};
+
+    ipc_server_cb_funcs.on_connected = serv_on_connected;
+    ipc_server_cb_funcs.on_received = serv_echo_on_received;
+    ipc_server_cb_funcs.on_disconnected = serv_on_disconnected;
+    ipc_client_cb_funcs.on_received = serv_oneway_on_received;
+    server_config.name = SERVER_NAME;
+    server_config.max_connection = MAX_CLIENT_COUNT;
+    server_config.cb_funcs = &ipc_server_cb_funcs;
+    server_config.reactor_count = 1;
+    server_config.memfd_threshold = 64 * 1024;
+    client_config.name = SERVER_NAME;
+    client_config.cb_funcs = &ipc_client_cb_funcs;
+    client_config.memfd_threshold = 64 * 1024;
+
+    async_completed_count = 0;
+    async_matched_count = 0;
+    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (ipc_server = cplus_ipc_server_new_ex(&server_config))));
+    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (ipc_client = cplus_ipc_client_new_ex(&client_config))));
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (frames[i] = (char *)cplus_malloc(2 * 1024 * 1024))));
+        cplus_mem_set(frames[i], 'a' + i, 2 * 1024 * 1024);
+        frames[i][2 * 1024 * 1024 - 1] = 0;
+        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_send_request_async(
+            ipc_client, 2 * 1024 * 1024, frames[i], client_on_completed, frames[i], 10000, CPLUS_NULL));
+    }
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_wait_requests(ipc_client, 10000));
+    UNITTEST_EXPECT_EQ(4, async_completed_count);
+    UNITTEST_EXPECT_EQ(4, async_matched_count);
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_delete(ipc_client));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_server_delete(ipc_server));
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_free(frames[i]));
+    }
+    UNITTEST_EXPECT_EQ(0, cplus_mgr_report());
+}
+
+#define STREAM_CHUNK_SIZE (8U * 1024U)
+#define STREAM_CHUNK_COUNT 256U
+static uint64_t stream_received_len = 0;
+static uint32_t stream_mismatched_count = 0;
+static uint32_t stream_end_count = 0;
+static uint64_t stream_fail_offset = 0;
+static uint32_t stream_delay_msec = 0;
+
+int32_t serv_stream_on_chunk(
     cplus_socket conn_sock
-    , uint32_t input_bufs_len
-    , void * input_bufs
-    , uint32_t * output_bufs_len
-    , void * output_bufs)
+    , uint32_t stream_id
+    , uint64_t offset
+    , uint32_t chunk_len
+    , void * chunk_bufs
+    , bool is_end)
 {
-    if (((strlen(test_string0) + 1) == input_bufs_len)
-        AND (0 == strcmp((const char *)(input_bufs), test_string0)))
+    UNUSED_PARAM(conn_sock);
+    UNUSED_PARAM(stream_id);
+
+    if (true == is_end)
     {
-        cplus_mem_cpy_ex(
-            output_bufs
-            , (*output_bufs_len)
-            , response_string0
-            , strlen(response_string0) + 1);
-        if ((* output_bufs_len) >= (strlen(response_string0) + 1))
-        {
-            verification_count[0] += 1;
-        }
-        (*output_bufs_len) = strlen(response_string0) + 1;
+        stream_end_count ++;
+        return CPLUS_SUCCESS;
     }
-    else if (((strlen(test_string1) + 1) == input_bufs_len)
-        AND (0 == strcmp((const char *)(input_bufs), test_string1)))
+
+    if (0 < stream_fail_offset AND stream_fail_offset <= offset)
     {
-        cplus_mem_cpy_ex(
-            output_bufs
-            , (*output_bufs_len)
-            , response_string1
-            , strlen(response_string1) + 1);
-        if ((* output_bufs_len) >= (strlen(response_string1) + 1))
+        errno = ENOSPC;
+        return CPLUS_FAIL;
+    }
+
+    for (uint32_t i = 0; i < chunk_len; i++)
+    {
+        if (((uint8_t *)(chunk_bufs))[i] != (uint8_t)(offset + i))
         {
-            verification_count[1] += 1;
+            stream_mismatched_count ++;
+            break;
         }
-        (*output_bufs_len) = strlen(response_string1) + 1;
     }
-    else if (((strlen(test_string2) + 1) == input_bufs_len)
-        AND (0 == strcmp((const char *)(input_bufs), test_string2)))
+    stream_received_len += chunk_len;
+    if (0 < stream_delay_msec)
     {
-        cplus_mem_cpy_ex(
-            output_bufs
-            , (*output_bufs_len)
-            , response_string2
-            , strlen(response_string2) + 1);
-        if ((* output_bufs_len) >= (strlen(response_string2) + 1))
+        cplus_systime_sleep_msec(stream_delay_msec);
+    }
+    return CPLUS_SUCCESS;
+}
+
+static void stream_on_client(uint32_t reactor_count, bool is_async, bool * failed)
+{
+    cplus_ipc_server ipc_server = CPLUS_NULL;
+    cplus_ipc_client ipc_client = CPLUS_NULL;
+    CPLUS_IPC_CB_FUNCS_T ipc_server_cb_funcs = {0}, ipc_client_cb_funcs = {0};
+    CPLUS_IPC_SERVER_CONFIG_T server_config = {0};
+    uint8_t chunk[STREAM_CHUNK_SIZE] = {0};
+    uint32_t stream_id = 0;
+
+    ipc_server_cb_funcs.on_connected = serv_on_connected;
+    ipc_server_cb_funcs.on_received = serv_echo_on_received;
+    ipc_server_cb_funcs.on_disconnected = serv_on_disconnected;
+    ipc_server_cb_funcs.on_stream_chunk = serv_stream_on_chunk;
+    ipc_client_cb_funcs.on_received = serv_oneway_on_received;
+    server_config.name = SERVER_NAME;
+    server_config.max_connection = MAX_CLIENT_COUNT;
+    server_config.cb_funcs = &ipc_server_cb_funcs;
+    server_config.reactor_count = reactor_count;
+
+    stream_received_len = 0;
+    stream_mismatched_count = 0;
+    stream_end_count = 0;
+    stream_fail_offset = 0;
+    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (ipc_server = cplus_ipc_server_new_ex(&server_config))));
+    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (ipc_client = cplus_ipc_client_new(
+        SERVER_NAME, (is_async)? &ipc_client_cb_funcs: CPLUS_NULL))));
+    for (uint32_t round = 0; round < 2; round++)
+    {
+        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_stream_begin(ipc_client, 1000, &stream_id));
+        UNITTEST_EXPECT_NE(0, stream_id);
+        UNITTEST_EXPECT_EQ(CPLUS_FAIL, cplus_ipc_client_stream_begin(ipc_client, 1000, CPLUS_NULL));
+        UNITTEST_EXPECT_EQ(EBUSY, errno);
+        for (uint32_t i = 0; i < STREAM_CHUNK_COUNT; i++)
         {
-            verification_count[2] += 1;
+            for (uint32_t k = 0; k < STREAM_CHUNK_SIZE; k++)
+            {
+                chunk[k] = (uint8_t)(i * STREAM_CHUNK_SIZE + k);
+            }
+            UNITTEST_EXPECT_EQ(STREAM_CHUNK_SIZE, cplus_ipc_client_stream_append(ipc_client, STREAM_CHUNK_SIZE, chunk, 5000));
         }
-        (*output_bufs_len) = strlen(response_string2) + 1;
+        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_stream_end(ipc_client, 5000));
     }
-    else if (((strlen(test_string3) + 1) == input_bufs_len)
-        AND (0 == strcmp((const char *)(input_bufs), test_string3)))
+    UNITTEST_EXPECT_EQ(2ULL * STREAM_CHUNK_COUNT * STREAM_CHUNK_SIZE, stream_received_len);
+    UNITTEST_EXPECT_EQ(0, stream_mismatched_count);
+    UNITTEST_EXPECT_EQ(2, stream_end_count);
+    UNITTEST_EXPECT_EQ(CPLUS_FAIL, cplus_ipc_client_stream_end(ipc_client, 1000));
+    UNITTEST_EXPECT_EQ(EBADF, errno);
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_delete(ipc_client));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_server_delete(ipc_server));
+}
+
+CPLUS_UNIT_TEST(cplus_ipc_client_stream_append, functionity)
+{
+    stream_on_client(0, false, failed);
+    stream_on_client(0, true, failed);
+    stream_on_client(2, false, failed);
+    stream_on_client(2, true, failed);
+    UNITTEST_EXPECT_EQ(0, cplus_mgr_report());
+}
+
+CPLUS_UNIT_TEST(cplus_ipc_client_stream_append, bad_case)
+{
+    cplus_ipc_server ipc_server = CPLUS_NULL;
+    cplus_ipc_client ipc_client = CPLUS_NULL;
+    CPLUS_IPC_CB_FUNCS_T ipc_server_cb_funcs = {0};
+    uint8_t chunk[STREAM_CHUNK_SIZE] = {0};
+    uint32_t appended_count = 0;
+
+    ipc_server_cb_funcs.on_connected = serv_on_connected;
+    ipc_server_cb_funcs.on_received = serv_echo_on_received;
+    ipc_server_cb_funcs.on_disconnected = serv_on_disconnected;
+
+    /* Nobody takes streams on this server. */
+    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (ipc_server = cplus_ipc_server_new(SERVER_NAME, MAX_CLIENT_COUNT, &ipc_server_cb_funcs))));
+    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (ipc_client = cplus_ipc_client_new(SERVER_NAME, CPLUS_NULL))));
+    UNITTEST_EXPECT_EQ(CPLUS_FAIL, cplus_ipc_client_stream_append(ipc_client, sizeof(chunk), chunk, 1000));
+    UNITTEST_EXPECT_EQ(EBADF, errno);
+    UNITTEST_EXPECT_EQ(CPLUS_FAIL, cplus_ipc_client_stream_begin(ipc_client, 1000, CPLUS_NULL));
+    UNITTEST_EXPECT_EQ(ENOTSUP, errno);
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_delete(ipc_client));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_server_delete(ipc_server));
+
+    /* The receiver gives up half way, the sender hears about it. */
+    ipc_server_cb_funcs.on_stream_chunk = serv_stream_on_chunk;
+    stream_received_len = 0;
+    stream_end_count = 0;
+    stream_fail_offset = 64 * STREAM_CHUNK_SIZE;
+    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (ipc_server = cplus_ipc_server_new(SERVER_NAME, MAX_CLIENT_COUNT, &ipc_server_cb_funcs))));
+    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (ipc_client = cplus_ipc_client_new(SERVER_NAME, CPLUS_NULL))));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_stream_begin(ipc_client, 1000, CPLUS_NULL));
+    for (appended_count = 0; appended_count < STREAM_CHUNK_COUNT; appended_count++)
     {
-        cplus_mem_cpy_ex(
-            output_bufs
-            , (*output_bufs_len)
-            , response_string3
-            , strlen(response_string3) + 1);
-        if ((* output_bufs_len) >= (strlen(response_string3) + 1))
+        if (0 > cplus_ipc_client_stream_append(ipc_client, sizeof(chunk), chunk, 1000))
         {
-            verification_count[3] += 1;
+            break;
         }
-        (*output_bufs_len) = strlen(response_string3) + 1;
     }
-    else if (((strlen(test_string4) + 1) == input_bufs_len)
-        AND (0 == strcmp((const char *)(input_bufs), test_string4)))
+    UNITTEST_EXPECT_EQ(ENOSPC, errno);
+    UNITTEST_EXPECT_EQ(true, (64 <= appended_count AND (64 + CPLUS_IPC_STREAM_CREDIT_WINDOW) >= appended_count));
+    UNITTEST_EXPECT_EQ(CPLUS_FAIL, cplus_ipc_client_stream_end(ipc_client, 1000));
+    UNITTEST_EXPECT_EQ(ENOSPC, errno);
+    UNITTEST_EXPECT_EQ(0, stream_end_count);
+
+    /* A slow receiver holds the sender back once a window is out. */
+    stream_fail_offset = 0;
+    stream_delay_msec = 100;
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_stream_begin(ipc_client, 1000, CPLUS_NULL));
+    for (appended_count = 0; appended_count < STREAM_CHUNK_COUNT; appended_count++)
     {
-        cplus_mem_cpy_ex(
-            output_bufs
-            , (*output_bufs_len)
-            , response_string4
-            , strlen(response_string4) + 1);
-        if ((* output_bufs_len) >= (strlen(response_string4) + 1))
+        if (0 > cplus_ipc_client_stream_append(ipc_client, sizeof(chunk), chunk, 50))
         {
-            verification_count[4] += 1;
+            break;
         }
-        (* output_bufs_len) = strlen(response_string4) + 1;
     }
-    return CPLUS_SUCCESS;
+    UNITTEST_EXPECT_EQ(ETIMEDOUT, errno);
+    UNITTEST_EXPECT_EQ(CPLUS_IPC_STREAM_CREDIT_WINDOW, appended_count);
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_stream_end(ipc_client, 5000));
+    UNITTEST_EXPECT_EQ(1, stream_end_count);
+    stream_delay_msec = 0;
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_delete(ipc_client));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_server_delete(ipc_server));
+    UNITTEST_EXPECT_EQ(0, cplus_mgr_report());
 }
 
-CPLUS_UNIT_TEST(CPLUS_IPC_CLIENT_SEND_REQUEST, functionity)
+static bool wait_verification_count(uint32_t expected, uint32_t timeout)
 {
-    client_count = 0;
-    for (uint32_t i = 0; i < sizeof(verification_count)/sizeof(uint32_t); i++)
+    uint32_t start_tick = cplus_systime_get_tick();
+
+    while (expected != cplus_atomic_read(&(verification_count[0])))
     {
-        verification_count[i] = 0;
+        if (timeout <= cplus_systime_elapsed_tick(start_tick))
+        {
+            return false;
+        }
+        cplus_systime_sleep_msec(1);
     }
+    return true;
+}
 
+static void oneway_batch_on_client(uint32_t reactor_count, bool is_async, bool * failed)
+{
     cplus_ipc_server ipc_server = CPLUS_NULL;
-    cplus_ipc_client client[MAX_CLIENT_COUNT] = {0};
-
-    char recv_bufs[65536] = {0};
-    uint32_t recv_bufs_size = sizeof(recv_bufs);
-    int32_t recv_count = 0;
+    cplus_ipc_client ipc_client = CPLUS_NULL;
+    CPLUS_IPC_CB_FUNCS_T ipc_server_cb_funcs = {0}, ipc_client_cb_funcs = {0};
+    CPLUS_IPC_SERVER_CONFIG_T server_config = {0};
+    CPLUS_IPC_CLIENT_CONFIG_T client_config = {0};
+    char recv_string[64] = {0}, * large_string = CPLUS_NULL;
 
-    CPLUS_IPC_CB_FUNCS_T ipc_server_cb_funcs = {0};
     ipc_server_cb_funcs.on_connected = serv_on_connected;
-    ipc_server_cb_funcs.on_received = serv_request_on_received;
+    ipc_server_cb_funcs.on_received = serv_oneway_on_received;
     ipc_server_cb_funcs.on_disconnected = serv_on_disconnected;
+    ipc_client_cb_funcs.on_received = serv_oneway_on_received;
+    server_config.name = SERVER_NAME;
+    server_config.max_connection = MAX_CLIENT_COUNT;
+    server_config.cb_funcs = &ipc_server_cb_funcs;
+    server_config.reactor_count = reactor_count;
+    client_config.name = SERVER_NAME;
+    client_config.cb_funcs = (is_async)? &ipc_client_cb_funcs: CPLUS_NULL;
+    client_config.oneway_batch_size = 4096;
+    client_config.oneway_linger = 20;
+
+    cplus_mem_set(verification_count, 0x00, sizeof(verification_count));
+    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (large_string = (char *)cplus_malloc(8192))));
+    cplus_mem_set(large_string, 'x', 8191);
+    large_string[8191] = 0;
+    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (ipc_server = cplus_ipc_server_new_ex(&server_config))));
+    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (ipc_client = cplus_ipc_client_new_ex(&client_config))));
+
+    /* Full batches leave on their own, the rest on the explicit flush. */
+    for (uint32_t i = 0; i < 10000; i++)
+    {
+        UNITTEST_EXPECT_EQ(strlen(test_string0) + 1, cplus_ipc_client_send_oneway(
+            ipc_client, strlen(test_string0) + 1, test_string0));
+    }
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_flush_oneway(ipc_client));
+    UNITTEST_EXPECT_EQ(true, wait_verification_count(10000, 5000));
 
-    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (ipc_server = cplus_ipc_server_new(SERVER_NAME, MAX_CLIENT_COUNT, &ipc_server_cb_funcs))));
-    for (int32_t idx = 0; idx < MAX_CLIENT_COUNT; idx++)
+    /* Left alone, a batch leaves once it lingered long enough. */
+    for (uint32_t i = 0; i < 3; i++)
     {
-        UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (client[idx] = cplus_ipc_client_new(SERVER_NAME, CPLUS_NULL))));
-        UNITTEST_EXPECT_EQ(
-            true
-            , (0 < (recv_count = cplus_ipc_client_send_request(
-                client[idx]
-                , strlen(test_string0) + 1
-                , test_string0
-                , recv_bufs_size
-                , (void *)(recv_bufs)
-                , 10000))));
-        UNITTEST_EXPECT_EQ(strlen(response_string0) + 1, recv_count);
-        UNITTEST_EXPECT_EQ(0, strcmp(recv_bufs, response_string0));
-        UNITTEST_EXPECT_EQ(
-            true
-            , (0 < (recv_count = cplus_ipc_client_send_request(
-                client[idx]
-                , strlen(test_string1) + 1
-                , test_string1
-                , recv_bufs_size
-                , (void *)(recv_bufs)
-                , 10000))));
-        UNITTEST_EXPECT_EQ(strlen(response_string1) + 1, recv_count);
-        UNITTEST_EXPECT_EQ(0, strcmp(recv_bufs, response_string1));
-        UNITTEST_EXPECT_EQ(
-            true
-            , (0 < (recv_count = cplus_ipc_client_send_request(
-                client[idx]
-                , strlen(test_string2) + 1
-                , test_string2
-                , recv_bufs_size
-                , (void *)(recv_bufs)
-                , 10000))));
-        UNITTEST_EXPECT_EQ(strlen(response_string2) + 1, recv_count);
-        UNITTEST_EXPECT_EQ(0, strcmp(recv_bufs, response_string2));
-        UNITTEST_EXPECT_EQ(
-            true
-            , (0 < (recv_count = cplus_ipc_client_send_request(
-                client[idx]
-                , strlen(test_string3) + 1
-                , test_string3
-                , recv_bufs_size
-                , (void *)(recv_bufs)
-                , 10000))));
-        UNITTEST_EXPECT_EQ(strlen(response_string3) + 1, recv_count);
-        UNITTEST_EXPECT_EQ(0, strcmp(recv_bufs, response_string3));
-        UNITTEST_EXPECT_EQ(
-            true
-            , (0 < (recv_count = cplus_ipc_client_send_request(
-                client[idx]
-                , strlen(test_string4) + 1
-                , test_string4
-                , recv_bufs_size
-                , (void *)(recv_bufs)
-                , 10000*60))));
-        UNITTEST_EXPECT_EQ(strlen(response_string4) + 1, recv_count);
-        UNITTEST_EXPECT_EQ(0, strcmp(recv_bufs, response_string4));
+        UNITTEST_EXPECT_EQ(strlen(test_string0) + 1, cplus_ipc_client_send_oneway(
+            ipc_client, strlen(test_string0) + 1, test_string0));
+    }
+    UNITTEST_EXPECT_EQ(true, wait_verification_count(10003, 1000));
+
+    /* Neither an oversized oneway nor a request overtakes the batch. */
+    UNITTEST_EXPECT_EQ(strlen(test_string0) + 1, cplus_ipc_client_send_oneway(
+        ipc_client, strlen(test_string0) + 1, test_string0));
+    UNITTEST_EXPECT_EQ(8192, cplus_ipc_client_send_oneway(ipc_client, 8192, large_string));
+    if (false == is_async)
+    {
+        UNITTEST_EXPECT_EQ(true, (0 < cplus_ipc_client_send_request(
+            ipc_client, strlen(test_string1) + 1, test_string1, sizeof(recv_string), recv_string, 1000)));
+        UNITTEST_EXPECT_EQ(10004, verification_count[0]);
+    }
+    UNITTEST_EXPECT_EQ(true, wait_verification_count(10004, 1000));
+
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_delete(ipc_client));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_server_delete(ipc_server));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_free(large_string));
+}
+
+CPLUS_UNIT_TEST(cplus_ipc_client_send_oneway, batch)
+{
+    oneway_batch_on_client(0, false, failed);
+    oneway_batch_on_client(0, true, failed);
+    oneway_batch_on_client(2, false, failed);
+    oneway_batch_on_client(2, true, failed);
+    UNITTEST_EXPECT_EQ(0, cplus_mgr_report());
+}
+
+static uint32_t job_running_count = 0;
+static uint32_t job_peak_count = 0;
+static uint32_t job_completed_count = 0;
+static uint32_t job_ordered_count = 0;
+
+int32_t serv_job_on_received(
+    cplus_socket conn_sock
+    , uint32_t input_bufs_len
+    , void * input_bufs
+    , uint32_t * output_bufs_len
+    , void * output_bufs)
+{
+    uint32_t index = 0, running = 0;
+    UNUSED_PARAM(conn_sock);
+
+    if (sizeof(uint32_t) != input_bufs_len)
+    {
+        errno = EINVAL;
+        return CPLUS_FAIL;
+    }
+    running = cplus_atomic_add(&job_running_count, 1);
+    if (running > job_peak_count)
+    {
+        job_peak_count = running;
+    }
+    cplus_mem_cpy(&index, input_bufs, sizeof(uint32_t));
+    /* Every fourth packet is the slow one, so the ones behind it finish first. */
+    cplus_systime_sleep_msec((0 == (index % 4))? 20: 2);
+    cplus_atomic_add(&job_running_count, -1);
+
+    cplus_mem_cpy(output_bufs, &index, sizeof(uint32_t));
+    (* output_bufs_len) = sizeof(uint32_t);
+    return CPLUS_SUCCESS;
+}
+
+static void job_on_completed(
+    cplus_ipc_client clt
+    , uint32_t request_id
+    , int32_t status
+    , uint32_t output_bufs_len
+    , void * output_bufs
+    , void * arg)
+{
+    uint32_t index = 0;
+    UNUSED_PARAM(clt);
+    UNUSED_PARAM(request_id);
+    UNUSED_PARAM(arg);
+
+    if (CPLUS_SUCCESS == status AND sizeof(uint32_t) == output_bufs_len)
+    {
+        cplus_mem_cpy(&index, output_bufs, sizeof(uint32_t));
+        if (index == job_completed_count)
+        {
+            job_ordered_count += 1;
+        }
     }
-    cplus_systime_sleep_msec(5 * 1000);
-    UNITTEST_EXPECT_EQ(MAX_CLIENT_COUNT, client_count);
-    for (int32_t idx = 0; idx < MAX_CLIENT_COUNT; idx++)
+    job_completed_count += 1;
+}
+
+CPLUS_UNIT_TEST(cplus_ipc_server_new_ex, handler_pool)
+{
+    cplus_ipc_server ipc_server = CPLUS_NULL;
+    cplus_ipc_client ipc_client = CPLUS_NULL;
+    cplus_taskpool pool = CPLUS_NULL, dispatch_pool = CPLUS_NULL;
+    uint32_t reactor_counts[] = {0, 2};
+    CPLUS_IPC_CB_FUNCS_T ipc_server_cb_funcs = {0}, ipc_client_cb_funcs = {0};
+    CPLUS_IPC_SERVER_CONFIG_T config = {0};
+
+    ipc_server_cb_funcs.on_connected = serv_on_connected;
+    ipc_server_cb_funcs.on_disconnected = serv_on_disconnected;
+    ipc_client_cb_funcs.on_received = serv_oneway_on_received;
+
+    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (pool = cplus_taskpool_new(6))));
+    config.name = SERVER_NAME;
+    config.max_connection = MAX_CLIENT_COUNT;
+    config.cb_funcs = &ipc_server_cb_funcs;
+    config.handler_pool = pool;
+    config.max_inflight_per_conn = 4;
+
+    for (uint32_t k = 0; k < sizeof(reactor_counts) / sizeof(uint32_t); k++)
     {
-        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_delete(client[idx]));
+        config.reactor_count = reactor_counts[k];
+        ipc_server_cb_funcs.on_received = serv_request_on_received;
+        request_on_reactor_server(&config, failed);
+
+        /* Pipeline the packets of one connection, they overlap on the pool but come back in order. */
+        job_running_count = 0;
+        job_peak_count = 0;
+        job_completed_count = 0;
+        job_ordered_count = 0;
+        ipc_server_cb_funcs.on_received = serv_job_on_received;
+        UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (ipc_server = cplus_ipc_server_new_ex(&config))));
+        UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (ipc_client = cplus_ipc_client_new(SERVER_NAME, &ipc_client_cb_funcs))));
+        for (uint32_t i = 0; i < 40; i++)
+        {
+            UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_send_request_async(
+                ipc_client, sizeof(uint32_t), &i, job_on_completed, CPLUS_NULL, 10000, CPLUS_NULL));
+        }
+        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_wait_requests(ipc_client, 10000));
+        UNITTEST_EXPECT_EQ(40, job_completed_count);
+        UNITTEST_EXPECT_EQ(40, job_ordered_count);
+        UNITTEST_EXPECT_EQ(true, (1 < job_peak_count));
+        UNITTEST_EXPECT_EQ(true, (config.max_inflight_per_conn >= job_peak_count));
+        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_delete(ipc_client));
+        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_server_delete(ipc_server));
     }
-    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_server_delete(ipc_server));
-    UNITTEST_EXPECT_EQ(0, client_count);
-    UNITTEST_EXPECT_EQ(MAX_CLIENT_COUNT, verification_count[0]);
-    UNITTEST_EXPECT_EQ(MAX_CLIENT_COUNT, verification_count[1]);
-    UNITTEST_EXPECT_EQ(MAX_CLIENT_COUNT, verification_count[2]);
-    UNITTEST_EXPECT_EQ(MAX_CLIENT_COUNT, verification_count[3]);
-    UNITTEST_EXPECT_EQ(MAX_CLIENT_COUNT, verification_count[4]);
+
+    /* A one-shot dispatch and the handler pool do not go together. */
+    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (dispatch_pool = cplus_taskpool_new(2))));
+    config.reactor_count = 1;
+    config.dispatch_pool = dispatch_pool;
+    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL == cplus_ipc_server_new_ex(&config)));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskpool_delete(dispatch_pool));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskpool_delete(pool));
     UNITTEST_EXPECT_EQ(0, cplus_mgr_report());
 }
 
-int32_t serv_oneway_on_received(
+static volatile bool job_is_held = false;
+
+int32_t serv_held_on_received(
     cplus_socket conn_sock
     , uint32_t input_bufs_len
     , void * input_bufs
     , uint32_t * output_bufs_len
     , void * output_bufs)
 {
-    if (((strlen(test_string0) + 1) == input_bufs_len)
-        AND (0 == strcmp((const char *)(input_bufs), test_string0)))
+    UNUSED_PARAM(conn_sock);
+    UNUSED_PARAM(input_bufs_len);
+    UNUSED_PARAM(input_bufs);
+    UNUSED_PARAM(output_bufs);
+
+    cplus_atomic_add(&job_running_count, 1);
+    while (true == job_is_held)
     {
-        verification_count[0] += 1;
+        cplus_systime_sleep_msec(1);
     }
-    else if (((strlen(test_string1) + 1) == input_bufs_len)
-        AND (0 == strcmp((const char *)(input_bufs), test_string1)))
+    cplus_atomic_add(&job_running_count, -1);
+    (* output_bufs_len) = 0;
+    return CPLUS_SUCCESS;
+}
+
+CPLUS_UNIT_TEST(cplus_ipc_server_new_ex, handler_pool_close)
+{
+    cplus_ipc_server ipc_server = CPLUS_NULL;
+    cplus_ipc_client client[3] = {0};
+    cplus_taskpool pool = CPLUS_NULL;
+    uint32_t index = 0;
+    CPLUS_IPC_CB_FUNCS_T ipc_server_cb_funcs = {0}, ipc_client_cb_funcs = {0};
+    CPLUS_IPC_SERVER_CONFIG_T config = {0};
+    CPLUS_IPC_SERVER_STATS_T serv_stats = {0};
+
+    ipc_server_cb_funcs.on_received = serv_held_on_received;
+    ipc_client_cb_funcs.on_received = serv_oneway_on_received;
+
+    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (pool = cplus_taskpool_new(2))));
+    config.name = SERVER_NAME;
+    config.max_connection = 2;
+    config.cb_funcs = &ipc_server_cb_funcs;
+    config.handler_pool = pool;
+    config.reactor_count = 1;
+    job_running_count = 0;
+    job_is_held = true;
+    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (ipc_server = cplus_ipc_server_new_ex(&config))));
+    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (client[0] = cplus_ipc_client_new(SERVER_NAME, &ipc_client_cb_funcs))));
+    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (client[1] = cplus_ipc_client_new(SERVER_NAME, CPLUS_NULL))));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_send_request_async(
+        client[0], sizeof(uint32_t), &index, job_on_completed, CPLUS_NULL, 10000, CPLUS_NULL));
+    for (int32_t i = 0; i < 100 AND 0 == cplus_atomic_read(&job_running_count); i++)
     {
-        verification_count[1] += 1;
+        cplus_systime_sleep_msec(10);
     }
-    else if (((strlen(test_string2) + 1) == input_bufs_len)
-        AND (0 == strcmp((const char *)(input_bufs), test_string2)))
+    UNITTEST_EXPECT_EQ(1, cplus_atomic_read(&job_running_count));
+
+    /* A peer leaving while its handler still runs does not hold up the reactor it shares. */
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_delete(client[0]));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_send_heartbeat(client[1], 3000));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_server_get_stats(ipc_server, &serv_stats));
+    for (int32_t i = 0; i < 100 AND 1 < serv_stats.conn_count; i++)
     {
-        verification_count[2] += 1;
+        cplus_systime_sleep_msec(10);
+        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_server_get_stats(ipc_server, &serv_stats));
     }
-    else if (((strlen(test_string3) + 1) == input_bufs_len)
-        AND (0 == strcmp((const char *)(input_bufs), test_string3)))
+    UNITTEST_EXPECT_EQ(1, serv_stats.conn_count);
+    UNITTEST_EXPECT_EQ(1, cplus_atomic_read(&job_running_count));
+
+    /* Its slot is given back once the handler is done. */
+    job_is_held = false;
+    for (int32_t i = 0; i < 100 AND 0 < cplus_atomic_read(&job_running_count); i++)
     {
-        verification_count[3] += 1;
+        cplus_systime_sleep_msec(10);
     }
-    else if (((strlen(test_string4) + 1) == input_bufs_len)
-        AND (0 == strcmp((const char *)(input_bufs), test_string4)))
+    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (client[2] = cplus_ipc_client_new(SERVER_NAME, CPLUS_NULL))));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_send_heartbeat(client[2], 3000));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_delete(client[1]));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_delete(client[2]));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_server_delete(ipc_server));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskpool_delete(pool));
+    UNITTEST_EXPECT_EQ(0, cplus_mgr_report());
+}
+
+static uint32_t pub_received[3] = {0};
+static uint32_t pub_ordered[3] = {0};
+static uint32_t pub_other_count = 0;
+static volatile bool pub_is_held = false;
+
+static void clt_count_published(uint32_t slot, const char * topic, uint32_t data_len, void * data)
+{
+    uint32_t index = 0;
+
+    if (0 != strcmp(topic, "state") OR sizeof(uint32_t) != data_len)
     {
-        verification_count[4] += 1;
+        cplus_atomic_add(&pub_other_count, 1);
+        return;
     }
-    return CPLUS_SUCCESS;
+    cplus_mem_cpy(&index, data, sizeof(uint32_t));
+    if (index == pub_received[slot])
+    {
+        pub_ordered[slot] += 1;
+    }
+    pub_received[slot] += 1;
 }
 
-CPLUS_UNIT_TEST(CPLUS_IPC_CLIENT_SEND_ONEWAY, functionity)
+static void clt_on_published_0(cplus_socket conn_sock, const char * topic, uint32_t data_len, void * data)
 {
-    client_count = 0;
-    for (uint32_t i = 0; i < sizeof(verification_count)/sizeof(uint32_t); i++)
+    UNUSED_PARAM(conn_sock);
+    clt_count_published(0, topic, data_len, data);
+}
+
+static void clt_on_published_1(cplus_socket conn_sock, const char * topic, uint32_t data_len, void * data)
+{
+    UNUSED_PARAM(conn_sock);
+    clt_count_published(1, topic, data_len, data);
+}
+
+static void clt_on_published_2(cplus_socket conn_sock, const char * topic, uint32_t data_len, void * data)
+{
+    UNUSED_PARAM(conn_sock);
+    clt_count_published(2, topic, data_len, data);
+}
+
+static void clt_slow_on_published(cplus_socket conn_sock, const char * topic, uint32_t data_len, void * data)
+{
+    UNUSED_PARAM(conn_sock);
+    UNUSED_PARAM(topic);
+    UNUSED_PARAM(data_len);
+    UNUSED_PARAM(data);
+
+    while (true == pub_is_held)
     {
-        verification_count[i] = 0;
+        cplus_systime_sleep_msec(1);
     }
+    cplus_atomic_add(&pub_other_count, 1);
+}
 
+CPLUS_UNIT_TEST(cplus_ipc_server_publish, functionity)
+{
     cplus_ipc_server ipc_server = CPLUS_NULL;
-    cplus_ipc_client client[MAX_CLIENT_COUNT] = {0};
+    cplus_ipc_client ipc_client[3] = {CPLUS_NULL}, sync_client = CPLUS_NULL;
+    cplus_taskpool dispatch_pool = CPLUS_NULL;
+    uint32_t reactor_counts[] = {0, 2, 1};
+    CPLUS_IPC_CB_FUNCS_T ipc_server_cb_funcs = {0}, ipc_client_cb_funcs[3] = {{0}};
+    CPLUS_IPC_SERVER_CONFIG_T config = {0};
+    CPLUS_IPC_CB_ON_PUBLISHED on_published[3] = {clt_on_published_0, clt_on_published_1, clt_on_published_2};
+    char long_topic[CPLUS_IPC_MAX_TOPIC_SIZE + 1] = {0};
 
-    CPLUS_IPC_CB_FUNCS_T ipc_server_cb_funcs = {0};
     ipc_server_cb_funcs.on_connected = serv_on_connected;
-    ipc_server_cb_funcs.on_received = serv_oneway_on_received;
     ipc_server_cb_funcs.on_disconnected = serv_on_disconnected;
-
-    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (ipc_server = cplus_ipc_server_new(SERVER_NAME, MAX_CLIENT_COUNT, &ipc_server_cb_funcs))));
-    for (int32_t idx = 0; idx < MAX_CLIENT_COUNT; idx++)
+    ipc_server_cb_funcs.on_received = serv_request_on_received;
+    for (uint32_t i = 0; i < 3; i++)
     {
-        UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (client[idx] = cplus_ipc_client_new(SERVER_NAME, CPLUS_NULL))));
-        UNITTEST_EXPECT_EQ(strlen(test_string0) + 1, cplus_ipc_client_send_oneway(client[idx], strlen(test_string0) + 1, test_string0));
-        UNITTEST_EXPECT_EQ(strlen(test_string1) + 1, cplus_ipc_client_send_oneway(client[idx], strlen(test_string1) + 1, test_string1));
-        UNITTEST_EXPECT_EQ(strlen(test_string2) + 1, cplus_ipc_client_send_oneway(client[idx], strlen(test_string2) + 1, test_string2));
-        UNITTEST_EXPECT_EQ(strlen(test_string3) + 1, cplus_ipc_client_send_oneway(client[idx], strlen(test_string3) + 1, test_string3));
-        UNITTEST_EXPECT_EQ(strlen(test_string4) + 1, cplus_ipc_client_send_oneway(client[idx], strlen(test_string4) + 1, test_string4));
+        ipc_client_cb_funcs[i].on_received = serv_oneway_on_received;
+        ipc_client_cb_funcs[i].on_published = on_published[i];
     }
-    cplus_systime_sleep_msec(5 * 1000);
-    UNITTEST_EXPECT_EQ(MAX_CLIENT_COUNT, client_count);
-    for (int32_t idx = 0; idx < MAX_CLIENT_COUNT; idx++)
+
+    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (dispatch_pool = cplus_taskpool_new(2))));
+    config.name = SERVER_NAME;
+    config.max_connection = MAX_CLIENT_COUNT;
+    config.cb_funcs = &ipc_server_cb_funcs;
+
+    for (uint32_t k = 0; k < sizeof(reactor_counts) / sizeof(uint32_t); k++)
     {
-        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_delete(client[idx]));
+        /* The last round runs the one-shot dispatch, where queued output is re-armed by the reactor. */
+        config.reactor_count = reactor_counts[k];
+        config.dispatch_pool = (2 == k)? dispatch_pool: CPLUS_NULL;
+        cplus_mem_set(pub_received, 0x00, sizeof(pub_received));
+        cplus_mem_set(pub_ordered, 0x00, sizeof(pub_ordered));
+        pub_other_count = 0;
+
+        UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (ipc_server = cplus_ipc_server_new_ex(&config))));
+        for (uint32_t i = 0; i < 3; i++)
+        {
+            UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (ipc_client[i] = cplus_ipc_client_new(SERVER_NAME, &(ipc_client_cb_funcs[i])))));
+            UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_subscribe(ipc_client[i], (2 == i)? "other": "state", 1000));
+        }
+        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_subscribe(ipc_client[0], "state", 1000));
+
+        for (uint32_t i = 0; i < 50; i++)
+        {
+            UNITTEST_EXPECT_EQ(2, cplus_ipc_server_publish(ipc_server, "state", sizeof(uint32_t), &i));
+        }
+        UNITTEST_EXPECT_EQ(1, cplus_ipc_server_publish(ipc_server, "other", 0, CPLUS_NULL));
+        UNITTEST_EXPECT_EQ(0, cplus_ipc_server_publish(ipc_server, "nobody", sizeof(uint32_t), &k));
+        for (int32_t i = 0; i < 200 AND (50 != pub_received[0] OR 50 != pub_received[1] OR 1 != pub_other_count); i++)
+        {
+            cplus_systime_sleep_msec(10);
+        }
+        UNITTEST_EXPECT_EQ(50, pub_received[0]);
+        UNITTEST_EXPECT_EQ(50, pub_ordered[0]);
+        UNITTEST_EXPECT_EQ(50, pub_received[1]);
+        UNITTEST_EXPECT_EQ(50, pub_ordered[1]);
+        UNITTEST_EXPECT_EQ(0, pub_received[2]);
+        UNITTEST_EXPECT_EQ(1, pub_other_count);
+
+        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_unsubscribe(ipc_client[1], "state", 1000));
+        UNITTEST_EXPECT_EQ(CPLUS_FAIL, cplus_ipc_client_unsubscribe(ipc_client[1], "state", 1000));
+        UNITTEST_EXPECT_EQ(ENOENT, errno);
+        UNITTEST_EXPECT_EQ(1, cplus_ipc_server_publish(ipc_server, "state", sizeof(uint32_t), &k));
+
+        for (uint32_t i = 0; i < 3; i++)
+        {
+            UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_delete(ipc_client[i]));
+        }
+        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_server_delete(ipc_server));
     }
+
+    /* A synchronous client has no one to read what is published. */
+    config.reactor_count = 0;
+    config.dispatch_pool = CPLUS_NULL;
+    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (ipc_server = cplus_ipc_server_new_ex(&config))));
+    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (sync_client = cplus_ipc_client_new(SERVER_NAME, CPLUS_NULL))));
+    UNITTEST_EXPECT_EQ(CPLUS_FAIL, cplus_ipc_client_subscribe(sync_client, "state", 1000));
+    cplus_mem_set(long_topic, 'a', CPLUS_IPC_MAX_TOPIC_SIZE);
+    UNITTEST_EXPECT_EQ(CPLUS_FAIL, cplus_ipc_server_publish(ipc_server, long_topic, 0, CPLUS_NULL));
+    UNITTEST_EXPECT_EQ(CPLUS_FAIL, cplus_ipc_server_publish(ipc_server, "", 0, CPLUS_NULL));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_delete(sync_client));
     UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_server_delete(ipc_server));
-    UNITTEST_EXPECT_EQ(0, client_count);
-    UNITTEST_EXPECT_EQ(MAX_CLIENT_COUNT, verification_count[0]);
-    UNITTEST_EXPECT_EQ(MAX_CLIENT_COUNT, verification_count[1]);
-    UNITTEST_EXPECT_EQ(MAX_CLIENT_COUNT, verification_count[2]);
-    UNITTEST_EXPECT_EQ(MAX_CLIENT_COUNT, verification_count[3]);
-    UNITTEST_EXPECT_EQ(MAX_CLIENT_COUNT, verification_count[4]);
+
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskpool_delete(dispatch_pool));
     UNITTEST_EXPECT_EQ(0, cplus_mgr_report());
 }
 
-CPLUS_UNIT_TEST(CPLUS_IPC_CLIENT_CONNECT, bad_case_over_connection_count)
+CPLUS_UNIT_TEST(cplus_ipc_server_publish, slow_subscriber)
 {
     cplus_ipc_server ipc_server = CPLUS_NULL;
-    cplus_ipc_client client[MAX_CLIENT_COUNT + 1] = {0};
+    cplus_ipc_client ipc_client = CPLUS_NULL;
+    uint32_t reactor_counts[] = {0, 2};
+    CPLUS_IPC_CB_FUNCS_T ipc_server_cb_funcs = {0}, ipc_client_cb_funcs = {0};
+    CPLUS_IPC_SERVER_CONFIG_T config = {0};
+    uint8_t * bufs = CPLUS_NULL;
+    int32_t res = 0, i = 0;
 
-    CPLUS_IPC_CB_FUNCS_T ipc_server_cb_funcs = {0};
     ipc_server_cb_funcs.on_connected = serv_on_connected;
-    ipc_server_cb_funcs.on_received = serv_oneway_on_received;
     ipc_server_cb_funcs.on_disconnected = serv_on_disconnected;
+    ipc_server_cb_funcs.on_received = serv_request_on_received;
+    ipc_client_cb_funcs.on_received = serv_oneway_on_received;
+    ipc_client_cb_funcs.on_published = clt_slow_on_published;
 
-    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (ipc_server = cplus_ipc_server_new(SERVER_NAME, MAX_CLIENT_COUNT, &ipc_server_cb_funcs))));
-    for (int32_t i = 0; i < MAX_CLIENT_COUNT; i++)
+    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (bufs = (uint8_t *)cplus_malloc(32 * 1024))));
+    cplus_mem_set(bufs, 0x5A, 32 * 1024);
+    config.name = SERVER_NAME;
+    config.max_connection = MAX_CLIENT_COUNT;
+    config.cb_funcs = &ipc_server_cb_funcs;
+    config.publish_backlog = 64 * 1024;
+
+    for (uint32_t k = 0; k < sizeof(reactor_counts) / sizeof(uint32_t); k++)
     {
-        UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (client[i] = cplus_ipc_client_new(SERVER_NAME, CPLUS_NULL))));
+        config.reactor_count = reactor_counts[k];
+
+        /* Dropped while the subscriber stalls, delivered again once it catches up. */
+        config.slow_subscriber_policy = CPLUS_IPC_SLOW_SUBSCRIBER_POLICY_DROP;
+        UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (ipc_server = cplus_ipc_server_new_ex(&config))));
+        UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (ipc_client = cplus_ipc_client_new(SERVER_NAME, &ipc_client_cb_funcs))));
+        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_subscribe(ipc_client, "bulk", 1000));
+        pub_is_held = true;
+        for (i = 0, res = 1; i < 400 AND 0 != res; i++)
+        {
+            res = cplus_ipc_server_publish(ipc_server, "bulk", 32 * 1024, bufs);
+        }
+        UNITTEST_EXPECT_EQ(0, res);
+        pub_is_held = false;
+        for (i = 0, res = 0; i < 200 AND 1 != res; i++)
+        {
+            cplus_systime_sleep_msec(10);
+            res = cplus_ipc_server_publish(ipc_server, "bulk", 32 * 1024, bufs);
+        }
+        UNITTEST_EXPECT_EQ(1, res);
+        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_delete(ipc_client));
+        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_server_delete(ipc_server));
+
+        /* Cut off instead, the server side is gone without the subscriber reading a byte. */
+        client_count = 0;
+        config.slow_subscriber_policy = CPLUS_IPC_SLOW_SUBSCRIBER_POLICY_DISCONNECT;
+        UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (ipc_server = cplus_ipc_server_new_ex(&config))));
+        UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (ipc_client = cplus_ipc_client_new(SERVER_NAME, &ipc_client_cb_funcs))));
+        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_subscribe(ipc_client, "bulk", 1000));
+        UNITTEST_EXPECT_EQ(1, client_count);
+        pub_is_held = true;
+        for (i = 0, res = 1; i < 400 AND 0 != res; i++)
+        {
+            res = cplus_ipc_server_publish(ipc_server, "bulk", 32 * 1024, bufs);
+        }
+        UNITTEST_EXPECT_EQ(0, res);
+        for (i = 0; i < 200 AND 0 != client_count; i++)
+        {
+            cplus_systime_sleep_msec(10);
+        }
+        UNITTEST_EXPECT_EQ(0, client_count);
+        UNITTEST_EXPECT_EQ(0, cplus_ipc_server_publish(ipc_server, "bulk", 32 * 1024, bufs));
+        pub_is_held = false;
+        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_delete(ipc_client));
+        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_server_delete(ipc_server));
     }
-    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL == (client[5] = cplus_ipc_client_new(SERVER_NAME, CPLUS_NULL))));
-    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_delete(client[0]));
-    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (client[5] = cplus_ipc_client_new(SERVER_NAME, CPLUS_NULL))));
-    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_send_heartbeat(client[5], 3000));
-    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_send_heartbeat(client[5], 3000));
-    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_delete(client[2]));
-    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (client[2] = cplus_ipc_client_new(SERVER_NAME, CPLUS_NULL))));
-    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_send_heartbeat(client[2], 3000));
-    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_delete(client[1]));
-    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_delete(client[2]));
-    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_delete(client[3]));
-    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_delete(client[4]));
-    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_delete(client[5]));
-    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_server_delete(ipc_server));
+
+    cplus_free(bufs);
     UNITTEST_EXPECT_EQ(0, cplus_mgr_report());
 }
 
-CPLUS_UNIT_TEST(CPLUS_IPC_CLIENT_SEND_REQUEST, bad_case_timeout)
+static uint32_t slow_consumer_count = 0;
+
+int32_t serv_stats_on_received(
+    cplus_socket conn_sock
+    , uint32_t input_bufs_len
+    , void * input_bufs
+    , uint32_t * output_bufs_len
+    , void * output_bufs)
 {
-    cplus_ipc_server ipc_server = CPLUS_NULL;
-    cplus_ipc_client ipc_client = CPLUS_NULL;
+    uint32_t delay = 0;
+    UNUSED_PARAM(conn_sock);
 
-    char recv_bufs[512] = {0};
-    uint32_t recv_bufs_size = sizeof(recv_bufs);
-    int32_t recv_count = 0;
+    if (sizeof(uint32_t) != input_bufs_len OR sizeof(uint32_t) > (* output_bufs_len))
+    {
+        errno = EINVAL;
+        return CPLUS_FAIL;
+    }
+    cplus_mem_cpy(&delay, input_bufs, sizeof(uint32_t));
+    if (0 < delay)
+    {
+        cplus_systime_sleep_msec(delay);
+    }
+    cplus_mem_cpy(output_bufs, &delay, sizeof(uint32_t));
+    (* output_bufs_len) = sizeof(uint32_t);
+    return CPLUS_SUCCESS;
+}
+
+static void serv_on_slow_consumer(cplus_socket conn_sock, CPLUS_IPC_CONN_STATS stats)
+{
+    if (conn_sock == stats->conn_sock AND true == stats->is_slow)
+    {
+        cplus_atomic_add(&slow_consumer_count, 1);
+    }
+}
 
+CPLUS_UNIT_TEST(cplus_ipc_server_get_stats, functionity)
+{
+    cplus_ipc_server ipc_server = CPLUS_NULL;
+    cplus_ipc_client ipc_client = CPLUS_NULL;
+    uint32_t reactor_counts[] = {0, 2}, delay = 0, output = 0;
     CPLUS_IPC_CB_FUNCS_T ipc_server_cb_funcs = {0};
-    ipc_server_cb_funcs.on_connected = serv_on_connected;
-    ipc_server_cb_funcs.on_received = serv_request_on_received;
-    ipc_server_cb_funcs.on_disconnected = serv_on_disconnected;
+    CPLUS_IPC_SERVER_CONFIG_T config = {0};
+    CPLUS_IPC_SERVER_STATS_T serv_stats = {0};
+    CPLUS_IPC_CONN_STATS_T conn_stats[2] = {{0}};
+
+    ipc_server_cb_funcs.on_received = serv_stats_on_received;
+    ipc_server_cb_funcs.on_slow_consumer = serv_on_slow_consumer;
+    config.name = SERVER_NAME;
+    config.max_connection = MAX_CLIENT_COUNT;
+    config.cb_funcs = &ipc_server_cb_funcs;
+    config.slow_request_msec = 100;
+
+    for (uint32_t k = 0; k < sizeof(reactor_counts) / sizeof(uint32_t); k++)
+    {
+        config.reactor_count = reactor_counts[k];
+        slow_consumer_count = 0;
+        UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (ipc_server = cplus_ipc_server_new_ex(&config))));
+        UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (ipc_client = cplus_ipc_client_new(SERVER_NAME, CPLUS_NULL))));
 
-    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (ipc_server = cplus_ipc_server_new(SERVER_NAME, MAX_CLIENT_COUNT, &ipc_server_cb_funcs))));
-    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (ipc_client = cplus_ipc_client_new(SERVER_NAME, CPLUS_NULL))));
-    UNITTEST_EXPECT_EQ(
-            true
-            , (0 < (recv_count = cplus_ipc_client_send_request(
-                ipc_client
-                , strlen(test_string0) + 1
-                , test_string0
-                , recv_bufs_size
-                , (void *)(recv_bufs)
-                , 1000))));
-    UNITTEST_EXPECT_EQ(strlen(response_string0) + 1, recv_count);
-    UNITTEST_EXPECT_EQ(0, strcmp(recv_bufs, response_string0));
-    UNITTEST_EXPECT_NE(
-            true
-            , (0 < (recv_count = cplus_ipc_client_send_request(
-                ipc_client
-                , strlen(test_string1) + 1
-                , test_string1
-                , recv_bufs_size
-                , (void *)(recv_bufs)
-                , 1))));
-    UNITTEST_EXPECT_EQ(ETIMEDOUT, errno);
-    UNITTEST_EXPECT_EQ(
-            true
-            , (0 < (recv_count = cplus_ipc_client_send_request(
-                ipc_client
-                , strlen(test_string2) + 1
-                , test_string2
-                , recv_bufs_size
-                , (void *)(recv_bufs)
-                , 1000))));
-    UNITTEST_EXPECT_EQ(strlen(response_string2) + 1, recv_count);
-    UNITTEST_EXPECT_EQ(0, strcmp(recv_bufs, response_string2));
-    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_delete(ipc_client));
-    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_server_delete(ipc_server));
+        delay = 0;
+        for (uint32_t i = 0; i < 10; i++)
+        {
+            UNITTEST_EXPECT_EQ(sizeof(uint32_t), cplus_ipc_client_send_request(
+                ipc_client, sizeof(uint32_t), &delay, sizeof(uint32_t), &output, 1000));
+        }
+        /* The heartbeat a client sends as it connects is a message each way as well. A response
+        is counted once it left, so the client may read the stats a moment before that. */
+        UNITTEST_EXPECT_EQ(1, cplus_ipc_server_get_conn_stats(ipc_server, 2, conn_stats));
+        for (int32_t i = 0; i < 100 AND 10 > conn_stats[0].request_time.count; i++)
+        {
+            cplus_systime_sleep_msec(10);
+            UNITTEST_EXPECT_EQ(1, cplus_ipc_server_get_conn_stats(ipc_server, 2, conn_stats));
+        }
+        UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != conn_stats[0].conn_sock));
+        UNITTEST_EXPECT_EQ(11, conn_stats[0].messages_received);
+        UNITTEST_EXPECT_EQ(10 * sizeof(uint32_t), conn_stats[0].bytes_received);
+        UNITTEST_EXPECT_EQ(11, conn_stats[0].messages_sent);
+        UNITTEST_EXPECT_EQ(10 * sizeof(uint32_t), conn_stats[0].bytes_sent);
+        UNITTEST_EXPECT_EQ(10, conn_stats[0].request_time.count);
+        UNITTEST_EXPECT_EQ(false, conn_stats[0].is_slow);
+        UNITTEST_EXPECT_EQ(0, conn_stats[0].queued_bytes);
+
+        /* One request over the limit marks the connection, the next quick one clears it again. */
+        delay = 200;
+        UNITTEST_EXPECT_EQ(sizeof(uint32_t), cplus_ipc_client_send_request(
+            ipc_client, sizeof(uint32_t), &delay, sizeof(uint32_t), &output, 1000));
+        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_server_get_stats(ipc_server, &serv_stats));
+        for (int32_t i = 0; i < 100 AND 0 == serv_stats.slow_conn_count; i++)
+        {
+            cplus_systime_sleep_msec(10);
+            UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_server_get_stats(ipc_server, &serv_stats));
+        }
+        UNITTEST_EXPECT_EQ(1, slow_consumer_count);
+        UNITTEST_EXPECT_EQ(1, serv_stats.conn_count);
+        UNITTEST_EXPECT_EQ(1, serv_stats.slow_conn_count);
+        UNITTEST_EXPECT_EQ(1, serv_stats.slow_count);
+        UNITTEST_EXPECT_EQ(true, (200000000ULL <= serv_stats.request_time.max_nsec));
+
+        delay = 0;
+        UNITTEST_EXPECT_EQ(sizeof(uint32_t), cplus_ipc_client_send_request(
+            ipc_client, sizeof(uint32_t), &delay, sizeof(uint32_t), &output, 1000));
+        for (int32_t i = 0; i < 100 AND 0 < serv_stats.slow_conn_count; i++)
+        {
+            cplus_systime_sleep_msec(10);
+            UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_server_get_stats(ipc_server, &serv_stats));
+        }
+        UNITTEST_EXPECT_EQ(0, serv_stats.slow_conn_count);
+        UNITTEST_EXPECT_EQ(1, slow_consumer_count);
+
+        /* The totals outlive the connection. */
+        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_delete(ipc_client));
+        for (int32_t i = 0; i < 100 AND 0 < serv_stats.conn_count; i++)
+        {
+            cplus_systime_sleep_msec(10);
+            UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_server_get_stats(ipc_server, &serv_stats));
+        }
+        UNITTEST_EXPECT_EQ(0, serv_stats.conn_count);
+        UNITTEST_EXPECT_EQ(1, serv_stats.accepted_count);
+        UNITTEST_EXPECT_EQ(13, serv_stats.messages_received);
+        UNITTEST_EXPECT_EQ(13, serv_stats.messages_sent);
+        UNITTEST_EXPECT_EQ(12, serv_stats.request_time.count);
+        UNITTEST_EXPECT_EQ(0, cplus_ipc_server_get_conn_stats(ipc_server, 2, conn_stats));
+        UNITTEST_EXPECT_EQ(CPLUS_FAIL, cplus_ipc_server_get_conn_stats(ipc_server, 2, CPLUS_NULL));
+        UNITTEST_EXPECT_EQ(CPLUS_FAIL, cplus_ipc_server_get_stats(ipc_server, CPLUS_NULL));
+        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_server_delete(ipc_server));
+    }
     UNITTEST_EXPECT_EQ(0, cplus_mgr_report());
 }
 
-CPLUS_UNIT_TEST(CPLUS_IPC_CLIENT_SEND_HEARTBEAT, bad_case_timeout)
+CPLUS_UNIT_TEST(cplus_ipc_server_new_ex, seqpacket)
 {
     cplus_ipc_server ipc_server = CPLUS_NULL;
-    cplus_ipc_client ipc_client = CPLUS_NULL;
+    cplus_ipc_client ipc_client = CPLUS_NULL, async_client = CPLUS_NULL;
+    uint32_t reactor_counts[] = {0, 2};
+    CPLUS_IPC_CB_FUNCS_T ipc_server_cb_funcs = {0}, ipc_client_cb_funcs = {0};
+    CPLUS_IPC_SERVER_CONFIG_T server_config = {0};
+    CPLUS_IPC_CLIENT_CONFIG_T client_config = {0};
+    uint8_t * send_bufs = CPLUS_NULL, * recv_bufs = CPLUS_NULL;
+    char recv_string[64] = {0}, requests[4][16] = {{0}};
 
-    CPLUS_IPC_CB_FUNCS_T ipc_server_cb_funcs = {0};
     ipc_server_cb_funcs.on_connected = serv_on_connected;
-    ipc_server_cb_funcs.on_received = serv_oneway_on_received;
+    ipc_server_cb_funcs.on_received = serv_echo_on_received;
     ipc_server_cb_funcs.on_disconnected = serv_on_disconnected;
+    ipc_client_cb_funcs.on_received = serv_oneway_on_received;
+    ipc_client_cb_funcs.on_published = clt_on_published_0;
+    server_config.name = SERVER_NAME;
+    server_config.max_connection = MAX_CLIENT_COUNT;
+    server_config.cb_funcs = &ipc_server_cb_funcs;
+    server_config.is_seqpacket = true;
+    client_config.name = SERVER_NAME;
+    client_config.is_seqpacket = true;
+
+    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (send_bufs = (uint8_t *)cplus_malloc(200 * 1024))));
+    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (recv_bufs = (uint8_t *)cplus_malloc(200 * 1024))));
+    for (uint32_t k = 0; k < 200 * 1024; k++)
+    {
+        send_bufs[k] = (uint8_t)k;
+    }
 
-    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (ipc_server = cplus_ipc_server_new(SERVER_NAME, MAX_CLIENT_COUNT, &ipc_server_cb_funcs))));
-    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (ipc_client = cplus_ipc_client_new(SERVER_NAME, CPLUS_NULL))));
-    UNITTEST_EXPECT_EQ(CPLUS_FAIL, cplus_ipc_client_send_heartbeat(ipc_client, 1));
-    UNITTEST_EXPECT_EQ(ETIMEDOUT, errno);
-    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_delete(ipc_client));
-    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_server_delete(ipc_server));
+    for (uint32_t k = 0; k < sizeof(reactor_counts) / sizeof(uint32_t); k++)
+    {
+        server_config.reactor_count = reactor_counts[k];
+        client_config.cb_funcs = CPLUS_NULL;
+        UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (ipc_server = cplus_ipc_server_new_ex(&server_config))));
+        /* A byte stream client cannot talk to a seqpacket server. */
+        UNITTEST_EXPECT_EQ(true, (CPLUS_NULL == cplus_ipc_client_new(SERVER_NAME, CPLUS_NULL)));
+        UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (ipc_client = cplus_ipc_client_new_ex(&client_config))));
+
+        UNITTEST_EXPECT_EQ(strlen(test_string0) + 1, cplus_ipc_client_send_request(
+            ipc_client, strlen(test_string0) + 1, test_string0, sizeof(recv_string), recv_string, 10000));
+        UNITTEST_EXPECT_EQ(0, strcmp(recv_string, test_string0));
+        /* Beyond a datagram, both ways go through a memfd without one being configured. */
+        cplus_mem_set(recv_bufs, 0x00, 200 * 1024);
+        UNITTEST_EXPECT_EQ(200 * 1024, cplus_ipc_client_send_request(
+            ipc_client, 200 * 1024, send_bufs, 200 * 1024, recv_bufs, 10000));
+        UNITTEST_EXPECT_EQ(0, memcmp(send_bufs, recv_bufs, 200 * 1024));
+        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_send_heartbeat(ipc_client, 1000));
+
+        client_config.cb_funcs = &ipc_client_cb_funcs;
+        async_completed_count = 0;
+        async_matched_count = 0;
+        cplus_mem_set(pub_received, 0x00, sizeof(pub_received));
+        cplus_mem_set(pub_ordered, 0x00, sizeof(pub_ordered));
+        UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (async_client = cplus_ipc_client_new_ex(&client_config))));
+        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_subscribe(async_client, "state", 1000));
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            cplus_str_printf(requests[i], sizeof(requests[i]), "request %u", i);
+            UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_send_request_async(
+                async_client, strlen(requests[i]) + 1, requests[i], client_on_completed, requests[i], 10000, CPLUS_NULL));
+        }
+        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_wait_requests(async_client, 10000));
+        UNITTEST_EXPECT_EQ(4, async_completed_count);
+        UNITTEST_EXPECT_EQ(4, async_matched_count);
+
+        for (uint32_t i = 0; i < 10; i++)
+        {
+            UNITTEST_EXPECT_EQ(1, cplus_ipc_server_publish(ipc_server, "state", sizeof(uint32_t), &i));
+        }
+        for (int32_t i = 0; i < 200 AND 10 != pub_received[0]; i++)
+        {
+            cplus_systime_sleep_msec(10);
+        }
+        UNITTEST_EXPECT_EQ(10, pub_received[0]);
+        UNITTEST_EXPECT_EQ(10, pub_ordered[0]);
+
+        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_delete(async_client));
+        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_client_delete(ipc_client));
+        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_ipc_server_delete(ipc_server));
+    }
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_free(send_bufs));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_free(recv_bufs));
     UNITTEST_EXPECT_EQ(0, cplus_mgr_report());
 }
 
@@ -1916,6 +6887,25 @@ void unittest_ipc_server(void)
     UNITTEST_ADD_TESTCASE(CPLUS_IPC_CLIENT_CONNECT, bad_case_over_connection_count);
     UNITTEST_ADD_TESTCASE(CPLUS_IPC_CLIENT_SEND_REQUEST, bad_case_timeout);
     UNITTEST_ADD_TESTCASE(CPLUS_IPC_CLIENT_SEND_HEARTBEAT, bad_case_timeout);
+    UNITTEST_ADD_TESTCASE(cplus_ipc_server_new_ex, reactor);
+    UNITTEST_ADD_TESTCASE(cplus_ipc_server_new_ex, reactor_with_dispatch_pool);
+    UNITTEST_ADD_TESTCASE(cplus_ipc_server_new_ex, reactor_over_connection_count);
+    UNITTEST_ADD_TESTCASE(cplus_ipc_client_send_request_async, functionity);
+    UNITTEST_ADD_TESTCASE(cplus_ipc_client_send_request_async, bad_case);
+    UNITTEST_ADD_TESTCASE(cplus_ipc_client_new_ex, shm_ring);
+    UNITTEST_ADD_TESTCASE(cplus_ipc_client_new_ex, shm_ring_fallback);
+    UNITTEST_ADD_TESTCASE(cplus_ipc_client_new_ex, shm_ring_async);
+    UNITTEST_ADD_TESTCASE(cplus_ipc_client_new_ex, memfd);
+    UNITTEST_ADD_TESTCASE(cplus_ipc_client_new_ex, memfd_async);
+    UNITTEST_ADD_TESTCASE(cplus_ipc_client_stream_append, functionity);
+    UNITTEST_ADD_TESTCASE(cplus_ipc_client_stream_append, bad_case);
+    UNITTEST_ADD_TESTCASE(cplus_ipc_client_send_oneway, batch);
+    UNITTEST_ADD_TESTCASE(cplus_ipc_server_new_ex, handler_pool);
+    UNITTEST_ADD_TESTCASE(cplus_ipc_server_new_ex, handler_pool_close);
+    UNITTEST_ADD_TESTCASE(cplus_ipc_server_publish, functionity);
+    UNITTEST_ADD_TESTCASE(cplus_ipc_server_publish, slow_subscriber);
+    UNITTEST_ADD_TESTCASE(cplus_ipc_server_get_stats, functionity);
+    UNITTEST_ADD_TESTCASE(cplus_ipc_server_new_ex, seqpacket);
 }
 
 #endif // __CPLUS_UNITTEST__
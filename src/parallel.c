@@ -0,0 +1,375 @@
+/******************************************************************
+* @file: parallel.c
+*
+* @author: Hunter Huang <bill.b750121@gmail.com>
+******************************************************************/
+
+#include "common.h"
+#include "cplus_memmgr.h"
+#include "cplus_atomic.h"
+#include "cplus_pevent.h"
+#include "cplus_task.h"
+#include "cplus_taskpool.h"
+#include "cplus_parallel.h"
+
+#define MAX_HELPER_COUNT 32U
+#define CHUNKS_PER_PARTICIPANT 8U
+
+struct parallel_job
+{
+    uint64_t cursor;
+    uint64_t end;
+    uint64_t grain;
+    uint32_t participant_count;
+    uint32_t pending_helper_count;
+    uint32_t slot_count;
+    CPLUS_PARALLEL_FOR_PROC for_fn;
+    CPLUS_PARALLEL_REDUCE_PROC reduce_fn;
+    void * ctx;
+    uint8_t * partials;
+    uint32_t partial_size;
+    cplus_pevent evt_helpers_done;
+};
+
+static bool parallel_claim_range(
+    struct parallel_job * job
+    , uint64_t * begin
+    , uint64_t * end)
+{
+    uint64_t cursor = cplus_atomic_read(&(job->cursor)), next = 0, remain = 0;
+
+    /* Guided self-scheduling, big chunks first and down to the grain near the
+    end, so the tail is balanced without paying per-element overhead. */
+    do
+    {
+        if (cursor >= job->end)
+        {
+            return false;
+        }
+        remain = job->end - cursor;
+        next = cursor + CPLUS_MIN(remain
+            , CPLUS_MAX(job->grain, (remain / (2 * job->participant_count))));
+    }
+    while (!cplus_atomic_compare_exchange(&(job->cursor), &cursor, &next));
+
+    (* begin) = cursor;
+    (* end) = next;
+    return true;
+}
+
+static void parallel_participate(struct parallel_job * job)
+{
+    uint64_t begin = 0, end = 0;
+    void * partial = CPLUS_NULL;
+
+    if (job->reduce_fn)
+    {
+        partial = &(job->partials[
+            cplus_atomic_fetch_add(&(job->slot_count), 1) * job->partial_size]);
+    }
+
+    while (parallel_claim_range(job, &begin, &end))
+    {
+        if (job->reduce_fn)
+        {
+            job->reduce_fn(begin, end, job->ctx, partial);
+        }
+        else
+        {
+            job->for_fn(begin, end, job->ctx);
+        }
+    }
+}
+
+static void parallel_helper_proc(void * param1, void * param2)
+{
+    struct parallel_job * job = (struct parallel_job *)(param1);
+    UNUSED_PARAM(param2);
+
+    parallel_participate(job);
+
+    if (0 == cplus_atomic_add(&(job->pending_helper_count), -1))
+    {
+        cplus_pevent_set(job->evt_helpers_done);
+    }
+}
+
+struct helper_withdrawal
+{
+    struct parallel_job * job;
+    bool is_found;
+};
+
+static int32_t find_queued_helper(void * data, void * arg)
+{
+    struct cplus_taskpool_task * task = (struct cplus_taskpool_task *)(data);
+    struct helper_withdrawal * withdrawal = (struct helper_withdrawal *)(arg);
+
+    if (parallel_helper_proc == task->proc AND withdrawal->job == task->param1)
+    {
+        withdrawal->is_found = true;
+        return 0;
+    }
+    return -1;
+}
+
+static int32_t parallel_run(
+    cplus_taskpool pool
+    , struct parallel_job * job)
+{
+    struct cplus_taskpool_task helpers[MAX_HELPER_COUNT] = {0};
+    uint32_t helper_count = 0;
+    uint64_t chunk_count = 0;
+
+    helper_count = CPLUS_MIN(cplus_taskpool_get_worker_count(pool), MAX_HELPER_COUNT);
+    chunk_count = ((job->end - job->cursor) + job->grain - 1) / job->grain;
+    helper_count = (uint32_t)CPLUS_MIN((uint64_t)(helper_count), (chunk_count - 1));
+
+    job->participant_count = helper_count + 1;
+    job->pending_helper_count = helper_count;
+
+    if (0 < helper_count)
+    {
+        if (CPLUS_NULL == (job->evt_helpers_done = cplus_pevent_new(false, false)))
+        {
+            return CPLUS_FAIL;
+        }
+
+        for (uint32_t i = 0; i < helper_count; i++)
+        {
+            helpers[i].proc = parallel_helper_proc;
+            helpers[i].param1 = job;
+            helpers[i].param2 = CPLUS_NULL;
+            helpers[i].callback = CPLUS_NULL;
+        }
+
+        if (CPLUS_SUCCESS != cplus_taskpool_add_tasks(pool, helper_count, helpers))
+        {
+            /* The queue is full, the caller does the whole range alone. */
+            job->participant_count = 1;
+            job->pending_helper_count = 0;
+            helper_count = 0;
+        }
+    }
+
+    /* The calling thread is always a participant. */
+    parallel_participate(job);
+
+    if (0 < helper_count)
+    {
+        /* Withdraw helpers which have not been picked up yet, nothing is left
+        for them and waiting on them would only add latency. */
+        struct helper_withdrawal withdrawal = {job, true};
+        bool is_drained = false;
+        while (withdrawal.is_found)
+        {
+            withdrawal.is_found = false;
+            cplus_taskpool_remove_task(pool, find_queued_helper, &withdrawal);
+            if (withdrawal.is_found
+                AND 0 == cplus_atomic_add(&(job->pending_helper_count), -1))
+            {
+                is_drained = true;
+            }
+        }
+
+        /* Unless the last one was withdrawn here, a running helper sets the event. */
+        if (false == is_drained)
+        {
+            cplus_pevent_wait(job->evt_helpers_done, CPLUS_INFINITE_TIMEOUT);
+        }
+        cplus_pevent_delete(job->evt_helpers_done);
+    }
+    return CPLUS_SUCCESS;
+}
+
+static inline uint64_t parallel_default_grain(cplus_taskpool pool, uint64_t begin, uint64_t end)
+{
+    uint64_t participant_count = cplus_taskpool_get_worker_count(pool) + 1;
+    return CPLUS_MAX(1UL, ((end - begin) / (participant_count * CHUNKS_PER_PARTICIPANT)));
+}
+
+int32_t cplus_parallel_for(
+    cplus_taskpool pool
+    , uint64_t begin
+    , uint64_t end
+    , uint64_t grain
+    , CPLUS_PARALLEL_FOR_PROC fn
+    , void * ctx)
+{
+    struct parallel_job job = {0};
+    CHECK_IF(false == cplus_taskpool_check(pool), CPLUS_FAIL);
+    CHECK_NOT_NULL(fn, CPLUS_FAIL);
+    CHECK_IF(begin > end, CPLUS_FAIL);
+
+    if (begin == end)
+    {
+        return CPLUS_SUCCESS;
+    }
+
+    job.cursor = begin;
+    job.end = end;
+    job.grain = (0 == grain)? parallel_default_grain(pool, begin, end): grain;
+    job.for_fn = fn;
+    job.ctx = ctx;
+
+    return parallel_run(pool, &job);
+}
+
+int32_t cplus_parallel_reduce(
+    cplus_taskpool pool
+    , uint64_t begin
+    , uint64_t end
+    , uint64_t grain
+    , CPLUS_PARALLEL_REDUCE_PROC fn
+    , CPLUS_PARALLEL_JOIN_PROC join
+    , void * ctx
+    , void * result
+    , uint32_t result_size)
+{
+    int32_t res = CPLUS_FAIL;
+    struct parallel_job job = {0};
+    CHECK_IF(false == cplus_taskpool_check(pool), CPLUS_FAIL);
+    CHECK_NOT_NULL(fn, CPLUS_FAIL);
+    CHECK_NOT_NULL(join, CPLUS_FAIL);
+    CHECK_NOT_NULL(result, CPLUS_FAIL);
+    CHECK_GT_ZERO(result_size, CPLUS_FAIL);
+    CHECK_IF(begin > end, CPLUS_FAIL);
+
+    if (begin == end)
+    {
+        return CPLUS_SUCCESS;
+    }
+
+    job.cursor = begin;
+    job.end = end;
+    job.grain = (0 == grain)? parallel_default_grain(pool, begin, end): grain;
+    job.reduce_fn = fn;
+    job.ctx = ctx;
+    job.partial_size = result_size;
+    job.slot_count = 0;
+
+    /* One partial per participant, each starts from the identity held in "result". */
+    job.partials = (uint8_t *)cplus_malloc((MAX_HELPER_COUNT + 1) * result_size);
+    if (CPLUS_NULL == job.partials)
+    {
+        return CPLUS_FAIL;
+    }
+    for (uint32_t i = 0; i <= MAX_HELPER_COUNT; i++)
+    {
+        cplus_mem_cpy(&(job.partials[i * result_size]), result, result_size);
+    }
+
+    if (CPLUS_SUCCESS == (res = parallel_run(pool, &job)))
+    {
+        for (uint32_t i = 0; i < job.slot_count; i++)
+        {
+            join(result, &(job.partials[i * result_size]), ctx);
+        }
+    }
+
+    cplus_free(job.partials);
+    return res;
+}
+
+#ifdef __CPLUS_UNITTEST__
+
+struct square_sum_ctx
+{
+    uint32_t * values;
+    uint32_t call_count;
+};
+
+static void square_values(uint64_t begin, uint64_t end, void * ctx)
+{
+    struct square_sum_ctx * sctx = (struct square_sum_ctx *)(ctx);
+
+    cplus_atomic_add(&(sctx->call_count), 1);
+    for (uint64_t i = begin; i < end; i++)
+    {
+        sctx->values[i] = (uint32_t)(i * i);
+    }
+}
+
+static void sum_values(uint64_t begin, uint64_t end, void * ctx, void * partial)
+{
+    struct square_sum_ctx * sctx = (struct square_sum_ctx *)(ctx);
+
+    for (uint64_t i = begin; i < end; i++)
+    {
+        (* (uint64_t *)(partial)) += sctx->values[i];
+    }
+}
+
+static void join_sum(void * result, void * partial, void * ctx)
+{
+    UNUSED_PARAM(ctx);
+    (* (uint64_t *)(result)) += (* (uint64_t *)(partial));
+}
+
+#define PARALLEL_TEST_COUNT 100000U
+
+CPLUS_UNIT_TEST(cplus_parallel_for, functionity)
+{
+    cplus_taskpool pool = CPLUS_NULL;
+    struct square_sum_ctx ctx = {0};
+    uint64_t sum = 0, expect = 0;
+
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL != (pool = cplus_taskpool_new(4)));
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL != (ctx.values = (uint32_t *)cplus_malloc(PARALLEL_TEST_COUNT * sizeof(uint32_t))));
+    cplus_mem_set(ctx.values, 0x00, PARALLEL_TEST_COUNT * sizeof(uint32_t));
+
+    UNITTEST_EXPECT_EQ(CPLUS_FAIL, cplus_parallel_for(pool, 10, 0, 1, square_values, &ctx));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_parallel_for(pool, 0, 0, 1, square_values, &ctx));
+    UNITTEST_EXPECT_EQ(0, ctx.call_count);
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_parallel_for(pool, 0, PARALLEL_TEST_COUNT, 1000, square_values, &ctx));
+    UNITTEST_EXPECT_EQ(true, (ctx.call_count <= (PARALLEL_TEST_COUNT / 1000)));
+
+    for (uint32_t i = 0; i < PARALLEL_TEST_COUNT; i++)
+    {
+        if (((uint32_t)(i * i)) != ctx.values[i])
+        {
+            UNITTEST_EXPECT_EQ(((uint32_t)(i * i)), ctx.values[i]);
+            break;
+        }
+        expect += ctx.values[i];
+    }
+
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_parallel_reduce(
+        pool, 0, PARALLEL_TEST_COUNT, 0, sum_values, join_sum, &ctx, &sum, sizeof(sum)));
+    UNITTEST_EXPECT_EQ(expect, sum);
+
+    cplus_free(ctx.values);
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskpool_delete(pool));
+    UNITTEST_EXPECT_EQ(0, cplus_mgr_report());
+}
+
+static void nested_for(uint64_t begin, uint64_t end, void * ctx)
+{
+    cplus_taskpool pool = (cplus_taskpool)(ctx);
+    struct square_sum_ctx inner = {0};
+    uint32_t values[64] = {0};
+
+    inner.values = values;
+    for (uint64_t i = begin; i < end; i++)
+    {
+        cplus_parallel_for(pool, 0, CPLUS_GET_ARRAY_SIZE(values), 1, square_values, &inner);
+    }
+}
+
+CPLUS_UNIT_TEST(cplus_parallel_for, nested_in_worker)
+{
+    cplus_taskpool pool = CPLUS_NULL;
+
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL != (pool = cplus_taskpool_new(2)));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_parallel_for(pool, 0, 32, 1, nested_for, pool));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskpool_delete(pool));
+    UNITTEST_EXPECT_EQ(0, cplus_mgr_report());
+}
+
+void unittest_parallel(void)
+{
+    UNITTEST_ADD_TESTCASE(cplus_parallel_for, functionity);
+    UNITTEST_ADD_TESTCASE(cplus_parallel_for, nested_in_worker);
+}
+
+#endif // __CPLUS_UNITTEST__
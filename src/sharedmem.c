@@ -143,6 +143,7 @@ static void * sharedmem_create(const char * name, uint32_t size)
         if (INVALID_FD != shmem->fd)
         {
             close(shmem->fd);
+            shmem->fd = INVALID_FD;
         }
     }
     else
@@ -210,6 +211,7 @@ static void * sharedmem_open(const char * name)
         if (INVALID_FD != shmem->fd)
         {
             close(shmem->fd);
+            shmem->fd = INVALID_FD;
         }
     }
     else
@@ -303,6 +305,7 @@ static void * sharedmem_new(const char * name, uint32_t size)
         if (INVALID_FD != shmem->fd)
         {
             close(shmem->fd);
+            shmem->fd = INVALID_FD;
         }
     }
     else
@@ -8,14 +8,17 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <sys/un.h>
+#include <fcntl.h>
 #include "common.h"
 #include "cplus_memmgr.h"
 #include "cplus_socket.h"
+#include "cplus_fiber.h"
 
 #define OBJ_TYPE (OBJ_NONE + SYS + 6)
 #define LOCAL_SOCKET_NAME_PATTERN "/var/tmp/cplus_socket_%s"
 
 #define MAX_ADDRESS_SIZE 64
+#define MAX_IOVEC_COUNT 16
 
 #define HAVE_MSGHDR_MSG_CONTROL
 
@@ -98,6 +101,11 @@ static void * socket_initialize_object(
                 style_in = SOCK_DGRAM;
             }
             break;
+        case CPLUS_SOCKET_STYLE_SEQPACKET:
+            {
+                style_in = SOCK_SEQPACKET;
+            }
+            break;
         }
 
         switch (skt->ip_protocol)
@@ -244,6 +252,14 @@ cplus_socket cplus_socket_new(CPLUS_SOCKET_TYPE type)
                 , CPLUS_SOCKET_IP_PROTOCOL_NONE);
         }
         break;
+    case CPLUS_SOCKET_TYPE_SEQPACKET_LOCAL:
+        {
+            skt = cplus_socket_new_ex(
+                CPLUS_SOCKET_DOMAIN_LOCAL
+                , CPLUS_SOCKET_STYLE_SEQPACKET
+                , CPLUS_SOCKET_IP_PROTOCOL_NONE);
+        }
+        break;
     case CPLUS_SOCKET_TYPE_DUEL_STACK:
         errno = ENOTSUP;
         break;
@@ -258,7 +274,7 @@ int32_t cplus_socket_shutdown(cplus_socket obj)
     CHECK_OBJECT_TYPE(obj);
     CHECK_IF(INVALID_SOCKET == skt->socket, CPLUS_FAIL);
     CHECK_IF(false == skt->is_connected, CPLUS_SUCCESS);
-    CHECK_IF(CPLUS_SOCKET_STYLE_STREAM != skt->style, CPLUS_SUCCESS);
+    CHECK_IF(CPLUS_SOCKET_STYLE_DGRAM == skt->style, CPLUS_SUCCESS);
 
     return shutdown(skt->socket, SHUT_RDWR);
 }
@@ -272,7 +288,7 @@ int32_t cplus_socket_shutdown_ex(
     CHECK_OBJECT_TYPE(obj);
     CHECK_IF(INVALID_SOCKET == skt->socket, CPLUS_FAIL);
     CHECK_IF(false == skt->is_connected, CPLUS_SUCCESS);
-    CHECK_IF(CPLUS_SOCKET_STYLE_STREAM != skt->style, CPLUS_SUCCESS);
+    CHECK_IF(CPLUS_SOCKET_STYLE_DGRAM == skt->style, CPLUS_SUCCESS);
 
     switch (mode)
     {
@@ -395,6 +411,12 @@ static int32_t ready_to_recv(int32_t sock_fd, uint32_t timeout)
     fd_set read_fds;
 	struct timeval select_timeout;
 
+    if (cplus_fiber_is_running())
+    {
+        /* Park the fiber instead of blocking the worker thread under it. */
+        return cplus_fiber_wait_fd(sock_fd, false, timeout);
+    }
+
     if (CPLUS_INFINITE_TIMEOUT != timeout)
     {
         timeout = CPLUS_MAX(1U, timeout);
@@ -419,6 +441,11 @@ static int32_t ready_to_send(int32_t sock_fd, uint32_t timeout)
     fd_set send_fds;
 	struct timeval select_timeout;
 
+    if (cplus_fiber_is_running())
+    {
+        return cplus_fiber_wait_fd(sock_fd, true, timeout);
+    }
+
     if (CPLUS_INFINITE_TIMEOUT != timeout)
     {
         timeout = CPLUS_MAX(1U, timeout);
@@ -701,6 +728,174 @@ int32_t cplus_socket_send(
     return send(skt->socket, data_bufs, data_len, MSG_NOSIGNAL);
 }
 
+int32_t cplus_socket_sendv(
+    cplus_socket obj
+    , const struct iovec * iov
+    , int32_t iov_count)
+{
+    struct socket * skt = (struct socket *)(obj);
+    struct iovec iov_left[MAX_IOVEC_COUNT];
+    struct msghdr msg = {0};
+    ssize_t count = 0;
+    int32_t total = 0;
+    CHECK_OBJECT_TYPE(obj);
+    CHECK_IF(INVALID_SOCKET == skt->socket, CPLUS_FAIL);
+    CHECK_NOT_NULL(iov, CPLUS_FAIL);
+    CHECK_IN_INTERVAL(iov_count, 1, MAX_IOVEC_COUNT, CPLUS_FAIL);
+
+    cplus_mem_cpy(iov_left, (void *)(iov), iov_count * sizeof(struct iovec));
+    msg.msg_iov = iov_left;
+    msg.msg_iovlen = iov_count;
+
+    while (0 < msg.msg_iovlen)
+    {
+        if (CPLUS_SUCCESS != ready_to_send(skt->socket, CPLUS_INFINITE_TIMEOUT))
+        {
+            return CPLUS_FAIL;
+        }
+
+        if (0 > (count = sendmsg(skt->socket, &msg, MSG_NOSIGNAL)))
+        {
+            if (EINTR == errno)
+            {
+                continue;
+            }
+            return CPLUS_FAIL;
+        }
+        total += (int32_t)count;
+
+        /* A short write resumes in the middle of an entry. */
+        while (0 < msg.msg_iovlen AND ((size_t)count) >= msg.msg_iov->iov_len)
+        {
+            count -= msg.msg_iov->iov_len;
+            msg.msg_iov ++;
+            msg.msg_iovlen --;
+        }
+        if (0 < msg.msg_iovlen)
+        {
+            msg.msg_iov->iov_base = &(((uint8_t *)(msg.msg_iov->iov_base))[count]);
+            msg.msg_iov->iov_len -= count;
+        }
+    }
+    return total;
+}
+
+int32_t cplus_socket_recvv(
+    cplus_socket obj
+    , struct iovec * iov
+    , int32_t iov_count
+    , uint32_t timeout)
+{
+    struct socket * skt = (struct socket *)(obj);
+    struct msghdr msg = {0};
+    CHECK_OBJECT_TYPE(obj);
+    CHECK_IF(INVALID_SOCKET == skt->socket, CPLUS_FAIL);
+    CHECK_NOT_NULL(iov, CPLUS_FAIL);
+    CHECK_IN_INTERVAL(iov_count, 1, MAX_IOVEC_COUNT, CPLUS_FAIL);
+
+    if (CPLUS_SUCCESS != ready_to_recv(skt->socket, timeout))
+    {
+        return CPLUS_FAIL;
+    }
+
+    msg.msg_iov = iov;
+    msg.msg_iovlen = iov_count;
+
+    return recvmsg(skt->socket, &msg, 0);
+}
+
+int32_t cplus_socket_sendv_fd(
+    cplus_socket obj
+    , const struct iovec * iov
+    , int32_t iov_count
+    , int32_t sendfd)
+{
+    struct socket * skt = (struct socket *)(obj);
+    struct iovec iov_left[MAX_IOVEC_COUNT];
+    struct msghdr msg = {0};
+    ssize_t count = 0;
+    int32_t total = 0;
+    union
+    {
+        struct cmsghdr cm;
+        uint8_t control[CMSG_SPACE(sizeof(int32_t))];
+    } control_un;
+    struct cmsghdr * cmptr = CPLUS_NULL;
+    CHECK_OBJECT_TYPE(obj);
+    CHECK_IF(INVALID_SOCKET == skt->socket, CPLUS_FAIL);
+    CHECK_NOT_NULL(iov, CPLUS_FAIL);
+    CHECK_IN_INTERVAL(iov_count, 1, MAX_IOVEC_COUNT, CPLUS_FAIL);
+    CHECK_IF(INVALID_FD == sendfd, CPLUS_FAIL);
+
+    cplus_mem_cpy(iov_left, (void *)(iov), iov_count * sizeof(struct iovec));
+    msg.msg_iov = iov_left;
+    msg.msg_iovlen = iov_count;
+
+    /* The descriptor rides on the first bytes, the receiver gets it together with them. */
+    cplus_mem_set(&control_un, 0x00, sizeof(control_un));
+    msg.msg_control = control_un.control;
+    msg.msg_controllen = sizeof(control_un.control);
+    cmptr = CMSG_FIRSTHDR(&msg);
+    cmptr->cmsg_len = CMSG_LEN(sizeof(int32_t));
+    cmptr->cmsg_level = SOL_SOCKET;
+    cmptr->cmsg_type = SCM_RIGHTS;
+    cplus_mem_cpy(CMSG_DATA(cmptr), &sendfd, sizeof(int32_t));
+
+    while (0 < msg.msg_iovlen)
+    {
+        if (CPLUS_SUCCESS != ready_to_send(skt->socket, CPLUS_INFINITE_TIMEOUT))
+        {
+            return CPLUS_FAIL;
+        }
+
+        if (0 > (count = sendmsg(skt->socket, &msg, MSG_NOSIGNAL)))
+        {
+            if (EINTR == errno)
+            {
+                continue;
+            }
+            return CPLUS_FAIL;
+        }
+        total += (int32_t)count;
+        msg.msg_control = CPLUS_NULL;
+        msg.msg_controllen = 0;
+
+        while (0 < msg.msg_iovlen AND ((size_t)count) >= msg.msg_iov->iov_len)
+        {
+            count -= msg.msg_iov->iov_len;
+            msg.msg_iov ++;
+            msg.msg_iovlen --;
+        }
+        if (0 < msg.msg_iovlen)
+        {
+            msg.msg_iov->iov_base = &(((uint8_t *)(msg.msg_iov->iov_base))[count]);
+            msg.msg_iov->iov_len -= count;
+        }
+    }
+    return total;
+}
+
+int32_t cplus_socket_recvmsg(
+    cplus_socket obj
+    , struct msghdr * msg
+    , int32_t flags
+    , uint32_t timeout)
+{
+    struct socket * skt = (struct socket *)(obj);
+    CHECK_OBJECT_TYPE(obj);
+    CHECK_IF(INVALID_SOCKET == skt->socket, CPLUS_FAIL);
+    CHECK_NOT_NULL(msg, CPLUS_FAIL);
+
+    /* MSG_DONTWAIT leaves the waiting to the caller's own poller. */
+    if (0 == (flags & MSG_DONTWAIT)
+        AND CPLUS_SUCCESS != ready_to_recv(skt->socket, timeout))
+    {
+        return CPLUS_FAIL;
+    }
+
+    return recvmsg(skt->socket, msg, flags);
+}
+
 static int32_t socket_sendmsg(cplus_socket obj, struct msghdr * msg)
 {
     struct socket * skt = (struct socket *)(obj);
@@ -765,6 +960,31 @@ static int32_t socket_recvmsg(cplus_socket obj
     return res;
 }
 
+int32_t cplus_socket_get_fd(cplus_socket obj)
+{
+    struct socket * skt = (struct socket *)(obj);
+    CHECK_OBJECT_TYPE(obj);
+
+    return skt->socket;
+}
+
+int32_t cplus_socket_setopt_nonblock(cplus_socket obj, bool enable_nonblock)
+{
+    struct socket * skt = (struct socket *)(obj);
+    int flags = 0;
+    CHECK_OBJECT_TYPE(obj);
+    CHECK_IF(INVALID_SOCKET == skt->socket, CPLUS_FAIL);
+
+    if (0 > (flags = fcntl(skt->socket, F_GETFL, 0)))
+    {
+        return CPLUS_FAIL;
+    }
+
+    flags = (enable_nonblock)? (flags | O_NONBLOCK): (flags & ~O_NONBLOCK);
+
+    return (0 == fcntl(skt->socket, F_SETFL, flags))? CPLUS_SUCCESS: CPLUS_FAIL;
+}
+
 int32_t cplus_socket_setopt_reuse_addr(cplus_socket obj, bool enable_reuse_addr)
 {
 	struct socket * skt = (struct socket *)(obj);
@@ -965,6 +1185,31 @@ CPLUS_UNIT_TEST(CPLUS_SOCKET_TYPE_STREAM_LOCAL, functionity)
     UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_mgr_report());
 }
 
+CPLUS_UNIT_TEST(CPLUS_SOCKET_TYPE_SEQPACKET_LOCAL, functionity)
+{
+    cplus_socket skt_server = CPLUS_NULL, skt_client = CPLUS_NULL, skt_remote = CPLUS_NULL;
+    char data_bufs[100] = {0};
+
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL != (skt_server = cplus_socket_new(CPLUS_SOCKET_TYPE_SEQPACKET_LOCAL)));
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL != (skt_remote = cplus_socket_new(CPLUS_SOCKET_TYPE_SEQPACKET_LOCAL)));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_socket_bind(skt_server, SERVER_NAME, 0));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_socket_listen(skt_server, 10));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_socket_connect(skt_remote, SERVER_NAME, 0));
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL != (skt_client = cplus_socket_accept(skt_server, CPLUS_INFINITE_TIMEOUT)));
+    /* Message boundaries are kept, each receive returns exactly one send. */
+    UNITTEST_EXPECT_EQ(strlen("Hello World") + 1, cplus_socket_send(skt_remote, (void *)("Hello World"), strlen("Hello World") + 1));
+    UNITTEST_EXPECT_EQ(strlen("0123456789") + 1, cplus_socket_send(skt_remote, (void *)("0123456789"), strlen("0123456789") + 1));
+    UNITTEST_EXPECT_EQ(strlen("Hello World") + 1, cplus_socket_recv(skt_client, data_bufs, sizeof(data_bufs), CPLUS_INFINITE_TIMEOUT));
+    UNITTEST_EXPECT_EQ(0, strcmp(data_bufs, "Hello World"));
+    UNITTEST_EXPECT_EQ(strlen("0123456789") + 1, cplus_socket_recv(skt_client, data_bufs, sizeof(data_bufs), CPLUS_INFINITE_TIMEOUT));
+    UNITTEST_EXPECT_EQ(0, strcmp(data_bufs, "0123456789"));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_socket_shutdown(skt_remote));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_socket_delete(skt_client));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_socket_delete(skt_remote));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_socket_delete(skt_server));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_mgr_report());
+}
+
 CPLUS_UNIT_TEST(CPLUS_SOCKET_TYPE_UDP_IPV4, functionity)
 {
     cplus_socket skt_server = CPLUS_NULL, skt_client = CPLUS_NULL;
@@ -1046,6 +1291,97 @@ CPLUS_UNIT_TEST(cplus_socket_send_fd, CPLUS_SOCKET_TYPE_STREAM_LOCAL)
     UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_mgr_report());
 }
 
+CPLUS_UNIT_TEST(cplus_socket_sendv, functionity)
+{
+    cplus_socket skt_server = CPLUS_NULL, skt_client = CPLUS_NULL, skt_remote = CPLUS_NULL;
+    char head[] = "HEAD", body[] = "BODY", tail[] = "TAIL";
+    char rr_head[4] = {0}, rr_rest[9] = {0};
+    struct iovec iov[3] = {0};
+
+    iov[0].iov_base = head;
+    iov[0].iov_len = 4;
+    iov[1].iov_base = body;
+    iov[1].iov_len = 4;
+    iov[2].iov_base = tail;
+    iov[2].iov_len = 4;
+
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL != (skt_server = cplus_socket_new(CPLUS_SOCKET_TYPE_STREAM_LOCAL)));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_socket_bind(skt_server, SERVER_NAME, 0));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_socket_listen(skt_server, 10));
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL != (skt_client = cplus_socket_new(CPLUS_SOCKET_TYPE_STREAM_LOCAL)));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_socket_connect(skt_client, SERVER_NAME, 0));
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL != (skt_remote = cplus_socket_accept(skt_server, CPLUS_INFINITE_TIMEOUT)));
+    UNITTEST_EXPECT_EQ(12, cplus_socket_sendv(skt_client, iov, 3));
+    iov[0].iov_base = rr_head;
+    iov[0].iov_len = sizeof(rr_head);
+    iov[1].iov_base = rr_rest;
+    iov[1].iov_len = 8;
+    UNITTEST_EXPECT_EQ(12, cplus_socket_recvv(skt_remote, iov, 2, 1000));
+    UNITTEST_EXPECT_EQ(0, memcmp(rr_head, "HEAD", 4));
+    UNITTEST_EXPECT_EQ(0, strcmp(rr_rest, "BODYTAIL"));
+    UNITTEST_EXPECT_EQ(CPLUS_FAIL, cplus_socket_recvv(skt_remote, iov, 2, 10));
+    UNITTEST_EXPECT_EQ(ETIMEDOUT, errno);
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_socket_delete(skt_client));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_socket_delete(skt_remote));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_socket_delete(skt_server));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_mgr_report());
+}
+
+CPLUS_UNIT_TEST(cplus_socket_sendv_fd, functionity)
+{
+    cplus_socket skt_server = CPLUS_NULL, skt_client = CPLUS_NULL, skt_remote = CPLUS_NULL;
+    cplus_file test_file = CPLUS_NULL;
+    int32_t recv_fd = INVALID_FD, send_fd = INVALID_FD;
+    char head[] = "HEAD", body[] = "BODY", rr[9] = {0}, rr_file[32] = {0};
+    struct iovec iov[2] = {0};
+    struct msghdr msg = {0};
+    struct cmsghdr * cmptr = CPLUS_NULL;
+    union
+    {
+        struct cmsghdr cm;
+        uint8_t control[CMSG_SPACE(sizeof(int32_t))];
+    } control_un;
+
+    iov[0].iov_base = head;
+    iov[0].iov_len = 4;
+    iov[1].iov_base = body;
+    iov[1].iov_len = 4;
+
+    UNITTEST_EXPECT_EQ(true, (CPLUS_NULL != (test_file = cplus_file_new((char *)(TEST_FILE), CPLUS_FILE_ACCESS_RDWR))));
+    UNITTEST_EXPECT_EQ(strlen(TEST_STR), cplus_file_write(test_file, strlen(TEST_STR), (void *)(TEST_STR)));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_file_reset_pos(test_file));
+    UNITTEST_EXPECT_EQ(true, (INVALID_FD != (send_fd = cplus_file_get_fd(test_file))));
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL != (skt_server = cplus_socket_new(CPLUS_SOCKET_TYPE_STREAM_LOCAL)));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_socket_bind(skt_server, SERVER_NAME, 0));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_socket_listen(skt_server, 10));
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL != (skt_client = cplus_socket_new(CPLUS_SOCKET_TYPE_STREAM_LOCAL)));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_socket_connect(skt_client, SERVER_NAME, 0));
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL != (skt_remote = cplus_socket_accept(skt_server, CPLUS_INFINITE_TIMEOUT)));
+    UNITTEST_EXPECT_EQ(8, cplus_socket_sendv_fd(skt_client, iov, 2, send_fd));
+    iov[0].iov_base = rr;
+    iov[0].iov_len = 8;
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control_un.control;
+    msg.msg_controllen = sizeof(control_un.control);
+    UNITTEST_EXPECT_EQ(8, cplus_socket_recvmsg(skt_remote, &msg, 0, 1000));
+    UNITTEST_EXPECT_EQ(0, strcmp(rr, "HEADBODY"));
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL != (cmptr = CMSG_FIRSTHDR(&msg)));
+    UNITTEST_EXPECT_EQ(SCM_RIGHTS, cmptr->cmsg_type);
+    cplus_mem_cpy(&recv_fd, CMSG_DATA(cmptr), sizeof(int32_t));
+    UNITTEST_EXPECT_EQ(strlen(TEST_STR), read(recv_fd, rr_file, sizeof(rr_file)));
+    UNITTEST_EXPECT_EQ(0, strcmp(TEST_STR, rr_file));
+    close(recv_fd);
+    UNITTEST_EXPECT_EQ(CPLUS_FAIL, cplus_socket_recvmsg(skt_remote, &msg, MSG_DONTWAIT, CPLUS_INFINITE_TIMEOUT));
+    UNITTEST_EXPECT_EQ(EAGAIN, errno);
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_file_delete(test_file));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_file_remove((char *)(TEST_FILE)));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_socket_delete(skt_client));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_socket_delete(skt_remote));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_socket_delete(skt_server));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_mgr_report());
+}
+
 CPLUS_UNIT_TEST(cplus_socket_send_fd, SERVER)
 {
     cplus_socket skt_server = CPLUS_NULL, skt_remote = CPLUS_NULL;
@@ -1114,10 +1450,13 @@ void unittest_socket(void)
 {
     UNITTEST_ADD_TESTCASE(CPLUS_SOCKET_TYPE_DGRAM_LOCAL, functionity);
     UNITTEST_ADD_TESTCASE(CPLUS_SOCKET_TYPE_STREAM_LOCAL, functionity);
+    UNITTEST_ADD_TESTCASE(CPLUS_SOCKET_TYPE_SEQPACKET_LOCAL, functionity);
     UNITTEST_ADD_TESTCASE(CPLUS_SOCKET_TYPE_UDP_IPV4, functionity);
     UNITTEST_ADD_TESTCASE(CPLUS_SOCKET_TYPE_TCP_IPV4, functionity);
     UNITTEST_ADD_TESTCASE(cplus_socket_send_fd, CPLUS_SOCKET_TYPE_STREAM_LOCAL);
     UNITTEST_ADD_TESTCASE(cplus_socket_send_fd, CPLUS_SOCKET_TYPE_DGRAM_LOCAL);
+    UNITTEST_ADD_TESTCASE(cplus_socket_sendv, functionity);
+    UNITTEST_ADD_TESTCASE(cplus_socket_sendv_fd, functionity);
 }
 
 void unittest_socket_server(void)
@@ -0,0 +1,347 @@
+/******************************************************************
+* @file: strand.c
+*
+* @author: Hunter Huang <bill.b750121@gmail.com>
+******************************************************************/
+
+#include <pthread.h>
+#include "common.h"
+#include "cplus_memmgr.h"
+#include "cplus_atomic.h"
+#include "cplus_mutex.h"
+#include "cplus_pevent.h"
+#include "cplus_systime.h"
+#include "cplus_task.h"
+#include "cplus_taskpool.h"
+#include "cplus_strand.h"
+
+#define OBJ_TYPE (OBJ_NONE + SYS + 14)
+#define MAX_TASK_COUNT 4096U
+#define STRAND_BATCH_SIZE 16U
+
+struct strand
+{
+    uint16_t type;
+    cplus_taskpool pool;
+    cplus_mutex access_sect;
+    cplus_pevent evt_idle;
+    bool is_scheduled;
+    uint32_t head;
+    uint32_t count;
+    uint32_t max_task_count;
+    struct cplus_taskpool_task * tasks;
+};
+
+static pthread_once_t once_init = PTHREAD_ONCE_INIT;
+static pthread_key_t key_for_current_strand;
+
+static void cplus_strand_once_init(void)
+{
+    pthread_key_create(&key_for_current_strand, CPLUS_NULL);
+}
+
+int32_t cplus_strand_delete(cplus_strand obj)
+{
+    struct strand * strand = (struct strand *)(obj);
+    CHECK_OBJECT_TYPE(obj);
+
+    if (strand->evt_idle)
+    {
+        /* Let queued tasks finish, the runner still holds the strand until then. */
+        cplus_pevent_wait(strand->evt_idle, CPLUS_INFINITE_TIMEOUT);
+        cplus_pevent_delete(strand->evt_idle);
+    }
+
+    if (strand->access_sect)
+    {
+        cplus_crit_sect_enter(strand->access_sect);
+        cplus_crit_sect_exit(strand->access_sect);
+        cplus_mutex_delete(strand->access_sect);
+    }
+
+    if (strand->tasks)
+    {
+        cplus_free(strand->tasks);
+    }
+
+    cplus_free(strand);
+    return CPLUS_SUCCESS;
+}
+
+static void * strand_initialize_object(cplus_taskpool pool, uint32_t max_task_count)
+{
+    struct strand * strand = CPLUS_NULL;
+
+    if ((strand = (struct strand *)cplus_malloc(sizeof(struct strand))))
+    {
+        CPLUS_INITIALIZE_STRUCT_POINTER(strand);
+        strand->type = OBJ_TYPE;
+        strand->pool = pool;
+        strand->is_scheduled = false;
+        strand->head = 0;
+        strand->count = 0;
+        strand->max_task_count = max_task_count;
+
+        if (CPLUS_NULL == (strand->tasks = (struct cplus_taskpool_task *)cplus_malloc(
+            max_task_count * sizeof(struct cplus_taskpool_task))))
+        {
+            goto exit;
+        }
+
+        if (CPLUS_NULL == (strand->access_sect = cplus_mutex_new()))
+        {
+            goto exit;
+        }
+
+        if (CPLUS_NULL == (strand->evt_idle = cplus_pevent_new(true, true)))
+        {
+            goto exit;
+        }
+    }
+    return strand;
+exit:
+    cplus_strand_delete(strand);
+    return CPLUS_NULL;
+}
+
+cplus_strand cplus_strand_new(cplus_taskpool pool, uint32_t max_task_count)
+{
+    CHECK_IF(false == cplus_taskpool_check(pool), CPLUS_NULL);
+    CHECK_IN_INTERVAL(max_task_count, 1, MAX_TASK_COUNT, CPLUS_NULL);
+
+    pthread_once(&(once_init), cplus_strand_once_init);
+    return strand_initialize_object(pool, max_task_count);
+}
+
+bool cplus_strand_check(cplus_object obj)
+{
+    return (obj && (GET_OBJECT_TYPE(obj) == OBJ_TYPE));
+}
+
+static void strand_runner_proc(void * param1, void * param2);
+
+static int32_t strand_schedule(struct strand * strand)
+{
+    struct cplus_taskpool_task task = {0};
+
+    task.proc = strand_runner_proc;
+    task.param1 = strand;
+    task.param2 = CPLUS_NULL;
+    task.callback = CPLUS_NULL;
+    return cplus_taskpool_add_task_ex(strand->pool, &task);
+}
+
+static void strand_runner_proc(void * param1, void * param2)
+{
+    struct strand * strand = (struct strand *)(param1);
+    struct cplus_taskpool_task task = {0};
+    void * previous = pthread_getspecific(key_for_current_strand);
+    UNUSED_PARAM(param2);
+
+    pthread_setspecific(key_for_current_strand, strand);
+    while (true)
+    {
+        for (uint32_t i = 0; i < STRAND_BATCH_SIZE; i++)
+        {
+            cplus_crit_sect_enter(strand->access_sect);
+            if (0 == strand->count)
+            {
+                strand->is_scheduled = false;
+                cplus_pevent_set(strand->evt_idle);
+                cplus_crit_sect_exit(strand->access_sect);
+                pthread_setspecific(key_for_current_strand, previous);
+                return;
+            }
+            cplus_mem_cpy(&task, &(strand->tasks[strand->head]), sizeof(struct cplus_taskpool_task));
+            strand->head = (strand->head + 1) % strand->max_task_count;
+            strand->count --;
+            cplus_crit_sect_exit(strand->access_sect);
+
+            task.proc(task.param1, task.param2);
+        }
+
+        /* A long queue gives the worker back after each batch, so one busy
+        strand cannot starve the others sharing the pool. */
+        if (CPLUS_SUCCESS == strand_schedule(strand))
+        {
+            break;
+        }
+    }
+    pthread_setspecific(key_for_current_strand, previous);
+}
+
+int32_t cplus_strand_post(
+    cplus_strand obj
+    , CPLUS_TASK_PROC proc
+    , void * param1
+    , void * param2)
+{
+    struct strand * strand = (struct strand *)(obj);
+    struct cplus_taskpool_task * task = CPLUS_NULL;
+    bool need_schedule = false;
+    CHECK_OBJECT_TYPE(obj);
+    CHECK_NOT_NULL(proc, CPLUS_FAIL);
+
+    cplus_crit_sect_enter(strand->access_sect);
+    {
+        if (strand->count >= strand->max_task_count)
+        {
+            cplus_crit_sect_exit(strand->access_sect);
+            errno = ENOMEM;
+            return CPLUS_FAIL;
+        }
+
+        task = &(strand->tasks[(strand->head + strand->count) % strand->max_task_count]);
+        task->proc = proc;
+        task->param1 = param1;
+        task->param2 = param2;
+        task->callback = CPLUS_NULL;
+        strand->count ++;
+
+        if (false == strand->is_scheduled)
+        {
+            strand->is_scheduled = true;
+            cplus_pevent_reset(strand->evt_idle);
+            need_schedule = true;
+        }
+    }
+    cplus_crit_sect_exit(strand->access_sect);
+
+    if (need_schedule AND CPLUS_SUCCESS != strand_schedule(strand))
+    {
+        /* This caller owns the strand now, draining it here keeps both the
+        order and the exclusion although the pool is saturated. */
+        strand_runner_proc(strand, CPLUS_NULL);
+    }
+    return CPLUS_SUCCESS;
+}
+
+uint32_t cplus_strand_get_task_count(cplus_strand obj)
+{
+    uint32_t count = 0;
+    struct strand * strand = (struct strand *)(obj);
+    CHECK_OBJECT_TYPE(obj);
+
+    cplus_crit_sect_enter(strand->access_sect);
+    count = strand->count;
+    cplus_crit_sect_exit(strand->access_sect);
+
+    return count;
+}
+
+int32_t cplus_strand_wait_idle(cplus_strand obj, uint32_t timeout)
+{
+    CHECK_OBJECT_TYPE(obj);
+    return cplus_pevent_wait(((struct strand *)(obj))->evt_idle, timeout);
+}
+
+bool cplus_strand_is_running_in_this_thread(cplus_strand obj)
+{
+    CHECK_OBJECT_TYPE(obj);
+    return (obj == pthread_getspecific(key_for_current_strand));
+}
+
+#ifdef __CPLUS_UNITTEST__
+
+#define STRAND_COUNT 8U
+#define STRAND_TASK_COUNT 200U
+
+struct strand_record
+{
+    cplus_strand strand;
+    uint32_t next_seqn;
+    int32_t in_flight;
+    int32_t violation_count;
+};
+
+static void check_serial_order(void * param1, void * param2)
+{
+    struct strand_record * record = (struct strand_record *)(param1);
+
+    if (1 != cplus_atomic_add(&(record->in_flight), 1)
+        OR (uint32_t)(uintptr_t)(param2) != record->next_seqn
+        OR false == cplus_strand_is_running_in_this_thread(record->strand))
+    {
+        cplus_atomic_add(&(record->violation_count), 1);
+    }
+    record->next_seqn ++;
+    cplus_atomic_add(&(record->in_flight), -1);
+}
+
+CPLUS_UNIT_TEST(cplus_strand_post, functionity)
+{
+    cplus_taskpool pool = CPLUS_NULL;
+    struct strand_record records[STRAND_COUNT];
+
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL != (pool = cplus_taskpool_new(4)));
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL == cplus_strand_new(pool, 0));
+    for (uint32_t i = 0; i < STRAND_COUNT; i++)
+    {
+        cplus_mem_set(&(records[i]), 0x00, sizeof(struct strand_record));
+        UNITTEST_EXPECT_EQ(true, CPLUS_NULL != (records[i].strand = cplus_strand_new(pool, STRAND_TASK_COUNT)));
+        UNITTEST_EXPECT_EQ(false, cplus_strand_is_running_in_this_thread(records[i].strand));
+    }
+
+    for (uint32_t seqn = 0; seqn < STRAND_TASK_COUNT; seqn++)
+    {
+        for (uint32_t i = 0; i < STRAND_COUNT; i++)
+        {
+            UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_strand_post(records[i].strand
+                , check_serial_order, &(records[i]), (void *)(uintptr_t)(seqn)));
+        }
+    }
+
+    for (uint32_t i = 0; i < STRAND_COUNT; i++)
+    {
+        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_strand_wait_idle(records[i].strand, 2000));
+        UNITTEST_EXPECT_EQ(0, cplus_strand_get_task_count(records[i].strand));
+        UNITTEST_EXPECT_EQ(STRAND_TASK_COUNT, records[i].next_seqn);
+        UNITTEST_EXPECT_EQ(0, records[i].violation_count);
+        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_strand_delete(records[i].strand));
+    }
+
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskpool_delete(pool));
+    UNITTEST_EXPECT_EQ(0, cplus_mgr_report());
+}
+
+static void count_task(void * param1, void * param2)
+{
+    UNUSED_PARAM(param2);
+    cplus_atomic_add((int32_t *)(param1), 1);
+}
+
+CPLUS_UNIT_TEST(cplus_strand_post, queue_full)
+{
+    cplus_taskpool pool = CPLUS_NULL;
+    cplus_strand strand = CPLUS_NULL;
+    int32_t count = 0;
+
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL != (pool = cplus_taskpool_new(1)));
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL != (strand = cplus_strand_new(pool, 4)));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskpool_all_pause(pool, true));
+    for (int32_t i = 0; i < 4; i++)
+    {
+        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_strand_post(strand, count_task, &count, CPLUS_NULL));
+    }
+    UNITTEST_EXPECT_EQ(CPLUS_FAIL, cplus_strand_post(strand, count_task, &count, CPLUS_NULL));
+    UNITTEST_EXPECT_EQ(ENOMEM, errno);
+    UNITTEST_EXPECT_EQ(4, cplus_strand_get_task_count(strand));
+    UNITTEST_EXPECT_EQ(1, cplus_taskpool_get_task_count(pool));
+    UNITTEST_EXPECT_EQ(CPLUS_FAIL, cplus_strand_wait_idle(strand, 100));
+
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskpool_all_pause(pool, false));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_strand_wait_idle(strand, 1000));
+    UNITTEST_EXPECT_EQ(4, cplus_atomic_read(&count));
+
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_strand_delete(strand));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskpool_delete(pool));
+    UNITTEST_EXPECT_EQ(0, cplus_mgr_report());
+}
+
+void unittest_strand(void)
+{
+    UNITTEST_ADD_TESTCASE(cplus_strand_post, functionity);
+    UNITTEST_ADD_TESTCASE(cplus_strand_post, queue_full);
+}
+
+#endif // __CPLUS_UNITTEST__
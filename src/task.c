@@ -8,19 +8,56 @@
     #define _GNU_SOURCE
 #endif
 #include <pthread.h>
+#include <sched.h>
 #include <limits.h>
 #include <sys/resource.h>
+#include <sys/prctl.h>
+#include <time.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <unistd.h>
 #include "common.h"
 #include "cplus_memmgr.h"
-#include "cplus_pevent.h"
 #include "cplus_systime.h"
 #include "cplus_atomic.h"
 #include "cplus_task.h"
 
 #define OBJ_TYPE (OBJ_NONE + SYS + 2)
 #define MAX_WAIT_STOP_TIME (60 * 1000)
+#define MAX_WAIT_CANCEL_TIME 100
 #define SUPPORT_NON_PORTABLE 0
+#define MAX_CPU_MASK_BITS 64U
 
+#define TASK_STATE_STARTED 0x01U
+#define TASK_STATE_PAUSED 0x02U
+#define TASK_STATE_STOPPING 0x04U
+#define TASK_STATE_FINISHED 0x08U
+#define TASK_STATE_EXITED 0x10U // the thread is in its cleanup, only a join is left
+#define TASK_STATE_ORPHANED 0x20U // a stop gave up on the thread, it frees the object itself
+
+#define STATS_SUB_BUCKET_BITS 3U
+#define STATS_BUCKET_COUNT (41U << STATS_SUB_BUCKET_BITS)
+
+#define MAX_ONESHOT_CARRIER_COUNT 64U
+#define ONESHOT_CARRIER_IDLE_TIMEOUT (10 * 1000)
+
+/* Log-linear histogram, every power of two is split in 8 linear buckets, so any
+percentile is known within 1/8 of its value from 1 nsec up to about 2 hours. */
+struct task_histogram
+{
+    uint64_t count;
+    uint64_t total_nsec;
+    uint64_t min_nsec;
+    uint64_t max_nsec;
+    uint32_t buckets[STATS_BUCKET_COUNT];
+};
+
+struct task_stats
+{
+    struct task_histogram wall_time;
+    struct task_histogram cpu_time;
+    struct task_histogram wakeup_latency;
+};
 
 struct task
 {
@@ -32,25 +69,251 @@ struct task
     void * param2;
     uint32_t duration;
     volatile bool is_suspended;
-    cplus_pevent evt_start;
-    cplus_pevent evt_stop;
-    cplus_pevent evt_finish;
-    cplus_pevent evt_pause;
+    uint32_t state; // TASK_STATE_*, every transition is a single atomic operation
+    uint32_t waiter_count;
+    uint32_t period_usec;
+    struct
+    {
+        uint64_t iteration_count;
+        uint64_t overrun_count;
+        uint64_t missed_count;
+        uint64_t max_jitter_nsec;
+        uint64_t total_jitter_nsec;
+        uint64_t jitter_count;
+    } period_stats; // only written by the task thread, atomically as readers don't stop it
+    struct task_stats * stats; // only written by the task thread, CPLUS_NULL unless collected
+};
+
+/* A parked thread kept to run one-shot tasks. It lives on the stack of its own
+thread and is only reachable through "oneshot_cache.idle" while it is parked. */
+struct oneshot_carrier
+{
+    pthread_t thread;
+    struct task * task;
+    uint32_t seq;
+    struct oneshot_carrier * next;
 };
 
+static struct
+{
+    pthread_mutex_t lock;
+    struct oneshot_carrier * idle;
+    uint32_t count;
+} oneshot_cache = {PTHREAD_MUTEX_INITIALIZER, CPLUS_NULL, 0};
+
+static inline int32_t task_get_sched_policy(CPLUS_TASK_SCHED_POLICY policy)
+{
+    return (CPLUS_TASK_SCHED_POLICY_FIFO == policy)? SCHED_FIFO: SCHED_RR;
+}
+
 static pthread_once_t once_init = PTHREAD_ONCE_INIT;
 
-static pthread_key_t key_for_evt_finish;
+static pthread_key_t key_for_task;
 static pthread_key_t key_for_duration;
 static pthread_key_t key_for_last_timestamp;
 
 static void cplus_task_once_init(void)
 {
-    pthread_key_create(&key_for_evt_finish, CPLUS_NULL);
+    pthread_key_create(&key_for_task, CPLUS_NULL);
     pthread_key_create(&key_for_duration, CPLUS_NULL);
     pthread_key_create(&key_for_last_timestamp, CPLUS_NULL);
 }
 
+static inline int32_t task_futex_wait(uint32_t * addr, uint32_t expected, const struct timespec * timeout)
+{
+    /* Returns at once when "* addr" is no longer "expected", the callers re-check the
+    state on every return, spurious wake-ups included. */
+    return (int32_t)syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, expected, timeout, CPLUS_NULL, 0);
+}
+
+static inline void task_futex_wake(uint32_t * addr)
+{
+    syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, INT_MAX, CPLUS_NULL, CPLUS_NULL, 0);
+}
+
+static inline void task_msec_to_timespec(struct timespec * ts, uint32_t msec)
+{
+    ts->tv_sec = msec / 1000;
+    ts->tv_nsec = (msec % 1000) * 1000000;
+}
+
+static inline uint64_t task_get_nsec(void)
+{
+    struct timespec ts = {0};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)(ts.tv_sec) * 1000000000ULL) + (uint64_t)(ts.tv_nsec);
+}
+
+static inline uint64_t task_get_thread_cpu_nsec(void)
+{
+    struct timespec ts = {0};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ((uint64_t)(ts.tv_sec) * 1000000000ULL) + (uint64_t)(ts.tv_nsec);
+}
+
+static inline uint32_t task_histogram_get_index(uint64_t nsec)
+{
+    uint32_t msb = 0;
+
+    if (nsec < (1ULL << STATS_SUB_BUCKET_BITS))
+    {
+        return (uint32_t)(nsec);
+    }
+    msb = 63 - __builtin_clzll(nsec);
+    return CPLUS_MIN(((msb - STATS_SUB_BUCKET_BITS + 1) << STATS_SUB_BUCKET_BITS)
+        + (uint32_t)((nsec >> (msb - STATS_SUB_BUCKET_BITS)) & ((1U << STATS_SUB_BUCKET_BITS) - 1))
+        , STATS_BUCKET_COUNT - 1);
+}
+
+static inline uint64_t task_histogram_get_upper_bound(uint32_t index)
+{
+    uint32_t shift = 0, sub = 0;
+
+    if (index < (1U << STATS_SUB_BUCKET_BITS))
+    {
+        return index;
+    }
+    shift = (index >> STATS_SUB_BUCKET_BITS) - 1;
+    sub = index & ((1U << STATS_SUB_BUCKET_BITS) - 1);
+    return ((uint64_t)((1U << STATS_SUB_BUCKET_BITS) + sub + 1) << shift) - 1;
+}
+
+static void task_histogram_add(struct task_histogram * histogram, uint64_t nsec)
+{
+    histogram->min_nsec = (0 == histogram->count)? nsec: CPLUS_MIN(histogram->min_nsec, nsec);
+    histogram->max_nsec = CPLUS_MAX(histogram->max_nsec, nsec);
+    histogram->total_nsec += nsec;
+    histogram->buckets[task_histogram_get_index(nsec)] ++;
+    histogram->count ++;
+}
+
+static void task_histogram_summarize(struct task_histogram * histogram, struct cplus_task_time_stats * stats)
+{
+    uint64_t count = histogram->count, target = 0, seen = 0;
+
+    stats->min_nsec = histogram->min_nsec;
+    stats->max_nsec = histogram->max_nsec;
+    stats->avg_nsec = (0 < count)? (histogram->total_nsec / count): 0;
+    stats->p99_nsec = 0;
+
+    target = ((count * 99) + 99) / 100;
+    for (uint32_t i = 0; 0 < target AND i < STATS_BUCKET_COUNT; i++)
+    {
+        if (target <= (seen += histogram->buckets[i]))
+        {
+            stats->p99_nsec = CPLUS_MIN(task_histogram_get_upper_bound(i), stats->max_nsec);
+            break;
+        }
+    }
+}
+
+static void task_sleep_until(struct task * task, uint64_t deadline)
+{
+    uint32_t state = 0;
+    struct timespec ts = {0};
+
+    ts.tv_sec = deadline / 1000000000ULL;
+    ts.tv_nsec = deadline % 1000000000ULL;
+
+    /* Same as clock_nanosleep(TIMER_ABSTIME) on CLOCK_MONOTONIC, but a stop request
+    changing "task->state" still wakes it. */
+    while (0 == ((state = cplus_atomic_read(&(task->state))) & TASK_STATE_STOPPING)
+        AND task_get_nsec() < deadline)
+    {
+        syscall(SYS_futex, &(task->state), FUTEX_WAIT_BITSET_PRIVATE, state, &ts, CPLUS_NULL, FUTEX_BITSET_MATCH_ANY);
+    }
+}
+
+static void task_wait_next_period(struct task * task, uint64_t * deadline)
+{
+    uint64_t period = (uint64_t)(task->period_usec) * 1000ULL;
+    uint64_t now = task_get_nsec(), missed = 0, jitter = 0;
+
+    cplus_atomic_add(&(task->period_stats.iteration_count), 1);
+    * deadline += period;
+    if (now > (* deadline))
+    {
+        /* Start the late iteration right away, but never burst through the periods
+        which have completely passed, the cadence stays on the original grid. */
+        missed = (now - (* deadline)) / period;
+        cplus_atomic_add(&(task->period_stats.overrun_count), 1);
+        cplus_atomic_add(&(task->period_stats.missed_count), missed);
+        * deadline += missed * period;
+        return;
+    }
+
+    task_sleep_until(task, * deadline);
+    if ((now = task_get_nsec()) > (* deadline))
+    {
+        jitter = now - (* deadline);
+        if (jitter > task->period_stats.max_jitter_nsec)
+        {
+            cplus_atomic_write(&(task->period_stats.max_jitter_nsec), jitter);
+        }
+        cplus_atomic_add(&(task->period_stats.total_jitter_nsec), jitter);
+    }
+    cplus_atomic_add(&(task->period_stats.jitter_count), 1);
+}
+
+static void task_set_state(struct task * task, uint32_t bits)
+{
+    cplus_atomic_or(&(task->state), bits);
+    task_futex_wake(&(task->state));
+}
+
+static inline void task_set_finished(struct task * task)
+{
+    /* The hot path of the loop, only enter the kernel when someone is waiting. Both
+    sides are sequentially consistent, so a waiter registering concurrently either
+    sees the bit or is seen here. */
+    cplus_atomic_or(&(task->state), TASK_STATE_FINISHED);
+    if (0 < cplus_atomic_read(&(task->waiter_count)))
+    {
+        task_futex_wake(&(task->state));
+    }
+}
+
+static int32_t task_wait_state(struct task * task, uint32_t bits, bool consume, uint32_t timeout)
+{
+    int32_t res = CPLUS_FAIL;
+    uint32_t state = 0, start = cplus_systime_get_tick(), elapsed = 0;
+    struct timespec ts = {0};
+
+    cplus_atomic_add(&(task->waiter_count), 1);
+    while (true)
+    {
+        state = cplus_atomic_read(&(task->state));
+        if (state & bits)
+        {
+            uint32_t new_state = state & ~bits;
+            if (false == consume
+                OR cplus_atomic_compare_exchange(&(task->state), &state, &new_state))
+            {
+                res = CPLUS_SUCCESS;
+                break;
+            }
+            continue;
+        }
+
+        if (CPLUS_INFINITE_TIMEOUT == timeout)
+        {
+            task_futex_wait(&(task->state), state, CPLUS_NULL);
+            continue;
+        }
+
+        if (timeout <= (elapsed = cplus_systime_elapsed_tick(start)))
+        {
+            errno = (0 == timeout)? EAGAIN: ETIMEDOUT;
+            break;
+        }
+        task_msec_to_timespec(&ts, timeout - elapsed);
+        task_futex_wait(&(task->state), state, &ts);
+    }
+    cplus_atomic_add(&(task->waiter_count), -1);
+
+    return res;
+}
+
 uint32_t cplus_task_get_loop_last_timestamp(void)
 {
     int32_t * ptr = CPLUS_NULL;
@@ -63,28 +326,26 @@ uint32_t cplus_task_get_loop_last_timestamp(void)
 
 int32_t cplus_task_set_loop_finish(void)
 {
-    uint32_t res = CPLUS_SUCCESS;
-    cplus_task evet_finish = CPLUS_NULL;
+    struct task * task = CPLUS_NULL;
 
-    if ((evet_finish = (cplus_task)pthread_getspecific(key_for_evt_finish)))
+    if ((task = (struct task *)pthread_getspecific(key_for_task)))
     {
-        res = cplus_pevent_set(evet_finish);
+        task_set_finished(task);
     }
 
-    return res;
+    return CPLUS_SUCCESS;
 }
 
 int32_t cplus_task_reset_loop_finish(void)
 {
-    uint32_t res = CPLUS_SUCCESS;
-    cplus_task evet_finish = CPLUS_NULL;
+    struct task * task = CPLUS_NULL;
 
-    if ((evet_finish = (cplus_task)pthread_getspecific(key_for_evt_finish)))
+    if ((task = (struct task *)pthread_getspecific(key_for_task)))
     {
-        res = cplus_pevent_reset(evet_finish);
+        cplus_atomic_and(&(task->state), ~TASK_STATE_FINISHED);
     }
 
-    return res;
+    return CPLUS_SUCCESS;
 }
 
 int32_t cplus_task_set_loop_duration(uint32_t duration)
@@ -132,13 +393,13 @@ uint32_t cplus_task_get_duration(cplus_task obj)
 int32_t cplus_task_wait_start(cplus_task obj, uint32_t timeout)
 {
     CHECK_OBJECT_TYPE(obj);
-    return cplus_pevent_wait(((struct task *)(obj))->evt_start, timeout);
+    return task_wait_state((struct task *)(obj), TASK_STATE_STARTED, false, timeout);
 }
 
 int32_t cplus_task_wait_finish(cplus_task obj, uint32_t timeout)
 {
     CHECK_OBJECT_TYPE(obj);
-    return cplus_pevent_wait(((struct task *)(obj))->evt_finish, timeout);
+    return task_wait_state((struct task *)(obj), TASK_STATE_FINISHED, true, timeout);
 }
 
 int32_t cplus_task_start(cplus_task obj, uint32_t delay)
@@ -146,7 +407,8 @@ int32_t cplus_task_start(cplus_task obj, uint32_t delay)
     CHECK_OBJECT_TYPE(obj);
 
     cplus_systime_sleep_msec(delay);
-    return cplus_pevent_set(((struct task *)(obj))->evt_start);
+    task_set_state((struct task *)(obj), TASK_STATE_STARTED);
+    return CPLUS_SUCCESS;
 }
 
 int32_t cplus_task_delete(cplus_task obj)
@@ -154,30 +416,37 @@ int32_t cplus_task_delete(cplus_task obj)
     struct task * task = (struct task *)(obj);
     CHECK_OBJECT_TYPE(obj);
 
-    if (task->evt_start)
-    {
-        cplus_pevent_delete(task->evt_start);
-    }
-    if (task->evt_stop)
-    {
-        cplus_pevent_delete(task->evt_stop);
-    }
-    if (task->evt_finish)
-    {
-        cplus_pevent_delete(task->evt_finish);
-    }
-    if (task->evt_pause)
+    if (task->stats)
     {
-        cplus_pevent_delete(task->evt_pause);
+        cplus_free(task->stats);
     }
     cplus_free(task);
 
     return CPLUS_SUCCESS;
 }
 
+static bool task_cancel(struct task * task)
+{
+    pthread_t thread = task->thread;
+
+    /* Most threads leave at once from a cancellation point. One which keeps
+    running owns the object from now on, freeing it here would pull it from
+    under the thread. */
+    pthread_cancel(thread);
+    if (CPLUS_SUCCESS == task_wait_state(task, TASK_STATE_EXITED, false, MAX_WAIT_CANCEL_TIME)
+        OR (TASK_STATE_EXITED & cplus_atomic_fetch_or(&(task->state), TASK_STATE_ORPHANED)))
+    {
+        pthread_join(thread, CPLUS_NULL);
+        return true;
+    }
+    pthread_detach(thread);
+    return false;
+}
+
 int32_t cplus_task_stop(cplus_task obj, uint32_t timeout)
 {
     int32_t res = CPLUS_FAIL;
+    bool is_owned = true;
     struct task * task = (struct task *)(obj);
     uint32_t tout = (CPLUS_INFINITE_TIMEOUT == timeout)? MAX_WAIT_STOP_TIME: timeout;
     CHECK_OBJECT_TYPE(obj);
@@ -185,11 +454,8 @@ int32_t cplus_task_stop(cplus_task obj, uint32_t timeout)
     if (0 != task->thread
         AND CPLUS_INFINITE_TIMEOUT != task->duration)
     {
-        cplus_pevent_set(task->evt_stop);
-        if (false == cplus_pevent_get_status(task->evt_start))
-        {
-            cplus_pevent_set(task->evt_start);
-        }
+        /* A task never started leaves its start wait on the stopping bit as well. */
+        task_set_state(task, TASK_STATE_STOPPING);
 #if SUPPORT_NON_PORTABLE
         if (0 == timeout)
         {
@@ -204,18 +470,15 @@ int32_t cplus_task_stop(cplus_task obj, uint32_t timeout)
 
         if (0 != res)
         {
+            is_owned = task_cancel(task);
             errno = res;
-            if (0 != (res = pthread_cancel(task->thread)))
-            {
-                errno = res;
-            }
             res = CPLUS_FAIL;
         }
 #else
-        res = cplus_pevent_wait(task->evt_finish, tout);
+        res = task_wait_state(task, TASK_STATE_FINISHED, true, tout);
         if (CPLUS_FAIL == res)
         {
-            pthread_cancel(task->thread);
+            is_owned = task_cancel(task);
             errno = (0 == tout)? EBUSY: ETIMEDOUT;
         }
         else
@@ -223,7 +486,10 @@ int32_t cplus_task_stop(cplus_task obj, uint32_t timeout)
             pthread_join(task->thread, CPLUS_NULL);
         }
 #endif // SUPPORT_NON_PORTABLE
-        cplus_task_delete(task);
+        if (is_owned)
+        {
+            cplus_task_delete(task);
+        }
         return res;
     }
 
@@ -234,61 +500,235 @@ int32_t cplus_task_pause(cplus_task obj, bool pause)
 {
     CHECK_OBJECT_TYPE(obj);
 
-    if (pause ^ !(cplus_pevent_get_status(((struct task *)(obj))->evt_pause)))
+    if (pause)
+    {
+        /* The loop notices it before the next iteration, no need to wake it. */
+        cplus_atomic_or(&(((struct task *)(obj))->state), TASK_STATE_PAUSED);
+    }
+    else
     {
-        return (pause)? cplus_pevent_reset(((struct task *)(obj))->evt_pause)
-            : cplus_pevent_set(((struct task *)(obj))->evt_pause);
+        cplus_atomic_and(&(((struct task *)(obj))->state), ~TASK_STATE_PAUSED);
+        task_futex_wake(&(((struct task *)(obj))->state));
     }
     return CPLUS_SUCCESS;
 }
 
+static void task_release_oneshot(struct task * task)
+{
+    if (task->callkback)
+    {
+        task->callkback(task->param1, task->param2);
+    }
+
+    /* Let a cplus_task_wait_finish() woken by the last iteration leave the object. */
+    while (0 < cplus_atomic_read(&(task->waiter_count)))
+    {
+        sched_yield();
+    }
+    cplus_task_delete(task);
+}
+
 void cancel_in_routine(void * param)
 {
     struct task * task = (struct task *)(param);
 
     if (CPLUS_INFINITE_TIMEOUT == task->duration)
     {
-        if (task->callkback)
+        task_release_oneshot(task);
+        return;
+    }
+
+    if (TASK_STATE_ORPHANED & cplus_atomic_fetch_or(&(task->state), TASK_STATE_EXITED))
+    {
+        cplus_task_delete(task);
+        return;
+    }
+    task_futex_wake(&(task->state));
+}
+
+static void * task_oneshot_carrier(void * param)
+{
+    struct oneshot_carrier carrier = {0};
+    struct task * task = (struct task *)(param);
+    uint32_t last_timestamp = 0, seq = 0;
+    struct timespec ts = {0};
+
+    pthread_once(&(once_init), cplus_task_once_init);
+    carrier.thread = pthread_self();
+    task_msec_to_timespec(&ts, ONESHOT_CARRIER_IDLE_TIMEOUT);
+
+    while (task)
+    {
+        task->thread = carrier.thread;
+        (void)pthread_setspecific(key_for_task, task);
+        (void)pthread_setspecific(key_for_duration, &task->duration);
+        (void)pthread_setspecific(key_for_last_timestamp, &(last_timestamp));
+
+        last_timestamp = cplus_systime_get_tick();
+        task->proc(task->param1, task->param2);
+        task_set_finished(task);
+        task_release_oneshot(task);
+
+        (void)pthread_setspecific(key_for_task, CPLUS_NULL);
+        (void)pthread_setspecific(key_for_duration, CPLUS_NULL);
+        (void)pthread_setspecific(key_for_last_timestamp, CPLUS_NULL);
+
+        pthread_mutex_lock(&(oneshot_cache.lock));
+        carrier.task = CPLUS_NULL;
+        carrier.next = oneshot_cache.idle;
+        oneshot_cache.idle = &carrier;
+        seq = carrier.seq;
+        pthread_mutex_unlock(&(oneshot_cache.lock));
+
+        while (CPLUS_NULL == (task = (struct task *)cplus_atomic_read_ptr((void **)&(carrier.task))))
         {
-            task->callkback(task->param1, task->param2);
+            if (0 != task_futex_wait(&(carrier.seq), seq, &ts) AND ETIMEDOUT == errno)
+            {
+                /* Idle for too long, retire unless a task was handed over meanwhile. */
+                pthread_mutex_lock(&(oneshot_cache.lock));
+                if (CPLUS_NULL == (task = carrier.task))
+                {
+                    struct oneshot_carrier ** link = &(oneshot_cache.idle);
+                    while (* link != &carrier)
+                    {
+                        link = &((* link)->next);
+                    }
+                    * link = carrier.next;
+                    oneshot_cache.count --;
+                }
+                pthread_mutex_unlock(&(oneshot_cache.lock));
+                break;
+            }
+            seq = cplus_atomic_read(&(carrier.seq));
         }
+    }
+    return CPLUS_NULL;
+}
 
-        cplus_task_delete(task);
+static int32_t task_oneshot_dispatch(struct task * task)
+{
+    int32_t res = 0;
+    pthread_t thread;
+    pthread_attr_t thread_attr;
+    struct oneshot_carrier * carrier = CPLUS_NULL;
+    bool spawn = false;
+
+    pthread_mutex_lock(&(oneshot_cache.lock));
+    if ((carrier = oneshot_cache.idle))
+    {
+        oneshot_cache.idle = carrier->next;
+        task->thread = carrier->thread;
+        cplus_atomic_write_ptr((void **)&(carrier->task), task);
+        cplus_atomic_add(&(carrier->seq), 1);
     }
-    return;
+    else if (MAX_ONESHOT_CARRIER_COUNT > oneshot_cache.count)
+    {
+        oneshot_cache.count ++;
+        spawn = true;
+    }
+    pthread_mutex_unlock(&(oneshot_cache.lock));
+
+    if (carrier)
+    {
+        task_futex_wake(&(carrier->seq));
+        return CPLUS_SUCCESS;
+    }
+
+    if (spawn)
+    {
+        if (0 == (res = pthread_attr_init(&thread_attr)))
+        {
+            pthread_attr_setdetachstate(&thread_attr, PTHREAD_CREATE_DETACHED);
+            res = pthread_create(&thread, &thread_attr, task_oneshot_carrier, task);
+            pthread_attr_destroy(&thread_attr);
+        }
+
+        if (0 == res)
+        {
+            return CPLUS_SUCCESS;
+        }
+
+        pthread_mutex_lock(&(oneshot_cache.lock));
+        oneshot_cache.count --;
+        pthread_mutex_unlock(&(oneshot_cache.lock));
+    }
+    return CPLUS_FAIL;
 }
 
 void * task_executor(void * param)
 {
     struct task * task = (struct task *)(param);
-    uint32_t last_timestamp = 0, duration = 0;
+    uint32_t last_timestamp = 0, duration = 0, state = 0;
+    uint64_t deadline = 0, scheduled_nsec = 0, start_nsec = 0, start_cpu_nsec = 0;
 
     pthread_once(&(once_init), cplus_task_once_init);
-    (void)pthread_setspecific(key_for_evt_finish, task->evt_finish);
+    (void)pthread_setspecific(key_for_task, task);
     (void)pthread_setspecific(key_for_duration, &task->duration);
+    (void)pthread_setspecific(key_for_last_timestamp, &(last_timestamp));
     pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, CPLUS_NULL);
     pthread_cleanup_push(cancel_in_routine, task);
 
-    int32_t start_working = cplus_pevent_wait(
-        task->evt_start
-        , CPLUS_INFINITE_TIMEOUT);
+    if (CPLUS_INFINITE_TIMEOUT == task->duration)
+    {
+        task->thread = pthread_self();
+    }
+
+    if (0 != task->period_usec)
+    {
+        /* The default 50 usec timer slack would show up as jitter of every wake-up. */
+        prctl(PR_SET_TIMERSLACK, 1UL, 0UL, 0UL, 0UL);
+    }
 
-    /*  Reason for False Positive : There is no double_unlock because "task->evt_stop->ptr_mutex"
-        must be locked, and if it is not locked, will not call to unlock */
-    /* coverity[double_unlock: FALSE] */
-    while((0 == start_working)
-        AND ((CPLUS_FAIL == cplus_pevent_wait(task->evt_stop, 0)) AND (EAGAIN == errno))
-        AND (cplus_pevent_get_status(task->evt_pause)
-            OR (CPLUS_SUCCESS == cplus_pevent_wait(task->evt_pause, CPLUS_INFINITE_TIMEOUT))))
+    while (0 == ((state = cplus_atomic_read(&(task->state))) & (TASK_STATE_STARTED | TASK_STATE_STOPPING)))
     {
+        task_futex_wait(&(task->state), state, CPLUS_NULL);
+    }
+
+    /* Run, pause and stop all live in "task->state", an iteration costs a few atomic
+    operations and the kernel is only entered to sleep or to wake a waiter. */
+    while (0 == ((state = cplus_atomic_read(&(task->state))) & TASK_STATE_STOPPING))
+    {
+        if (state & TASK_STATE_PAUSED)
+        {
+            task_futex_wait(&(task->state), state, CPLUS_NULL);
+            deadline = 0; // the periods spent paused are not missed ones
+            scheduled_nsec = 0;
+            continue;
+        }
         pthread_testcancel();
 
         last_timestamp = cplus_systime_get_tick();
-        (void)pthread_setspecific(key_for_last_timestamp, &(last_timestamp));
+        if (0 != task->period_usec)
+        {
+            scheduled_nsec = deadline = (0 == deadline)? task_get_nsec(): deadline;
+        }
 
-        cplus_pevent_reset(task->evt_finish);
+        if (task->stats)
+        {
+            start_nsec = task_get_nsec();
+            start_cpu_nsec = task_get_thread_cpu_nsec();
+            if (0 != scheduled_nsec)
+            {
+                task_histogram_add(&(task->stats->wakeup_latency)
+                    , (start_nsec > scheduled_nsec)? (start_nsec - scheduled_nsec): 0);
+            }
+        }
+
+        cplus_atomic_and(&(task->state), ~TASK_STATE_FINISHED);
         task->proc(task->param1, task->param2);
-        cplus_pevent_set(task->evt_finish);
+        task_set_finished(task);
+
+        if (task->stats)
+        {
+            task_histogram_add(&(task->stats->cpu_time), task_get_thread_cpu_nsec() - start_cpu_nsec);
+            task_histogram_add(&(task->stats->wall_time), task_get_nsec() - start_nsec);
+        }
+
+        if (0 != task->period_usec)
+        {
+            task_wait_next_period(task, &deadline);
+            continue;
+        }
 
         if (CPLUS_INFINITE_TIMEOUT == (duration = cplus_atomic_read(&task->duration)))
         {
@@ -296,25 +736,72 @@ void * task_executor(void * param)
         }
 
         uint32_t diff_timestamp = cplus_systime_elapsed_tick(last_timestamp);
-        if (duration > diff_timestamp)
+        uint32_t sleep_msec = (duration > diff_timestamp)? (duration - diff_timestamp): 1;
+        uint32_t sleep_start = cplus_systime_get_tick(), elapsed = 0;
+        struct timespec ts = {0};
+
+        if (task->stats)
         {
-            cplus_pevent_wait(task->evt_stop, duration - diff_timestamp);
+            scheduled_nsec = task_get_nsec() + ((uint64_t)(sleep_msec) * 1000000ULL);
         }
-        else
+
+        /* Sleep out the rest of the period, only a stop request cuts it short. */
+        while (0 == ((state = cplus_atomic_read(&(task->state))) & TASK_STATE_STOPPING)
+            AND sleep_msec > (elapsed = cplus_systime_elapsed_tick(sleep_start)))
         {
-            cplus_systime_sleep_msec(1);
+            task_msec_to_timespec(&ts, sleep_msec - elapsed);
+            task_futex_wait(&(task->state), state, &ts);
         }
     }
-    cplus_pevent_set(task->evt_finish);
+    task_set_state(task, TASK_STATE_FINISHED);
 
     pthread_exit(0);
     pthread_cleanup_pop(0);
 }
 
-static void * task_initialize_object(CPLUS_TASK_CONFIG config)
+static int32_t task_setup_attr(pthread_attr_t * attr, CPLUS_TASK_CONFIG config)
 {
     int32_t res = 0;
-    pthread_attr_t * attr = CPLUS_NULL;
+
+    if (0 < config->stacksize)
+    {
+        pthread_attr_setstacksize(attr, config->stacksize);
+    }
+
+    if (0 != config->cpu_mask)
+    {
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        for (uint32_t cpu = 0; cpu < MAX_CPU_MASK_BITS; cpu++)
+        {
+            if (config->cpu_mask & (1ULL << cpu))
+            {
+                CPU_SET(cpu, &cpu_set);
+            }
+        }
+        if (0 != (res = pthread_attr_setaffinity_np(attr, sizeof(cpu_set), &cpu_set)))
+        {
+            return res;
+        }
+    }
+
+    if (CPLUS_TASK_SCHED_POLICY_DEFAULT != config->sched_policy)
+    {
+        struct sched_param param = {0};
+        param.sched_priority = config->sched_priority;
+
+        if (0 != (res = pthread_attr_setinheritsched(attr, PTHREAD_EXPLICIT_SCHED))
+            OR 0 != (res = pthread_attr_setschedpolicy(attr, task_get_sched_policy(config->sched_policy)))
+            OR 0 != (res = pthread_attr_setschedparam(attr, &param)))
+        {
+            return res;
+        }
+    }
+    return 0;
+}
+
+static struct task * task_new_object(CPLUS_TASK_CONFIG config)
+{
     struct task * task = CPLUS_NULL;
 
     if ((task = (struct task *)cplus_malloc(sizeof(struct task))))
@@ -328,42 +815,49 @@ static void * task_initialize_object(CPLUS_TASK_CONFIG config)
         task->param2 = config->param2;
         task->duration = config->duration;
         task->is_suspended = config->suspend;
+        task->state = (task->is_suspended)? 0: TASK_STATE_STARTED;
+        task->waiter_count = 0;
+        task->period_usec = config->period_usec;
 
-        if (CPLUS_NULL == (task->evt_start = cplus_pevent_new(
-            true, !task->is_suspended)))
-        {
-            goto exit;
-        }
-        if (CPLUS_NULL == (task->evt_stop = cplus_pevent_new(true, false)))
-        {
-            goto exit;
-        }
-        if (CPLUS_NULL == (task->evt_finish = cplus_pevent_new(false, false)))
+        if (config->collect_stats)
         {
-            goto exit;
-        }
-        if (CPLUS_NULL == (task->evt_pause = cplus_pevent_new(true, true)))
-        {
-            goto exit;
+            if (CPLUS_NULL == (task->stats = (struct task_stats *)cplus_malloc(sizeof(struct task_stats))))
+            {
+                cplus_task_delete(task);
+                return CPLUS_NULL;
+            }
+            CPLUS_INITIALIZE_STRUCT_POINTER(task->stats);
         }
+    }
+    return task;
+}
 
-        pthread_attr_t attr_stacksize = {0};
-        if (0 < config->stacksize)
+static void * task_initialize_object(CPLUS_TASK_CONFIG config)
+{
+    int32_t res = 0;
+    pthread_attr_t * attr = CPLUS_NULL;
+    pthread_t thread = 0;
+    struct task * task = CPLUS_NULL;
+
+    if ((task = task_new_object(config)))
+    {
+        pthread_attr_t thread_attr;
+        if (0 != (res = pthread_attr_init(&thread_attr)))
         {
-            if (0 == pthread_attr_init(&attr_stacksize))
-            {
-                if (0 == pthread_attr_setstacksize(&attr_stacksize, config->stacksize))
-                {
-                    attr = &attr_stacksize;
-                }
-            }
+            errno = res;
+            goto exit;
         }
-        res = pthread_create(&task->thread, attr, task_executor, task);
+        attr = &thread_attr;
 
-        if (attr)
+        /* A one-shot frees itself when done, it may be gone before pthread_create()
+        returns, so it starts detached and the object is left alone afterwards. */
+        if (0 == (res = task_setup_attr(attr, config))
+            AND (CPLUS_INFINITE_TIMEOUT != config->duration
+                OR 0 == (res = pthread_attr_setdetachstate(attr, PTHREAD_CREATE_DETACHED))))
         {
-            pthread_attr_destroy(attr);
+            res = pthread_create(&thread, attr, task_executor, task);
         }
+        pthread_attr_destroy(attr);
 
         if (0 != res)
         {
@@ -371,9 +865,9 @@ static void * task_initialize_object(CPLUS_TASK_CONFIG config)
             goto exit;
         }
 
-        if (CPLUS_INFINITE_TIMEOUT == config->duration)
+        if (CPLUS_INFINITE_TIMEOUT != config->duration)
         {
-            pthread_detach(task->thread);
+            task->thread = thread;
         }
     }
     return task;
@@ -382,6 +876,23 @@ exit:
     return CPLUS_NULL;
 }
 
+static void * task_oneshot_initialize_object(CPLUS_TASK_CONFIG config)
+{
+    struct task * task = CPLUS_NULL;
+
+    /* One-shot tasks run on cached threads, a dedicated thread is only created
+    when every cached one is busy. */
+    if ((task = task_new_object(config)))
+    {
+        if (CPLUS_SUCCESS == task_oneshot_dispatch(task))
+        {
+            return task;
+        }
+        cplus_task_delete(task);
+    }
+    return task_initialize_object(config);
+}
+
 bool cplus_task_check(cplus_object obj)
 {
     return (obj && (GET_OBJECT_TYPE(obj) == OBJ_TYPE));
@@ -402,7 +913,7 @@ cplus_task cplus_task_oneshot(
     config.duration = CPLUS_INFINITE_TIMEOUT;
     config.suspend = false;
     config.stacksize = 0;
-    return task_initialize_object(&config);
+    return task_oneshot_initialize_object(&config);
 }
 
 cplus_task cplus_task_oneshot_ex(
@@ -421,7 +932,7 @@ cplus_task cplus_task_oneshot_ex(
     config.duration = CPLUS_INFINITE_TIMEOUT;
     config.suspend = false;
     config.stacksize = 0;
-    return task_initialize_object(&config);
+    return task_oneshot_initialize_object(&config);
 }
 
 cplus_task cplus_task_new(
@@ -456,9 +967,63 @@ cplus_task cplus_task_new_ex(CPLUS_TASK_CONFIG config)
         CHECK_IN_INTERVAL(config->stacksize, PTHREAD_STACK_MIN, rlim.rlim_cur, CPLUS_NULL);
     }
 
+    CHECK_IF(0 != config->period_usec AND CPLUS_INFINITE_TIMEOUT == config->duration, CPLUS_NULL);
+    CHECK_IN_INTERVAL(config->sched_policy, CPLUS_TASK_SCHED_POLICY_DEFAULT
+        , CPLUS_TASK_SCHED_POLICY_MAX - 1, CPLUS_NULL);
+    if (CPLUS_TASK_SCHED_POLICY_DEFAULT != config->sched_policy)
+    {
+        int32_t policy = task_get_sched_policy(config->sched_policy);
+        CHECK_IN_INTERVAL(config->sched_priority, sched_get_priority_min(policy)
+            , sched_get_priority_max(policy), CPLUS_NULL);
+    }
+
     return task_initialize_object(config);
 }
 
+int32_t cplus_task_get_period_stats(cplus_task obj, struct cplus_task_period_stats * stats)
+{
+    struct task * task = (struct task *)(obj);
+    CHECK_OBJECT_TYPE(obj);
+    CHECK_NOT_NULL(stats, CPLUS_FAIL);
+    CHECK_IF(0 == task->period_usec, CPLUS_FAIL);
+
+    /* Read while the task thread keeps updating, each figure is consistent on its own. */
+    uint64_t jitter_count = cplus_atomic_read(&(task->period_stats.jitter_count));
+    stats->iteration_count = cplus_atomic_read(&(task->period_stats.iteration_count));
+    stats->overrun_count = cplus_atomic_read(&(task->period_stats.overrun_count));
+    stats->missed_count = cplus_atomic_read(&(task->period_stats.missed_count));
+    stats->max_jitter_nsec = cplus_atomic_read(&(task->period_stats.max_jitter_nsec));
+    stats->avg_jitter_nsec = (0 < jitter_count)
+        ? (cplus_atomic_read(&(task->period_stats.total_jitter_nsec)) / jitter_count): 0;
+    return CPLUS_SUCCESS;
+}
+
+int32_t cplus_task_get_stats(cplus_task obj, struct cplus_task_stats * stats)
+{
+    struct task * task = (struct task *)(obj);
+    struct task_histogram histogram;
+    CHECK_OBJECT_TYPE(obj);
+    CHECK_NOT_NULL(stats, CPLUS_FAIL);
+    CHECK_NOT_NULL(task->stats, CPLUS_FAIL);
+
+    /* A snapshot taken while the task keeps running, the histograms may differ by the
+    iteration in progress. */
+    CPLUS_INITIALIZE_STRUCT_POINTER(stats);
+    cplus_mem_cpy(&histogram, &(task->stats->wall_time), sizeof(struct task_histogram));
+    stats->iteration_count = histogram.count;
+    stats->total_wall_nsec = histogram.total_nsec;
+    task_histogram_summarize(&histogram, &(stats->wall_time));
+
+    cplus_mem_cpy(&histogram, &(task->stats->cpu_time), sizeof(struct task_histogram));
+    stats->total_cpu_nsec = histogram.total_nsec;
+    task_histogram_summarize(&histogram, &(stats->cpu_time));
+
+    cplus_mem_cpy(&histogram, &(task->stats->wakeup_latency), sizeof(struct task_histogram));
+    task_histogram_summarize(&histogram, &(stats->wakeup_latency));
+
+    return CPLUS_SUCCESS;
+}
+
 uintptr_t cplus_task_get_self_id(void)
 {
 	return pthread_self();
@@ -688,6 +1253,255 @@ CPLUS_UNIT_TEST(cplus_task_pause, functionity)
     UNITTEST_EXPECT_EQ(0, cplus_mgr_report());
 }
 
+static void record_affinity(void * param1, void * param2)
+{
+    cpu_set_t cpu_set;
+    UNUSED_PARAM(param2);
+
+    CPU_ZERO(&cpu_set);
+    pthread_getaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+    (* (int32_t *)(param1)) = CPU_COUNT(&cpu_set) * 100 + sched_getcpu();
+    cplus_task_set_loop_finish();
+}
+
+CPLUS_UNIT_TEST(cplus_task_new_ex, affinity_and_sched_policy)
+{
+    cplus_task task = CPLUS_NULL;
+    CPLUS_TASK_CONFIG_T config = {0};
+    int32_t affinity = -1;
+
+    config.proc = record_affinity;
+    config.param1 = &affinity;
+    config.duration = 100;
+    config.suspend = false;
+    config.cpu_mask = 0x01;
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL != (task = cplus_task_new_ex(&config)));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_task_wait_finish(task, 1000));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_task_stop(task, CPLUS_INFINITE_TIMEOUT));
+    UNITTEST_EXPECT_EQ(100, affinity);
+
+    config.sched_policy = CPLUS_TASK_SCHED_POLICY_MAX;
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL == cplus_task_new_ex(&config));
+    config.sched_policy = CPLUS_TASK_SCHED_POLICY_FIFO;
+    config.sched_priority = sched_get_priority_max(SCHED_FIFO) + 1;
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL == cplus_task_new_ex(&config));
+
+    config.sched_priority = sched_get_priority_min(SCHED_FIFO);
+    if ((task = cplus_task_new_ex(&config)))
+    {
+        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_task_wait_finish(task, 1000));
+        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_task_stop(task, CPLUS_INFINITE_TIMEOUT));
+    }
+    else
+    {
+        // Real-time policies need CAP_SYS_NICE.
+        UNITTEST_EXPECT_EQ(EPERM, errno);
+    }
+    UNITTEST_EXPECT_EQ(0, cplus_mgr_report());
+}
+
+static void count_loop_proc(void * param1, void * param2)
+{
+    UNUSED_PARAM(param2);
+    cplus_atomic_add((int32_t *)(param1), 1);
+}
+
+CPLUS_UNIT_TEST(cplus_task_new, short_period)
+{
+    cplus_task task = CPLUS_NULL;
+    int32_t count = 0, paused_count = 0;
+
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL != (task = cplus_task_new(count_loop_proc, &count, CPLUS_NULL, 1)));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_task_start(task, 0));
+    for (int32_t i = 0; i < 100 AND 20 > cplus_atomic_read(&count); i++)
+    {
+        cplus_systime_sleep_msec(10);
+    }
+    UNITTEST_EXPECT_EQ(true, (cplus_atomic_read(&count) >= 20));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_task_wait_finish(task, 100));
+
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_task_pause(task, true));
+    cplus_systime_sleep_msec(10);
+    paused_count = cplus_atomic_read(&count);
+    cplus_systime_sleep_msec(100);
+    UNITTEST_EXPECT_EQ(paused_count, cplus_atomic_read(&count));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_task_pause(task, false));
+    for (int32_t i = 0; i < 100 AND paused_count == cplus_atomic_read(&count); i++)
+    {
+        cplus_systime_sleep_msec(10);
+    }
+    UNITTEST_EXPECT_EQ(true, (cplus_atomic_read(&count) > paused_count));
+
+    /* A stop request cuts the sleep between two iterations short, otherwise
+    the join would time out long before the minute is over. */
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_task_set_duration(task, 60 * 1000));
+    cplus_systime_sleep_msec(10);
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_task_stop(task, 5000));
+    UNITTEST_EXPECT_EQ(0, cplus_mgr_report());
+}
+
+static int32_t run_oneshots(bool cached, int32_t round)
+{
+    CPLUS_TASK_CONFIG_T config = {0};
+    int32_t count = 0;
+
+    config.proc = count_loop_proc;
+    config.param1 = &count;
+    config.duration = CPLUS_INFINITE_TIMEOUT;
+    for (int32_t i = 0; i < round; i++)
+    {
+        if (CPLUS_NULL == ((cached)? task_oneshot_initialize_object(&config): task_initialize_object(&config)))
+        {
+            break;
+        }
+        /* One at a time, so a cached carrier is parked again before the next. */
+        for (int32_t j = 0; j < 1000 AND (i + 1) != cplus_atomic_read(&count); j++)
+        {
+            cplus_systime_sleep_msec(1);
+        }
+    }
+    return cplus_atomic_read(&count);
+}
+
+static void record_self_id(void * param1, void * param2)
+{
+    UNUSED_PARAM(param2);
+    cplus_atomic_write((uintptr_t *)(param1), cplus_task_get_self_id());
+}
+
+static bool is_carrier_parked(uintptr_t id)
+{
+    bool is_parked = false;
+
+    pthread_mutex_lock(&(oneshot_cache.lock));
+    is_parked = (oneshot_cache.idle AND id == (uintptr_t)(oneshot_cache.idle->thread));
+    pthread_mutex_unlock(&(oneshot_cache.lock));
+    return is_parked;
+}
+
+CPLUS_UNIT_TEST(cplus_task_oneshot, carrier_reuse)
+{
+    uintptr_t first_id = 0, second_id = 0;
+
+    UNITTEST_EXPECT_EQ(200, run_oneshots(false, 200));
+    UNITTEST_EXPECT_EQ(200, run_oneshots(true, 200));
+
+    /* A parked carrier is reused by the next one-shot. */
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL != cplus_task_oneshot(record_self_id, &first_id, CPLUS_NULL));
+    for (int32_t i = 0; i < 100 AND false == is_carrier_parked(cplus_atomic_read(&first_id)); i++)
+    {
+        cplus_systime_sleep_msec(10);
+    }
+    UNITTEST_EXPECT_EQ(true, (0 != first_id));
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL != cplus_task_oneshot(record_self_id, &second_id, CPLUS_NULL));
+    for (int32_t i = 0; i < 100 AND 0 == cplus_atomic_read(&second_id); i++)
+    {
+        cplus_systime_sleep_msec(10);
+    }
+    UNITTEST_EXPECT_EQ(first_id, second_id);
+    UNITTEST_EXPECT_EQ(0, cplus_mgr_report());
+}
+
+static void period_proc(void * param1, void * param2)
+{
+    int32_t * count = (int32_t *)param1;
+    UNUSED_PARAM(param2);
+
+    /* Overrun twice by sleeping across more than two periods. */
+    if (10 == cplus_atomic_add(count, 1) OR 20 == cplus_atomic_read(count))
+    {
+        cplus_systime_sleep_msec(17);
+    }
+}
+
+CPLUS_UNIT_TEST(cplus_task_new_ex, period_usec)
+{
+    cplus_task task = CPLUS_NULL;
+    CPLUS_TASK_CONFIG_T config = {0};
+    CPLUS_TASK_PERIOD_STATS_T stats = {0};
+    int32_t count = 0;
+
+    config.proc = period_proc;
+    config.param1 = &count;
+    config.duration = CPLUS_INFINITE_TIMEOUT;
+    config.period_usec = 5000;
+    config.suspend = true;
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL == cplus_task_new_ex(&config));
+    config.duration = 0;
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL != (task = cplus_task_new_ex(&config)));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_task_start(task, 0));
+    for (int32_t i = 0; i < 1000 AND 200 > cplus_atomic_read(&count); i++)
+    {
+        cplus_systime_sleep_msec(5);
+    }
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_task_pause(task, true));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_task_get_period_stats(task, &stats));
+    /* The two long iterations overrun and skip at least two whole periods each,
+    a busy machine can only add to that. */
+    UNITTEST_EXPECT_EQ(true, (2 <= stats.overrun_count));
+    UNITTEST_EXPECT_EQ(true, (4 <= stats.missed_count));
+    UNITTEST_EXPECT_EQ(true, (stats.overrun_count < stats.iteration_count));
+    UNITTEST_EXPECT_EQ(true, (199 <= stats.iteration_count));
+    UNITTEST_EXPECT_EQ(true, (stats.avg_jitter_nsec <= stats.max_jitter_nsec));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_task_stop(task, CPLUS_INFINITE_TIMEOUT));
+
+    config.period_usec = 0;
+    config.duration = 100;
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL != (task = cplus_task_new_ex(&config)));
+    UNITTEST_EXPECT_EQ(CPLUS_FAIL, cplus_task_get_period_stats(task, &stats));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_task_stop(task, CPLUS_INFINITE_TIMEOUT));
+    UNITTEST_EXPECT_EQ(0, cplus_mgr_report());
+}
+
+static void busy_1ms_proc(void * param1, void * param2)
+{
+    UNUSED_PARAM(param2);
+    uint64_t start = task_get_thread_cpu_nsec();
+
+    while ((task_get_thread_cpu_nsec() - start) < (1000 * 1000));
+    cplus_atomic_add((int32_t *)(param1), 1);
+}
+
+CPLUS_UNIT_TEST(cplus_task_get_stats, functionity)
+{
+    cplus_task task = CPLUS_NULL;
+    CPLUS_TASK_CONFIG_T config = {0};
+    CPLUS_TASK_STATS_T stats = {0};
+    int32_t count = 0;
+
+    UNITTEST_EXPECT_EQ(1023, task_histogram_get_upper_bound(task_histogram_get_index(1000)));
+    UNITTEST_EXPECT_EQ(true, (task_histogram_get_upper_bound(task_histogram_get_index(1000000)) >= 1000000));
+    UNITTEST_EXPECT_EQ(true, (task_histogram_get_upper_bound(task_histogram_get_index(1000000)) < 1125000));
+    UNITTEST_EXPECT_EQ(7, task_histogram_get_upper_bound(task_histogram_get_index(7)));
+
+    config.proc = busy_1ms_proc;
+    config.param1 = &count;
+    config.duration = 5;
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL != (task = cplus_task_new_ex(&config)));
+    UNITTEST_EXPECT_EQ(CPLUS_FAIL, cplus_task_get_stats(task, &stats));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_task_stop(task, CPLUS_INFINITE_TIMEOUT));
+
+    config.collect_stats = true;
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL != (task = cplus_task_new_ex(&config)));
+    for (int32_t i = 0; i < 500 AND 50 > cplus_atomic_read(&count); i++)
+    {
+        cplus_systime_sleep_msec(10);
+    }
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_task_pause(task, true));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_task_get_stats(task, &stats));
+    UNITTEST_EXPECT_EQ(true, (0 < stats.iteration_count));
+    UNITTEST_EXPECT_EQ(true, (stats.iteration_count <= (uint64_t)cplus_atomic_read(&count)));
+    /* Each round burns at least 1 ms of its own CPU time, whatever the scheduler does. */
+    UNITTEST_EXPECT_EQ(true, (stats.cpu_time.min_nsec >= (1000 * 1000)));
+    UNITTEST_EXPECT_EQ(true, (stats.cpu_time.avg_nsec >= stats.cpu_time.min_nsec));
+    UNITTEST_EXPECT_EQ(true, (stats.cpu_time.avg_nsec <= stats.cpu_time.max_nsec));
+    UNITTEST_EXPECT_EQ(true, (stats.cpu_time.p99_nsec <= stats.cpu_time.max_nsec));
+    UNITTEST_EXPECT_EQ(true, (stats.cpu_time.p99_nsec >= stats.cpu_time.min_nsec));
+    UNITTEST_EXPECT_EQ(true, (stats.total_cpu_nsec >= (stats.iteration_count * 1000 * 1000)));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_task_stop(task, CPLUS_INFINITE_TIMEOUT));
+    UNITTEST_EXPECT_EQ(0, cplus_mgr_report());
+}
+
 void unittest_task(void)
 {
     UNITTEST_ADD_TESTCASE(cplus_task_oneshot_ex, functionity);
@@ -698,6 +1512,11 @@ void unittest_task(void)
     // UNITTEST_ADD_TESTCASE(cplus_task_get_loop_last_timestamp, functionity);
     UNITTEST_ADD_TESTCASE(cplus_task_stop, functionity);
     UNITTEST_ADD_TESTCASE(cplus_task_pause, functionity);
+    UNITTEST_ADD_TESTCASE(cplus_task_new_ex, affinity_and_sched_policy);
+    UNITTEST_ADD_TESTCASE(cplus_task_new, short_period);
+    UNITTEST_ADD_TESTCASE(cplus_task_oneshot, carrier_reuse);
+    UNITTEST_ADD_TESTCASE(cplus_task_new_ex, period_usec);
+    UNITTEST_ADD_TESTCASE(cplus_task_get_stats, functionity);
 }
 
 #endif // __CPLUS_UNITTEST__
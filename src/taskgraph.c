@@ -0,0 +1,579 @@
+/******************************************************************
+* @file: taskgraph.c
+*
+* @author: Hunter Huang <bill.b750121@gmail.com>
+******************************************************************/
+
+#include "common.h"
+#include "cplus_memmgr.h"
+#include "cplus_atomic.h"
+#include "cplus_pevent.h"
+#include "cplus_task.h"
+#include "cplus_taskpool.h"
+#include "cplus_taskgraph.h"
+
+#define OBJ_TYPE (OBJ_NONE + SYS + 11)
+#define MAX_NODE_COUNT 4096U
+#define DEFAULT_SUCCESSOR_SIZE 4U
+#define TASKGRAPH_READY_BATCH_SIZE 16U
+
+struct taskgraph_node
+{
+    CPLUS_TASK_PROC proc;
+    void * param1;
+    void * param2;
+    uint32_t predecessor_count;
+    uint32_t remain_count;
+    uint32_t successor_count;
+    uint32_t successor_size;
+    uint32_t * successors;
+    struct taskgraph_node * next_inline; // links the nodes a thread runs itself when the pool is full
+};
+
+struct taskgraph
+{
+    uint16_t type;
+    cplus_taskpool pool;
+    uint32_t max_node_count;
+    uint32_t node_count;
+    bool is_validated;
+    bool is_submitted;
+    uint32_t remain_node_count;
+    cplus_pevent evt_completed;
+    struct taskgraph_node * nodes;
+};
+
+static void taskgraph_node_proc(void * param1, void * param2);
+
+int32_t cplus_taskgraph_delete(cplus_taskgraph obj)
+{
+    struct taskgraph * graph = (struct taskgraph *)(obj);
+    CHECK_OBJECT_TYPE(obj);
+
+    if (graph->nodes)
+    {
+        for (uint32_t i = 0; i < graph->node_count; i++)
+        {
+            if (graph->nodes[i].successors)
+            {
+                cplus_free(graph->nodes[i].successors);
+            }
+        }
+        cplus_free(graph->nodes);
+    }
+
+    if (graph->evt_completed)
+    {
+        cplus_pevent_delete(graph->evt_completed);
+    }
+
+    cplus_free(graph);
+    return CPLUS_SUCCESS;
+}
+
+static inline bool taskgraph_is_running(struct taskgraph * graph)
+{
+    /* The run is over once the completion is signaled, not when the counter
+    drops to zero, otherwise a quick re-submit could race with the last set. */
+    return (graph->is_submitted AND false == cplus_pevent_get_status(graph->evt_completed));
+}
+
+static int32_t taskgraph_flush_ready_nodes(
+    struct taskgraph * graph
+    , uint32_t count
+    , struct cplus_taskpool_task * ready
+    , struct taskgraph_node ** inline_nodes)
+{
+    struct taskgraph_node * node = CPLUS_NULL;
+
+    if (0 < count
+        AND CPLUS_SUCCESS != cplus_taskpool_add_tasks(graph->pool, count, ready))
+    {
+        /* The pool cannot take them now, the current thread runs them instead
+        of dropping the rest of the graph. They are queued rather than run from
+        here, a deep graph would otherwise recurse through the stack. */
+        for (uint32_t i = 0; i < count; i++)
+        {
+            node = (struct taskgraph_node *)(ready[i].param2);
+            node->next_inline = (* inline_nodes);
+            (* inline_nodes) = node;
+        }
+    }
+    return CPLUS_SUCCESS;
+}
+
+static void taskgraph_run_node(struct taskgraph * graph, struct taskgraph_node * node)
+{
+    struct taskgraph_node * next = CPLUS_NULL, * successor = CPLUS_NULL, * inline_nodes = CPLUS_NULL;
+    struct cplus_taskpool_task ready[TASKGRAPH_READY_BATCH_SIZE] = {0};
+    uint32_t ready_count = 0;
+
+    while (node)
+    {
+        node->proc(node->param1, node->param2);
+
+        next = CPLUS_NULL;
+        ready_count = 0;
+        for (uint32_t i = 0; i < node->successor_count; i++)
+        {
+            successor = &(graph->nodes[node->successors[i]]);
+            if (0 != cplus_atomic_add(&(successor->remain_count), -1))
+            {
+                continue;
+            }
+
+            /* The first released successor continues on this thread, the
+            others are handed to the pool. */
+            if (CPLUS_NULL == next)
+            {
+                next = successor;
+                continue;
+            }
+
+            ready[ready_count].proc = taskgraph_node_proc;
+            ready[ready_count].param1 = graph;
+            ready[ready_count].param2 = successor;
+            ready[ready_count].callback = CPLUS_NULL;
+            if (TASKGRAPH_READY_BATCH_SIZE <= (++ ready_count))
+            {
+                taskgraph_flush_ready_nodes(graph, ready_count, ready, &inline_nodes);
+                ready_count = 0;
+            }
+        }
+        taskgraph_flush_ready_nodes(graph, ready_count, ready, &inline_nodes);
+
+        if (0 == cplus_atomic_add(&(graph->remain_node_count), -1))
+        {
+            cplus_pevent_set(graph->evt_completed);
+        }
+
+        if (CPLUS_NULL == next AND inline_nodes)
+        {
+            next = inline_nodes;
+            inline_nodes = next->next_inline;
+        }
+        node = next;
+    }
+}
+
+static void taskgraph_node_proc(void * param1, void * param2)
+{
+    taskgraph_run_node((struct taskgraph *)(param1), (struct taskgraph_node *)(param2));
+}
+
+static int32_t taskgraph_validate(struct taskgraph * graph)
+{
+    int32_t res = CPLUS_SUCCESS;
+    uint32_t * indegree = CPLUS_NULL, * queue = CPLUS_NULL;
+    uint32_t head = 0, tail = 0;
+    struct taskgraph_node * node = CPLUS_NULL;
+
+    if (true == graph->is_validated OR 0 == graph->node_count)
+    {
+        return CPLUS_SUCCESS;
+    }
+
+    indegree = (uint32_t *)cplus_malloc(graph->node_count * sizeof(uint32_t));
+    queue = (uint32_t *)cplus_malloc(graph->node_count * sizeof(uint32_t));
+    if (CPLUS_NULL == indegree OR CPLUS_NULL == queue)
+    {
+        res = CPLUS_FAIL;
+        goto exit;
+    }
+
+    /* Kahn's algorithm, every node must be reachable in topological order. */
+    for (uint32_t i = 0; i < graph->node_count; i++)
+    {
+        indegree[i] = graph->nodes[i].predecessor_count;
+        if (0 == indegree[i])
+        {
+            queue[tail ++] = i;
+        }
+    }
+
+    while (head < tail)
+    {
+        node = &(graph->nodes[queue[head ++]]);
+        for (uint32_t i = 0; i < node->successor_count; i++)
+        {
+            if (0 == (-- indegree[node->successors[i]]))
+            {
+                queue[tail ++] = node->successors[i];
+            }
+        }
+    }
+
+    if (tail != graph->node_count)
+    {
+        errno = ELOOP;
+        res = CPLUS_FAIL;
+    }
+    else
+    {
+        graph->is_validated = true;
+    }
+exit:
+    if (indegree)
+    {
+        cplus_free(indegree);
+    }
+    if (queue)
+    {
+        cplus_free(queue);
+    }
+    return res;
+}
+
+int32_t cplus_taskgraph_submit(cplus_taskgraph obj)
+{
+    struct taskgraph * graph = (struct taskgraph *)(obj);
+    struct taskgraph_node * node = CPLUS_NULL, * inline_nodes = CPLUS_NULL;
+    struct cplus_taskpool_task ready[TASKGRAPH_READY_BATCH_SIZE] = {0};
+    uint32_t ready_count = 0;
+    CHECK_OBJECT_TYPE(obj);
+
+    if (taskgraph_is_running(graph))
+    {
+        errno = EBUSY;
+        return CPLUS_FAIL;
+    }
+
+    if (CPLUS_SUCCESS != taskgraph_validate(graph))
+    {
+        return CPLUS_FAIL;
+    }
+
+    cplus_pevent_reset(graph->evt_completed);
+    graph->is_submitted = true;
+    if (0 == graph->node_count)
+    {
+        cplus_pevent_set(graph->evt_completed);
+        return CPLUS_SUCCESS;
+    }
+
+    for (uint32_t i = 0; i < graph->node_count; i++)
+    {
+        cplus_atomic_write(&(graph->nodes[i].remain_count), graph->nodes[i].predecessor_count);
+    }
+    cplus_atomic_write(&(graph->remain_node_count), graph->node_count);
+
+    for (uint32_t i = 0; i < graph->node_count; i++)
+    {
+        if (0 != graph->nodes[i].predecessor_count)
+        {
+            continue;
+        }
+
+        ready[ready_count].proc = taskgraph_node_proc;
+        ready[ready_count].param1 = graph;
+        ready[ready_count].param2 = &(graph->nodes[i]);
+        ready[ready_count].callback = CPLUS_NULL;
+        if (TASKGRAPH_READY_BATCH_SIZE <= (++ ready_count))
+        {
+            taskgraph_flush_ready_nodes(graph, ready_count, ready, &inline_nodes);
+            ready_count = 0;
+        }
+    }
+    taskgraph_flush_ready_nodes(graph, ready_count, ready, &inline_nodes);
+
+    /* Roots the pool refused run here, each drains what it releases itself. */
+    while (inline_nodes)
+    {
+        node = inline_nodes;
+        inline_nodes = node->next_inline;
+        taskgraph_run_node(graph, node);
+    }
+
+    return CPLUS_SUCCESS;
+}
+
+int32_t cplus_taskgraph_wait(cplus_taskgraph obj, uint32_t timeout)
+{
+    CHECK_OBJECT_TYPE(obj);
+    return cplus_pevent_wait(((struct taskgraph *)(obj))->evt_completed, timeout);
+}
+
+int32_t cplus_taskgraph_add_node(
+    cplus_taskgraph obj
+    , CPLUS_TASK_PROC proc
+    , void * param1
+    , void * param2)
+{
+    struct taskgraph * graph = (struct taskgraph *)(obj);
+    struct taskgraph_node * node = CPLUS_NULL;
+    CHECK_OBJECT_TYPE(obj);
+    CHECK_NOT_NULL(proc, CPLUS_FAIL);
+
+    if (taskgraph_is_running(graph))
+    {
+        errno = EBUSY;
+        return CPLUS_FAIL;
+    }
+
+    if (graph->node_count >= graph->max_node_count)
+    {
+        errno = ENOMEM;
+        return CPLUS_FAIL;
+    }
+
+    node = &(graph->nodes[graph->node_count]);
+    CPLUS_INITIALIZE_STRUCT_POINTER(node);
+    node->proc = proc;
+    node->param1 = param1;
+    node->param2 = param2;
+    graph->is_validated = false;
+
+    return (int32_t)(graph->node_count ++);
+}
+
+int32_t cplus_taskgraph_add_edge(
+    cplus_taskgraph obj
+    , int32_t predecessor
+    , int32_t successor)
+{
+    struct taskgraph * graph = (struct taskgraph *)(obj);
+    struct taskgraph_node * node = CPLUS_NULL;
+    uint32_t * successors = CPLUS_NULL;
+    CHECK_OBJECT_TYPE(obj);
+    CHECK_IN_INTERVAL(predecessor, 0, ((int32_t)(graph->node_count) - 1), CPLUS_FAIL);
+    CHECK_IN_INTERVAL(successor, 0, ((int32_t)(graph->node_count) - 1), CPLUS_FAIL);
+    CHECK_IF(predecessor == successor, CPLUS_FAIL);
+
+    if (taskgraph_is_running(graph))
+    {
+        errno = EBUSY;
+        return CPLUS_FAIL;
+    }
+
+    node = &(graph->nodes[predecessor]);
+    for (uint32_t i = 0; i < node->successor_count; i++)
+    {
+        if (((uint32_t)successor) == node->successors[i])
+        {
+            return CPLUS_SUCCESS;
+        }
+    }
+
+    if (node->successor_count >= node->successor_size)
+    {
+        uint32_t size = (0 == node->successor_size)? DEFAULT_SUCCESSOR_SIZE: (node->successor_size * 2);
+
+        successors = (uint32_t *)((node->successors)
+            ? cplus_realloc(node->successors, size * sizeof(uint32_t))
+            : cplus_malloc(size * sizeof(uint32_t)));
+        if (CPLUS_NULL == successors)
+        {
+            return CPLUS_FAIL;
+        }
+        node->successors = successors;
+        node->successor_size = size;
+    }
+
+    node->successors[node->successor_count ++] = (uint32_t)successor;
+    graph->nodes[successor].predecessor_count ++;
+    graph->is_validated = false;
+
+    return CPLUS_SUCCESS;
+}
+
+uint32_t cplus_taskgraph_get_node_count(cplus_taskgraph obj)
+{
+    CHECK_OBJECT_TYPE(obj);
+    return ((struct taskgraph *)(obj))->node_count;
+}
+
+static void * taskgraph_initialize_object(cplus_taskpool pool, uint32_t max_node_count)
+{
+    struct taskgraph * graph = CPLUS_NULL;
+
+    if ((graph = (struct taskgraph *)cplus_malloc(sizeof(struct taskgraph))))
+    {
+        CPLUS_INITIALIZE_STRUCT_POINTER(graph);
+        graph->type = OBJ_TYPE;
+        graph->pool = pool;
+        graph->max_node_count = max_node_count;
+        graph->node_count = 0;
+        graph->is_validated = false;
+        graph->is_submitted = false;
+        graph->remain_node_count = 0;
+
+        graph->nodes = (struct taskgraph_node *)cplus_malloc(
+            max_node_count * sizeof(struct taskgraph_node));
+        if (CPLUS_NULL == graph->nodes)
+        {
+            goto exit;
+        }
+        cplus_mem_set(graph->nodes, 0x00, max_node_count * sizeof(struct taskgraph_node));
+
+        if (CPLUS_NULL == (graph->evt_completed = cplus_pevent_new(true, false)))
+        {
+            goto exit;
+        }
+    }
+    return graph;
+exit:
+    cplus_taskgraph_delete(graph);
+    return CPLUS_NULL;
+}
+
+cplus_taskgraph cplus_taskgraph_new(cplus_taskpool pool, uint32_t max_node_count)
+{
+    CHECK_IF(false == cplus_taskpool_check(pool), CPLUS_NULL);
+    CHECK_IN_INTERVAL(max_node_count, 1, MAX_NODE_COUNT, CPLUS_NULL);
+
+    return taskgraph_initialize_object(pool, max_node_count);
+}
+
+bool cplus_taskgraph_check(cplus_object obj)
+{
+    return (obj && (GET_OBJECT_TYPE(obj) == OBJ_TYPE));
+}
+
+#ifdef __CPLUS_UNITTEST__
+#include "cplus_systime.h"
+
+struct graph_trace
+{
+    uint32_t seqn;
+    uint32_t order[8];
+};
+
+struct graph_step
+{
+    struct graph_trace * trace;
+    uint32_t id;
+};
+
+static void record_step(void * param1, void * param2)
+{
+    struct graph_step * step = (struct graph_step *)(param1);
+    UNUSED_PARAM(param2);
+
+    cplus_systime_sleep_msec(10);
+    step->trace->order[step->id] = cplus_atomic_add(&(step->trace->seqn), 1);
+}
+
+CPLUS_UNIT_TEST(cplus_taskgraph_submit, functionity)
+{
+    cplus_taskpool pool = CPLUS_NULL;
+    cplus_taskgraph graph = CPLUS_NULL;
+    struct graph_trace trace = {0};
+    struct graph_step steps[5] = {0};
+
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL != (pool = cplus_taskpool_new(4)));
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL != (graph = cplus_taskgraph_new(pool, 5)));
+    for (uint32_t i = 0; i < 5; i++)
+    {
+        steps[i].trace = &trace;
+        steps[i].id = i;
+        UNITTEST_EXPECT_EQ(i, cplus_taskgraph_add_node(graph, record_step, &steps[i], CPLUS_NULL));
+    }
+    UNITTEST_EXPECT_EQ(CPLUS_FAIL, cplus_taskgraph_add_node(graph, record_step, &steps[0], CPLUS_NULL));
+    UNITTEST_EXPECT_EQ(ENOMEM, errno);
+    /* 0 -> (1, 2, 3) -> 4 */
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskgraph_add_edge(graph, 0, 1));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskgraph_add_edge(graph, 0, 2));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskgraph_add_edge(graph, 0, 3));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskgraph_add_edge(graph, 1, 4));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskgraph_add_edge(graph, 2, 4));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskgraph_add_edge(graph, 3, 4));
+    UNITTEST_EXPECT_EQ(CPLUS_FAIL, cplus_taskgraph_add_edge(graph, 3, 3));
+    UNITTEST_EXPECT_EQ(CPLUS_FAIL, cplus_taskgraph_add_edge(graph, 3, 5));
+
+    for (int32_t round = 0; round < 3; round++)
+    {
+        trace.seqn = 0;
+        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskgraph_submit(graph));
+        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskgraph_wait(graph, 3000));
+        UNITTEST_EXPECT_EQ(5, trace.seqn);
+        UNITTEST_EXPECT_EQ(1, trace.order[0]);
+        UNITTEST_EXPECT_EQ(true, (1 < trace.order[1] AND 5 > trace.order[1]));
+        UNITTEST_EXPECT_EQ(true, (1 < trace.order[2] AND 5 > trace.order[2]));
+        UNITTEST_EXPECT_EQ(true, (1 < trace.order[3] AND 5 > trace.order[3]));
+        UNITTEST_EXPECT_EQ(5, trace.order[4]);
+    }
+
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskgraph_delete(graph));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskpool_delete(pool));
+    UNITTEST_EXPECT_EQ(0, cplus_mgr_report());
+}
+
+CPLUS_UNIT_TEST(cplus_taskgraph_submit, bad_case_cycle)
+{
+    cplus_taskpool pool = CPLUS_NULL;
+    cplus_taskgraph graph = CPLUS_NULL;
+    struct graph_trace trace = {0};
+    struct graph_step steps[3] = {0};
+
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL != (pool = cplus_taskpool_new(2)));
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL != (graph = cplus_taskgraph_new(pool, 3)));
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        steps[i].trace = &trace;
+        steps[i].id = i;
+        UNITTEST_EXPECT_EQ(i, cplus_taskgraph_add_node(graph, record_step, &steps[i], CPLUS_NULL));
+    }
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskgraph_add_edge(graph, 0, 1));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskgraph_add_edge(graph, 1, 2));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskgraph_add_edge(graph, 2, 1));
+    UNITTEST_EXPECT_EQ(CPLUS_FAIL, cplus_taskgraph_submit(graph));
+    UNITTEST_EXPECT_EQ(ELOOP, errno);
+    UNITTEST_EXPECT_EQ(CPLUS_FAIL, cplus_taskgraph_wait(graph, 0));
+    UNITTEST_EXPECT_EQ(0, trace.seqn);
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskgraph_delete(graph));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskpool_delete(pool));
+    UNITTEST_EXPECT_EQ(0, cplus_mgr_report());
+}
+
+static void count_step(void * param1, void * param2)
+{
+    UNUSED_PARAM(param2);
+    cplus_atomic_add((uint32_t *)(param1), 1);
+}
+
+CPLUS_UNIT_TEST(cplus_taskgraph_submit, deep_graph_on_full_pool)
+{
+    cplus_taskpool pool = CPLUS_NULL;
+    cplus_taskgraph graph = CPLUS_NULL;
+    struct cplus_taskpool_config config = {0};
+    uint32_t count = 0;
+
+    /* A ladder of two nodes per level, every level releases two nodes and the
+    pool takes at most one, the rest run on the releasing thread. */
+    config.worker_count = 1;
+    config.max_task_count = 1;
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL != (pool = cplus_taskpool_new_ex(&config)));
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL != (graph = cplus_taskgraph_new(pool, MAX_NODE_COUNT)));
+    for (uint32_t i = 0; i < MAX_NODE_COUNT; i++)
+    {
+        UNITTEST_EXPECT_EQ(i, cplus_taskgraph_add_node(graph, count_step, &count, CPLUS_NULL));
+    }
+    for (uint32_t i = 0; i + 2 < MAX_NODE_COUNT; i += 2)
+    {
+        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskgraph_add_edge(graph, i, i + 2));
+        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskgraph_add_edge(graph, i, i + 3));
+        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskgraph_add_edge(graph, i + 1, i + 2));
+        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskgraph_add_edge(graph, i + 1, i + 3));
+    }
+
+    for (int32_t round = 0; round < 3; round++)
+    {
+        count = 0;
+        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskgraph_submit(graph));
+        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskgraph_wait(graph, 10000));
+        UNITTEST_EXPECT_EQ(MAX_NODE_COUNT, cplus_atomic_read(&count));
+    }
+
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskgraph_delete(graph));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskpool_delete(pool));
+    UNITTEST_EXPECT_EQ(0, cplus_mgr_report());
+}
+
+void unittest_taskgraph(void)
+{
+    UNITTEST_ADD_TESTCASE(cplus_taskgraph_submit, functionity);
+    UNITTEST_ADD_TESTCASE(cplus_taskgraph_submit, bad_case_cycle);
+    UNITTEST_ADD_TESTCASE(cplus_taskgraph_submit, deep_graph_on_full_pool);
+}
+
+#endif // __CPLUS_UNITTEST__
@@ -4,7 +4,12 @@
 * @author: Hunter Huang <bill.b750121@gmail.com>
 ******************************************************************/
 
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE
+#endif
 #include <limits.h>
+#include <sched.h>
+#include <time.h>
 #include "common.h"
 #include "cplus_memmgr.h"
 #include "cplus_mempool.h"
@@ -12,18 +17,27 @@
 #include "cplus_task.h"
 #include "cplus_taskpool.h"
 #include "cplus_mutex.h"
-#include "cplus_semaphore.h"
 #include "cplus_systime.h"
 #include "cplus_pevent.h"
 #include "cplus_atomic.h"
 
 #define OBJ_TYPE (OBJ_NONE + SYS + 3)
 #define MAX_TASK_COUNT 255U
-#define MAX_WORKER_COUNT 32U
+#define MAX_WORKER_COUNT CPLUS_TASKPOOL_MAX_WORKER_COUNT
+#define MAX_CPU_COUNT 64U
 
-#define TIMEOUT_FOR_WAIT_RECEIVED_TASK 3000
 #define TIMEOUT_FOR_TERMINAL_WORKER (1000 * 15)
-#define PERIOD_FOR_WORKER_FREQUENCY 1
+#define PERIOD_FOR_CYCLING_TASK 1
+
+struct taskpool_counters
+{
+    uint64_t executed_count;
+    uint64_t busy_nsec;
+    uint64_t idle_nsec;
+    CPLUS_TASKPOOL_HISTOGRAM_T wait_time;
+    CPLUS_TASKPOOL_HISTOGRAM_T run_time;
+    CPLUS_TASKPOOL_HISTOGRAM_T callback_time;
+};
 
 struct taskpool
 {
@@ -36,15 +50,125 @@ struct taskpool
     cplus_mutex worker_access_sect;
     cplus_llist worker_list;
     cplus_mempool worker_pool;
-    cplus_semaphore remain_taskpool;
+    cplus_llist idle_list;
+    volatile bool is_paused;
+    uint64_t cpu_mask;
+    CPLUS_TASKPOOL_AFFINITY affinity;
+    uint8_t cpu_order[MAX_CPU_COUNT];
+    uint32_t cpu_order_count;
+    uint32_t used_slot_mask;
+    CPLUS_TASK_SCHED_POLICY sched_policy;
+    int32_t sched_priority;
+    uint64_t submitted_count;
+    uint64_t rejected_count;
+    uint32_t max_queued_count;
+    uint32_t stats_epoch;
+    uint64_t stats_reset_nsec;
+    struct taskpool_counters retired;
+};
+
+struct taskpool_entry
+{
+    struct cplus_taskpool_task task; // must be the first, comparators of cplus_taskpool_remove_task() see it
+    uint64_t enqueue_nsec;
 };
 
 struct task_worker
 {
     pthread_t pid;
     cplus_task executor;
+    cplus_pevent evt_wakeup;
+    volatile bool is_stopping;
+    uint32_t slot;
+    uint32_t stats_epoch;
+    uint32_t counters_seq; // odd while the worker updates its counters
+    struct taskpool_counters counters;
 };
 
+static int32_t taskpool_worker_delete(struct taskpool * tp, struct task_worker * worker, uint32_t timeout);
+
+static inline uint64_t taskpool_get_nsec(void)
+{
+    struct timespec ts = {0};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)(ts.tv_sec) * 1000000000ULL) + (uint64_t)(ts.tv_nsec);
+}
+
+static inline void taskpool_histogram_add(CPLUS_TASKPOOL_HISTOGRAM histogram, uint64_t nsec)
+{
+    uint64_t usec = nsec / 1000;
+    uint32_t index = (0 == usec)? 0: (64 - __builtin_clzll(usec));
+
+    histogram->count ++;
+    histogram->total_nsec += nsec;
+    histogram->max_nsec = CPLUS_MAX(histogram->max_nsec, nsec);
+    histogram->buckets[CPLUS_MIN(index, CPLUS_TASKPOOL_HISTOGRAM_BUCKETS - 1)] ++;
+}
+
+static void taskpool_histogram_merge(CPLUS_TASKPOOL_HISTOGRAM dest, CPLUS_TASKPOOL_HISTOGRAM src)
+{
+    dest->count += src->count;
+    dest->total_nsec += src->total_nsec;
+    dest->max_nsec = CPLUS_MAX(dest->max_nsec, src->max_nsec);
+    for (uint32_t i = 0; i < CPLUS_TASKPOOL_HISTOGRAM_BUCKETS; i++)
+    {
+        dest->buckets[i] += src->buckets[i];
+    }
+}
+
+static void taskpool_counters_merge(struct taskpool_counters * dest, struct taskpool_counters * src)
+{
+    dest->executed_count += src->executed_count;
+    dest->busy_nsec += src->busy_nsec;
+    dest->idle_nsec += src->idle_nsec;
+    taskpool_histogram_merge(&(dest->wait_time), &(src->wait_time));
+    taskpool_histogram_merge(&(dest->run_time), &(src->run_time));
+    taskpool_histogram_merge(&(dest->callback_time), &(src->callback_time));
+}
+
+static inline void taskpool_sync_stats_epoch(struct taskpool * tp, struct task_worker * worker)
+{
+    /* Counters are only written by their own worker, so a reset can't clear them from
+    outside without racing. It bumps the epoch instead and the worker clears itself. */
+    uint32_t epoch = cplus_atomic_read(&(tp->stats_epoch));
+    if (worker->stats_epoch != epoch)
+    {
+        CPLUS_INITIALIZE_STRUCT_POINTER(&(worker->counters));
+        worker->stats_epoch = epoch;
+    }
+}
+
+/* The counters are 64-bit and would tear when read on a 32-bit target, the
+owning worker brackets its updates with a sequence which readers check. */
+static inline void taskpool_counters_begin(struct task_worker * worker)
+{
+    cplus_atomic_add(&(worker->counters_seq), 1);
+}
+
+static inline void taskpool_counters_end(struct task_worker * worker)
+{
+    cplus_atomic_add(&(worker->counters_seq), 1);
+}
+
+static uint32_t taskpool_counters_read(struct task_worker * worker, struct taskpool_counters * counters)
+{
+    uint32_t seq = 0, epoch = 0;
+
+    do
+    {
+        while (1 & (seq = cplus_atomic_read(&(worker->counters_seq))))
+        {
+            sched_yield();
+        }
+        epoch = worker->stats_epoch;
+        cplus_mem_cpy(counters, &(worker->counters), sizeof(struct taskpool_counters));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    }
+    while (seq != cplus_atomic_read(&(worker->counters_seq)));
+
+    return epoch;
+}
+
 int32_t cplus_taskpool_delete_ex(cplus_taskpool obj, uint32_t timeout)
 {
     struct taskpool * tp = (struct taskpool *)(obj);
@@ -57,13 +181,17 @@ int32_t cplus_taskpool_delete_ex(cplus_taskpool obj, uint32_t timeout)
         cplus_crit_sect_enter(tp->worker_access_sect);
         while ((worker = (struct task_worker *)cplus_llist_pop_back(tp->worker_list)))
         {
-            cplus_task_stop(worker->executor, timeout);
-            cplus_mempool_free(tp->worker_pool, worker);
+            taskpool_worker_delete(tp, worker, timeout);
         }
         cplus_llist_delete(tp->worker_list);
         cplus_crit_sect_exit(tp->worker_access_sect);
     }
 
+    if (tp->idle_list)
+    {
+        cplus_llist_delete(tp->idle_list);
+    }
+
     if (tp->worker_pool)
     {
         cplus_mempool_delete(tp->worker_pool);
@@ -95,11 +223,6 @@ int32_t cplus_taskpool_delete_ex(cplus_taskpool obj, uint32_t timeout)
         cplus_mutex_delete(tp->task_access_sect);
     }
 
-    if (tp->remain_taskpool)
-    {
-        cplus_semaphore_delete(tp->remain_taskpool);
-    }
-
     cplus_free(tp);
     return CPLUS_SUCCESS;
 }
@@ -109,57 +232,297 @@ int32_t cplus_taskpool_delete(cplus_taskpool obj)
     return cplus_taskpool_delete_ex(obj, TIMEOUT_FOR_TERMINAL_WORKER);
 }
 
+static inline struct task_worker * taskpool_pop_idle_worker(struct taskpool * tp)
+{
+    /* Must be called in "task_access_sect". The latest parked worker is picked first,
+    its stack and cache are most likely still warm. */
+    return (struct task_worker *)((0 < cplus_llist_get_size(tp->idle_list))
+        ? cplus_llist_pop_back(tp->idle_list): CPLUS_NULL);
+}
+
+static void taskpool_wakeup_all_workers(struct taskpool * tp)
+{
+    struct task_worker * worker = CPLUS_NULL;
+
+    cplus_crit_sect_enter(tp->task_access_sect);
+    while ((worker = taskpool_pop_idle_worker(tp)))
+    {
+        cplus_pevent_set(worker->evt_wakeup);
+    }
+    cplus_crit_sect_exit(tp->task_access_sect);
+}
+
 void task_worker(void * param1, void * param2)
 {
     struct taskpool * tp = (struct taskpool *)param1;
-    struct cplus_taskpool_task task_t = {0}, * task = CPLUS_NULL;
-    uint32_t task_count = 0;
-    void * (* fetch_task)(cplus_llist) = CPLUS_NULL;
-    UNUSED_PARAM(param2);
+    struct task_worker * worker = (struct task_worker *)param2;
+    struct cplus_taskpool_task task_t = {0};
+    struct taskpool_entry * entry = CPLUS_NULL;
+    uint64_t enqueue_nsec = 0, start_nsec = 0, callback_nsec = 0, end_nsec = 0;
 
-    fetch_task = (!!(tp->get_task_cycling))? cplus_llist_get_cycling_next: cplus_llist_pop_back;
-
-    if ((true == tp->get_task_cycling)
-        || CPLUS_SUCCESS == cplus_semaphore_wait_poll(tp->remain_taskpool, TIMEOUT_FOR_WAIT_RECEIVED_TASK))
+    while (false == worker->is_stopping)
     {
+        entry = CPLUS_NULL;
+
         cplus_crit_sect_enter(tp->task_access_sect);
-        if (0 < (task_count = cplus_llist_get_size(tp->task_list)))
+        if (false == tp->is_paused
+            AND 0 < cplus_llist_get_size(tp->task_list))
         {
-            if (!(task = (struct cplus_taskpool_task *)fetch_task(tp->task_list)))
+            if (tp->get_task_cycling)
             {
-                cplus_systime_sleep_msec(1);
-                cplus_crit_sect_exit(tp->task_access_sect);
-                return;
+                entry = (struct taskpool_entry *)cplus_llist_get_cycling_next(tp->task_list);
             }
             else
             {
-                cplus_mem_cpy(&task_t, task, sizeof(struct cplus_taskpool_task));
-                if (!(tp->get_task_cycling))
+                entry = (struct taskpool_entry *)cplus_llist_pop_back(tp->task_list);
+            }
+
+            if (entry)
+            {
+                cplus_mem_cpy(&task_t, &(entry->task), sizeof(struct cplus_taskpool_task));
+                enqueue_nsec = entry->enqueue_nsec;
+                if (tp->get_task_cycling)
                 {
-                    cplus_mempool_free(tp->task_pool, task);
+                    /* Only the first round of a cycling task has waited in the queue. */
+                    entry->enqueue_nsec = 0;
+                }
+                else
+                {
+                    cplus_mempool_free(tp->task_pool, entry);
                 }
             }
         }
+
+        if (CPLUS_NULL == entry)
+        {
+            if (true == worker->is_stopping)
+            {
+                /* Already taken off the idle list by taskpool_worker_delete(), it must
+                not be parked there again. */
+                cplus_crit_sect_exit(tp->task_access_sect);
+                break;
+            }
+
+            /* Nothing to do, park on the private event until a submission, a resume
+            or a stop request hands this worker over. */
+            cplus_llist_push_back(tp->idle_list, worker);
+            cplus_crit_sect_exit(tp->task_access_sect);
+
+            start_nsec = taskpool_get_nsec();
+            cplus_pevent_wait(worker->evt_wakeup, CPLUS_INFINITE_TIMEOUT);
+            end_nsec = taskpool_get_nsec();
+
+            taskpool_counters_begin(worker);
+            taskpool_sync_stats_epoch(tp, worker);
+            worker->counters.idle_nsec += end_nsec
+                - CPLUS_MIN(end_nsec, CPLUS_MAX(start_nsec, cplus_atomic_read(&(tp->stats_reset_nsec))));
+            taskpool_counters_end(worker);
+            continue;
+        }
         cplus_crit_sect_exit(tp->task_access_sect);
 
+        start_nsec = taskpool_get_nsec();
         if (task_t.proc)
         {
             task_t.proc(task_t.param1, task_t.param2);
         }
-
+        callback_nsec = end_nsec = taskpool_get_nsec();
         if (task_t.callback)
         {
             task_t.callback(task_t.param1, task_t.param2);
+            end_nsec = taskpool_get_nsec();
+        }
+
+        taskpool_counters_begin(worker);
+        taskpool_sync_stats_epoch(tp, worker);
+        if (enqueue_nsec)
+        {
+            taskpool_histogram_add(&(worker->counters.wait_time), start_nsec - enqueue_nsec);
+        }
+        taskpool_histogram_add(&(worker->counters.run_time), callback_nsec - start_nsec);
+        if (task_t.callback)
+        {
+            taskpool_histogram_add(&(worker->counters.callback_time), end_nsec - callback_nsec);
+        }
+        worker->counters.executed_count ++;
+        worker->counters.busy_nsec += (end_nsec - start_nsec);
+        taskpool_counters_end(worker);
+
+        if (tp->get_task_cycling)
+        {
+            /* Cycling tasks are kept in the list, pace them by the period and
+            let a stop request break the wait immediately. */
+            cplus_pevent_wait(worker->evt_wakeup, PERIOD_FOR_CYCLING_TASK);
         }
     }
     return;
 }
 
+static int32_t taskpool_worker_delete(
+    struct taskpool * tp
+    , struct task_worker * worker
+    , uint32_t timeout)
+{
+    CHECK_NOT_NULL(worker, CPLUS_FAIL);
+
+    if (worker->executor)
+    {
+        cplus_crit_sect_enter(tp->task_access_sect);
+        worker->is_stopping = true;
+        cplus_llist_delete_data(tp->idle_list, worker);
+        cplus_crit_sect_exit(tp->task_access_sect);
+
+        cplus_pevent_set(worker->evt_wakeup);
+        cplus_task_stop(worker->executor, timeout);
+    }
+
+    if (worker->evt_wakeup)
+    {
+        cplus_pevent_delete(worker->evt_wakeup);
+    }
+
+    if (worker->stats_epoch == cplus_atomic_read(&(tp->stats_epoch)))
+    {
+        /* Keep the history of a retired worker in the pool-wide figures. */
+        taskpool_counters_merge(&(tp->retired), &(worker->counters));
+    }
+
+    tp->used_slot_mask &= ~(1U << worker->slot);
+    return cplus_mempool_free(tp->worker_pool, worker);
+}
+
+static uint64_t taskpool_get_worker_cpu_mask(struct taskpool * tp, uint32_t slot)
+{
+    if (CPLUS_TASKPOOL_AFFINITY_NONE == tp->affinity)
+    {
+        return tp->cpu_mask;
+    }
+    return (1ULL << tp->cpu_order[slot % tp->cpu_order_count]);
+}
+
+static int32_t taskpool_setup_cpu_order(
+    struct taskpool * tp
+    , struct cplus_taskpool_config * config)
+{
+    uint8_t cpus[MAX_CPU_COUNT] = {0};
+    uint32_t cpu_count = 0, bits = 0;
+
+    if (CPLUS_TASKPOOL_AFFINITY_EXPLICIT == tp->affinity)
+    {
+        for (uint32_t i = 0; i < config->cpu_list_count; i++)
+        {
+            tp->cpu_order[i] = (uint8_t)(config->cpu_list[i]);
+        }
+        tp->cpu_order_count = config->cpu_list_count;
+        return CPLUS_SUCCESS;
+    }
+
+    if (0 == tp->cpu_mask)
+    {
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        if (0 != sched_getaffinity(0, sizeof(cpu_set), &cpu_set))
+        {
+            return CPLUS_FAIL;
+        }
+        for (uint32_t cpu = 0; cpu < MAX_CPU_COUNT; cpu++)
+        {
+            if (CPU_ISSET(cpu, &cpu_set))
+            {
+                tp->cpu_mask |= (1ULL << cpu);
+            }
+        }
+    }
+
+    for (uint32_t cpu = 0; cpu < MAX_CPU_COUNT; cpu++)
+    {
+        if (tp->cpu_mask & (1ULL << cpu))
+        {
+            cpus[cpu_count ++] = (uint8_t)(cpu);
+        }
+    }
+    if (0 == cpu_count)
+    {
+        errno = EINVAL;
+        return CPLUS_FAIL;
+    }
+
+    if (CPLUS_TASKPOOL_AFFINITY_COMPACT == tp->affinity)
+    {
+        cplus_mem_cpy(tp->cpu_order, cpus, cpu_count);
+        tp->cpu_order_count = cpu_count;
+        return CPLUS_SUCCESS;
+    }
+
+    /* Scatter walks the CPUs in bit-reversed order (0, N/2, N/4, 3N/4, ...), so
+    every prefix of the workers is spread as evenly as possible, which also
+    holds when workers are added later by cplus_taskpool_reset_worker_count(). */
+    while ((1U << bits) < cpu_count)
+    {
+        bits ++;
+    }
+    for (uint32_t i = 0; i < (1U << bits); i++)
+    {
+        uint32_t reversed = 0;
+        for (uint32_t b = 0; b < bits; b++)
+        {
+            reversed |= ((i >> b) & 1U) << (bits - 1 - b);
+        }
+        if (reversed < cpu_count)
+        {
+            tp->cpu_order[tp->cpu_order_count ++] = cpus[reversed];
+        }
+    }
+    return CPLUS_SUCCESS;
+}
+
+static struct task_worker * taskpool_worker_new(struct taskpool * tp)
+{
+    struct task_worker * worker = CPLUS_NULL;
+    CPLUS_TASK_CONFIG_T task_config = {0};
+
+    if ((worker = (struct task_worker *)cplus_mempool_alloc(tp->worker_pool)))
+    {
+        CPLUS_INITIALIZE_STRUCT_POINTER(worker);
+        worker->is_stopping = false;
+        worker->slot = __builtin_ctz(~(tp->used_slot_mask));
+        worker->stats_epoch = cplus_atomic_read(&(tp->stats_epoch));
+        tp->used_slot_mask |= (1U << worker->slot);
+
+        if (CPLUS_NULL == (worker->evt_wakeup = cplus_pevent_new(false, false)))
+        {
+            goto exit;
+        }
+
+        task_config.proc = task_worker;
+        task_config.param1 = tp;
+        task_config.param2 = worker;
+        task_config.duration = 0;
+        task_config.suspend = true;
+        task_config.stacksize = tp->stack_size;
+        task_config.cpu_mask = taskpool_get_worker_cpu_mask(tp, worker->slot);
+        task_config.sched_policy = tp->sched_policy;
+        task_config.sched_priority = tp->sched_priority;
+        if (CPLUS_NULL == (worker->executor = cplus_task_new_ex(&task_config)))
+        {
+            goto exit;
+        }
+        worker->pid = cplus_task_get_pid(worker->executor);
+
+        cplus_task_start(worker->executor, 0);
+        cplus_task_wait_start(worker->executor, CPLUS_INFINITE_TIMEOUT);
+    }
+    return worker;
+exit:
+    taskpool_worker_delete(tp, worker, 0);
+    return CPLUS_NULL;
+}
+
 static void * taskpool_initialize_object(
     struct cplus_taskpool_config * config)
 {
     struct taskpool * tp = CPLUS_NULL;
-    struct cplus_task_config task_config = {0};
+    struct task_worker * worker = CPLUS_NULL;
 
     if ((tp = (struct taskpool *)cplus_malloc(sizeof(struct taskpool))))
     {
@@ -167,6 +530,18 @@ static void * taskpool_initialize_object(
         tp->type = OBJ_TYPE;
         tp->stack_size = config->stack_size;
         tp->get_task_cycling = config->get_task_cycling;
+        tp->is_paused = false;
+        tp->cpu_mask = config->cpu_mask;
+        tp->affinity = config->affinity;
+        tp->sched_policy = config->sched_policy;
+        tp->sched_priority = config->sched_priority;
+        tp->used_slot_mask = 0;
+
+        if (CPLUS_TASKPOOL_AFFINITY_NONE != tp->affinity
+            AND CPLUS_SUCCESS != taskpool_setup_cpu_order(tp, config))
+        {
+            goto exit;
+        }
 
         tp->task_access_sect = cplus_mutex_new();
         if (CPLUS_NULL == tp->task_access_sect)
@@ -176,7 +551,7 @@ static void * taskpool_initialize_object(
 
         tp->task_pool = cplus_mempool_new(
             config->max_task_count
-            , sizeof(struct cplus_taskpool_task));
+            , sizeof(struct taskpool_entry));
         if (CPLUS_NULL == tp->task_pool)
         {
             goto exit;
@@ -206,36 +581,18 @@ static void * taskpool_initialize_object(
             goto exit;
         }
 
-        tp->remain_taskpool = cplus_semaphore_new(0);
-        if (CPLUS_NULL == tp->remain_taskpool)
+        tp->idle_list = cplus_llist_prev_new(MAX_WORKER_COUNT);
+        if (CPLUS_NULL == tp->idle_list)
         {
             goto exit;
         }
 
         for (uint32_t i = 0; i < config->worker_count; i++)
         {
-            cplus_task executor = CPLUS_NULL;
-            struct task_worker * worker = CPLUS_NULL;
-
-            task_config.proc = task_worker;
-            task_config.param1 = tp;
-            task_config.duration = PERIOD_FOR_WORKER_FREQUENCY;
-            task_config.suspend = true;
-            task_config.stacksize = tp->stack_size;
-            if (!(executor = cplus_task_new_ex(&task_config)))
+            if (CPLUS_NULL == (worker = taskpool_worker_new(tp)))
             {
                 goto exit;
             }
-
-            if ((worker = (struct task_worker *)cplus_mempool_alloc(tp->worker_pool)))
-            {
-                worker->pid = cplus_task_get_pid(executor);
-                worker->executor = executor;
-            }
-
-            cplus_task_start(executor, 0);
-            cplus_task_wait_start(executor, CPLUS_INFINITE_TIMEOUT);
-
             cplus_llist_push_front(tp->worker_list, worker);
         }
     }
@@ -260,6 +617,17 @@ cplus_taskpool cplus_taskpool_new_ex(struct cplus_taskpool_config * config)
     CHECK_NOT_NULL(config, CPLUS_NULL);
     CHECK_IN_INTERVAL(config->max_task_count, 1, MAX_TASK_COUNT, CPLUS_NULL);
     CHECK_IF(config->worker_count > MAX_WORKER_COUNT, CPLUS_NULL);
+    CHECK_IN_INTERVAL(config->affinity, CPLUS_TASKPOOL_AFFINITY_NONE
+        , CPLUS_TASKPOOL_AFFINITY_MAX - 1, CPLUS_NULL);
+    if (CPLUS_TASKPOOL_AFFINITY_EXPLICIT == config->affinity)
+    {
+        CHECK_NOT_NULL(config->cpu_list, CPLUS_NULL);
+        CHECK_IN_INTERVAL(config->cpu_list_count, 1, MAX_CPU_COUNT, CPLUS_NULL);
+        for (uint32_t i = 0; i < config->cpu_list_count; i++)
+        {
+            CHECK_IF(config->cpu_list[i] >= MAX_CPU_COUNT, CPLUS_NULL);
+        }
+    }
 
     config->stack_size = (0 != config->stack_size)? CPLUS_MAX(((uint32_t)PTHREAD_STACK_MIN), config->stack_size): 0;
     return taskpool_initialize_object(config);
@@ -274,7 +642,8 @@ int32_t cplus_taskpool_add_task_ex(cplus_taskpool obj, struct cplus_taskpool_tas
 {
     int32_t res = CPLUS_FAIL;
     struct taskpool * tp = (struct taskpool *)(obj);
-    struct cplus_taskpool_task * t = CPLUS_NULL;
+    struct taskpool_entry * t = CPLUS_NULL;
+    struct task_worker * worker = CPLUS_NULL;
 
     CHECK_OBJECT_TYPE(obj);
     CHECK_NOT_NULL(task, CPLUS_FAIL);
@@ -283,12 +652,10 @@ int32_t cplus_taskpool_add_task_ex(cplus_taskpool obj, struct cplus_taskpool_tas
     uint32_t task_count = cplus_llist_get_size(tp->task_list);
     if (MAX_TASK_COUNT > task_count)
     {
-        if ((t = (struct cplus_taskpool_task *)cplus_mempool_alloc(tp->task_pool)))
+        if ((t = (struct taskpool_entry *)cplus_mempool_alloc(tp->task_pool)))
         {
-            t->proc = task->proc;
-            t->param1 = task->param1;
-            t->param2 = task->param2;
-            t->callback = task->callback;
+            cplus_mem_cpy(&(t->task), task, sizeof(struct cplus_taskpool_task));
+            t->enqueue_nsec = taskpool_get_nsec();
             res = cplus_llist_push_front(tp->task_list, t);
         }
     }
@@ -297,12 +664,81 @@ int32_t cplus_taskpool_add_task_ex(cplus_taskpool obj, struct cplus_taskpool_tas
         errno = ENOMEM;
         res = CPLUS_FAIL;
     }
+
+    if (CPLUS_SUCCESS == res)
+    {
+        tp->submitted_count ++;
+        tp->max_queued_count = CPLUS_MAX(tp->max_queued_count, task_count + 1);
+        if (false == tp->is_paused AND (worker = taskpool_pop_idle_worker(tp)))
+        {
+            /* Exactly one parked worker is handed the new task. It is signalled before
+            the lock is left, a worker off the idle list may be deleted right after. */
+            cplus_pevent_set(worker->evt_wakeup);
+        }
+    }
+    else
+    {
+        tp->rejected_count ++;
+    }
     cplus_crit_sect_exit(tp->task_access_sect);
 
-    if ((false == tp->get_task_cycling) && CPLUS_SUCCESS == res)
+    return res;
+}
+
+int32_t cplus_taskpool_add_tasks(
+    cplus_taskpool obj
+    , uint32_t count
+    , struct cplus_taskpool_task * tasks)
+{
+    int32_t res = CPLUS_SUCCESS;
+    struct taskpool * tp = (struct taskpool *)(obj);
+    struct taskpool_entry * t = CPLUS_NULL;
+    struct task_worker * worker = CPLUS_NULL;
+    uint32_t wakeup_count = 0;
+    uint64_t enqueue_nsec = 0;
+
+    CHECK_OBJECT_TYPE(obj);
+    CHECK_NOT_NULL(tasks, CPLUS_FAIL);
+    CHECK_GT_ZERO(count, CPLUS_FAIL);
+
+    cplus_crit_sect_enter(tp->task_access_sect);
+    if ((MAX_TASK_COUNT < (cplus_llist_get_size(tp->task_list) + count))
+        OR (count > cplus_mempool_get_free_blocks_count(tp->task_pool)))
+    {
+        /* All or nothing, never enqueue a part of the batch. */
+        errno = ENOMEM;
+        res = CPLUS_FAIL;
+        tp->rejected_count += count;
+    }
+    else
     {
-        cplus_semaphore_push(tp->remain_taskpool, 1);
+        enqueue_nsec = taskpool_get_nsec();
+        for (uint32_t i = 0; i < count; i++)
+        {
+            if (CPLUS_NULL == (t = (struct taskpool_entry *)cplus_mempool_alloc(tp->task_pool)))
+            {
+                res = CPLUS_FAIL;
+                break;
+            }
+            cplus_mem_cpy(&(t->task), &(tasks[i]), sizeof(struct cplus_taskpool_task));
+            t->enqueue_nsec = enqueue_nsec;
+            cplus_llist_push_front(tp->task_list, t);
+            tp->submitted_count ++;
+        }
+        tp->max_queued_count = CPLUS_MAX(tp->max_queued_count, cplus_llist_get_size(tp->task_list));
+
+        /* Only wake as many parked workers as there are new tasks, the busy
+        ones keep draining the list without any wake-up. Each is signalled
+        under the lock, as in cplus_taskpool_add_task_ex(). */
+        while (false == tp->is_paused
+            AND wakeup_count < count
+            AND CPLUS_NULL != (worker = taskpool_pop_idle_worker(tp)))
+        {
+            cplus_pevent_set(worker->evt_wakeup);
+            wakeup_count ++;
+        }
     }
+    cplus_crit_sect_exit(tp->task_access_sect);
 
     return res;
 }
@@ -370,7 +806,6 @@ int32_t cplus_taskpool_reset_worker_count(cplus_taskpool obj, uint32_t worker_co
     struct task_worker * worker = CPLUS_NULL;
     int32_t count_to_change = 0;
     uint32_t current_worker_count = 0;
-    uint32_t old_stack_size = tp->stack_size;
 
     CHECK_OBJECT_TYPE(obj);
     CHECK_IF(worker_count > MAX_WORKER_COUNT, CPLUS_FAIL);
@@ -385,8 +820,7 @@ int32_t cplus_taskpool_reset_worker_count(cplus_taskpool obj, uint32_t worker_co
             {
                 if ((worker = (struct task_worker *)cplus_llist_pop_back(tp->worker_list)))
                 {
-                    cplus_task_stop(worker->executor, TIMEOUT_FOR_TERMINAL_WORKER);
-                    cplus_mempool_free(tp->worker_pool, worker);
+                    taskpool_worker_delete(tp, worker, TIMEOUT_FOR_TERMINAL_WORKER);
                 }
             }
         }
@@ -395,28 +829,10 @@ int32_t cplus_taskpool_reset_worker_count(cplus_taskpool obj, uint32_t worker_co
             count_to_change = worker_count - current_worker_count;
             while (count_to_change --)
             {
-                cplus_task executor = CPLUS_NULL;
-                struct task_worker * worker = CPLUS_NULL;
-                CPLUS_TASK_CONFIG_T task_config = {0};
-
-                task_config.proc = task_worker;
-                task_config.param1 = tp;
-                task_config.duration = PERIOD_FOR_WORKER_FREQUENCY;
-                task_config.suspend = true;
-                task_config.stacksize = old_stack_size;
-                if (CPLUS_NULL == (executor = cplus_task_new_ex(&task_config)))
+                if (CPLUS_NULL == (worker = taskpool_worker_new(tp)))
                 {
                     break;
                 }
-
-                if ((worker = (struct task_worker *)cplus_mempool_alloc(tp->worker_pool)))
-                {
-                    worker->pid = cplus_task_get_pid(executor);
-                    worker->executor = executor;
-                }
-
-                cplus_task_start(executor, 0);
-                cplus_task_wait_start(executor, CPLUS_INFINITE_TIMEOUT);
                 cplus_llist_push_front(tp->worker_list, worker);
             }
         }
@@ -445,17 +861,16 @@ uint32_t cplus_taskpool_get_task_count(cplus_taskpool obj)
 int32_t cplus_taskpool_all_pause(cplus_taskpool obj, bool pause)
 {
     struct taskpool * tp = (struct taskpool *)(obj);
-    struct task_worker * worker = CPLUS_NULL;
     CHECK_OBJECT_TYPE(obj);
 
-    if (tp->worker_list)
+    cplus_crit_sect_enter(tp->task_access_sect);
+    tp->is_paused = pause;
+    cplus_crit_sect_exit(tp->task_access_sect);
+
+    if (false == pause)
     {
-        cplus_crit_sect_enter(tp->worker_access_sect);
-        CPLUS_LLIST_FOREACH(tp->worker_list, worker)
-        {
-            cplus_task_pause(worker->executor, pause);
-        }
-        cplus_crit_sect_exit(tp->worker_access_sect);
+        /* Parked workers don't poll, resume them explicitly. */
+        taskpool_wakeup_all_workers(tp);
     }
     return CPLUS_SUCCESS;
 }
@@ -479,6 +894,82 @@ int32_t cplus_taskpool_clear_task(cplus_taskpool obj)
     return CPLUS_SUCCESS;
 }
 
+int32_t cplus_taskpool_get_stats(cplus_taskpool obj, struct cplus_taskpool_stats * stats)
+{
+    struct taskpool * tp = (struct taskpool *)(obj);
+    struct task_worker * worker = CPLUS_NULL;
+    struct taskpool_counters total = {0}, counters = {0};
+    uint32_t epoch = 0;
+    CHECK_OBJECT_TYPE(obj);
+    CHECK_NOT_NULL(stats, CPLUS_FAIL);
+
+    CPLUS_INITIALIZE_STRUCT_POINTER(stats);
+
+    /* Running workers are not stopped, each one's counters are a consistent
+    snapshot but the workers are taken one after the other. */
+    cplus_crit_sect_enter(tp->worker_access_sect);
+    {
+        cplus_mem_cpy(&total, &(tp->retired), sizeof(struct taskpool_counters));
+        epoch = cplus_atomic_read(&(tp->stats_epoch));
+        stats->worker_count = cplus_llist_get_size(tp->worker_list);
+        for (uint32_t i = 0; i < stats->worker_count; i++)
+        {
+            worker = (struct task_worker *)cplus_llist_get_of(tp->worker_list, i);
+            stats->workers[i].slot = worker->slot;
+            if (epoch == taskpool_counters_read(worker, &counters))
+            {
+                stats->workers[i].executed_count = counters.executed_count;
+                stats->workers[i].busy_nsec = counters.busy_nsec;
+                stats->workers[i].idle_nsec = counters.idle_nsec;
+                taskpool_counters_merge(&total, &counters);
+            }
+        }
+    }
+    cplus_crit_sect_exit(tp->worker_access_sect);
+
+    stats->executed_count = total.executed_count;
+    stats->busy_nsec = total.busy_nsec;
+    stats->idle_nsec = total.idle_nsec;
+    cplus_mem_cpy(&(stats->wait_time), &(total.wait_time), sizeof(CPLUS_TASKPOOL_HISTOGRAM_T));
+    cplus_mem_cpy(&(stats->run_time), &(total.run_time), sizeof(CPLUS_TASKPOOL_HISTOGRAM_T));
+    cplus_mem_cpy(&(stats->callback_time), &(total.callback_time), sizeof(CPLUS_TASKPOOL_HISTOGRAM_T));
+
+    cplus_crit_sect_enter(tp->task_access_sect);
+    {
+        stats->submitted_count = tp->submitted_count;
+        stats->rejected_count = tp->rejected_count;
+        stats->queued_count = cplus_llist_get_size(tp->task_list);
+        stats->max_queued_count = tp->max_queued_count;
+    }
+    cplus_crit_sect_exit(tp->task_access_sect);
+
+    return CPLUS_SUCCESS;
+}
+
+int32_t cplus_taskpool_reset_stats(cplus_taskpool obj)
+{
+    struct taskpool * tp = (struct taskpool *)(obj);
+    CHECK_OBJECT_TYPE(obj);
+
+    cplus_crit_sect_enter(tp->worker_access_sect);
+    {
+        CPLUS_INITIALIZE_STRUCT_POINTER(&(tp->retired));
+        cplus_atomic_write(&(tp->stats_reset_nsec), taskpool_get_nsec());
+        cplus_atomic_add(&(tp->stats_epoch), 1);
+    }
+    cplus_crit_sect_exit(tp->worker_access_sect);
+
+    cplus_crit_sect_enter(tp->task_access_sect);
+    {
+        tp->submitted_count = 0;
+        tp->rejected_count = 0;
+        tp->max_queued_count = cplus_llist_get_size(tp->task_list);
+    }
+    cplus_crit_sect_exit(tp->task_access_sect);
+
+    return CPLUS_SUCCESS;
+}
+
 #ifdef __CPLUS_UNITTEST__
 #include "cplus_atomic.h"
 #include "cplus_pevent.h"
@@ -650,6 +1141,266 @@ CPLUS_UNIT_TEST(cplus_taskpool_all_pause, functionity)
     UNITTEST_EXPECT_EQ(0, cplus_mgr_report());
 }
 
+static volatile bool is_resizing = false;
+
+void count_and_signal(void * param1, void * param2)
+{
+    cplus_atomic_add((int32_t *)param1, 1);
+    cplus_pevent_set((cplus_pevent)param2);
+}
+
+void * resize_worker_count(void * args)
+{
+    cplus_taskpool taskpool = (cplus_taskpool)args;
+    uint32_t worker_count = 1;
+
+    while (true == is_resizing)
+    {
+        cplus_taskpool_reset_worker_count(taskpool, worker_count);
+        worker_count = (1 == worker_count)? 8: 1;
+    }
+    return CPLUS_NULL;
+}
+
+CPLUS_UNIT_TEST(cplus_taskpool_add_task_ex, wakeup_parked_worker)
+{
+    cplus_taskpool taskpool = CPLUS_NULL;
+    cplus_pevent evt_done = CPLUS_NULL;
+    struct cplus_taskpool_task task = {0};
+    pthread_t resizer;
+    int32_t executed_count = 0;
+    const int32_t round = 1000;
+
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL != (taskpool = cplus_taskpool_new(8)));
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL != (evt_done = cplus_pevent_new(false, false)));
+    task.proc = count_and_signal;
+    task.param1 = &executed_count;
+    task.param2 = evt_done;
+
+    /* Once every worker is parked, each submission has to hand its task to one of them. */
+    cplus_systime_sleep_msec(100);
+    for (int32_t i = 0; i < round; i++)
+    {
+        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskpool_add_task_ex(taskpool, &task));
+        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_pevent_wait(evt_done, CPLUS_INFINITE_TIMEOUT));
+    }
+    UNITTEST_EXPECT_EQ(round, cplus_atomic_read(&executed_count));
+
+    /* Workers are deleted and created while they are parked and woken up. */
+    is_resizing = true;
+    UNITTEST_EXPECT_EQ(0, pthread_create(&resizer, CPLUS_NULL, resize_worker_count, taskpool));
+    for (int32_t i = 0; i < round; i++)
+    {
+        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskpool_add_task_ex(taskpool, &task));
+        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_pevent_wait(evt_done, CPLUS_INFINITE_TIMEOUT));
+    }
+    is_resizing = false;
+    pthread_join(resizer, CPLUS_NULL);
+    UNITTEST_EXPECT_EQ(2 * round, cplus_atomic_read(&executed_count));
+
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskpool_delete(taskpool));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_pevent_delete(evt_done));
+    UNITTEST_EXPECT_EQ(0, cplus_mgr_report());
+}
+
+CPLUS_UNIT_TEST(cplus_taskpool_add_tasks, functionity)
+{
+    cplus_taskpool taskpool = CPLUS_NULL;
+    struct cplus_taskpool_config config = {0};
+    struct cplus_taskpool_task tasks[100] = {0};
+    int32_t count = 0;
+
+    config.worker_count = 4;
+    config.max_task_count = 150;
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL != (taskpool = cplus_taskpool_new_ex(&config)));
+    for (uint32_t i = 0; i < CPLUS_GET_ARRAY_SIZE(tasks); i++)
+    {
+        tasks[i].proc = acc_proc;
+        tasks[i].param1 = &count;
+    }
+    UNITTEST_EXPECT_EQ(CPLUS_FAIL, cplus_taskpool_add_tasks(taskpool, 0, tasks));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskpool_all_pause(taskpool, true));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskpool_add_tasks(taskpool, 100, tasks));
+    UNITTEST_EXPECT_EQ(100, cplus_taskpool_get_task_count(taskpool));
+    UNITTEST_EXPECT_EQ(CPLUS_FAIL, cplus_taskpool_add_tasks(taskpool, 100, tasks));
+    UNITTEST_EXPECT_EQ(ENOMEM, errno);
+    UNITTEST_EXPECT_EQ(100, cplus_taskpool_get_task_count(taskpool));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskpool_all_pause(taskpool, false));
+    for (int32_t i = 0; i < 100 AND 100 != cplus_atomic_read(&count); i++)
+    {
+        cplus_systime_sleep_msec(10);
+    }
+    UNITTEST_EXPECT_EQ(100, cplus_atomic_read(&count));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskpool_add_tasks(taskpool, 50, tasks));
+    for (int32_t i = 0; i < 100 AND 150 != cplus_atomic_read(&count); i++)
+    {
+        cplus_systime_sleep_msec(10);
+    }
+    UNITTEST_EXPECT_EQ(150, cplus_atomic_read(&count));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskpool_delete(taskpool));
+    UNITTEST_EXPECT_EQ(0, cplus_mgr_report());
+}
+
+static void record_worker_cpu(void * param1, void * param2)
+{
+    cpu_set_t cpu_set;
+    UNUSED_PARAM(param2);
+
+    CPU_ZERO(&cpu_set);
+    pthread_getaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+    if (1 == CPU_COUNT(&cpu_set) AND CPU_ISSET(sched_getcpu(), &cpu_set))
+    {
+        cplus_atomic_add((int32_t *)(param1), 1);
+    }
+}
+
+CPLUS_UNIT_TEST(cplus_taskpool_new_ex, affinity)
+{
+    cplus_taskpool taskpool = CPLUS_NULL;
+    struct cplus_taskpool_config config = {0};
+    uint32_t cpu_list[] = {0};
+    int32_t pinned_count = 0;
+    cpu_set_t cpu_set;
+
+    /* Pin to the first CPU this process may run on, CPU 0 can be excluded by
+    a cgroup or taskset. */
+    CPU_ZERO(&cpu_set);
+    UNITTEST_EXPECT_EQ(0, sched_getaffinity(0, sizeof(cpu_set), &cpu_set));
+    while (cpu_list[0] < MAX_CPU_COUNT AND false == CPU_ISSET(cpu_list[0], &cpu_set))
+    {
+        cpu_list[0] ++;
+    }
+    UNITTEST_EXPECT_EQ(true, MAX_CPU_COUNT > cpu_list[0]);
+
+    config.worker_count = 4;
+    config.max_task_count = 16;
+    config.affinity = CPLUS_TASKPOOL_AFFINITY_EXPLICIT;
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL == cplus_taskpool_new_ex(&config));
+    config.cpu_list = cpu_list;
+    config.cpu_list_count = CPLUS_GET_ARRAY_SIZE(cpu_list);
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL != (taskpool = cplus_taskpool_new_ex(&config)));
+    for (int32_t i = 0; i < 8; i++)
+    {
+        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskpool_add_task(taskpool, record_worker_cpu, &pinned_count));
+    }
+    for (int32_t i = 0; i < 100 AND 8 != cplus_atomic_read(&pinned_count); i++)
+    {
+        cplus_systime_sleep_msec(10);
+    }
+    UNITTEST_EXPECT_EQ(8, pinned_count);
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskpool_reset_worker_count(taskpool, 2));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskpool_reset_worker_count(taskpool, 6));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskpool_delete(taskpool));
+
+    config.cpu_list = CPLUS_NULL;
+    config.cpu_list_count = 0;
+    config.affinity = CPLUS_TASKPOOL_AFFINITY_SCATTER;
+    pinned_count = 0;
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL != (taskpool = cplus_taskpool_new_ex(&config)));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskpool_add_task(taskpool, record_worker_cpu, &pinned_count));
+    for (int32_t i = 0; i < 100 AND 1 != cplus_atomic_read(&pinned_count); i++)
+    {
+        cplus_systime_sleep_msec(10);
+    }
+    UNITTEST_EXPECT_EQ(1, pinned_count);
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskpool_delete(taskpool));
+
+    config.affinity = CPLUS_TASKPOOL_AFFINITY_COMPACT;
+    config.cpu_mask = (1ULL << cpu_list[0]);
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL != (taskpool = cplus_taskpool_new_ex(&config)));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskpool_delete(taskpool));
+    UNITTEST_EXPECT_EQ(0, cplus_mgr_report());
+}
+
+static void sleep_2ms_proc(void * param1, void * param2)
+{
+    UNUSED_PARAM(param1);
+    UNUSED_PARAM(param2);
+    cplus_systime_sleep_msec(2);
+}
+
+CPLUS_UNIT_TEST(cplus_taskpool_get_stats, functionity)
+{
+    cplus_taskpool taskpool = CPLUS_NULL;
+    struct cplus_taskpool_config config = {0};
+    struct cplus_taskpool_task task = {0};
+    struct cplus_taskpool_stats stats = {0};
+    uint64_t executed_count = 0, bucket_count = 0;
+    int32_t count = 0;
+
+    config.worker_count = 2;
+    config.max_task_count = 8;
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL != (taskpool = cplus_taskpool_new_ex(&config)));
+    UNITTEST_EXPECT_EQ(CPLUS_FAIL, cplus_taskpool_get_stats(taskpool, CPLUS_NULL));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskpool_all_pause(taskpool, true));
+    task.proc = sleep_2ms_proc;
+    task.param1 = &count;
+    task.callback = acc_proc;
+    for (int32_t i = 0; i < 8; i++)
+    {
+        UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskpool_add_task_ex(taskpool, &task));
+    }
+    UNITTEST_EXPECT_EQ(CPLUS_FAIL, cplus_taskpool_add_task_ex(taskpool, &task));
+    UNITTEST_EXPECT_EQ(CPLUS_FAIL, cplus_taskpool_add_tasks(taskpool, 1, &task));
+    cplus_systime_sleep_msec(10);
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskpool_all_pause(taskpool, false));
+    for (int32_t i = 0; i < 100 AND 8 != cplus_atomic_read(&count); i++)
+    {
+        cplus_systime_sleep_msec(10);
+    }
+    cplus_systime_sleep_msec(10);
+
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskpool_get_stats(taskpool, &stats));
+    UNITTEST_EXPECT_EQ(8, stats.submitted_count);
+    UNITTEST_EXPECT_EQ(2, stats.rejected_count);
+    UNITTEST_EXPECT_EQ(8, stats.executed_count);
+    UNITTEST_EXPECT_EQ(0, stats.queued_count);
+    UNITTEST_EXPECT_EQ(8, stats.max_queued_count);
+    UNITTEST_EXPECT_EQ(8, stats.wait_time.count);
+    UNITTEST_EXPECT_EQ(8, stats.run_time.count);
+    UNITTEST_EXPECT_EQ(8, stats.callback_time.count);
+    UNITTEST_EXPECT_EQ(true, (stats.wait_time.max_nsec >= (10 * 1000 * 1000)));
+    UNITTEST_EXPECT_EQ(true, (stats.run_time.total_nsec >= (8 * 2 * 1000 * 1000)));
+    UNITTEST_EXPECT_EQ(true, (stats.busy_nsec >= stats.run_time.total_nsec));
+    UNITTEST_EXPECT_EQ(true, (0 < stats.idle_nsec));
+    for (uint32_t i = 0; i < CPLUS_TASKPOOL_HISTOGRAM_BUCKETS; i++)
+    {
+        bucket_count += stats.run_time.buckets[i];
+    }
+    UNITTEST_EXPECT_EQ(8, bucket_count);
+    UNITTEST_EXPECT_EQ(2, stats.worker_count);
+    for (uint32_t i = 0; i < stats.worker_count; i++)
+    {
+        executed_count += stats.workers[i].executed_count;
+    }
+    UNITTEST_EXPECT_EQ(8, executed_count);
+
+    /* The history of a retired worker stays in the pool-wide figures. */
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskpool_reset_worker_count(taskpool, 1));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskpool_get_stats(taskpool, &stats));
+    UNITTEST_EXPECT_EQ(8, stats.executed_count);
+    UNITTEST_EXPECT_EQ(1, stats.worker_count);
+
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskpool_reset_stats(taskpool));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskpool_get_stats(taskpool, &stats));
+    UNITTEST_EXPECT_EQ(0, stats.submitted_count);
+    UNITTEST_EXPECT_EQ(0, stats.rejected_count);
+    UNITTEST_EXPECT_EQ(0, stats.executed_count);
+    UNITTEST_EXPECT_EQ(0, stats.run_time.count);
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskpool_add_task_ex(taskpool, &task));
+    for (int32_t i = 0; i < 100 AND 9 != cplus_atomic_read(&count); i++)
+    {
+        cplus_systime_sleep_msec(10);
+    }
+    cplus_systime_sleep_msec(10);
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskpool_get_stats(taskpool, &stats));
+    UNITTEST_EXPECT_EQ(1, stats.submitted_count);
+    UNITTEST_EXPECT_EQ(1, stats.executed_count);
+    UNITTEST_EXPECT_EQ(1, stats.workers[0].executed_count);
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskpool_delete(taskpool));
+    UNITTEST_EXPECT_EQ(0, cplus_mgr_report());
+}
+
 void unittest_taskpool(void)
 {
     UNITTEST_ADD_TESTCASE(cplus_taskpool_new_ex, functionity);
@@ -657,6 +1408,10 @@ void unittest_taskpool(void)
     UNITTEST_ADD_TESTCASE(cplus_taskpool_get_worker_count, functionity);
     UNITTEST_ADD_TESTCASE(cplus_taskpool_reset_worker_count, functionity);
     UNITTEST_ADD_TESTCASE(cplus_taskpool_all_pause, functionity);
+    UNITTEST_ADD_TESTCASE(cplus_taskpool_add_task_ex, wakeup_parked_worker);
+    UNITTEST_ADD_TESTCASE(cplus_taskpool_add_tasks, functionity);
+    UNITTEST_ADD_TESTCASE(cplus_taskpool_new_ex, affinity);
+    UNITTEST_ADD_TESTCASE(cplus_taskpool_get_stats, functionity);
 }
 
 #endif // __CPLUS_UNITTEST__
\ No newline at end of file
@@ -0,0 +1,704 @@
+/******************************************************************
+* @file: timerwheel.c
+*
+* @author: Hunter Huang <bill.b750121@gmail.com>
+******************************************************************/
+
+#include <time.h>
+#include "common.h"
+#include "cplus_memmgr.h"
+#include "cplus_atomic.h"
+#include "cplus_mutex.h"
+#include "cplus_pevent.h"
+#include "cplus_systime.h"
+#include "cplus_task.h"
+#include "cplus_taskpool.h"
+#include "cplus_timerwheel.h"
+
+#define OBJ_TYPE (OBJ_NONE + SYS + 12)
+#define MAX_TIMER_COUNT 0xFFFFU
+
+/* 4 levels of 64 slots with a 1 msec tick reach 2^24 msec (about 4.6 hours),
+longer delays are parked in the last level and re-cascaded until due. */
+#define WHEEL_LEVEL_COUNT 4U
+#define WHEEL_SLOT_BITS 6U
+#define WHEEL_SLOT_COUNT (1U << WHEEL_SLOT_BITS)
+#define WHEEL_SLOT_MASK (WHEEL_SLOT_COUNT - 1)
+#define WHEEL_MAX_DELTA ((1ULL << (WHEEL_SLOT_BITS * WHEEL_LEVEL_COUNT)) - 1)
+#define PENDING_LEVEL WHEEL_LEVEL_COUNT
+
+#define TIMER_ID_INDEX(ID) (((ID) & 0xFFFFU) - 1)
+#define TIMER_ID_GENERATION(ID) ((uint16_t)((ID) >> 16))
+#define TIMER_ID_MAKE(INDEX, GENERATION) ((((uint32_t)(GENERATION)) << 16) | ((INDEX) + 1))
+
+struct timer_link
+{
+    struct timer_link * prev;
+    struct timer_link * next;
+};
+
+struct timer_node
+{
+    struct timer_link link;
+    uint64_t expire;
+    uint32_t period;
+    uint16_t generation;
+    uint8_t level;
+    uint8_t slot;
+    bool is_armed;
+    CPLUS_TASK_PROC proc;
+    void * param1;
+    void * param2;
+};
+
+struct timerwheel
+{
+    uint16_t type;
+    cplus_taskpool pool;
+    cplus_mutex access_sect;
+    cplus_pevent evt_wakeup;
+    cplus_task executor;
+    volatile bool is_stopping;
+    uint64_t base_msec;
+    uint64_t current_tick;
+    uint64_t wakeup_tick;
+    uint32_t timer_count;
+    uint32_t max_timer_count;
+    struct timer_node * nodes;
+    struct timer_node * free_nodes;
+    uint64_t occupied[WHEEL_LEVEL_COUNT];
+    struct timer_link slots[WHEEL_LEVEL_COUNT][WHEEL_SLOT_COUNT];
+    struct timer_link pending;
+};
+
+static inline uint64_t timerwheel_get_msec(void)
+{
+    struct timespec ts = {0};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)(ts.tv_sec) * 1000) + (ts.tv_nsec / 1000000);
+}
+
+static inline uint64_t timerwheel_get_now_tick(struct timerwheel * tw)
+{
+    return timerwheel_get_msec() - tw->base_msec;
+}
+
+static inline void timer_link_init(struct timer_link * head)
+{
+    head->prev = head;
+    head->next = head;
+}
+
+static inline bool timer_link_is_empty(struct timer_link * head)
+{
+    return (head->next == head);
+}
+
+static inline void timer_link_append(struct timer_link * head, struct timer_link * link)
+{
+    link->prev = head->prev;
+    link->next = head;
+    head->prev->next = link;
+    head->prev = link;
+}
+
+static void timerwheel_unlink(struct timerwheel * tw, struct timer_node * node)
+{
+    struct timer_link * head = CPLUS_NULL;
+
+    node->link.prev->next = node->link.next;
+    node->link.next->prev = node->link.prev;
+    node->link.prev = node->link.next = CPLUS_NULL;
+
+    if (PENDING_LEVEL != node->level)
+    {
+        head = &(tw->slots[node->level][node->slot]);
+        if (timer_link_is_empty(head))
+        {
+            tw->occupied[node->level] &= ~(1ULL << node->slot);
+        }
+    }
+}
+
+static void timerwheel_insert(struct timerwheel * tw, struct timer_node * node)
+{
+    uint64_t delta = (node->expire > tw->current_tick)? (node->expire - tw->current_tick): 0;
+    uint64_t expire = node->expire;
+    uint32_t level = 0;
+
+    if (WHEEL_MAX_DELTA < delta)
+    {
+        expire = tw->current_tick + WHEEL_MAX_DELTA;
+        delta = WHEEL_MAX_DELTA;
+    }
+
+    /* A due timer (delta 0) only shows up while cascading, before the current
+    level 0 slot is collected, so putting it there still fires it on time. */
+    while (level < (WHEEL_LEVEL_COUNT - 1)
+        AND delta >= (1ULL << (WHEEL_SLOT_BITS * (level + 1))))
+    {
+        level ++;
+    }
+
+    node->level = (uint8_t)(level);
+    node->slot = (uint8_t)((expire >> (WHEEL_SLOT_BITS * level)) & WHEEL_SLOT_MASK);
+    timer_link_append(&(tw->slots[level][node->slot]), &(node->link));
+    tw->occupied[level] |= (1ULL << node->slot);
+}
+
+static void timerwheel_cascade(struct timerwheel * tw, uint32_t level, uint32_t slot)
+{
+    struct timer_link list, * link = CPLUS_NULL, * head = &(tw->slots[level][slot]);
+
+    if (timer_link_is_empty(head))
+    {
+        return;
+    }
+
+    /* Detach the whole slot first, re-inserting may land in the same slot
+    when the delay exceeds the reach of the wheel. */
+    list.next = head->next;
+    list.prev = head->prev;
+    list.next->prev = &list;
+    list.prev->next = &list;
+    timer_link_init(head);
+    tw->occupied[level] &= ~(1ULL << slot);
+
+    while (&list != (link = list.next))
+    {
+        list.next = link->next;
+        link->next->prev = &list;
+        timerwheel_insert(tw, (struct timer_node *)(link));
+    }
+}
+
+static void timerwheel_collect_slot(struct timerwheel * tw, uint32_t slot)
+{
+    struct timer_link * head = &(tw->slots[0][slot]), * link = CPLUS_NULL;
+    struct timer_node * node = CPLUS_NULL;
+
+    while (head != (link = head->next))
+    {
+        node = (struct timer_node *)(link);
+        timerwheel_unlink(tw, node);
+        node->level = PENDING_LEVEL;
+        timer_link_append(&(tw->pending), &(node->link));
+    }
+}
+
+static uint64_t timerwheel_get_next_event_tick(struct timerwheel * tw)
+{
+    uint64_t next_tick = UINT64_MAX, index = 0, rotated = 0;
+    uint32_t offset = 0, shift = 0;
+
+    /* The first tick after the current one which collects a level 0 slot or
+    cascades an occupied slot of a higher level, nothing happens before it. */
+    for (uint32_t level = 0; level < WHEEL_LEVEL_COUNT; level++)
+    {
+        if (0 == tw->occupied[level])
+        {
+            continue;
+        }
+        shift = WHEEL_SLOT_BITS * level;
+        index = tw->current_tick >> shift;
+        offset = (uint32_t)((index + 1) & WHEEL_SLOT_MASK);
+        rotated = (tw->occupied[level] >> offset)
+            | ((0 == offset)? 0: (tw->occupied[level] << (WHEEL_SLOT_COUNT - offset)));
+        next_tick = CPLUS_MIN(next_tick, (index + 1 + __builtin_ctzll(rotated)) << shift);
+    }
+    return next_tick;
+}
+
+static void timerwheel_advance(struct timerwheel * tw, uint64_t now_tick)
+{
+    uint32_t level = 0;
+    uint64_t next_tick = 0;
+
+    while (tw->current_tick < now_tick)
+    {
+        /* Jump over the empty ticks, a long idle period costs one step per
+        occupied slot instead of one per tick. */
+        next_tick = timerwheel_get_next_event_tick(tw);
+        if (next_tick > now_tick)
+        {
+            tw->current_tick = now_tick;
+            break;
+        }
+
+        tw->current_tick = next_tick;
+        for (level = 1; level < WHEEL_LEVEL_COUNT; level++)
+        {
+            if (0 != ((tw->current_tick >> (WHEEL_SLOT_BITS * (level - 1))) & WHEEL_SLOT_MASK))
+            {
+                break;
+            }
+        }
+        /* Higher levels first, so their timers can still drop into lower ones. */
+        while (1 < level)
+        {
+            level --;
+            timerwheel_cascade(tw, level
+                , (uint32_t)((tw->current_tick >> (WHEEL_SLOT_BITS * level)) & WHEEL_SLOT_MASK));
+        }
+        timerwheel_collect_slot(tw, (uint32_t)(tw->current_tick & WHEEL_SLOT_MASK));
+    }
+}
+
+static uint64_t timerwheel_get_next_tick(struct timerwheel * tw)
+{
+    if (false == timer_link_is_empty(&(tw->pending)))
+    {
+        return tw->current_tick;
+    }
+    return timerwheel_get_next_event_tick(tw);
+}
+
+static void timerwheel_free_node(struct timerwheel * tw, struct timer_node * node)
+{
+    node->is_armed = false;
+    node->generation ++;
+    node->link.next = (struct timer_link *)(tw->free_nodes);
+    tw->free_nodes = node;
+    tw->timer_count --;
+}
+
+static void timerwheel_fire(struct timerwheel * tw, CPLUS_TASK_PROC proc, void * param1, void * param2)
+{
+    struct cplus_taskpool_task task = {0};
+
+    if (tw->pool)
+    {
+        task.proc = proc;
+        task.param1 = param1;
+        task.param2 = param2;
+        task.callback = CPLUS_NULL;
+        if (CPLUS_SUCCESS == cplus_taskpool_add_task_ex(tw->pool, &task))
+        {
+            return;
+        }
+        /* The pool is saturated, running late on this thread beats dropping it. */
+    }
+    proc(param1, param2);
+}
+
+static void timerwheel_proc(void * param1, void * param2)
+{
+    struct timerwheel * tw = (struct timerwheel *)(param1);
+    struct timer_node * node = CPLUS_NULL;
+    CPLUS_TASK_PROC proc = CPLUS_NULL;
+    void * proc_param1 = CPLUS_NULL, * proc_param2 = CPLUS_NULL;
+    uint64_t now_tick = 0, next_tick = 0;
+    UNUSED_PARAM(param2);
+
+    while (false == tw->is_stopping)
+    {
+        cplus_crit_sect_enter(tw->access_sect);
+        now_tick = timerwheel_get_now_tick(tw);
+        timerwheel_advance(tw, now_tick);
+
+        if (false == timer_link_is_empty(&(tw->pending)))
+        {
+            node = (struct timer_node *)(tw->pending.next);
+            timerwheel_unlink(tw, node);
+            proc = node->proc;
+            proc_param1 = node->param1;
+            proc_param2 = node->param2;
+
+            if (0 < node->period)
+            {
+                /* Re-arm from the scheduled time, not from now, so periods do
+                not drift; periods missed by a late wake-up are skipped. */
+                node->expire += node->period;
+                if (node->expire <= tw->current_tick)
+                {
+                    node->expire += ((tw->current_tick - node->expire) / node->period + 1) * node->period;
+                }
+                timerwheel_insert(tw, node);
+            }
+            else
+            {
+                timerwheel_free_node(tw, node);
+            }
+            cplus_crit_sect_exit(tw->access_sect);
+
+            timerwheel_fire(tw, proc, proc_param1, proc_param2);
+            continue;
+        }
+
+        next_tick = timerwheel_get_next_tick(tw);
+        tw->wakeup_tick = next_tick;
+        cplus_crit_sect_exit(tw->access_sect);
+
+        cplus_pevent_wait(tw->evt_wakeup, (UINT64_MAX == next_tick)
+            ? CPLUS_INFINITE_TIMEOUT: (uint32_t)(next_tick - now_tick));
+    }
+}
+
+int32_t cplus_timerwheel_delete(cplus_timerwheel obj)
+{
+    struct timerwheel * tw = (struct timerwheel *)(obj);
+    CHECK_OBJECT_TYPE(obj);
+
+    if (tw->executor)
+    {
+        tw->is_stopping = true;
+        cplus_pevent_set(tw->evt_wakeup);
+        cplus_task_stop(tw->executor, CPLUS_INFINITE_TIMEOUT);
+    }
+
+    if (tw->evt_wakeup)
+    {
+        cplus_pevent_delete(tw->evt_wakeup);
+    }
+
+    if (tw->access_sect)
+    {
+        cplus_mutex_delete(tw->access_sect);
+    }
+
+    if (tw->nodes)
+    {
+        cplus_free(tw->nodes);
+    }
+
+    cplus_free(tw);
+    return CPLUS_SUCCESS;
+}
+
+static void * timerwheel_initialize_object(uint32_t max_timer_count, cplus_taskpool pool)
+{
+    struct timerwheel * tw = CPLUS_NULL;
+    CPLUS_TASK_CONFIG_T task_config = {0};
+
+    if ((tw = (struct timerwheel *)cplus_malloc(sizeof(struct timerwheel))))
+    {
+        CPLUS_INITIALIZE_STRUCT_POINTER(tw);
+        tw->type = OBJ_TYPE;
+        tw->pool = pool;
+        tw->is_stopping = false;
+        tw->base_msec = timerwheel_get_msec();
+        tw->current_tick = 0;
+        tw->wakeup_tick = UINT64_MAX;
+        tw->timer_count = 0;
+        tw->max_timer_count = max_timer_count;
+
+        for (uint32_t level = 0; level < WHEEL_LEVEL_COUNT; level++)
+        {
+            tw->occupied[level] = 0;
+            for (uint32_t slot = 0; slot < WHEEL_SLOT_COUNT; slot++)
+            {
+                timer_link_init(&(tw->slots[level][slot]));
+            }
+        }
+        timer_link_init(&(tw->pending));
+
+        if (CPLUS_NULL == (tw->nodes = (struct timer_node *)cplus_malloc(
+            max_timer_count * sizeof(struct timer_node))))
+        {
+            goto exit;
+        }
+        cplus_mem_set(tw->nodes, 0x00, max_timer_count * sizeof(struct timer_node));
+        tw->free_nodes = CPLUS_NULL;
+        for (uint32_t i = max_timer_count; i > 0; i--)
+        {
+            tw->nodes[i - 1].link.next = (struct timer_link *)(tw->free_nodes);
+            tw->free_nodes = &(tw->nodes[i - 1]);
+        }
+
+        if (CPLUS_NULL == (tw->access_sect = cplus_mutex_new()))
+        {
+            goto exit;
+        }
+
+        if (CPLUS_NULL == (tw->evt_wakeup = cplus_pevent_new(false, false)))
+        {
+            goto exit;
+        }
+
+        task_config.proc = timerwheel_proc;
+        task_config.param1 = tw;
+        task_config.param2 = CPLUS_NULL;
+        task_config.duration = 0;
+        task_config.suspend = false;
+        if (CPLUS_NULL == (tw->executor = cplus_task_new_ex(&task_config)))
+        {
+            goto exit;
+        }
+    }
+    return tw;
+exit:
+    cplus_timerwheel_delete(tw);
+    return CPLUS_NULL;
+}
+
+cplus_timerwheel cplus_timerwheel_new(uint32_t max_timer_count, cplus_taskpool pool)
+{
+    CHECK_IN_INTERVAL(max_timer_count, 1, MAX_TIMER_COUNT, CPLUS_NULL);
+    CHECK_IF(pool AND false == cplus_taskpool_check(pool), CPLUS_NULL);
+
+    return timerwheel_initialize_object(max_timer_count, pool);
+}
+
+bool cplus_timerwheel_check(cplus_object obj)
+{
+    return (obj && (GET_OBJECT_TYPE(obj) == OBJ_TYPE));
+}
+
+uint32_t cplus_timerwheel_add(
+    cplus_timerwheel obj
+    , uint32_t delay
+    , uint32_t period
+    , CPLUS_TASK_PROC proc
+    , void * param1
+    , void * param2)
+{
+    struct timerwheel * tw = (struct timerwheel *)(obj);
+    struct timer_node * node = CPLUS_NULL;
+    uint32_t timer_id = 0;
+    bool need_wakeup = false;
+    CHECK_OBJECT_TYPE(obj);
+    CHECK_NOT_NULL(proc, 0);
+
+    cplus_crit_sect_enter(tw->access_sect);
+    {
+        if (CPLUS_NULL == (node = tw->free_nodes))
+        {
+            cplus_crit_sect_exit(tw->access_sect);
+            errno = ENOMEM;
+            return 0;
+        }
+        tw->free_nodes = (struct timer_node *)(node->link.next);
+        tw->timer_count ++;
+
+        /* The wheel may lag behind the clock while its thread sleeps, count
+        the delay from now and never from the past. */
+        node->expire = timerwheel_get_now_tick(tw) + CPLUS_MAX(delay, 1U);
+        node->expire = CPLUS_MAX(node->expire, tw->current_tick + 1);
+        node->period = period;
+        node->proc = proc;
+        node->param1 = param1;
+        node->param2 = param2;
+        node->is_armed = true;
+        timerwheel_insert(tw, node);
+
+        timer_id = TIMER_ID_MAKE((uint32_t)(node - tw->nodes), node->generation);
+        if (node->expire < tw->wakeup_tick)
+        {
+            tw->wakeup_tick = node->expire;
+            need_wakeup = true;
+        }
+    }
+    cplus_crit_sect_exit(tw->access_sect);
+
+    if (need_wakeup)
+    {
+        cplus_pevent_set(tw->evt_wakeup);
+    }
+    return timer_id;
+}
+
+int32_t cplus_timerwheel_cancel(cplus_timerwheel obj, uint32_t timer_id)
+{
+    struct timerwheel * tw = (struct timerwheel *)(obj);
+    struct timer_node * node = CPLUS_NULL;
+    int32_t res = CPLUS_FAIL;
+    CHECK_OBJECT_TYPE(obj);
+    CHECK_IN_INTERVAL(TIMER_ID_INDEX(timer_id), 0, tw->max_timer_count - 1, CPLUS_FAIL);
+
+    cplus_crit_sect_enter(tw->access_sect);
+    {
+        node = &(tw->nodes[TIMER_ID_INDEX(timer_id)]);
+        if (node->is_armed AND TIMER_ID_GENERATION(timer_id) == node->generation)
+        {
+            timerwheel_unlink(tw, node);
+            timerwheel_free_node(tw, node);
+            res = CPLUS_SUCCESS;
+        }
+        else
+        {
+            /* Already fired, cancelled or never existed. */
+            errno = ENOENT;
+        }
+    }
+    cplus_crit_sect_exit(tw->access_sect);
+
+    return res;
+}
+
+uint32_t cplus_timerwheel_get_timer_count(cplus_timerwheel obj)
+{
+    uint32_t count = 0;
+    struct timerwheel * tw = (struct timerwheel *)(obj);
+    CHECK_OBJECT_TYPE(obj);
+
+    cplus_crit_sect_enter(tw->access_sect);
+    count = tw->timer_count;
+    cplus_crit_sect_exit(tw->access_sect);
+
+    return count;
+}
+
+#ifdef __CPLUS_UNITTEST__
+
+#define TIMER_TEST_COUNT 2000U
+
+struct timer_record
+{
+    uint64_t added_msec;
+    uint32_t delay;
+    int32_t late_count;
+};
+
+static void count_fired(void * param1, void * param2)
+{
+    cplus_atomic_add((int32_t *)(param1), 1);
+    UNUSED_PARAM(param2);
+}
+
+static void check_fired_on_time(void * param1, void * param2)
+{
+    struct timer_record * record = (struct timer_record *)(param2);
+    uint64_t elapsed = timerwheel_get_msec() - record->added_msec;
+
+    if (elapsed + 1 < record->delay OR elapsed > record->delay + 50)
+    {
+        cplus_atomic_add(&(record->late_count), 1);
+    }
+    cplus_atomic_add((int32_t *)(param1), 1);
+}
+
+CPLUS_UNIT_TEST(cplus_timerwheel_add, functionity)
+{
+    cplus_timerwheel tw = CPLUS_NULL;
+    struct timer_record * records = CPLUS_NULL;
+    int32_t fired = 0, late_count = 0;
+    uint32_t delay = 0;
+
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL == cplus_timerwheel_new(0, CPLUS_NULL));
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL != (tw = cplus_timerwheel_new(TIMER_TEST_COUNT, CPLUS_NULL)));
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL != (records = (struct timer_record *)cplus_malloc(
+        TIMER_TEST_COUNT * sizeof(struct timer_record))));
+    UNITTEST_EXPECT_EQ(0, cplus_timerwheel_add(tw, 10, 0, CPLUS_NULL, CPLUS_NULL, CPLUS_NULL));
+
+    /* Delays span level 0 and level 1 of the wheel. */
+    for (uint32_t i = 0; i < TIMER_TEST_COUNT; i++)
+    {
+        delay = (i * 7919) % 300;
+        records[i].added_msec = timerwheel_get_msec();
+        records[i].delay = delay;
+        records[i].late_count = 0;
+        if (0 == cplus_timerwheel_add(tw, delay, 0, check_fired_on_time, &fired, &(records[i])))
+        {
+            UNITTEST_EXPECT_EQ(true, false);
+            break;
+        }
+    }
+    UNITTEST_EXPECT_EQ(0, cplus_timerwheel_add(tw, 10, 0, count_fired, &fired, CPLUS_NULL));
+    UNITTEST_EXPECT_EQ(ENOMEM, errno);
+
+    for (int32_t i = 0; i < 100 AND TIMER_TEST_COUNT != (uint32_t)cplus_atomic_read(&fired); i++)
+    {
+        cplus_systime_sleep_msec(10);
+    }
+    UNITTEST_EXPECT_EQ(TIMER_TEST_COUNT, (uint32_t)cplus_atomic_read(&fired));
+    UNITTEST_EXPECT_EQ(0, cplus_timerwheel_get_timer_count(tw));
+    for (uint32_t i = 0; i < TIMER_TEST_COUNT; i++)
+    {
+        late_count += records[i].late_count;
+    }
+    UNITTEST_EXPECT_EQ(0, late_count);
+
+    cplus_free(records);
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_timerwheel_delete(tw));
+    UNITTEST_EXPECT_EQ(0, cplus_mgr_report());
+}
+
+CPLUS_UNIT_TEST(cplus_timerwheel_add, periodic_and_cancel)
+{
+    cplus_timerwheel tw = CPLUS_NULL;
+    cplus_taskpool pool = CPLUS_NULL;
+    int32_t periodic_fired = 0, cancelled_fired = 0, long_fired = 0, cascaded_fired = 0;
+    uint32_t periodic_id = 0, cancelled_id = 0, long_id = 0;
+
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL != (pool = cplus_taskpool_new(2)));
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL != (tw = cplus_timerwheel_new(16, pool)));
+
+    UNITTEST_EXPECT_EQ(true, 0 != (periodic_id = cplus_timerwheel_add(tw, 20, 20, count_fired, &periodic_fired, CPLUS_NULL)));
+    UNITTEST_EXPECT_EQ(true, 0 != (cancelled_id = cplus_timerwheel_add(tw, 100, 0, count_fired, &cancelled_fired, CPLUS_NULL)));
+    UNITTEST_EXPECT_EQ(true, 0 != (long_id = cplus_timerwheel_add(tw, 10 * 60 * 1000, 0, count_fired, &long_fired, CPLUS_NULL)));
+    UNITTEST_EXPECT_EQ(true, 0 != cplus_timerwheel_add(tw, 4100, 0, count_fired, &cascaded_fired, CPLUS_NULL));
+    UNITTEST_EXPECT_EQ(4, cplus_timerwheel_get_timer_count(tw));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_timerwheel_cancel(tw, cancelled_id));
+    UNITTEST_EXPECT_EQ(CPLUS_FAIL, cplus_timerwheel_cancel(tw, cancelled_id));
+    UNITTEST_EXPECT_EQ(ENOENT, errno);
+
+    cplus_systime_sleep_msec(1010);
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_timerwheel_cancel(tw, periodic_id));
+    UNITTEST_EXPECT_EQ(true, (45 <= cplus_atomic_read(&periodic_fired) AND 51 >= cplus_atomic_read(&periodic_fired)));
+    UNITTEST_EXPECT_EQ(0, cancelled_fired);
+    UNITTEST_EXPECT_EQ(0, long_fired);
+    UNITTEST_EXPECT_EQ(2, cplus_timerwheel_get_timer_count(tw));
+
+    /* Cascaded down from level 2. */
+    cplus_systime_sleep_msec(3000);
+    UNITTEST_EXPECT_EQ(0, cascaded_fired);
+    cplus_systime_sleep_msec(150);
+    UNITTEST_EXPECT_EQ(1, cascaded_fired);
+    UNITTEST_EXPECT_EQ(1, cplus_timerwheel_get_timer_count(tw));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_timerwheel_cancel(tw, long_id));
+
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_timerwheel_delete(tw));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_taskpool_delete(pool));
+    UNITTEST_EXPECT_EQ(0, cplus_mgr_report());
+}
+
+CPLUS_UNIT_TEST(timerwheel_advance, long_idle)
+{
+    struct timerwheel * tw = CPLUS_NULL;
+    struct timer_link * link = CPLUS_NULL;
+    uint32_t delays[] = {100, 5000, 10 * 60 * 1000, 5 * 3600 * 1000};
+    uint64_t last_expire = 0;
+    int32_t fired = 0, pending_count = 0;
+
+    UNITTEST_EXPECT_EQ(true, CPLUS_NULL != (tw = (struct timerwheel *)cplus_timerwheel_new(8, CPLUS_NULL)));
+    for (uint32_t i = 0; i < CPLUS_GET_ARRAY_SIZE(delays); i++)
+    {
+        UNITTEST_EXPECT_EQ(true, 0 != cplus_timerwheel_add(tw, delays[i], 0, count_fired, &fired, CPLUS_NULL));
+    }
+
+    /* Pretend the wheel slept for 6 hours, every level and the timer beyond
+    the reach of the wheel must come out due and in order. */
+    cplus_crit_sect_enter(tw->access_sect);
+    timerwheel_advance(tw, tw->current_tick + 6ULL * 3600 * 1000);
+    for (link = tw->pending.next; &(tw->pending) != link; link = link->next)
+    {
+        UNITTEST_EXPECT_EQ(true, last_expire <= ((struct timer_node *)(link))->expire);
+        last_expire = ((struct timer_node *)(link))->expire;
+        pending_count ++;
+    }
+    UNITTEST_EXPECT_EQ(CPLUS_GET_ARRAY_SIZE(delays), (uint32_t)pending_count);
+    for (uint32_t level = 0; level < WHEEL_LEVEL_COUNT; level++)
+    {
+        UNITTEST_EXPECT_EQ(0, tw->occupied[level]);
+    }
+    cplus_crit_sect_exit(tw->access_sect);
+    cplus_pevent_set(tw->evt_wakeup);
+
+    for (int32_t i = 0; i < 100 AND pending_count != cplus_atomic_read(&fired); i++)
+    {
+        cplus_systime_sleep_msec(10);
+    }
+    UNITTEST_EXPECT_EQ(pending_count, cplus_atomic_read(&fired));
+    UNITTEST_EXPECT_EQ(0, cplus_timerwheel_get_timer_count(tw));
+    UNITTEST_EXPECT_EQ(CPLUS_SUCCESS, cplus_timerwheel_delete(tw));
+    UNITTEST_EXPECT_EQ(0, cplus_mgr_report());
+}
+
+void unittest_timerwheel(void)
+{
+    UNITTEST_ADD_TESTCASE(cplus_timerwheel_add, functionity);
+    UNITTEST_ADD_TESTCASE(cplus_timerwheel_add, periodic_and_cancel);
+    UNITTEST_ADD_TESTCASE(timerwheel_advance, long_idle);
+}
+
+#endif // __CPLUS_UNITTEST__
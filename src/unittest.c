@@ -150,6 +150,11 @@ extern void unittest_semaphore(void);
 extern void unittest_task(void);
 extern void unittest_mutex(void);
 extern void unittest_taskpool(void);
+extern void unittest_taskgraph(void);
+extern void unittest_parallel(void);
+extern void unittest_timerwheel(void);
+extern void unittest_fiber(void);
+extern void unittest_strand(void);
 extern void unittest_syslog(void);
 extern void unittest_data(void);
 extern void unittest_helper(void);
@@ -191,6 +196,11 @@ int32_t main(void)
     unittest_task();
     unittest_mutex();
     unittest_taskpool();
+    unittest_taskgraph();
+    unittest_parallel();
+    unittest_timerwheel();
+    unittest_fiber();
+    unittest_strand();
     unittest_syslog();
     unittest_data();
     unittest_helper();